@@ -28,6 +28,7 @@
 
 """Python interface to x3270 emulators"""
 
+import collections
 import io
 import os
 import socket
@@ -67,8 +68,47 @@ class StartupException(RuntimeError):
     def __init__(self,msg):
         RuntimeError.__init__(self,msg)
 
+class action_future():
+    """Pending result of an action sent with _session.submit_action()"""
+    def __init__(self,session,argstr):
+        self._session = session
+        self._argstr = argstr
+        self._done = False
+        self._result = None
+        self._exception = None
+
+    def done(self):
+        """Checks for the action being complete
+
+           Returns:
+              bool: True if the response has been read
+        """
+        return self._done
+
+    def result(self):
+        """Waits for the action to complete
+
+           Responses are read in order, so this also completes any actions
+           that were submitted before this one.
+
+           Returns:
+              str: Command output
+                 Mulitiple lines are separated by newline characters.
+           Raises:
+              ActionFailException: Emulator returned an error.
+              EOFError: Emulator exited unexpectedly.
+        """
+        while (not self._done):
+            self._session._read_response()
+        if (self._exception != None): raise self._exception
+        return self._result
+
 class _session():
     """Abstract x3270if session base class"""
+
+    # Maximum number of actions sent without reading their responses
+    max_pending = 64
+
     def __init__(self,debug=False):
         """Initialize an instance
 
@@ -86,6 +126,10 @@ class _session():
         self._to3270 = None
         self._from3270 = None
 
+        # Actions sent, waiting for responses
+        self._pending = collections.deque()
+        self._unflushed = False
+
     def __del__(self):
         self._debug('_session deleted')
 
@@ -113,6 +157,23 @@ class _session():
               ActionFailException: Emulator returned an error.
               EOFError: Emulator exited unexpectedly.
         """
+        return self.submit_action(cmd, *args).result()
+
+    def submit_action(self,cmd,*args):
+        """Send an action to the emulator without waiting for it to complete
+
+           Any number of actions can be sent this way before their results
+           are collected; the emulator runs them in order. The action is not
+           written until a result is needed, or until more than max_pending
+           actions are outstanding, or until flush() is called, so a burst of
+           actions goes out together.
+
+           Args:
+              cmd (str): Action name, as for run_action()
+              args (iterable): Arguments, as for run_action()
+           Returns:
+              action_future: Pending result
+        """
         if (not isinstance(cmd, str)):
             raise TypeError("First argument must be a string")
         self._debug("args is {0}, len is {1}".format(args, len(args)))
@@ -124,25 +185,69 @@ class _session():
         else:
             # Multiple arguments.
             argstr = cmd + '(' + ','.join(quote(str(arg)) for arg in args) + ')'
+        while (len(self._pending) >= self.max_pending):
+            self._read_response()
         self._to3270.write(argstr + '\n')
-        self._to3270.flush()
+        self._unflushed = True
         self._debug('Sent ' + argstr)
+        future = action_future(self, argstr)
+        self._pending.append(future)
+        return future
+
+    def flush(self):
+        """Send any submitted actions that have not been written yet"""
+        if (self._unflushed):
+            self._to3270.flush()
+            self._unflushed = False
+
+    def run_actions(self,actions):
+        """Send a sequence of actions to the emulator, without waiting for
+           each one to complete before sending the next
+
+           Args:
+              actions (iterable): Actions
+                 Each action is either a string, passed through unmodified,
+                 or a tuple or list holding the action name and its
+                 arguments.
+           Returns:
+              list of str: Output from each action
+           Raises:
+              ActionFailException: An action failed. The exception is
+                 raised after all of the responses have been read.
+              EOFError: Emulator exited unexpectedly.
+        """
+        futures = [self.submit_action(a) if isinstance(a, str) else self.submit_action(a[0], *a[1:]) for a in actions]
+        for future in futures:
+            while (not future.done()):
+                self._read_response()
+        return [future.result() for future in futures]
+
+    def _read_response(self):
+        """Read the response to the oldest pending action
+
+           Raises:
+              EOFError: Emulator exited unexpectedly.
+        """
+        self.flush()
         result = ''
         prev = ''
         while (True):
             text = self._from3270.readline().rstrip('\n')
             if (text == ''): raise EOFError('Emulator exited')
             self._debug("Got '" + text + "'")
-            if (text == 'ok'):
-                self._prompt = prev
+            if (text == 'ok' or text == 'error'):
                 break
-            if (text == 'error'):
-                self._prompt = prev
-                raise ActionFailException(result)
-            if (result == ''): result = prev.lstrip('data: ')
-            else: result = result + '\n' + prev.lstrip('data: ')
+            if (prev.startswith('data: ')): prev = prev[6:]
+            if (result == ''): result = prev
+            else: result = result + '\n' + prev
             prev = text
-        return result
+        self._prompt = prev
+        future = self._pending.popleft()
+        if (text == 'error'):
+            future._exception = ActionFailException(result)
+        else:
+            future._result = result
+        future._done = True
 
     def _debug(self,text):
         """Debug output
@@ -68,6 +68,17 @@ main(int argc, char *argv[])
 	Free(e);
     }
 
+    /* Embedded NULs. */
+    {
+	char *b = base64_encode_len("a\0b\0", 4);
+
+	if (verbose) {
+	    printf("'a\\0b\\0' -> '%s'\n", b);
+	}
+	assert(!strcmp(b, "YQBiAA=="));
+	Free(b);
+    }
+
     assert(base64_decode("a=b") == NULL);
     assert(base64_decode("a===") == NULL);
     assert(base64_decode("[") == NULL);
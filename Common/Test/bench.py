@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# Common functions for performance benchmarks
+
+import os
+import re
+import select
+import socket
+import sys
+import threading
+import time
+import Common.Test.cti as cti
+
+def host_records(trace_file:str):
+    '''Return the host-to-emulator data in a trace file, split into records'''
+    records = []
+    accum = b''
+    with open(trace_file, 'r', errors='replace') as f:
+        for line in f:
+            if re.match('^< 0x[0-9a-f]+ +', line):
+                data = bytes.fromhex(line.split()[2])
+                if data.startswith(b'\xff') and not data.startswith(b'\xff\xff'):
+                    # Telnet command, a record of its own.
+                    if accum != b'':
+                        records.append(accum)
+                        accum = b''
+                    records.append(data)
+                    continue
+                accum += data
+                if accum.endswith(b'\xff\xef'):
+                    records.append(accum)
+                    accum = b''
+    if accum != b'':
+        records.append(accum)
+    return records
+
+def replay_stream(trace_file:str, mbytes:int):
+    '''Return the host side of a trace file with its 3270 data records
+       repeated to make up about mbytes megabytes, or None if there are none'''
+    records = host_records(trace_file)
+    data = [r for r in records if r[0] != 0xff and r.endswith(b'\xff\xef')]
+    if data == []:
+        return None
+    body = b''.join(data)
+    return b''.join(records) + body * max(1, (mbytes * 1024 * 1024) // len(body))
+
+def trace_model(trace_file:str):
+    '''Return the model number from a trace file header, or None'''
+    with open(trace_file, 'r', errors='replace') as f:
+        for line in f:
+            m = re.match('^ Model ([0-9]+-[0-9]+(-E)?)', line)
+            if m != None:
+                return m.group(1)
+            if line.startswith(' Data stream:'):
+                break
+    return None
+
+def wait_rusage(child):
+    '''Wait for a child process, returning its CPU time in seconds'''
+    _, status, ru = os.wait4(child.pid, 0)
+    child.returncode = os.waitstatus_to_exitcode(status)
+    return ru.ru_utime + ru.ru_stime
+
+def wait_rusage_rss(child):
+    '''Wait for a child process, returning its CPU time in seconds and its
+       peak resident set size in kilobytes'''
+    _, status, ru = os.wait4(child.pid, 0)
+    child.returncode = os.waitstatus_to_exitcode(status)
+    return (ru.ru_utime + ru.ru_stime, ru.ru_maxrss)
+
+def report(name:str, count:float, units:str, seconds:float):
+    '''Report a benchmark result'''
+    rate = count / seconds if seconds > 0 else float('inf')
+    print(f'bench: {name}: {count:.2f} {units} in {seconds:.3f}s ({rate:.2f} {units}/s)', file=sys.stderr)
+
+def report_memory(name:str, kbytes:int):
+    '''Report peak memory use'''
+    print(f'bench: {name}: peak RSS {kbytes / 1024:.1f} MB', file=sys.stderr)
+
+def report_latency(name:str, times_ns:list):
+    '''Report latency percentiles, given a list of times in nanoseconds'''
+    t = sorted(times_ns)
+    mean = sum(t) / len(t) / 1000
+    p50 = t[len(t) // 2] / 1000
+    p99 = t[(len(t) * 99) // 100] / 1000
+    print(f'bench: {name}: {len(t)} samples, mean {mean:.1f}us, p50 {p50:.1f}us, p99 {p99:.1f}us', file=sys.stderr)
+
+# Host that sends a fixed stream of data to an emulator and drains what the
+# emulator sends back, then synchronizes with a timing mark.
+class streamhost():
+
+    conn = None
+
+    def __init__(self, tc:cti.cti, ipv6=False):
+        self.tc = tc
+        self.listensocket = socket.socket(socket.AF_INET6 if ipv6 else socket.AF_INET, socket.SOCK_STREAM, 0)
+        self.listensocket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listensocket.bind(('::1' if ipv6 else '127.0.0.1', 0))
+        self.port = self.listensocket.getsockname()[1]
+        self.listensocket.listen()
+        self.got_tm = threading.Event()
+
+    def accept(self, timeout=5):
+        '''Accept the emulator connection and start draining its output'''
+        r, _, _ = select.select([self.listensocket], [], [], timeout)
+        self.tc.assertNotEqual([], r, 'Emulator did not connect')
+        (self.conn, _) = self.listensocket.accept()
+        self.listensocket.close()
+        self.thread = threading.Thread(target=self.drain)
+        self.thread.start()
+
+    def drain(self):
+        '''Read emulator output until EOF, watching for a timing mark reply'''
+        tail = b''
+        while True:
+            try:
+                data = self.conn.recv(65536)
+            except OSError:
+                break
+            if data == b'':
+                break
+            tail = (tail + data)[-3:]
+            # Emulators answer WONT TM; pr3287 answers WILL TM.
+            if tail in (b'\xff\xfc\x06', b'\xff\xfb\x06'):
+                self.got_tm.set()
+
+    def send(self, data:bytes, timeout=60):
+        '''Send data to the emulator and wait for it to be processed'''
+        self.got_tm.clear()
+        self.conn.sendall(data)
+        self.conn.sendall(b'\xff\xfd\x06')
+        self.tc.assertTrue(self.got_tm.wait(timeout), 'Emulator did not answer timing mark')
+
+    def close(self):
+        if self.conn != None:
+            self.conn.shutdown(socket.SHUT_RDWR)
+            self.conn.close()
+            self.conn = None
+            self.thread.join(timeout=2)
@@ -55,6 +55,28 @@ def unused_port(ipv6=False):
     s.bind(('::' if ipv6 else '0.0.0.0', 0))
     return (s.getsockname()[1], s)
 
+# Read one HTTP response from a socket.
+# Returns the header, the body and any data that followed the response.
+def http_response(s:socket.socket, buf:bytes):
+    while b'\r\n\r\n' not in buf:
+        data = s.recv(4096)
+        if data == b'':
+            raise EOFError('Connection closed')
+        buf += data
+    header, buf = buf.split(b'\r\n\r\n', 1)
+    header = header.decode()
+    length = 0
+    for line in header.split('\r\n')[1:]:
+        name, value = line.split(':', 1)
+        if name.lower() == 'content-length':
+            length = int(value)
+    while len(buf) < length:
+        data = s.recv(4096)
+        if data == b'':
+            raise EOFError('Connection closed')
+        buf += data
+    return header, buf[:length].decode(), buf[length:]
+
 # Simple socket copy server.
 class copyserver():
 
@@ -78,6 +78,7 @@ static void write_tests(void);
 static void set_tests(void);
 static void iterator_tests(void);
 static void clone_tests(void);
+static void stream_tests(void);
 
 static struct {
     const char *name;
@@ -90,6 +91,7 @@ static struct {
     { "Set", set_tests },
     { "Iterator", iterator_tests },
     { "Clone", clone_tests },
+    { "Stream", stream_tests },
     { NULL, NULL }
 };
 
@@ -1047,3 +1049,115 @@ clone_tests(void)
     json_free(k);
     CLEAN_UP;
 }
+
+/* Incremental parsing tests. */
+static void
+stream_tests(void)
+{
+    json_errcode_t errcode;
+    json_t *j = NULL;
+    json_parse_error_t *e = NULL;
+    json_stream_t *js;
+    size_t consumed;
+    size_t i;
+    size_t length;
+    json_t *l;
+
+    /* Feed a value one byte at a time. */
+#   define TEST_STREAM "{ \"a\": [ 1, \"b\\\"c\", { \"d\": null } ], \"\u00e9\": \"\303\251\360\237\230\200\" }"
+    js = json_stream_init();
+    for (i = 0; i < strlen(TEST_STREAM) - 1; i++) {
+	errcode = json_stream_parse(js, TEST_STREAM + i, 1, &consumed, &j, &e);
+	assert(errcode == JE_INCOMPLETE);
+	assert(consumed == 1);
+	assert(!json_stream_idle(js));
+    }
+    errcode = json_stream_parse(js, TEST_STREAM + i, 1, &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(consumed == 1);
+    assert(json_stream_idle(js));
+    assert(json_is_object(j));
+    assert(json_object_member(j, "a", NT, &l));
+    assert(json_array_length(l) == 3);
+    assert(!strcmp(json_string_value(json_array_element(l, 1), &length),
+		"b\"c"));
+    assert(json_object_member(j, "\303\251", NT, &l));
+    assert(!strcmp(json_string_value(l, &length), "\303\251\360\237\230\200"));
+    json_free(j);
+    json_stream_free(js);
+    CLEAN_UP_BOTH;
+
+    /* Parse a sequence of values from one buffer. */
+#   define TEST_STREAM_SEQ "\"a\" [2]\n{}12 true\n"
+    js = json_stream_init();
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ, strlen(TEST_STREAM_SEQ),
+	    &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(consumed == 3);
+    assert(json_is_string(j));
+    json_free(j);
+    i = consumed;
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ + i,
+	    strlen(TEST_STREAM_SEQ) - i, &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(json_is_array(j));
+    json_free(j);
+    i += consumed;
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ + i,
+	    strlen(TEST_STREAM_SEQ) - i, &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(json_is_object(j));
+    json_free(j);
+    i += consumed;
+
+    /* A number is not complete until something follows it. */
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ + i, 1, &consumed, &j, &e);
+    assert(errcode == JE_INCOMPLETE);
+    i += consumed;
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ + i,
+	    strlen(TEST_STREAM_SEQ) - i, &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(json_integer_value(j) == 12);
+    json_free(j);
+    i += consumed;
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ + i,
+	    strlen(TEST_STREAM_SEQ) - i, &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(json_is_boolean(j));
+    json_free(j);
+    i += consumed;
+    errcode = json_stream_parse(js, TEST_STREAM_SEQ + i,
+	    strlen(TEST_STREAM_SEQ) - i, &consumed, &j, &e);
+    assert(errcode == JE_INCOMPLETE);
+    assert(i + consumed == strlen(TEST_STREAM_SEQ));
+    assert(json_stream_idle(js));
+
+    /* The end of the input completes a number. */
+    errcode = json_stream_parse(js, "-7", 2, &consumed, &j, &e);
+    assert(errcode == JE_INCOMPLETE);
+    errcode = json_stream_end(js, &j, &e);
+    assert(errcode == JE_OK);
+    assert(json_integer_value(j) == -7);
+    json_free(j);
+
+    /* An error is reported with its position, and parsing can resume. */
+    errcode = json_stream_parse(js, "[1,\n 2 3]", 9, &consumed, &j, &e);
+    assert(errcode == JE_SYNTAX);
+    assert(e->line == 4);
+    assert(e->column == 4);
+    json_free_error(e);
+    errcode = json_stream_parse(js, "[3]", 3, &consumed, &j, &e);
+    assert(errcode == JE_OK);
+    assert(json_array_length(j) == 1);
+    json_free(j);
+
+    /* Incomplete input at the end. */
+    errcode = json_stream_parse(js, "{\"a\":", 5, &consumed, &j, &e);
+    assert(errcode == JE_INCOMPLETE);
+    errcode = json_stream_end(js, &j, &e);
+    assert(errcode == JE_INCOMPLETE);
+    json_free_error(e);
+    assert(json_stream_idle(js));
+    json_stream_free(js);
+    CLEAN_UP_BOTH;
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2026 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *      timeout_test.c
+ *              Timeout unit tests and arm/cancel benchmark
+ */
+
+#include "globals.h"
+
+#include <assert.h>
+#include <sys/time.h>
+
+#include "appres.h"
+#include "glue.h"
+#include "task.h"
+#include "trace.h"
+#include "utils.h"
+
+/* Stubs for what XtGlue.o needs from the rest of the library. */
+AppRes appres;
+
+bool
+run_tasks(void)
+{
+    return false;
+}
+
+void
+vtrace(const char *fmt, ...)
+{
+}
+
+void
+xs_warning(const char *fmt, ...)
+{
+}
+
+static void order_test(void);
+static void remove_test(void);
+static void self_remove_test(void);
+
+static struct {
+    const char *name;
+    void (*function)(void);
+} test[] = {
+    { "Order", order_test },
+    { "Remove", remove_test },
+    { "Self-remove", self_remove_test },
+    { NULL, NULL }
+};
+
+#define MAX_FIRED	256
+static int fired[MAX_FIRED];
+static int nfired;
+static ioid_t ids[MAX_FIRED];
+static int nids;
+
+/* Records which timeout fired. */
+static void
+record_fired(ioid_t id)
+{
+    int i;
+
+    for (i = 0; i < nids; i++) {
+	if (ids[i] == id) {
+	    assert(nfired < MAX_FIRED);
+	    fired[nfired++] = i;
+	    return;
+	}
+    }
+    assert(false);
+}
+
+/* Runs events until the expected number of timeouts have fired. */
+static void
+run_until(int count)
+{
+    while (nfired < count) {
+	process_events(true);
+    }
+}
+
+/* Timeouts fire in order of expiration. */
+static void
+order_test(void)
+{
+    static unsigned long interval[] = { 0, 30, 10, 20, 10, 0 };
+    static int expect[] = { 0, 5, 2, 4, 3, 1 };
+    int i;
+
+    nfired = 0;
+    for (nids = 0; nids < (int)array_count(interval); nids++) {
+	ids[nids] = AddTimeOut(interval[nids], record_fired);
+    }
+    run_until(nids);
+    for (i = 0; i < nids; i++) {
+	assert(fired[i] == expect[i]);
+    }
+}
+
+/* Removed timeouts do not fire, and the rest still fire in order. */
+static void
+remove_test(void)
+{
+    int i;
+
+    nfired = 0;
+    for (nids = 0; nids < 100; nids++) {
+	ids[nids] = AddTimeOut((nids % 7) * 5, record_fired);
+    }
+    for (i = 0; i < nids; i += 3) {
+	RemoveTimeOut(ids[i]);
+    }
+    run_until(nids - ((nids + 2) / 3));
+    for (i = 0; i < nfired; i++) {
+	assert(fired[i] % 3 != 0);
+	if (i > 0) {
+	    assert((fired[i - 1] % 7) <= (fired[i] % 7));
+	}
+    }
+}
+
+static ioid_t other_id;
+
+/* Removes itself and another pending timeout. */
+static void
+remove_self(ioid_t id)
+{
+    RemoveTimeOut(id);
+    RemoveTimeOut(other_id);
+    record_fired(id);
+}
+
+/* A timeout can remove itself and others from its callback. */
+static void
+self_remove_test(void)
+{
+    nfired = 0;
+    nids = 0;
+    ids[nids++] = AddTimeOut(0, remove_self);
+    ids[nids++] = other_id = AddTimeOut(10, record_fired);
+    ids[nids++] = AddTimeOut(20, record_fired);
+    run_until(2);
+    assert(fired[0] == 0);
+    assert(fired[1] == 2);
+}
+
+/* Does nothing. */
+static void
+no_fire(ioid_t id)
+{
+    assert(false);
+}
+
+/*
+ * Benchmark: arm and cancel timeouts the way Wait() and Expect() do, with a
+ * population of other timeouts pending.
+ */
+static void
+bench(void)
+{
+#   define BENCH_CYCLES	100000
+#   define BENCH_PENDING	1000
+    ioid_t pending[BENCH_PENDING];
+    struct timeval t0, t1;
+    double us;
+    int i;
+
+    for (i = 0; i < BENCH_PENDING; i++) {
+	pending[i] = AddTimeOut(1000 + (i * 7919) % 10000, no_fire);
+    }
+    gettimeofday(&t0, NULL);
+    for (i = 0; i < BENCH_CYCLES; i++) {
+	RemoveTimeOut(AddTimeOut(6000, no_fire));
+    }
+    gettimeofday(&t1, NULL);
+    for (i = 0; i < BENCH_PENDING; i++) {
+	RemoveTimeOut(pending[i]);
+    }
+    us = (t1.tv_sec - t0.tv_sec) * 1000000.0 + (t1.tv_usec - t0.tv_usec);
+    printf("%d arm/cancel cycles with %d pending: %.3f ms, %.1f ns/cycle\n",
+	    BENCH_CYCLES, BENCH_PENDING, us / 1000.0,
+	    (us * 1000.0) / BENCH_CYCLES);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int i;
+    bool verbose = false;
+
+    if (argc > 1 && !strcmp(argv[1], "-b")) {
+	bench();
+	return 0;
+    }
+    if (argc > 1 && !strcmp(argv[1], "-v")) {
+	verbose = true;
+    }
+
+    /* Loop through the tests. */
+    for (i = 0; test[i].name != NULL; i++) {
+	(*test[i].function)();
+	if (verbose) {
+	    printf("%s test - PASS\n", test[i].name);
+	} else {
+	    printf(".");
+	    fflush(stdout);
+	}
+    }
+
+    /* Success. */
+    printf("\nPASS\n");
+    return 0;
+}
@@ -45,6 +45,7 @@
 
 #include "resources.h"
 
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #include "gdi_print.h"
 #include "names.h"
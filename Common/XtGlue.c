@@ -33,6 +33,7 @@
 #include "glue.h"
 #include "appres.h"
 #include "latin1.h"
+#include "resources.h"
 #include "task.h"
 #include "trace.h"
 #include "txa.h"
@@ -43,6 +44,7 @@
 #endif /*]*/
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,6 +56,9 @@
 #if defined(SEPARATE_SELECT_H) /*[*/
 # include <sys/select.h>
 #endif /*]*/
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+# include <sys/epoll.h>
+#endif /*]*/
 
 #define InputReadMask	0x1
 #define InputExceptMask	0x2
@@ -441,8 +446,15 @@ ms_ts(unsigned long long *u)
 }
 #endif /*]*/
 
+/*
+ * Pending timeouts are kept in a binary min-heap ordered by expiration time.
+ * Each timeout records its position in the heap, so it can be removed without
+ * a search. Timeouts with the same expiration time fire in the order they
+ * were added.
+ */
 typedef struct timeout {
-    struct timeout *next;
+    size_t index;		/* position in the heap */
+    unsigned long seq;		/* order of creation, for ties */
 #if defined(_WIN32) /*[*/
     unsigned long long ts;
 #else /*][*/
@@ -451,18 +463,107 @@ typedef struct timeout {
     tofn_t proc;
     bool in_play;
 } timeout_t;
-static timeout_t *timeouts = NULL;
+static timeout_t **timeouts = NULL;
+static size_t ntimeouts = 0;
+static size_t timeouts_size = 0;
+static unsigned long timeout_seq = 0;
+
+/* Returns true if timeout a expires before timeout b. */
+static bool
+timeout_before(timeout_t *a, timeout_t *b)
+{
+#if defined(_WIN32) /*[*/
+    if (a->ts != b->ts) {
+	return a->ts < b->ts;
+    }
+#else /*][*/
+    if (a->tv.tv_sec != b->tv.tv_sec) {
+	return a->tv.tv_sec < b->tv.tv_sec;
+    }
+    if (a->tv.tv_usec != b->tv.tv_usec) {
+	return a->tv.tv_usec < b->tv.tv_usec;
+    }
+#endif /*]*/
+    return (long)(a->seq - b->seq) < 0;
+}
+
+/* Stores a timeout in the heap. */
+static void
+timeout_set(size_t i, timeout_t *t)
+{
+    timeouts[i] = t;
+    t->index = i;
+}
+
+/* Moves a timeout towards the root of the heap. */
+static void
+timeout_sift_up(size_t i)
+{
+    timeout_t *t = timeouts[i];
+
+    while (i > 0) {
+	size_t parent = (i - 1) / 2;
+
+	if (!timeout_before(t, timeouts[parent])) {
+	    break;
+	}
+	timeout_set(i, timeouts[parent]);
+	i = parent;
+    }
+    timeout_set(i, t);
+}
+
+/* Moves a timeout away from the root of the heap. */
+static void
+timeout_sift_down(size_t i)
+{
+    timeout_t *t = timeouts[i];
+
+    for (;;) {
+	size_t child = (2 * i) + 1;
+
+	if (child >= ntimeouts) {
+	    break;
+	}
+	if (child + 1 < ntimeouts &&
+		timeout_before(timeouts[child + 1], timeouts[child])) {
+	    child++;
+	}
+	if (!timeout_before(timeouts[child], t)) {
+	    break;
+	}
+	timeout_set(i, timeouts[child]);
+	i = child;
+    }
+    timeout_set(i, t);
+}
+
+/* Takes a timeout out of the heap. */
+static void
+timeout_unlink(timeout_t *t)
+{
+    size_t i = t->index;
+    timeout_t *last = timeouts[--ntimeouts];
+
+    if (last != t) {
+	timeout_set(i, last);
+	if (i > 0 && timeout_before(last, timeouts[(i - 1) / 2])) {
+	    timeout_sift_up(i);
+	} else {
+	    timeout_sift_down(i);
+	}
+    }
+}
 
 ioid_t
 AddTimeOut(unsigned long interval_ms, tofn_t proc)
 {
     timeout_t *t_new;
-    timeout_t *t;
-    timeout_t *prev = NULL;
 
     t_new = (timeout_t *)Malloc(sizeof(timeout_t));
     t_new->proc = proc;
     t_new->in_play = false;
+    t_new->seq = timeout_seq++;
 #if defined(_WIN32) /*[*/
     ms_ts(&t_new->ts);
     t_new->ts += interval_ms;
@@ -470,38 +571,20 @@ AddTimeOut(unsigned long interval_ms, tofn_t proc)
     gettimeofday(&t_new->tv, NULL);
     t_new->tv.tv_sec += interval_ms / 1000L;
     t_new->tv.tv_usec += (interval_ms % 1000L) * 1000L;
-    if (t_new->tv.tv_usec > MILLION) {
+    if (t_new->tv.tv_usec >= MILLION) {
 	t_new->tv.tv_sec += t_new->tv.tv_usec / MILLION;
 	t_new->tv.tv_usec %= MILLION;
     }
 #endif /*]*/
 
-    /* Find where to insert this item. */
-    for (t = timeouts; t != NULL; t = t->next) {
-#if defined(_WIN32) /*[*/
-	if (t->ts > t_new->ts)
-#else /*][*/
-	if (t->tv.tv_sec > t_new->tv.tv_sec ||
-	    (t->tv.tv_sec == t_new->tv.tv_sec &&
-	     t->tv.tv_usec > t_new->tv.tv_usec))
-#endif /*]*/
-	{
-	    break;
-	}
-	prev = t;
-    }
-
     /* Insert it. */
-    if (prev == NULL) {	/* Front. */
-	t_new->next = timeouts;
-	timeouts = t_new;
-    } else if (t == NULL) {	/* Rear. */
-	t_new->next = NULL;
-	prev->next = t_new;
-    } else {			/* Middle. */
-	t_new->next = t;
-	prev->next = t_new;
+    if (ntimeouts >= timeouts_size) {
+	timeouts_size = timeouts_size? (2 * timeouts_size): 16;
+	timeouts = (timeout_t **)Realloc(timeouts,
+		timeouts_size * sizeof(timeout_t *));
     }
+    timeouts[ntimeouts] = t_new;
+    timeout_sift_up(ntimeouts++);
 
     return (ioid_t)t_new;
 }
@@ -510,69 +593,273 @@ void
 RemoveTimeOut(ioid_t timer)
 {
     timeout_t *st = (timeout_t *)timer;
-    timeout_t *t;
-    timeout_t *prev = NULL;
 
     if (st->in_play) {
 	return;
     }
-    for (t = timeouts; t != NULL; t = t->next) {
-	if (t == st) {
-	    if (prev != NULL) {
-		prev->next = t->next;
-	    } else {
-		timeouts = t->next;
-	    }
-	    Free(t);
-	    return;
-	}
-	prev = t;
+    if (st->index < ntimeouts && timeouts[st->index] == st) {
+	timeout_unlink(st);
+	Free(st);
     }
 }
 
 /* Input events. */ 
 typedef struct input {  
     struct input *next;
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+    struct input *fd_next;	/* next input for the same fd */
+#endif /*]*/
     iosrc_t source; 
     int condition;
     iofn_t proc;
 } input_t;          
 static input_t *inputs = NULL;
+static int ninputs = 0;
 static bool inputs_changed = false;
 
-ioid_t
-AddInput(iosrc_t source, iofn_t fn)
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+/*
+ * epoll support.
+ *
+ * Inputs are indexed by file descriptor, and each file descriptor is
+ * registered with epoll once, with the union of the conditions its inputs
+ * are waiting for. Registrations persist across calls to
+ * process_some_events(), and are only changed by AddInput, AddExcept,
+ * AddOutput and RemoveInput.
+ */
+#define EPOLL_MAX_EVENTS	64
+
+typedef struct {
+    input_t *inputs;		/* inputs for this fd */
+    uint32_t events;		/* events registered with epoll */
+    bool always_ready;		/* fd can't be polled (e.g., a regular file) */
+} epoll_fd_t;
+
+static enum {
+    EB_UNKNOWN,			/* not decided yet */
+    EB_SELECT,			/* use select() */
+    EB_EPOLL			/* use epoll_wait() */
+} event_backend = EB_UNKNOWN;
+static int epoll_fd = -1;
+static epoll_fd_t *epoll_fds = NULL;
+static int epoll_fds_size = 0;
+static int epoll_always_ready = 0;
+
+/*
+ * Compute the epoll events for the inputs on a file descriptor.
+ */
+static uint32_t
+epoll_events(int fd)
 {
     input_t *ip;
+    uint32_t events = 0;
 
-    assert(source != INVALID_IOSRC);
+    for (ip = epoll_fds[fd].inputs; ip != NULL; ip = ip->fd_next) {
+	if (ip->condition & InputReadMask) {
+	    events |= EPOLLIN;
+	}
+	if (ip->condition & InputWriteMask) {
+	    events |= EPOLLOUT;
+	}
+	if (ip->condition & InputExceptMask) {
+	    events |= EPOLLPRI;
+	}
+    }
+    return events;
+}
+
+/*
+ * Bring the epoll registration for a file descriptor up to date.
+ */
+static void
+epoll_update(int fd)
+{
+    epoll_fd_t *f = &epoll_fds[fd];
+    uint32_t events = epoll_events(fd);
+    struct epoll_event ev;
+    int rv;
+
+    if (f->always_ready) {
+	if (!events) {
+	    f->always_ready = false;
+	    epoll_always_ready--;
+	}
+	f->events = events;
+	return;
+    }
+    if (events == f->events) {
+	return;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    if (!events) {
+	/* This fails harmlessly if the fd has already been closed. */
+	(void) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+	f->events = 0;
+	return;
+    }
+
+    rv = epoll_ctl(epoll_fd, f->events? EPOLL_CTL_MOD: EPOLL_CTL_ADD, fd,
+	    &ev);
+    if (rv < 0 && errno == ENOENT) {
+	/* The fd was closed and re-opened. */
+	rv = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    } else if (rv < 0 && errno == EEXIST) {
+	rv = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    }
+    if (rv < 0) {
+	if (errno == EPERM) {
+	    /* Regular files can't be polled, but are always ready. */
+	    f->always_ready = true;
+	    epoll_always_ready++;
+	} else {
+	    xs_warning("epoll_ctl(%d) failed: %s", fd, strerror(errno));
+	}
+    }
+    f->events = events;
+}
+
+/*
+ * Add an input to the per-fd index.
+ */
+static void
+epoll_link(input_t *ip)
+{
+    int fd = ip->source;
+
+    if (fd >= epoll_fds_size) {
+	int new_size = epoll_fds_size? epoll_fds_size: 64;
+
+	while (new_size <= fd) {
+	    new_size *= 2;
+	}
+	epoll_fds = (epoll_fd_t *)Realloc(epoll_fds,
+		new_size * sizeof(epoll_fd_t));
+	memset(epoll_fds + epoll_fds_size, 0,
+		(new_size - epoll_fds_size) * sizeof(epoll_fd_t));
+	epoll_fds_size = new_size;
+    }
+    ip->fd_next = epoll_fds[fd].inputs;
+    epoll_fds[fd].inputs = ip;
+    if (epoll_fd != -1) {
+	epoll_update(fd);
+    }
+}
+
+/*
+ * Remove an input from the per-fd index.
+ */
+static void
+epoll_unlink(input_t *ip)
+{
+    input_t **ipp;
+
+    for (ipp = &epoll_fds[ip->source].inputs; *ipp != NULL;
+	    ipp = &(*ipp)->fd_next) {
+	if (*ipp == ip) {
+	    *ipp = ip->fd_next;
+	    break;
+	}
+    }
+    if (epoll_fd != -1) {
+	epoll_update(ip->source);
+    }
+}
+
+/*
+ * (Re-)create the epoll set from the per-fd index.
+ * Returns true for success.
+ */
+static bool
+epoll_init(void)
+{
+    int fd;
+
+    if (epoll_fd != -1) {
+	close(epoll_fd);
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+	xs_warning("epoll_create1 failed: %s", strerror(errno));
+	return false;
+    }
+    epoll_always_ready = 0;
+    for (fd = 0; fd < epoll_fds_size; fd++) {
+	epoll_fds[fd].events = 0;
+	epoll_fds[fd].always_ready = false;
+	epoll_update(fd);
+    }
+    return true;
+}
+
+/*
+ * Decide which event backend to use.
+ * Returns true if epoll is in use.
+ */
+static bool
+epoll_active(void)
+{
+    if (event_backend != EB_UNKNOWN) {
+	return event_backend == EB_EPOLL;
+    }
+
+    event_backend = EB_EPOLL;
+    if (appres.event_backend != NULL) {
+	if (!strcasecmp(appres.event_backend, "select")) {
+	    event_backend = EB_SELECT;
+	} else if (strcasecmp(appres.event_backend, "epoll")) {
+	    xs_warning("Unknown %s '%s', using epoll", ResEventBackend,
+		    appres.event_backend);
+	}
+    }
+    if (event_backend == EB_EPOLL && !epoll_init()) {
+	event_backend = EB_SELECT;
+    }
+    vtrace("Event backend is %s\n",
+	    (event_backend == EB_EPOLL)? "epoll": "select");
+    return event_backend == EB_EPOLL;
+}
+#endif /*]*/
+
+/*
+ * Add an input to the list.
+ */
+static ioid_t
+add_input(iosrc_t source, int condition, iofn_t fn)
+{
+    input_t *ip;
 
     ip = (input_t *)Malloc(sizeof(input_t));
     ip->source = source;
-    ip->condition = InputReadMask;
+    ip->condition = condition;
     ip->proc = fn;
     ip->next = inputs;
     inputs = ip;
+    ninputs++;
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+    epoll_link(ip);
+#endif /*]*/
     inputs_changed = true;
     return (ioid_t)ip;
 }
 
+ioid_t
+AddInput(iosrc_t source, iofn_t fn)
+{
+    assert(source != INVALID_IOSRC);
+
+    return add_input(source, InputReadMask, fn);
+}
+
 ioid_t
 AddExcept(iosrc_t source, iofn_t fn)
 {
 #if defined(_WIN32) /*[*/
     return 0;
 #else /*][*/
-    input_t *ip;
-
-    ip = (input_t *)Malloc(sizeof(input_t));
-    ip->source = source;
-    ip->condition = InputExceptMask;
-    ip->proc = fn;
-    ip->next = inputs;
-    inputs = ip;
-    inputs_changed = true;
-    return (ioid_t)ip;
+    return add_input(source, InputExceptMask, fn);
 #endif /*]*/
 }
 
@@ -580,16 +867,7 @@ AddExcept(iosrc_t source, iofn_t fn)
 ioid_t
 AddOutput(iosrc_t source, iofn_t fn)
 {
-    input_t *ip;
-
-    ip = (input_t *)Malloc(sizeof(input_t));
-    ip->source = source;
-    ip->condition = InputWriteMask;
-    ip->proc = fn;
-    ip->next = inputs;
-    inputs = ip;
-    inputs_changed = true;
-    return (ioid_t)ip;
+    return add_input(source, InputWriteMask, fn);
 }
 #endif /*]*/
 
@@ -613,6 +891,10 @@ RemoveInput(ioid_t id)
     } else {
 	inputs = ip->next;
     }
+    ninputs--;
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+    epoll_unlink(ip);
+#endif /*]*/
     Free(ip);
     inputs_changed = true;
 }
@@ -681,6 +963,11 @@ poll_children(void)
 #define MAX_HA	256
 #endif /*]*/
 
+static void expire_timeouts(bool *processed_any);
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+static bool process_some_epoll_events(bool block, bool *processed_any);
+#endif /*]*/
+
 /*
  * Inner event dispatcher.
  * Processes one or more pending I/O and timeout events.
@@ -709,7 +996,6 @@ process_some_events(bool block, bool *processed_any)
     struct timeval now, twait, *tp;
 #endif /*]*/
     input_t *ip, *ip_next;
-    struct timeout *t;
     bool any_events_pending;
 
 #   if defined(_WIN32) /*[*/
@@ -726,6 +1012,12 @@ process_some_events(bool block, bool *processed_any)
 			      t->tv.tv_usec < now.tv_usec))
 #   endif /*]*/
 
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+    if (epoll_active()) {
+	return process_some_epoll_events(block, processed_any);
+    }
+#endif /*]*/
+
     *processed_any = false;
 
     any_events_pending = false;
@@ -767,18 +1059,18 @@ process_some_events(bool block, bool *processed_any)
     }
 
     if (block) {
-	if (timeouts != NULL) {
+	if (ntimeouts) {
 	    /* Compute how long to wait for the first event. */
 	    GET_TS(&now);
 #if defined(_WIN32) /*[*/
-	    if (now > timeouts->ts) {
+	    if (now > timeouts[0]->ts) {
 		tmo = 0;
 	    } else {
-		tmo = (DWORD)(timeouts->ts - now);
+		tmo = (DWORD)(timeouts[0]->ts - now);
 	    }
 #else /*][*/
-	    twait.tv_sec = timeouts->tv.tv_sec - now.tv_sec;
-	    twait.tv_usec = timeouts->tv.tv_usec - now.tv_usec;
+	    twait.tv_sec = timeouts[0]->tv.tv_sec - now.tv_sec;
+	    twait.tv_usec = timeouts[0]->tv.tv_usec - now.tv_usec;
 	    if (twait.tv_usec < 0L) {
 		twait.tv_sec--;
 		twait.tv_usec += MILLION;
@@ -920,24 +1212,181 @@ process_some_events(bool block, bool *processed_any)
     }
 
     /* See what's expired. */
-    if (timeouts != NULL) {
-	GET_TS(&now);
-	while ((t = timeouts) != NULL) {
-	    if (EXPIRED(t, now)) {
-		timeouts = t->next;
-		t->in_play = true;
-		(*t->proc)((ioid_t)t);
-		*processed_any = true;
-		Free(t);
-	    } else {
-		break;
+    expire_timeouts(processed_any);
+
+    /* If inputs have changed, retry. */
+    return !inputs_changed;
+}
+
+/*
+ * Run the timeouts that have expired.
+ */
+static void
+expire_timeouts(bool *processed_any)
+{
+#if defined(_WIN32) /*[*/
+    unsigned long long now;
+#else /*][*/
+    struct timeval now;
+#endif /*]*/
+    timeout_t *t;
+
+    if (!ntimeouts) {
+	return;
+    }
+
+    GET_TS(&now);
+    while (ntimeouts) {
+	t = timeouts[0];
+	if (EXPIRED(t, now)) {
+	    timeout_unlink(t);
+	    t->in_play = true;
+	    (*t->proc)((ioid_t)t);
+	    *processed_any = true;
+	    Free(t);
+	} else {
+	    break;
+	}
+    }
+}
+
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+/*
+ * Dispatch the inputs on one file descriptor.
+ * Returns false if the set of inputs changed.
+ */
+static bool
+epoll_dispatch(int fd, uint32_t revents, bool *processed_any)
+{
+    input_t *ip, *ip_next;
+
+    for (ip = epoll_fds[fd].inputs; ip != NULL; ip = ip_next) {
+	ip_next = ip->fd_next;
+	if (((ip->condition & InputReadMask) &&
+		    (revents & (EPOLLIN | EPOLLHUP | EPOLLERR))) ||
+		((ip->condition & InputWriteMask) &&
+		    (revents & (EPOLLOUT | EPOLLHUP | EPOLLERR))) ||
+		((ip->condition & InputExceptMask) &&
+		    (revents & EPOLLPRI))) {
+	    (*ip->proc)(ip->source, (ioid_t)ip);
+	    *processed_any = true;
+	    if (inputs_changed) {
+		/* Other events may no longer be valid. Try again. */
+		return false;
+	    }
+	}
+    }
+    return true;
+}
+
+/*
+ * Inner event dispatcher, epoll version.
+ * Same semantics as process_some_events.
+ */
+static bool
+process_some_epoll_events(bool block, bool *processed_any)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int timeout_ms;
+    int ns;
+    int i;
+    bool stale = false;
+
+    *processed_any = false;
+
+    if (block) {
+	if (ntimeouts) {
+	    struct timeval now;
+	    long long ms;
+
+	    /* Compute how long to wait for the first event, rounding up. */
+	    gettimeofday(&now, NULL);
+	    ms = (timeouts[0]->tv.tv_sec - now.tv_sec) * 1000LL +
+		(timeouts[0]->tv.tv_usec - now.tv_usec + 999) / 1000;
+	    timeout_ms = (ms < 0)? 0: ((ms > INT_MAX)? INT_MAX: (int)ms);
+	} else {
+	    /* Block infinitely. */
+	    timeout_ms = -1;
+	}
+    } else {
+	/* Don't block. */
+	timeout_ms = 0;
+    }
+    if (epoll_always_ready) {
+	timeout_ms = 0;
+    }
+
+    /* Poll for children. */
+    if (poll_children()) {
+	return false;
+    }
+
+    /* If there's nothing to do now, we're done. */
+    if (!ninputs && !(block && ntimeouts)) {
+	return true;
+    }
+
+    /* Wait for events. */
+    if (timeout_ms < 0) {
+	vtrace("Waiting for %d event%s\n", ninputs, (ninputs == 1)? "": "s");
+    } else {
+	vtrace("Waiting for %d event%s or %d.%03ds\n", ninputs,
+		(ninputs == 1)? "": "s", timeout_ms / 1000, timeout_ms % 1000);
+    }
+    ns = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeout_ms);
+    if (ns < 0) {
+	if (errno != EINTR) {
+	    xs_warning("process_events: epoll_wait() failed: %s",
+		    strerror(errno));
+	}
+	return true;
+    }
+    vtrace("Got %u event%s\n", ns + epoll_always_ready,
+	    (ns + epoll_always_ready == 1)? "": "s");
+
+    inputs_changed = false;
+
+    /* Process the event(s) that occurred. */
+    for (i = 0; i < ns; i++) {
+	int fd = events[i].data.fd;
+
+	if (fd >= epoll_fds_size || epoll_fds[fd].inputs == NULL) {
+	    /*
+	     * Nothing is waiting for this fd. It was closed without being
+	     * removed first, and the registration lives on because another
+	     * process shares it.
+	     */
+	    stale = true;
+	    continue;
+	}
+	if (!epoll_dispatch(fd, events[i].events, processed_any)) {
+	    return false;
+	}
+    }
+    if (epoll_always_ready) {
+	int fd;
+
+	for (fd = 0; fd < epoll_fds_size; fd++) {
+	    if (epoll_fds[fd].always_ready &&
+		    !epoll_dispatch(fd, EPOLLIN | EPOLLOUT, processed_any)) {
+		return false;
 	    }
 	}
     }
+    if (stale) {
+	vtrace("Stale epoll registration, rebuilding\n");
+	if (!epoll_init()) {
+	    event_backend = EB_SELECT;
+	}
+    }
+
+    /* See what's expired. */
+    expire_timeouts(processed_any);
 
     /* If inputs have changed, retry. */
     return !inputs_changed;
 }
+#endif /*]*/
 
 /*
  * Event dispatcher.
@@ -81,20 +81,31 @@ typedef struct {
 } screen_t;
 
 /* Row-difference region. */
-typedef struct _rowdiff {
-    struct _rowdiff *next;
+typedef struct {
     int start_col;
     int width;
     enum { RD_ATTR, RD_TEXT } reason;
 } rowdiff_t;
 
+/* Rendering state from the governing field attribute. */
+typedef struct {
+    unsigned char fa;	/* field attribute */
+    int fg;		/* foreground color */
+    int bg;		/* background color */
+    int gr;		/* graphic rendition */
+    bool high;		/* highlighted */
+} fa_state_t;
+
 static int saved_rows = 0;
 static int saved_cols = 0;
 static int last_rows = 0;
 static int last_cols = 0;
 static struct ea *saved_ea = NULL;
 static screen_t *saved_s = NULL;
+static screen_t *new_s = NULL;
 static bool saved_ea_is_empty = false;
+static bool render_all = true;
+static rowdiff_t *rowdiffs = NULL;
 
 static int sent_baddr = 0;
 static int saved_baddr = 0;
@@ -182,13 +193,26 @@ see_gr(u_short gr)
     return txdFree(vb_consume(&r));
 }
 
+/* Fill a region of a rendered screen with blanks, blue on black. */
+static void
+blank_screen(screen_t *s, int count)
+{
+    int i;
+
+    memset(s, 0, count * sizeof(screen_t));
+    for (i = 0; i < count; i++) {
+	s[i].ccode = ' ';
+	s[i].fg = mode3279? HOST_COLOR_BLUE: HOST_COLOR_NEUTRAL_WHITE;
+	s[i].bg = HOST_COLOR_NEUTRAL_BLACK;
+    }
+}
+
 /* Save empty screen state. */
 static void
 save_empty(void)
 {
     size_t se = ROWS * COLS * sizeof(struct ea);
     size_t ss = maxROWS * maxCOLS * sizeof(screen_t);
-    int i;
 
     /* Zero saved_ea. */
     Replace(saved_ea, (struct ea *)Malloc(se));
@@ -199,12 +223,14 @@ save_empty(void)
 
     /* Erase saved_s. */
     Replace(saved_s, (screen_t *)Malloc(ss));
-    memset(saved_s, 0, ss);
-    for (i = 0; i < maxROWS * maxCOLS; i++) {
-	saved_s[i].ccode = ' ';
-	saved_s[i].fg = mode3279? HOST_COLOR_BLUE: HOST_COLOR_NEUTRAL_WHITE;
-	saved_s[i].bg = HOST_COLOR_NEUTRAL_BLACK;
-    }
+    blank_screen(saved_s, maxROWS * maxCOLS);
+
+    /* Allocate the new screen and the row diffs. */
+    Replace(new_s, (screen_t *)Malloc(ss));
+    Replace(rowdiffs, (rowdiff_t *)Malloc(maxCOLS * sizeof(rowdiff_t)));
+
+    /* The next update needs to look at everything. */
+    render_all = true;
 }
 
 /* Emit an erase indication. */
@@ -347,51 +373,49 @@ uncircle(unsigned long uc)
     return 'A' + (uc - CIRCLED_A);
 }
 
+/* Compute the rendering state for a field attribute. */
+static void
+get_fa_state(struct ea *ea, fa_state_t *fs)
+{
+    fs->fa = ea->fa;
+    if (ea->fg) {
+	fs->fg = ea->fg & 0x0f;
+    } else {
+	fs->fg = color_from_fa(fs->fa);
+    }
+    if (ea->bg) {
+	fs->bg = ea->bg & 0x0f;
+    } else {
+	fs->bg = HOST_COLOR_NEUTRAL_BLACK;
+    }
+    if (ea->gr & GR_INTENSIFY) {
+	fs->high = true;
+    } else {
+	fs->high = FA_IS_HIGH(fs->fa);
+    }
+    fs->gr = ea->gr;
+}
+
 /*
  * Render the screen into a buffer.
  *
  * ea: ROWS*COLS screen buffer to render
  * s: maxROWS*maxCOLS screen_t to render into
+ * rows: rows to render, or NULL to render all of them
  */
-void
-render_screen(struct ea *ea, screen_t *s)
+static void
+render_screen(struct ea *ea, screen_t *s, const bool *rows)
 {
     int i;
     ucs4_t uc;
-    int fa_addr = find_field_attribute(0);
-    unsigned char fa = ea[fa_addr].fa;
-    int fa_fg;
-    int fa_bg;
-    int fa_gr;
-    bool fa_high;
-
-    /* Start with all blanks, blue on black. */
-    memset(s, 0, maxROWS * maxCOLS * sizeof(screen_t));
-    for (i = 0; i < maxROWS * maxCOLS; i++) {
-	s[i].ccode = ' ';
-	s[i].fg = mode3279? HOST_COLOR_BLUE : HOST_COLOR_NEUTRAL_WHITE;
-	s[i].bg = HOST_COLOR_NEUTRAL_BLACK;
-    }
+    fa_state_t fs;
 
-    if (ea[fa_addr].fg) {
-	fa_fg = ea[fa_addr].fg & 0x0f;
-    } else {
-	fa_fg = color_from_fa(fa);
+    if (rows == NULL) {
+	/* Start with all blanks, blue on black. */
+	blank_screen(s, maxROWS * maxCOLS);
     }
 
-    if (ea[fa_addr].bg) {
-	fa_bg = ea[fa_addr].bg & 0x0f;
-    } else {
-	fa_bg = HOST_COLOR_NEUTRAL_BLACK;
-    }
-
-    if (ea[fa_addr].gr & GR_INTENSIFY) {
-	fa_high = true;
-    } else {
-	fa_high = FA_IS_HIGH(fa);
-    }
-
-    fa_gr = ea[fa_addr].gr;
+    get_fa_state(&ea[find_field_attribute(0)], &fs);
 
     for (i = 0; i < ROWS * COLS; i++) {
 	int fg_color, bg_color;
@@ -402,28 +426,31 @@ render_screen(struct ea *ea, screen_t *s)
 	bool pua = false;
 	bool no_copy = false;
 
+	if (rows != NULL && !(i % COLS)) {
+	    int row = i / COLS;
+
+	    if (!rows[row]) {
+		int j;
+
+		/* Skip the row, but keep track of the field attribute. */
+		for (j = i + COLS - 1; j >= i; j--) {
+		    if (ea[j].fa) {
+			get_fa_state(&ea[j], &fs);
+			break;
+		    }
+		}
+		i += COLS - 1;
+		continue;
+	    }
+	    blank_screen(s + (row * maxCOLS), maxCOLS);
+	}
+
 	uc = 0;
 
 	if (ea[i].fa) {
 	    uc = ' ';
-	    fa = ea[i].fa;
-	    if (ea[i].fg) {
-		fa_fg = ea[i].fg & 0x0f;
-	    } else {
-		fa_fg = color_from_fa(fa);
-	    }
-	    if (ea[i].bg) {
-		fa_bg = ea[i].bg & 0x0f;
-	    } else {
-		fa_bg = HOST_COLOR_NEUTRAL_BLACK;
-	    }
-	    if (ea[i].gr & GR_INTENSIFY) {
-		fa_high = true;
-	    } else {
-		fa_high = FA_IS_HIGH(fa);
-	    }
-	    fa_gr = ea[i].gr;
-	} else if (FA_IS_ZERO(fa)) {
+	    get_fa_state(&ea[i], &fs);
+	} else if (FA_IS_ZERO(fs.fa)) {
 	    if (ctlr_dbcs_state(i) == DBCS_LEFT) {
 		uc = 0x3000;
 		dbcs = true;
@@ -528,14 +555,14 @@ render_screen(struct ea *ea, screen_t *s)
 	if (ea[i].fg) {
 	    fg_color = ea[i].fg & 0x0f;
 	} else {
-	    fg_color = fa_fg;
+	    fg_color = fs.fg;
 	}
 	if (ea[i].bg) {
 	    bg_color = ea[i].bg & 0x0f;
 	} else {
-	    bg_color = fa_bg;
+	    bg_color = fs.bg;
 	}
-	if (!ea[i].fa && ((fa_gr | ea[i].gr) & GR_REVERSE)) {
+	if (!ea[i].fa && ((fs.gr | ea[i].gr) & GR_REVERSE)) {
 	    int tmp;
 
 	    tmp = fg_color;
@@ -543,10 +570,10 @@ render_screen(struct ea *ea, screen_t *s)
 	    bg_color = tmp;
 	}
 
-	if ((fa_gr | ea[i].gr) & GR_INTENSIFY) {
+	if ((fs.gr | ea[i].gr) & GR_INTENSIFY) {
 	    high = true;
 	} else {
-	    high = fa_high;
+	    high = fs.high;
 	}
 
 	/* Draw this position. */
@@ -559,20 +586,20 @@ render_screen(struct ea *ea, screen_t *s)
 	    s[si].bg = mode3279? bg_color: HOST_COLOR_NEUTRAL_BLACK;
 
 	    if (!ea[i].fa &&
-		    !FA_IS_ZERO(fa) &&
-		    ((fa_gr | ea[i].gr) & GR_UNDERLINE)) {
+		    !FA_IS_ZERO(fs.fa) &&
+		    ((fs.gr | ea[i].gr) & GR_UNDERLINE)) {
 		s[si].gr |= XX_UNDERLINE;
 	    }
-	    if ((fa_gr | ea[i].gr) & GR_BLINK) {
+	    if ((fs.gr | ea[i].gr) & GR_BLINK) {
 		s[si].gr |= XX_BLINK;
 	    }
 	    if (high) {
 		s[si].gr |= XX_HIGHLIGHT;
 	    }
-	    if (FA_IS_SELECTABLE(fa)) {
+	    if (FA_IS_SELECTABLE(fs.fa)) {
 		s[si].gr |= XX_SELECTABLE;
 	    }
-	    if (!mode3279 && ((fa_gr | ea[i].gr) & GR_REVERSE)) {
+	    if (!mode3279 && ((fs.gr | ea[i].gr) & GR_REVERSE)) {
 		s[si].gr |= XX_REVERSE;
 	    }
 	    if (dbcs) {
@@ -581,7 +608,7 @@ render_screen(struct ea *ea, screen_t *s)
 	    if (order || (toggled(VISIBLE_CONTROL) && ea[i].fa)) {
 		s[si].gr |= XX_ORDER;
 	    }
-	    if (!ea[i].fa && !FA_IS_ZERO(fa) && extra_underline) {
+	    if (!ea[i].fa && !FA_IS_ZERO(fs.fa) && extra_underline) {
 		s[si].gr |= XX_UNDERLINE;
 	    }
 	    if (pua) {
@@ -597,13 +624,16 @@ render_screen(struct ea *ea, screen_t *s)
     }
 }
 
-/* Generate one row's worth of raw diffs. */
-static rowdiff_t *
-generate_rowdiffs(screen_t *oldr, screen_t *newr)
+/*
+ * Generate one row's worth of raw diffs into 'diffs', which has room for
+ * maxCOLS entries.
+ * Returns the number of diffs.
+ */
+static int
+generate_rowdiffs(screen_t *oldr, screen_t *newr, rowdiff_t *diffs)
 {
     int col;
-    rowdiff_t *diffs = NULL;
-    rowdiff_t *last_diff = NULL;
+    int ndiffs = 0;
 
     for (col = 0; col < maxCOLS; col++) {
 	rowdiff_t *d;
@@ -612,8 +642,7 @@ generate_rowdiffs(screen_t *oldr, screen_t *newr)
 	    continue;
 	}
 
-	d = (rowdiff_t *)Malloc(sizeof(rowdiff_t));
-	d->next = NULL;
+	d = &diffs[ndiffs++];
 	d->start_col = col;
 	d->width = 1;
 
@@ -647,18 +676,12 @@ generate_rowdiffs(screen_t *oldr, screen_t *newr)
 		}
 	    }
 	}
-	if (last_diff != NULL) {
-	    last_diff->next = d;
-	} else {
-	    diffs = d;
-	}
-	last_diff = d;
-	
+
 	/* Skip over what we just generated. */
 	col += d->width - 1;
     }
 
-    return diffs;
+    return ndiffs;
 }
 
 /*
@@ -679,18 +702,25 @@ ea_equal_attrs_span(screen_t *oldr, screen_t *newr, rowdiff_t *d,
     return true;
 }
 
-/* Merge adjacent sets of diffs to minimize output. */
-static rowdiff_t *
-merge_adjacent(rowdiff_t *diffs, screen_t *oldr, screen_t *newr)
+/*
+ * Merge adjacent sets of diffs to minimize output.
+ * Returns the new number of diffs.
+ */
+static int
+merge_adjacent(rowdiff_t *diffs, int ndiffs, screen_t *oldr, screen_t *newr)
 {
     rowdiff_t *d;
-    rowdiff_t *next;
+    int i;
+    int nmerged;
 
-    for (d = diffs; d != NULL; d = next) {
-	next = d->next;
-	if (next == NULL) {
-	    break;
-	}
+    if (ndiffs == 0) {
+	return 0;
+    }
+
+    d = &diffs[0];
+    nmerged = 1;
+    for (i = 1; i < ndiffs; i++) {
+	rowdiff_t *next = &diffs[i];
 
 	/*
 	 * Merge two text diffs if they are joined by a span of RED_SPAN or
@@ -706,15 +736,7 @@ merge_adjacent(rowdiff_t *diffs, screen_t *oldr, screen_t *newr)
 		ea_equal_attrs(&newr[d->start_col], &newr[next->start_col]) &&
 		ea_equal_attrs_span(oldr, newr, d, next)) {
 
-	    rowdiff_t *nx;
-
 	    d->width = next->start_col + next->width - d->start_col;
-	    nx = next;
-	    d->next = next->next;
-	    Free(nx);
-
-	    /* Consider d again. */
-	    next = d;
 	    continue;
 	}
 
@@ -729,15 +751,7 @@ merge_adjacent(rowdiff_t *diffs, screen_t *oldr, screen_t *newr)
 		ea_equal_attrs(&oldr[d->start_col], &oldr[next->start_col]) &&
 		ea_equal_attrs(&newr[d->start_col], &newr[next->start_col])) {
 
-	    rowdiff_t *nx;
-
 	    d->width += next->width;
-	    nx = next;
-	    d->next = next->next;
-	    Free(nx);
-
-	    /* Consider d again. */
-	    next = d;
 	    continue;
 	}
 
@@ -752,30 +766,28 @@ merge_adjacent(rowdiff_t *diffs, screen_t *oldr, screen_t *newr)
 		ea_equal_attrs(&oldr[d->start_col], &oldr[next->start_col]) &&
 		ea_equal_attrs(&newr[d->start_col], &newr[next->start_col])) {
 
-	    rowdiff_t *nx;
-
 	    d->reason = RD_TEXT;
 	    d->width += next->width;
-	    nx = next;
-	    d->next = next->next;
-	    Free(nx);
-
-	    /* Consider d again. */
-	    next = d;
 	    continue;
 	}
+
+	/* No merge. */
+	d = &diffs[nmerged++];
+	*d = *next;
     }
 
-    return diffs;
+    return nmerged;
 }
 
 /* Emit encoded diffs. */
 static void
-emit_rowdiffs(screen_t *oldr, screen_t *newr, rowdiff_t *diffs)
+emit_rowdiffs(screen_t *oldr, screen_t *newr, rowdiff_t *diffs, int ndiffs)
 {
-    rowdiff_t *d;
+    int n;
+
+    for (n = 0; n < ndiffs; n++) {
+	rowdiff_t *d = &diffs[n];
 
-    for (d = diffs; d != NULL; d = d->next) {
 	if (XML_MODE) {
 	    uix_open_leaf((d->reason == RD_TEXT)? IndChar: IndAttr);
 	} else {
@@ -826,35 +838,20 @@ emit_rowdiffs(screen_t *oldr, screen_t *newr, rowdiff_t *diffs)
     }
 }
 
-static rowdiff_t *
-free_rowdiffs(rowdiff_t *diffs)
-{
-    /* Free the diffs. */
-    while (diffs != NULL) {
-	rowdiff_t *next = diffs->next;
-	Free(diffs);
-	diffs = next;
-    }
-    return NULL;
-}
-
 /* Emit one row's worth of diffs. */
 static void
 emit_row(screen_t *oldr, screen_t *newr)
 {
-    rowdiff_t *diffs = NULL;
+    int ndiffs;
 
     /* Construct the sets of raw diffs. */
-    diffs = generate_rowdiffs(oldr, newr);
+    ndiffs = generate_rowdiffs(oldr, newr, rowdiffs);
 
     /* Merge adjacent diffs where it makes sense. */
-    diffs = merge_adjacent(diffs, oldr, newr);
+    ndiffs = merge_adjacent(rowdiffs, ndiffs, oldr, newr);
 
     /* Emit the diffs. */
-    emit_rowdiffs(oldr, newr, diffs);
-
-    /* Free the diffs. */
-    diffs = free_rowdiffs(diffs);
+    emit_rowdiffs(oldr, newr, rowdiffs, ndiffs);
 }
 
 /*
@@ -893,9 +890,10 @@ emit_cursor_cond(bool with_screen)
 
 /*
  * Emit the diff between two screens.
+ * If 'rows' is non-NULL, only the rows flagged in it are compared.
  */
 static void
-emit_diff(screen_t *old, screen_t *new)
+emit_diff(screen_t *old, screen_t *new, const bool *rows)
 {
     int row;
 
@@ -912,7 +910,8 @@ emit_diff(screen_t *old, screen_t *new)
 
     for (row = 0; row < maxROWS; row++) {
 
-	if (memcmp(old + (row * maxCOLS), new + (row * maxCOLS),
+	if ((rows == NULL || (row < ROWS && rows[row])) &&
+		memcmp(old + (row * maxCOLS), new + (row * maxCOLS),
 		sizeof(screen_t) * maxCOLS)) {
 	    if (XML_MODE) {
 		uix_push(IndRow,
@@ -948,10 +947,47 @@ emit_diff(screen_t *old, screen_t *new)
 void
 cursor_move(int baddr)
 {
+    if (baddr != cursor_addr) {
+	screen_generation++;	/* the cursor is part of the screen image */
+    }
     saved_baddr = baddr;
     cursor_addr = baddr;
 }
 
+/*
+ * Check the rows ctlr.c says have changed against the saved buffer.
+ * Returns true if any of them actually changed. Sets *fa_changed if any
+ * field attribute changed, since that can affect the rendering of any
+ * other row.
+ */
+static bool
+check_changed_rows(bool *fa_changed)
+{
+    int row;
+    int i;
+    bool any = false;
+
+    *fa_changed = false;
+    for (row = 0; row < ROWS; row++) {
+	struct ea *sea = saved_ea + (row * COLS);
+	struct ea *nea = ea_buf + (row * COLS);
+
+	if (!row_changed[row] ||
+		!memcmp(sea, nea, COLS * sizeof(struct ea))) {
+	    continue;
+	}
+	any = true;
+	for (i = 0; i < COLS; i++) {
+	    if ((sea[i].fa || nea[i].fa) &&
+		    memcmp(&sea[i], &nea[i], sizeof(struct ea))) {
+		*fa_changed = true;
+		return true;
+	    }
+	}
+    }
+    return any;
+}
+
 /*
  * Display a changed screen, perhaps unconditionally.
  */
@@ -960,10 +996,11 @@ screen_disp_cond(bool always)
 {
     bool sent_erase = false;
     size_t se = ROWS * COLS * sizeof(struct ea);
-    size_t ss = maxROWS * maxCOLS * sizeof(screen_t);
     bool empty;
+    bool fa_changed = false;
     int i;
-    screen_t *s;
+    int row;
+    const bool *rows;
     static bool xformatted = false;
 
     /* Check for a size change. */
@@ -980,7 +1017,9 @@ screen_disp_cond(bool always)
     if (!always &&
 	saved_rows == ROWS &&
 	saved_cols == COLS &&
-	!memcmp(saved_ea, ea_buf, se)) {
+	(render_all? !memcmp(saved_ea, ea_buf, se):
+		     !check_changed_rows(&fa_changed))) {
+	memset(row_changed, false, maxROWS * sizeof(bool));
 	emit_cursor_cond(true);
 	return;
     }
@@ -1003,6 +1042,7 @@ screen_disp_cond(bool always)
 	}
 	/* Remember that the screen is empty. */
 	save_empty();
+	memset(row_changed, false, maxROWS * sizeof(bool));
 	emit_cursor_cond(true);
 	return;
     }
@@ -1014,20 +1054,32 @@ screen_disp_cond(bool always)
 	xformatted = formatted;
     }
 
-    /* Render the new screen. */
-    s = Malloc(ss);
-    render_screen(ea_buf, s);
+    /*
+     * Render the new screen. Unless something forces a complete redraw,
+     * only the rows that ctlr.c flagged as changed are rendered and diffed.
+     */
+    rows = (always || render_all || fa_changed)? NULL: row_changed;
+    render_screen(ea_buf, new_s, rows);
 
     /* Tell them what the screen looks like now. */
-    emit_diff(saved_s, s);
+    emit_diff(saved_s, new_s, rows);
 
     /* Save the screen for next time. */
-    Replace(saved_ea, Malloc(se));
-    memcpy(saved_ea, ea_buf, se);
+    for (row = 0; row < maxROWS; row++) {
+	if (rows == NULL || (row < ROWS && rows[row])) {
+	    memcpy(saved_s + (row * maxCOLS), new_s + (row * maxCOLS),
+		    maxCOLS * sizeof(screen_t));
+	    if (row < ROWS) {
+		memcpy(saved_ea + (row * COLS), ea_buf + (row * COLS),
+			COLS * sizeof(struct ea));
+	    }
+	}
+    }
     saved_ea_is_empty = false;
-    Replace(saved_s, s);
+    render_all = false;
     saved_rows = ROWS;
     saved_cols = COLS;
+    memset(row_changed, false, maxROWS * sizeof(bool));
 }
 
 /*
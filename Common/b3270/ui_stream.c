@@ -113,9 +113,7 @@ typedef struct _uij_container {
 /* JSON state. */
 static struct {
     uij_container_t *container;
-    char *pending_input;
-    int line;
-    int column;
+    json_stream_t *stream;	/* incremental input parser */
 } uij;
 
 /* Action state. */
@@ -1252,46 +1250,12 @@ do_jpassthru_complete(const json_t *j, bool success)
     Free(text);
 }
 
-/*
- * Handle JSON input.
- * Returns a JSON parse error code.
- */
-static json_errcode_t
-handle_json_input(char *buf, size_t nr, size_t *offset)
+/* Handle one JSON input object. */
+static void
+handle_json_input(json_t *result)
 {
-    json_errcode_t errcode;
-    json_t *result;
-    json_parse_error_t *error;
     json_t *element;
 
-    *offset = 0;
-
-    /* Try parsing it as JSON. */
-    errcode = json_parse(buf, nr, &result, &error);
-    if (errcode != JE_OK) {
-	*offset = error->offset;
-	if (errcode == JE_INCOMPLETE) {
-	    _json_free_error(error);
-	    return errcode;
-	}
-	if (errcode != JE_EXTRA) {
-	    int line = uij.line + error->line;
-	    int column = uij.column + error->column;
-	    ui_leaf(IndUiError,
-		    AttrFatal, AT_BOOLEAN, true,
-		    AttrText, AT_STRING, error->errmsg,
-		    AttrLine, AT_INT, (int64_t)line,
-		    AttrColumn, AT_INT, (uint64_t)column,
-		    NULL);
-	    fprintf(stderr, "Fatal JSON parsing error at input:%d:%d: %s\n",
-		    uij.line + error->line,
-		    uij.column + error->column,
-		    error->errmsg);
-	    x3270_exit(1);
-	}
-	_json_free_error(error);
-    }
-
     /* Pick it apart. */
     if (json_is_string(result)) {
 	/* Quick command syntax: string == run. */
@@ -1303,7 +1267,7 @@ handle_json_input(char *buf, size_t nr, size_t *offset)
 
 	push_cb(command, len, &cb_ui, (task_cbh)uia);
 	json_free(result);
-	return errcode;
+	return;
     }
 
     if (!json_is_object(result) || json_object_length(result) != 1) {
@@ -1313,7 +1277,7 @@ handle_json_input(char *buf, size_t nr, size_t *offset)
 		    "Operation must be an object with one member",
 		NULL);
 	json_free(result);
-	return errcode;
+	return;
     }
     if (json_object_member(result, OperRun, NT, &element)) {
 	do_jrun(element);
@@ -1330,33 +1294,6 @@ handle_json_input(char *buf, size_t nr, size_t *offset)
 		NULL);
     }
     json_free(result);
-    return errcode;
-}
-
-/* Count the newlines in a buffer. */
-static int
-count_newlines(const char *s, size_t len, int *column)
-{
-    int nnl = 0;
-
-    while (len) {
-	ucs4_t ucs4;
-	int nr = utf8_to_unicode(s, len, &ucs4);
-
-	assert(nr > 0);
-	if (ucs4 == '\n') {
-	    nnl++;
-	    if (column != NULL) {
-		*column = 0;
-	    }
-	} else if (column != NULL) {
-	    (*column)++;
-	}
-	s += nr;
-	len -= nr;
-    }
-
-    return nnl;
 }
 
 /* UI input processor. */
@@ -1406,66 +1343,41 @@ process_input(const char *buf, ssize_t nr)
 	}
 
     } else {
-	char *rs;	/* run start */
-	char *ss;	/* scan start, may skip newlines */
-	bool exhausted = false;
-
-	if (uij.pending_input != NULL) {
-	    char *p = uij.pending_input;
-
-	    /* Handle multi-line input. */
-	    uij.pending_input = Asprintf("%s%.*s", p, (int)nr, buf);
-	    Free(p);
-	} else {
-	    uij.pending_input = Asprintf("%.*s", (int)nr, buf);
+	if (uij.stream == NULL) {
+	    uij.stream = json_stream_init();
 	}
 
 	/*
-	 * Input may arrive in awkward chunks: with a partial line or with
-	 * multiple lines at once (embedded newlines).
+	 * Input may arrive in awkward chunks: with a partial object or with
+	 * multiple objects at once. The parser keeps its state between reads,
+	 * so each byte is scanned once.
 	 */
-	ss = rs = uij.pending_input;
 	while (true) {
-	    size_t len;
-	    char *newline = strrchr(ss, '\n');
 	    json_errcode_t errcode;
-	    size_t offset;
+	    json_t *result;
+	    json_parse_error_t *error;
+	    size_t consumed;
 
-	    if (newline == NULL) {
-		/* No newline. Don't even try to parse it. */
+	    errcode = json_stream_parse(uij.stream, buf, nr, &consumed,
+		    &result, &error);
+	    if (errcode == JE_INCOMPLETE) {
 		break;
 	    }
-
-	    /* Get ready to scan past this newline. */
-	    len = newline - rs;
-	    ss = newline + 1;
-
-	    /* Parse and run. */
-	    errcode = handle_json_input(rs, len, &offset);
-	    if (errcode == JE_OK) {
-		/* Complete, nothing extra. */
-		uij.line += count_newlines(rs, len + 1, NULL);
-		uij.column = 0;
-		if (!*ss) {
-		    /* Buffer is completely digested. */
-		    exhausted = true;
-		    break;
-		}
-		/* Buffer is partially digested. */
-		rs = ss;
-	    } else if (errcode == JE_EXTRA) {
-		/* Successfully parsed, with extra data. */
-		uij.line += count_newlines(rs, offset, &uij.column);
-		memmove(uij.pending_input, uij.pending_input + offset,
-			strlen(uij.pending_input + offset) + 1);
-		rs = ss = uij.pending_input;
-	    } else {
-		/* Incomplete. */
-		assert(errcode == JE_INCOMPLETE);
+	    if (errcode != JE_OK) {
+		ui_leaf(IndUiError,
+			AttrFatal, AT_BOOLEAN, true,
+			AttrText, AT_STRING, error->errmsg,
+			AttrLine, AT_INT, (int64_t)error->line,
+			AttrColumn, AT_INT, (int64_t)error->column,
+			NULL);
+		fprintf(stderr,
+			"Fatal JSON parsing error at input:%d:%d: %s\n",
+			error->line, error->column, error->errmsg);
+		x3270_exit(1);
 	    }
-	}
-	if (exhausted) {
-	    Replace(uij.pending_input, NULL);
+	    handle_json_input(result);
+	    buf += consumed;
+	    nr -= consumed;
 	}
     }
 }
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *	bintrace.c
+ *		Binary network data capture.
+ *
+ *		When the traceBinaryFile resource is set, everything sent to
+ *		and received from the host is appended to that file in the
+ *		format described in bintrace.h, with no formatting. The
+ *		btrc2trc tool expands a capture into the text trace format,
+ *		and playback can replay one directly.
+ */
+
+#include "globals.h"
+
+#include <errno.h>
+#if !defined(_WIN32) /*[*/
+# include <fcntl.h>
+#endif /*]*/
+
+#include "appres.h"
+#include "bintrace.h"
+#include "popups.h"
+#include "resources.h"
+#include "utils.h"
+
+/* Size of the capture file buffer. */
+#define BINTRACE_BUFSIZE	(256 * 1024)
+
+static FILE *bintrace_f = NULL;
+static bool bintrace_failed = false;
+
+/* Flushes the capture file on disconnect. */
+static void
+bintrace_connect(bool mode)
+{
+    if (!mode && bintrace_f != NULL) {
+	fflush(bintrace_f);
+    }
+}
+
+/* Closes the capture file at exit. */
+static void
+bintrace_exiting(bool mode _is_unused)
+{
+    if (bintrace_f != NULL) {
+	fclose(bintrace_f);
+	bintrace_f = NULL;
+    }
+}
+
+/* Opens the capture file. */
+static bool
+bintrace_open(void)
+{
+    char *name;
+
+    name = do_subst(appres.trace_binary_file, DS_VARS | DS_TILDE);
+    bintrace_f = fopen(name, "wb");
+    if (bintrace_f == NULL) {
+	popup_an_errno(errno, "%s", name);
+	Free(name);
+	bintrace_failed = true;
+	return false;
+    }
+    Free(name);
+    setvbuf(bintrace_f, NULL, _IOFBF, BINTRACE_BUFSIZE);
+#if !defined(_WIN32) /*[*/
+    fcntl(fileno(bintrace_f), F_SETFD, 1);
+#endif /*]*/
+    fwrite(BINTRACE_MAGIC, BINTRACE_MAGIC_LEN, 1, bintrace_f);
+    register_schange(ST_CONNECT, bintrace_connect);
+    register_schange(ST_EXITING, bintrace_exiting);
+    return true;
+}
+
+/* Captures network data. */
+void
+bintrace_netdata(char direction, unsigned const char *buf, size_t len)
+{
+    unsigned char hdr[BINTRACE_HDR_LEN];
+    struct timeval tv;
+
+    if (bintrace_f == NULL &&
+	    (appres.trace_binary_file == NULL ||
+	     bintrace_failed ||
+	     !bintrace_open())) {
+	return;
+    }
+
+    gettimeofday(&tv, NULL);
+    bintrace_encode_header(hdr, direction, len,
+	    (tv.tv_sec * 1000000ULL) + tv.tv_usec);
+    if (fwrite(hdr, BINTRACE_HDR_LEN, 1, bintrace_f) != 1 ||
+	    (len && fwrite(buf, len, 1, bintrace_f) != 1)) {
+	popup_an_errno(errno, "Write to binary trace file failed");
+	fclose(bintrace_f);
+	bintrace_f = NULL;
+	bintrace_failed = true;
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *	bintrace_fmt.c
+ *		Binary network data trace file format.
+ */
+
+#include "globals.h"
+
+#include "bintrace.h"
+
+/* Encodes a record header. */
+void
+bintrace_encode_header(unsigned char *hdr, char direction, size_t len,
+	unsigned long long us)
+{
+    int i;
+
+    hdr[0] = (unsigned char)direction;
+    hdr[1] = hdr[2] = hdr[3] = 0;
+    for (i = 0; i < 4; i++) {
+	hdr[4 + i] = (unsigned char)((len >> (8 * (3 - i))) & 0xff);
+    }
+    for (i = 0; i < 8; i++) {
+	hdr[8 + i] = (unsigned char)((us >> (8 * (7 - i))) & 0xff);
+    }
+}
+
+/*
+ * Checks a file for the binary trace magic number.
+ * If it is there, leaves the file positioned at the first record.
+ * Otherwise, rewinds the file.
+ */
+bool
+bintrace_is_binary(FILE *f)
+{
+    char magic[BINTRACE_MAGIC_LEN];
+
+    if (fread(magic, BINTRACE_MAGIC_LEN, 1, f) == 1 &&
+	    !memcmp(magic, BINTRACE_MAGIC, BINTRACE_MAGIC_LEN)) {
+	return true;
+    }
+    rewind(f);
+    return false;
+}
+
+/*
+ * Reads a record from a binary trace file.
+ * The record's buffer is reallocated as needed; the caller frees it.
+ */
+bintrace_read_t
+bintrace_read(FILE *f, bintrace_record_t *r)
+{
+    unsigned char hdr[BINTRACE_HDR_LEN];
+    size_t nr;
+    int i;
+
+    nr = fread(hdr, 1, BINTRACE_HDR_LEN, f);
+    if (nr == 0 && feof(f)) {
+	return BTR_EOF;
+    }
+    if (nr != BINTRACE_HDR_LEN ||
+	    (hdr[0] != BINTRACE_HOST && hdr[0] != BINTRACE_EMUL)) {
+	return BTR_ERROR;
+    }
+    r->direction = (char)hdr[0];
+    r->len = 0;
+    for (i = 0; i < 4; i++) {
+	r->len = (r->len << 8) | hdr[4 + i];
+    }
+    r->us = 0;
+    for (i = 0; i < 8; i++) {
+	r->us = (r->us << 8) | hdr[8 + i];
+    }
+    if (r->len > r->buf_size) {
+	r->buf_size = r->len;
+	r->buf = Realloc(r->buf, r->buf_size);
+    }
+    if (r->len && fread(r->buf, r->len, 1, f) != 1) {
+	return BTR_ERROR;
+    }
+    return BTR_RECORD;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *	btrc2trc.c
+ *		Expands a binary network data trace into the text trace
+ *		format, so it can be read or used by tools that understand
+ *		.trc files.
+ */
+
+#include "globals.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include "bintrace.h"
+#include "sa_malloc.h"
+
+#define LINEDUMP_MAX	32
+
+static char *me;
+
+void
+usage(const char *s)
+{
+    if (s != NULL) {
+	fprintf(stderr, "%s\n", s);
+    }
+    fprintf(stderr, "usage: %s [binary-trace-file]\n", me);
+    exit(1);
+}
+
+/* Formats a timestamp the way the trace file does. */
+static const char *
+fmt_ts(unsigned long long us)
+{
+    static char buf[64];
+    time_t t = (time_t)(us / 1000000ULL);
+    struct tm *tm = localtime(&t);
+
+    snprintf(buf, sizeof(buf), "%d%02d%02d.%02d%02d%02d.%03d",
+	    tm->tm_year + 1900,
+	    tm->tm_mon + 1,
+	    tm->tm_mday,
+	    tm->tm_hour,
+	    tm->tm_min,
+	    tm->tm_sec,
+	    (int)((us % 1000000ULL) / 1000ULL));
+    return buf;
+}
+
+/* Dumps network data the way trace_netdata() does. */
+static void
+dump(char direction, const unsigned char *buf, size_t len)
+{
+    size_t offset;
+
+    for (offset = 0; offset < len; offset++) {
+	if (!(offset % LINEDUMP_MAX)) {
+	    printf("%s%c 0x%-3x ", (offset? "\n": ""), direction,
+		    (unsigned)offset);
+	}
+	printf("%02x", buf[offset]);
+    }
+    printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *name = "stdin";
+    FILE *f = stdin;
+    bintrace_record_t r;
+    bool first = true;
+    int rv = 0;
+
+    if ((me = strrchr(argv[0], '/')) != NULL) {
+	me++;
+    } else {
+	me = argv[0];
+    }
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+	usage(NULL);
+    }
+    if (argc == 2) {
+	name = argv[1];
+	f = fopen(name, "rb");
+	if (f == NULL) {
+	    perror(name);
+	    exit(1);
+	}
+    }
+
+    if (!bintrace_is_binary(f)) {
+	fprintf(stderr, "%s: not a binary trace file\n", name);
+	exit(1);
+    }
+
+    memset(&r, 0, sizeof(r));
+    for (;;) {
+	bintrace_read_t ret = bintrace_read(f, &r);
+
+	if (ret == BTR_EOF) {
+	    break;
+	}
+	if (ret == BTR_ERROR) {
+	    fprintf(stderr, "%s: %s\n", name,
+		    ferror(f)? strerror(errno): "truncated or invalid record");
+	    rv = 1;
+	    break;
+	}
+	if (first) {
+	    printf("%s Trace started\n", fmt_ts(r.us));
+	    printf(" Converted from binary trace %s\n", name);
+	    printf(" Data stream:\n");
+	    first = false;
+	}
+	if (r.direction == BINTRACE_HOST) {
+	    printf("%s Host socket read complete nr=%u\n", fmt_ts(r.us),
+		    (unsigned)r.len);
+	    dump(r.direction, r.buf, r.len);
+	} else {
+	    dump(r.direction, r.buf, r.len);
+	    printf("%s Host socket write complete nw=%u\n", fmt_ts(r.us),
+		    (unsigned)r.len);
+	}
+    }
+
+    Free(r.buf);
+    if (f != stdin) {
+	fclose(f);
+    }
+    return rv;
+}
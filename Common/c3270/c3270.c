@@ -2373,6 +2373,7 @@ c3270_register(void)
 	{ ResKeymap,	aoffset(interactive.key_map),	XRM_STRING },
 	{ ResMenuBar,	aoffset(interactive.menubar),	XRM_BOOLEAN },
 	{ ResNoPrompt,	aoffset(secure),		XRM_BOOLEAN },
+	{ ResSaveBytes,	aoffset(interactive.save_bytes),XRM_INT },
 	{ ResSaveLines,	aoffset(interactive.save_lines),XRM_INT },
 #if !defined(_WIN32) /*[*/
 	{ ResCbreak,	aoffset(c3270.cbreak_mode),	XRM_BOOLEAN },
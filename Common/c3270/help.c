@@ -80,6 +80,8 @@ static struct {
 	    "<n> bytes of screen contents from <row>,<col> (1-origin), in ASCII" },
 	{ AnAscii1, "<row>,<col>,<rows>,<cols>", P_SCRIPTING,
 	    "<rows>x<cols> of screen contents from <row>,<col> (1-origin), in ASCII" },
+	{ AnAsciiDelta, "[<generation>]", P_SCRIPTING,
+	    "Rows (1-origin) changed since <generation>, in ASCII" },
 	{ AnAsciiField, NULL, P_SCRIPTING,
 	    "Contents of current field, in ASCII" },
 	{ AnAttn, NULL, P_3270, "Send 3270 ATTN sequence (TELNET IP)" },
@@ -137,7 +139,9 @@ static struct {
 	    "Escape to '" HELP_W "c3270>' prompt" },
 	{ AnExecute, "<command>", P_SCRIPTING, "Execute a shell command" },
 	{ "Exit", NULL, P_INTERACTIVE, "Exit " HELP_W "c3270" },
-	{ AnExpect, "<pattern>", P_SCRIPTING, "Wait for NVT output" },
+	{ AnExpect, "<pattern>[,<seconds>]", P_SCRIPTING, "Wait for NVT output" },
+	{ AnExpect, "[-Timeout,<seconds>,]<pattern>,<pattern>...", P_SCRIPTING,
+	    "Wait for any of several NVT outputs, report which" },
 	{ AnFail, "<text>", P_SCRIPTING, "Fail and return text" },
 	{ AnFieldEnd, NULL, P_3270, "Move to end of field" },
 	{ AnFieldMark, NULL, P_3270, "3270 FIELD MARK key (X'1E')" },
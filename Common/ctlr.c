@@ -95,8 +95,14 @@ unsigned long ea_sum, aea_sum;
 #endif /*]*/
 bool formatted = false;	/* set in screen_disp */
 bool screen_changed = false;
+unsigned long screen_generation = 0;	/* bumped on any buffer, cursor or
+					   MDT change */
 int first_changed = -1;
 int last_changed = -1;
+bool *row_changed = NULL;	/* per-row change flags, cleared by the
+				   screen update logic */
+unsigned long *row_generation = NULL; /* per-row screen_generation of the
+				   last change */
 unsigned char reply_mode = SF_SRM_FIELD;
 int crm_nattr = 0;
 unsigned char crm_attr[16];
@@ -104,7 +110,20 @@ bool dbcs = false;
 
 /* Statics */
 static unsigned char *zero_buf;	/* empty buffer, for area clears */
+
+/*
+ * ea_buf is a window into a larger allocation. In NVT mode, scrolling the
+ * whole screen just slides the window down one row; the screen is copied
+ * back to the start of the allocation only when the window runs off the end.
+ * aea_buf has no slide room. Switching buffers exchanges their contents, so
+ * the live screen is always the one that can slide.
+ */
+#define EA_SLACK_SCREENS	1	/* extra screens of slide room */
+static struct ea *ea_alloc;	/* allocation holding ea_buf */
+static struct ea *aea_alloc;	/* allocation holding aea_buf */
+static size_t ea_alloc_size;	/* size of ea_alloc, in struct eas */
 static void set_formatted(void);
+static int fa_index_get(int **index);
 static void ctlr_blanks(void);
 static bool trace_primed = false;
 static unsigned char default_fg;
@@ -118,8 +137,39 @@ static int sscp_start;
 static void ctlr_add_ic(int baddr, unsigned char ic);
 static bool ctlr_initted = false;
 
+/*
+ * Field index: the sorted buffer addresses of the field attributes in
+ * ea_buf. It is kept up to date by ctlr_add_fa(), ctlr_add() and
+ * ctlr_clear(), and rebuilt on demand after anything that moves field
+ * attributes around wholesale.
+ */
+static int *fa_index;		/* field attribute addresses */
+static int fa_count;		/* number of entries in fa_index */
+static bool fa_index_valid = false;
+static struct ea *fa_index_buf;	/* ea_buf when fa_index was built */
+static int fa_index_size;	/* ROWS*COLS when fa_index was built */
+
 static void ticking_stop(struct timeval *tp);
 
+/*
+ * Mark the rows spanned by a region of the buffer (bstart up to but not
+ * including bend) as changed, in the current screen generation.
+ */
+static void
+mark_rows_changed(int bstart, int bend)
+{
+    int row;
+
+    if (row_changed == NULL || bend <= bstart) {
+	return;
+    }
+    for (row = bstart / COLS; row <= (bend - 1) / COLS && row < maxROWS;
+	    row++) {
+	row_changed[row] = true;
+	row_generation[row] = screen_generation;
+    }
+}
+
 /*
  * code_table is used to translate buffer addresses and attributes to the 3270
  * datastream representation
@@ -139,9 +189,13 @@ static unsigned char code_table[64] = {
 
 #define ALL_CHANGED	{ \
 	screen_changed = true; \
+	screen_generation++; \
+	mark_rows_changed(0, ROWS*COLS); \
 	if (IN_NVT) { first_changed = 0; last_changed = ROWS*COLS; } }
 #define REGION_CHANGED(f, l)	{ \
 	screen_changed = true; \
+	screen_generation++; \
+	mark_rows_changed(f, l); \
 	if (IN_NVT) { \
 	    if (first_changed == -1 || f < first_changed) first_changed = f; \
 	    if (last_changed == -1 || l > last_changed) last_changed = l; } }
@@ -189,24 +243,28 @@ ctlr_init(unsigned cmask)
 void
 ctlr_reinit(unsigned cmask)
 {
-    static struct ea *real_ea_buf = NULL;
-    static struct ea *real_aea_buf = NULL;
+    int i;
 
     ctlr_initted = true;
     if (cmask & MODEL_CHANGE) {
 	/* Allocate buffers */
-	if (real_ea_buf) {
-	    Free((char *)real_ea_buf);
-	}
-	real_ea_buf = (struct ea *)Calloc(sizeof(struct ea),
-		(maxROWS * maxCOLS) + 1);
-	ea_buf = real_ea_buf + 1;
-	if (real_aea_buf) {
-	    Free((char *)real_aea_buf);
+	ea_alloc_size = 1 + ((1 + EA_SLACK_SCREENS) * maxROWS * maxCOLS);
+	Replace(ea_alloc, (struct ea *)Calloc(sizeof(struct ea),
+		    ea_alloc_size));
+	ea_buf = ea_alloc + 1;
+	Replace(aea_alloc, (struct ea *)Calloc(sizeof(struct ea),
+		    1 + (maxROWS * maxCOLS)));
+	aea_buf = aea_alloc + 1;
+	Replace(row_changed, (bool *)Malloc(maxROWS * sizeof(bool)));
+	Replace(row_generation,
+		(unsigned long *)Malloc(maxROWS * sizeof(unsigned long)));
+	Replace(fa_index, (int *)Malloc(maxROWS * maxCOLS * sizeof(int)));
+	fa_index_valid = false;
+	memset(row_changed, true, maxROWS * sizeof(bool));
+	screen_generation++;
+	for (i = 0; i < maxROWS; i++) {
+	    row_generation[i] = screen_generation;
 	}
-	real_aea_buf = (struct ea *)Calloc(sizeof(struct ea),
-		(maxROWS * maxCOLS) + 1);
-	aea_buf = real_aea_buf + 1;
 #if defined(CHECK_AEA_BUF) /*[*/
 	ea_sum = 0;
 	aea_sum = 0;
@@ -370,17 +428,7 @@ ctlr_reset(void)
 static void
 set_formatted(void)
 {
-    int baddr;
-
-    formatted = false;
-    baddr = 0;
-    do {
-	if (ea_buf[baddr].fa) {
-	    formatted = true;
-	    break;
-	}
-	INC_BA(baddr);
-    } while (baddr != 0);
+    formatted = fa_index_get(NULL) > 0;
 }
 
 /*
@@ -427,6 +475,186 @@ ctlr_connect(bool ignored _is_unused)
     }
 }
 
+/* Returns true if the field index is valid for the current buffer. */
+static bool
+fa_index_current(void)
+{
+    return fa_index_valid && fa_index_buf == ea_buf &&
+	fa_index_size == ROWS * COLS;
+}
+
+/* Invalidate the field index. */
+static void
+fa_index_invalidate(void)
+{
+    fa_index_valid = false;
+}
+
+/* Empty the field index, after the buffer has been cleared. */
+static void
+fa_index_clear(void)
+{
+    fa_count = 0;
+    fa_index_buf = ea_buf;
+    fa_index_size = ROWS * COLS;
+    fa_index_valid = true;
+}
+
+/*
+ * Get the field index, rebuilding it if necessary.
+ * Returns the number of field attributes.
+ */
+static int
+fa_index_get(int **index)
+{
+    if (!fa_index_current()) {
+	int baddr;
+
+	fa_count = 0;
+	for (baddr = 0; baddr < ROWS * COLS; baddr++) {
+	    if (ea_buf[baddr].fa) {
+		fa_index[fa_count++] = baddr;
+	    }
+	}
+	fa_index_buf = ea_buf;
+	fa_index_size = ROWS * COLS;
+	fa_index_valid = true;
+    }
+    if (index != NULL) {
+	*index = fa_index;
+    }
+    return fa_count;
+}
+
+/*
+ * Search the field index.
+ * Returns the position of the last entry <= baddr, or -1 if there is none.
+ */
+static int
+fa_index_search(int baddr)
+{
+    int lo = 0;
+    int hi = fa_count;
+
+    /* Find the first entry > baddr. */
+    while (lo < hi) {
+	int mid = lo + (hi - lo) / 2;
+
+	if (fa_index[mid] <= baddr) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    return lo - 1;
+}
+
+/*
+ * Returns true if a (non-wrapping) region of the buffer might contain field
+ * attributes.
+ */
+static bool
+fa_index_in_region(int baddr, int count)
+{
+    int ix;
+
+    if (!fa_index_current()) {
+	return true;
+    }
+    ix = fa_index_search(baddr + count - 1);
+    return ix >= 0 && fa_index[ix] >= baddr;
+}
+
+/* Add a field attribute to the field index. */
+static void
+fa_index_add(int baddr)
+{
+    int ix;
+
+    if (!fa_index_current()) {
+	return;
+    }
+    ix = fa_index_search(baddr);
+    if (ix >= 0 && fa_index[ix] == baddr) {
+	return;
+    }
+    ix++;
+    memmove(&fa_index[ix + 1], &fa_index[ix], (fa_count - ix) * sizeof(int));
+    fa_index[ix] = baddr;
+    fa_count++;
+}
+
+/* Remove a field attribute from the field index. */
+static void
+fa_index_remove(int baddr)
+{
+    int ix;
+
+    if (!fa_index_current()) {
+	return;
+    }
+    ix = fa_index_search(baddr);
+    if (ix < 0 || fa_index[ix] != baddr) {
+	return;
+    }
+    memmove(&fa_index[ix], &fa_index[ix + 1],
+	    (fa_count - ix - 1) * sizeof(int));
+    fa_count--;
+}
+
+/*
+ * Mark the rows from a buffer address through the end of the field that
+ * contains it as changed, in the current screen generation. This is done when
+ * a field attribute is added, removed or changed at or before that address,
+ * because the attribute affects how the rest of the field is displayed.
+ */
+static void
+mark_field_changed(int baddr)
+{
+    int *index;
+    int n;
+    int ix;
+
+    if (row_changed == NULL) {
+	return;
+    }
+    n = fa_index_get(&index);
+    if (n == 0) {
+	/* The screen just became unformatted. */
+	mark_rows_changed(0, ROWS * COLS);
+	return;
+    }
+    ix = fa_index_search(baddr) + 1;
+    if (ix < n) {
+	mark_rows_changed(baddr, index[ix]);
+    } else {
+	/* The field wraps. */
+	mark_rows_changed(baddr, ROWS * COLS);
+	mark_rows_changed(0, index[0]);
+    }
+}
+
+/*
+ * Find the buffer address of the field attribute for a given buffer address,
+ * using the field index.
+ * Returns -1 if there are no fields.
+ */
+static int
+fa_index_find(int baddr)
+{
+    int ix;
+
+    if (fa_index_get(NULL) == 0) {
+	return -1;
+    }
+    ix = fa_index_search(baddr);
+    if (ix < 0) {
+	/* Wrap to the last field on the screen. */
+	ix = fa_count - 1;
+    }
+    return fa_index[ix];
+}
+
 /*
  * Find the buffer address of the field attribute for a given buffer address.
  * Returns -1 if the screen isn't formatted.
@@ -436,6 +664,10 @@ find_field_attribute_ea(int baddr, struct ea *ea)
 {
     int sbaddr;
 
+    if (ea == ea_buf) {
+	return fa_index_find(baddr);
+    }
+
     sbaddr = baddr;    
     do {   
 	if (ea[baddr].fa) {
@@ -479,28 +711,32 @@ bool
 get_bounded_field_attribute(register int baddr, register int bound,
 	unsigned char *fa_out)
 {
-    int sbaddr;
+    int faddr;
+    int fa_distance, bound_distance;
 
     if (!formatted) {
 	*fa_out = ea_buf[-1].fa;
 	return true;
     }
 
-    sbaddr = baddr;
-    do {
-	if (ea_buf[baddr].fa) {
-	    *fa_out = ea_buf[baddr].fa;
-	    return true;
-	}
-	DEC_BA(baddr);
-    } while (baddr != sbaddr && baddr != bound);
-
     /* Screen is unformatted (and 'formatted' is inaccurate). */
-    if (baddr == sbaddr) {
+    faddr = fa_index_find(baddr);
+    if (faddr < 0) {
 	*fa_out = ea_buf[-1].fa;
 	return true;
     }
 
+    /*
+     * Searching backwards from baddr, see if the attribute comes before
+     * the boundary. The boundary itself is not searched, unless it is baddr.
+     */
+    fa_distance = (baddr - faddr + (ROWS * COLS)) % (ROWS * COLS);
+    bound_distance = (baddr - bound + (ROWS * COLS)) % (ROWS * COLS);
+    if (bound_distance == 0 || fa_distance < bound_distance) {
+	*fa_out = ea_buf[faddr].fa;
+	return true;
+    }
+
     /* Wrapped to boundary. */
     return false;
 }
@@ -523,18 +759,26 @@ fa2ea(int baddr)
 int
 next_unprotected(int baddr0)
 {
-    register int baddr, nbaddr;
+    int *index;
+    int count;
+    int ix;
+    int i;
+
+    /* Start with the first field attribute at or after baddr0. */
+    count = fa_index_get(&index);
+    ix = fa_index_search(baddr0);
+    if (ix < 0 || index[ix] != baddr0) {
+	ix++;
+    }
+    for (i = 0; i < count; i++) {
+	int baddr = index[(ix + i) % count];
+	int nbaddr = baddr;
 
-    nbaddr = baddr0;
-    do {
-	baddr = nbaddr;
 	INC_BA(nbaddr);
-	if (ea_buf[baddr].fa &&
-		!FA_IS_PROTECTED(ea_buf[baddr].fa) &&
-		!ea_buf[nbaddr].fa) {
+	if (!FA_IS_PROTECTED(ea_buf[baddr].fa) && !ea_buf[nbaddr].fa) {
 	    return nbaddr;
 	}
-    } while (nbaddr != baddr0);
+    }
     return 0;
 }
 
@@ -2466,6 +2710,9 @@ ctlr_dbcs_postprocess(void)
 	return 0;
     }
 
+    /* The db fields can change anywhere. */
+    mark_rows_changed(0, ROWS*COLS);
+
     /*
      * Find the field attribute for location 0.  If unformatted, it's the
      * dummy at -1.  Also compute the starting and ending points for the
@@ -2655,6 +2902,7 @@ ctlr_clear(bool can_snap)
 
     /* Clear the screen. */
     memset((char *)ea_buf, 0, ROWS*COLS*sizeof(struct ea));
+    fa_index_clear();
     ALL_CHANGED;
     cursor_move(0);
     buffer_addr = 0;
@@ -2708,9 +2956,13 @@ ctlr_add(int baddr, unsigned char c, unsigned char cs)
 	    unselect(baddr, 1);
 	}
 	ONE_CHANGED(baddr);
+	if (ea_buf[baddr].fa) {
+	    fa_index_remove(baddr);
+	    ea_buf[baddr].fa = 0;
+	    mark_field_changed(baddr);
+	}
 	ea_buf[baddr].ec = c;
 	ea_buf[baddr].cs = cs;
-	ea_buf[baddr].fa = 0;
 	ea_buf[baddr].ucs4 = 0;
     }
 }
@@ -2737,10 +2989,14 @@ ctlr_add_nvt(int baddr, ucs4_t ucs4, unsigned char cs)
 	    unselect(baddr, 1);
 	}
 	ONE_CHANGED(baddr);
+	if (ea_buf[baddr].fa) {
+	    fa_index_remove(baddr);
+	    ea_buf[baddr].fa = 0;
+	    mark_field_changed(baddr);
+	}
 	ea_buf[baddr].ucs4 = ucs4;
 	ea_buf[baddr].ec = 0;
 	ea_buf[baddr].cs = cs;
-	ea_buf[baddr].fa = 0;
 
 	if (cs == CS_DBCS) {
 	    ea_buf[baddr].db = ucs4 == ' '? DBCS_RIGHT: DBCS_LEFT;
@@ -2761,7 +3017,15 @@ ctlr_add_fa(int baddr, unsigned char fa, unsigned char cs)
      * Store the new attribute, setting the 'printable' bits so that the
      * value will be non-zero.
      */
-    ea_buf[baddr].fa = FA_PRINTABLE | (fa & FA_MASK);
+    fa = FA_PRINTABLE | (fa & FA_MASK);
+    if (ea_buf[baddr].fa != fa) {
+	ONE_CHANGED(baddr);
+	ea_buf[baddr].fa = fa;
+	fa_index_add(baddr);
+	mark_field_changed(baddr);
+    } else {
+	fa_index_add(baddr);
+    }
 }
 
 /* 
@@ -2893,9 +3157,18 @@ ctlr_bcopy(int baddr_from, int baddr_to, int count, int move_ea)
     /* Move the characters. */
     if (memcmp((char *) &ea_buf[baddr_from], (char *) &ea_buf[baddr_to],
 		count * sizeof(struct ea))) {
+	bool fa_moved = fa_index_in_region(baddr_from, count) ||
+		fa_index_in_region(baddr_to, count);
+
+	if (fa_moved) {
+	    fa_index_invalidate();
+	}
 	memmove(&ea_buf[baddr_to], &ea_buf[baddr_from],
 		count * sizeof(struct ea));
 	REGION_CHANGED(baddr_to, baddr_to + count);
+	if (fa_moved) {
+	    mark_field_changed(baddr_to + count - 1);
+	}
 	/*
 	 * For the time being, if any selected text shifts around on
 	 * the screen, unhighlight it.  Eventually there should be
@@ -2918,8 +3191,16 @@ ctlr_aclear(int baddr, int count, int clear_ea)
 {
     if (memcmp((char *)&ea_buf[baddr], (char *)zero_buf,
 		count * sizeof(struct ea))) {
+	bool fa_cleared = fa_index_in_region(baddr, count);
+
+	if (fa_cleared) {
+	    fa_index_invalidate();
+	}
 	memset((char *) &ea_buf[baddr], 0, count * sizeof(struct ea));
 	REGION_CHANGED(baddr, baddr + count);
+	if (fa_cleared) {
+	    mark_field_changed(baddr + count - 1);
+	}
 	if (area_is_selected(baddr, count)) {
 	    unselect(baddr, count);
 	}
@@ -2927,6 +3208,38 @@ ctlr_aclear(int baddr, int count, int clear_ea)
     /* XXX: What about clear_ea? */
 }
 
+/*
+ * Slide ea_buf down one row, dropping the top row of the screen.
+ * The contents of the new bottom row are undefined.
+ */
+static void
+ea_buf_slide(void)
+{
+    struct ea dummy = ea_buf[-1];	/* struct copy */
+    struct ea *ea_end = ea_alloc + ea_alloc_size;
+    bool fa_current = fa_index_current();
+
+    if (ea_buf + COLS + (maxROWS * maxCOLS) <= ea_end) {
+	/* There is room to slide the window. */
+	ea_buf += COLS;
+    } else {
+	/*
+	 * Copy the remaining rows back to the start of the allocation and
+	 * clear everything after them, so the slide room starts out empty.
+	 */
+	memmove(ea_alloc + 1, ea_buf + COLS,
+		(ROWS - 1) * COLS * sizeof(struct ea));
+	ea_buf = ea_alloc + 1;
+	memset((char *)(ea_buf + ((ROWS - 1) * COLS)), 0,
+		(ea_end - (ea_buf + ((ROWS - 1) * COLS))) * sizeof(struct ea));
+    }
+    ea_buf[-1] = dummy;		/* struct copy */
+
+    if (fa_current) {
+	fa_index_buf = ea_buf;
+    }
+}
+
 /*
  * Scroll the screen 1 row.
  *
@@ -2950,7 +3263,10 @@ ctlr_scroll(unsigned char fg, unsigned char bg)
     }
 
     /* Move ea_buf. */
-    memmove(&ea_buf[0], &ea_buf[COLS], qty * sizeof(struct ea));
+    if (fa_index_in_region(0, ROWS * COLS)) {
+	fa_index_invalidate();
+    }
+    ea_buf_slide();
 
     /* Clear the last line. */
     memset((char *) &ea_buf[qty], 0, COLS * sizeof(struct ea));
@@ -2969,6 +3285,16 @@ ctlr_scroll(unsigned char fg, unsigned char bg)
     if (obscured) {
 	ALL_CHANGED;
     } else {
+	/*
+	 * The row change flags scroll, too. Every row's contents are new, as
+	 * far as the generation numbers are concerned.
+	 */
+	memmove(row_changed, row_changed + 1, (ROWS - 1) * sizeof(bool));
+	row_changed[ROWS - 1] = true;
+	screen_generation++;
+	for (i = 0; i < ROWS; i++) {
+	    row_generation[i] = screen_generation;
+	}
 	screen_scroll(fg, bg);
     }
 }
@@ -2979,6 +3305,7 @@ ctlr_scroll(unsigned char fg, unsigned char bg)
 void
 ctlr_changed(int bstart, int bend)
 {
+    fa_index_invalidate();
     REGION_CHANGED(bstart, bend);
 }
 
@@ -3008,14 +3335,25 @@ void
 ctlr_altbuffer(bool alt)
 {
     if (alt != is_altbuffer) {
-	struct ea *etmp;
+	struct ea etmp;
+	int i;
 #if defined(CHECK_AEA_BUF) /*[*/
 	unsigned long stmp;
 #endif /*]*/
 
-	etmp = ea_buf;
-	ea_buf = aea_buf;
-	aea_buf = etmp;
+	/*
+	 * Only ea_alloc has room to slide, so move the live screen back to
+	 * the start of it and exchange contents instead of pointers.
+	 */
+	if (ea_buf != ea_alloc + 1) {
+	    memmove(ea_alloc + 1, ea_buf, maxROWS * maxCOLS * sizeof(struct ea));
+	    ea_buf = ea_alloc + 1;
+	}
+	for (i = 0; i < maxROWS * maxCOLS; i++) {
+	    etmp = ea_buf[i];	/* struct copy */
+	    ea_buf[i] = aea_buf[i];	/* struct copy */
+	    aea_buf[i] = etmp;	/* struct copy */
+	}
 
 #if defined(CHECK_AEA_BUF) /*[*/
 	stmp = ea_sum;
@@ -3029,6 +3367,7 @@ ctlr_altbuffer(bool alt)
 #endif /*]*/
 
 	is_altbuffer = alt;
+	fa_index_invalidate();
 	ALL_CHANGED;
 	unselect(0, ROWS*COLS);
 
@@ -3051,6 +3390,8 @@ mdt_set(int baddr)
     faddr = find_field_attribute(baddr);
     if (faddr >= 0 && !(ea_buf[faddr].fa & FA_MODIFY)) {
 	ea_buf[faddr].fa |= FA_MODIFY;
+	screen_generation++;
+	mark_rows_changed(faddr, faddr + 1);
 	if (appres.modified_sel) {
 	    ALL_CHANGED;
 	}
@@ -3065,6 +3406,8 @@ mdt_clear(int baddr)
     faddr = find_field_attribute(baddr);
     if (faddr >= 0 && (ea_buf[faddr].fa & FA_MODIFY)) {
 	ea_buf[faddr].fa &= ~FA_MODIFY;
+	screen_generation++;
+	mark_rows_changed(faddr, faddr + 1);
 	if (appres.modified_sel) {
 	    ALL_CHANGED;
 	}
@@ -42,6 +42,7 @@
 
 #include "resources.h"
 
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #if defined(_WIN32) /*[*/
 # include "gdi_print.h"
@@ -52,7 +53,6 @@
 #include "unicodec.h"
 #include "utf8.h"
 #include "utils.h"
-#include "varbuf.h"
 #include "vstatus.h"
 
 /* Typedefs */
@@ -63,7 +63,9 @@ typedef struct {
     bool broken;		/* If set, output has failed already. */
     int spp;			/* Screens per page. */
     int screens;		/* Screen count this page. */
-    FILE *file;			/* Stream to write to */
+    FILE *file;			/* Stream to write to, or NULL */
+    varbuf_t *vb;		/* Buffer to write to */
+    varbuf_t obuf;		/* Output buffer, if writing to a stream */
     char *caption;		/* Caption with %T% expanded */
     char *printer_name;		/* Printer name (used by GDI) */
 } real_fps_t;
@@ -72,6 +74,31 @@ typedef struct {
 
 /* Statics */
 
+/* Append a character to the output. */
+static void
+fps_putc(real_fps_t *fps, char c)
+{
+    vb_append(fps->vb, &c, 1);
+}
+
+/*
+ * Write accumulated output to the stream, if there is one.
+ * Returns true for success, false for failure.
+ */
+static bool
+fps_flush(real_fps_t *fps)
+{
+    size_t len = vb_len(fps->vb);
+    bool ok;
+
+    if (fps->file == NULL || len == 0) {
+	return true;
+    }
+    ok = fwrite(vb_buf(fps->vb), 1, len, fps->file) == len;
+    vb_reset(fps->vb);
+    return ok;
+}
+
 /*
  * Map default 3279 colors.  This code is duplicated three times. ;-(
  */
@@ -201,12 +228,13 @@ html_caption(const char *caption)
 }
 
 /*
- * Write a screen trace header to a stream.
+ * Write a screen trace header to a stream or a buffer.
  * Returns the context to use with subsequent calls.
  */
-fps_status_t
-fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
-	const char *printer_name, fps_t *fps_ret, void *wait_context)
+static fps_status_t
+fps_start(FILE *f, varbuf_t *vb, ptype_t ptype, unsigned opts,
+	const char *caption, const char *printer_name, fps_t *fps_ret,
+	void *wait_context)
 {
     real_fps_t *fps;
     int rv = FPS_STATUS_SUCCESS;
@@ -226,6 +254,8 @@ fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
     fps->spp = 1;
     fps->screens = 0;
     fps->file = f;
+    vb_init(&fps->obuf);
+    fps->vb = (vb != NULL)? vb: &fps->obuf;
 
     if (caption != NULL) {
 	char *xcaption;
@@ -275,7 +305,7 @@ fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
 	    pt_nsize = 8;
 	}
 
-	if (fprintf(f, "{\\rtf1\\ansi\\ansicpg%u\\deff0\\deflang1033{"
+	vb_appendf(fps->vb, "{\\rtf1\\ansi\\ansicpg%u\\deff0\\deflang1033{"
 		    "\\fonttbl{\\f0\\fmodern\\fprq1\\fcharset0 %s;}}\n"
 		    "{\\colortbl ;\\red255\\green255\\blue255;\\red0\\green0\\blue0;}"
 		    "\\viewkind4\\uc1\\pard\\f0\\fs%d ",
@@ -284,15 +314,11 @@ fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
 #else /*][*/
 		    1252, /* the number doesn't matter */
 #endif /*]*/
-		    pt_font, pt_nsize * 2) < 0) {
-	    rv = FPS_STATUS_ERROR;
-	}
-	if (rv == FPS_STATUS_SUCCESS && fps->caption != NULL) {
+		    pt_font, pt_nsize * 2);
+	if (fps->caption != NULL) {
 	    char *hcaption = rtf_caption(fps->caption);
 
-	    if (fprintf(f, "%s\\par\\par\n", hcaption) < 0) {
-		rv = FPS_STATUS_ERROR;
-	    }
+	    vb_appendf(fps->vb, "%s\\par\\par\n", hcaption);
 	    Free(hcaption);
 	}
 	break;
@@ -306,32 +332,28 @@ fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
 	}
 
 	/* Print the preamble. */
-	if (!(opts & FPS_NO_HEADER) &&
-		fprintf(f, "<html>\n"
+	if (!(opts & FPS_NO_HEADER)) {
+	    vb_appends(fps->vb, "<html>\n"
 		   "<head>\n"
 		   " <meta http-equiv=\"Content-Type\" "
 		     "content=\"text/html; charset=utf-8\">\n"
 		   "</head>\n"
-		   " <body>\n") < 0) {
-	    rv = FPS_STATUS_ERROR;
+		   " <body>\n");
 	}
-	if (rv == FPS_STATUS_SUCCESS && hcaption) {
-	    if (fprintf(f, "<p>%s</p>\n", hcaption) < 0) {
-		rv = FPS_STATUS_ERROR;
-	    }
+	if (hcaption) {
+	    vb_appendf(fps->vb, "<p>%s</p>\n", hcaption);
 	    Free(hcaption);
 	}
 	break;
     }
     case P_TEXT:
 	if (fps->caption != NULL) {
-	    if (fprintf(f, "%s\n\n", fps->caption) < 0) {
-		rv = FPS_STATUS_ERROR;
-	    }
+	    vb_appendf(fps->vb, "%s\n\n", fps->caption);
 	}
 	break;
     case P_GDI:
 #if defined(_WIN32) /*[*/
+	assert(f != NULL);
 	switch (gdi_print_start(printer_name, opts, wait_context)) {
 	case GDI_STATUS_SUCCESS:
 	    break;
@@ -363,10 +385,15 @@ fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
 	}
     }
 
+    if (rv == FPS_STATUS_SUCCESS && !fps_flush(fps)) {
+	rv = FPS_STATUS_ERROR;
+    }
+
     if (rv != FPS_STATUS_SUCCESS) {
 	/* We've failed; there's no point in returning the context. */
 	Free(fps->caption);
 	Free(fps->printer_name);
+	vb_free(&fps->obuf);
 	Free(fps);
 	*fps_ret = NULL;
     } else {
@@ -376,6 +403,18 @@ fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
     return rv;
 }
 
+/*
+ * Write a screen trace header to a stream.
+ * Returns the context to use with subsequent calls.
+ */
+fps_status_t
+fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
+	const char *printer_name, fps_t *fps_ret, void *wait_context)
+{
+    return fps_start(f, NULL, ptype, opts, caption, printer_name, fps_ret,
+	    wait_context);
+}
+
 /* Get the DBCS state for part of the screen, real or imagined. */
 static enum dbcs_state
 protected_dbcs_state(int baddr)
@@ -476,54 +515,40 @@ fprint_screen_body(fps_t ofps)
     case P_RTF:
 	if (fps->need_separator) {
 	    if (fps->screens < fps->spp) {
-		if (fprintf(fps->file, "\\par\n") < 0) {
-		    FAIL;
-		}
+		vb_appends(fps->vb, "\\par\n");
 	    } else {
-		if (fprintf(fps->file, "\n\\page\n") < 0) {
-		    FAIL;
-		}
+		vb_appends(fps->vb, "\n\\page\n");
 		fps->screens = 0;
 	    }
 	}
 	if (current_high) {
-	    if (fprintf(fps->file, "\\b ") < 0) {
-		FAIL;
-	    }
+	    vb_appends(fps->vb, "\\b ");
 	}
 	break;
     case P_HTML:
-	if (fprintf(fps->file, "  <table border=0>"
-	       "<tr bgcolor=black><td>"
-	       "<pre><span style=\"color:%s;"
+	vb_appendf(fps->vb, "  <table border=0>"
+		"<tr bgcolor=black><td>"
+		"<pre><span style=\"color:%s;"
 				   "background:%s;"
 				   "font-weight:%s;"
 				   "font-style:%s;"
 				   "text-decoration:%s\">",
-	       html_color(current_fg),
-	       html_color(current_bg),
-	       current_high? "bold": "normal",
-	       current_ital? "italic": "normal",
-	       current_underline? "underline": "none") < 0) {
-	    FAIL;
-	}
+		html_color(current_fg),
+		html_color(current_bg),
+		current_high? "bold": "normal",
+		current_ital? "italic": "normal",
+		current_underline? "underline": "none");
 	break;
     case P_TEXT:
 	if (fps->need_separator) {
 	    if ((fps->opts & FPS_FF_SEP) && fps->screens >= fps->spp) {
-		if (fputc('\f', fps->file) < 0) {
-		    FAIL;
-		}
+		fps_putc(fps, '\f');
 		fps->screens = 0;
 	    } else {
 		for (i = 0; i < COLS; i++) {
-		    if (fputc('=', fps->file) < 0) {
-			FAIL;
-		    }
-		}
-		if (fputc('\n', fps->file) < 0) {
-		    FAIL;
+		    fps_putc(fps, '=');
 		}
+		fps_putc(fps, '\n');
 	    }
 	}
 	break;
@@ -561,9 +586,7 @@ fprint_screen_body(fps_t ofps)
 
 	if (i && !(i % COLS)) {
 	    if (fps->ptype == P_HTML) {
-		if (fputc('\n', fps->file) < 0) {
-		    FAIL;
-		}
+		fps_putc(fps, '\n');
 	    } else {
 		nr++;
 	    }
@@ -642,12 +665,8 @@ fprint_screen_body(fps_t ofps)
 	/* Translate to a type-specific format and write it out. */
 	while (nr) {
 	    if (fps->ptype == P_RTF)
-		if (fprintf(fps->file, "\\par") < 0) {
-		    FAIL;
-		}
-	    if (fputc('\n', fps->file) < 0) {
-		FAIL;
-	    }
+		vb_appends(fps->vb, "\\par");
+	    fps_putc(fps, '\n');
 	    nr--;
 	}
 	if (fps->ptype == P_RTF) {
@@ -664,13 +683,9 @@ fprint_screen_body(fps_t ofps)
 	    }
 	    if (high != current_high) {
 		if (high) {
-		    if (fprintf(fps->file, "\\b ") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\b ");
 		} else {
-		    if (fprintf(fps->file, "\\b0 ") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\b0 ");
 		}
 		current_high = high;
 	    }
@@ -683,13 +698,9 @@ fprint_screen_body(fps_t ofps)
 	    }
 	    if (underline != current_underline) {
 		if (underline) {
-		    if (fprintf(fps->file, "\\ul ") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\ul ");
 		} else {
-		    if (fprintf(fps->file, "\\ul0 ") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\ul0 ");
 		}
 		current_underline = underline;
 	    }
@@ -705,13 +716,9 @@ fprint_screen_body(fps_t ofps)
 	    }
 	    if (reverse != current_reverse) {
 		if (reverse) {
-		    if (fprintf(fps->file, "\\cf1\\highlight2 ") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\cf1\\highlight2 ");
 		} else {
-		    if (fprintf(fps->file, "\\cf0\\highlight0 ") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\cf0\\highlight0 ");
 		}
 		current_reverse = reverse;
 	    }
@@ -772,20 +779,18 @@ fprint_screen_body(fps_t ofps)
 		high != current_high ||
 		fa_ital != current_ital ||
 		underline != current_underline) {
-		if (fprintf(fps->file,
-			    "</span><span "
-			    "style=\"color:%s;"
-			    "background:%s;"
-			    "font-weight:%s;"
-			    "font-style:%s;"
-			    "text-decoration:%s\">",
-			    html_color(fg_color),
-			    html_color(bg_color),
-			    high? "bold": "normal",
-			    fa_ital? "italic": "normal",
-			    underline? "underline": "none") < 0) {
-		    FAIL;
-		}
+		vb_appendf(fps->vb,
+			"</span><span "
+			"style=\"color:%s;"
+			"background:%s;"
+			"font-weight:%s;"
+			"font-style:%s;"
+			"text-decoration:%s\">",
+			html_color(fg_color),
+			html_color(bg_color),
+			high? "bold": "normal",
+			fa_ital? "italic": "normal",
+			underline? "underline": "none");
 		current_fg = fg_color;
 		current_bg = bg_color;
 		current_high = high;
@@ -796,59 +801,39 @@ fprint_screen_body(fps_t ofps)
 	any = true;
 	if (fps->ptype == P_RTF) {
 	    if (uc & ~0x7f) {
-		if (fprintf(fps->file, "\\u%u?", uc) < 0) {
-		    FAIL;
-		}
+		vb_appendf(fps->vb, "\\u%u?", uc);
 	    } else {
 		nmb = unicode_to_multibyte(uc, mb, sizeof(mb));
 		if (mb[0] == '\\' || mb[0] == '{' || mb[0] == '}') {
-		    if (fprintf(fps->file, "\\%c", mb[0]) < 0) {
-			FAIL;
-		    }
+		    vb_appendf(fps->vb, "\\%c", mb[0]);
 		} else if (mb[0] == '-') {
-		    if (fprintf(fps->file, "\\_") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\_");
 		} else if (mb[0] == ' ') {
-		    if (fprintf(fps->file, "\\~") < 0) {
-			FAIL;
-		    }
+		    vb_appends(fps->vb, "\\~");
 		} else {
-		    if (fputc(mb[0], fps->file) < 0) {
-			FAIL;
-		    }
+		    fps_putc(fps, mb[0]);
 		}
 	    }
 	} else if (fps->ptype == P_HTML) {
 	    if (uc == '<') {
-		if (fprintf(fps->file, "&lt;") < 0) {
-		    FAIL;
-		}
+		vb_appends(fps->vb, "&lt;");
 	    } else if (uc == '&') {
-		if (fprintf(fps->file, "&amp;") < 0) {
-		    FAIL;
-		}
+		vb_appends(fps->vb, "&amp;");
 	    } else if (uc == '>') {
-		if (fprintf(fps->file, "&gt;") < 0) {
-		    FAIL;
-		}
+		vb_appends(fps->vb, "&gt;");
 	    } else {
 		nmb = unicode_to_utf8(uc, mb);
 		{
 		    int k;
 
 		    for (k = 0; k < nmb; k++) {
-			if (fputc(mb[k], fps->file) < 0) {
-			    FAIL;
-			}
+			fps_putc(fps, mb[k]);
 		    }
 		}
 	    }
 	} else {
 	    nmb = unicode_to_multibyte(uc, mb, sizeof(mb));
-	    if (fputs(mb, fps->file) < 0) {
-		FAIL;
-	    }
+	    vb_appends(fps->vb, mb);
 	}
     }
 
@@ -856,32 +841,29 @@ fprint_screen_body(fps_t ofps)
 	nr++;
     }
     if (!any && !(fps->opts & FPS_EVEN_IF_EMPTY) && fps->ptype == P_TEXT) {
-	return FPS_STATUS_SUCCESS;
+	goto done;
     }
     while (nr) {
 	if (fps->ptype == P_RTF) {
-	    if (fprintf(fps->file, "\\par") < 0) {
-		FAIL;
-	    }
+	    vb_appends(fps->vb, "\\par");
 	}
 	if (fps->ptype == P_TEXT) {
-	    if (fputc('\n', fps->file) < 0) {
-		FAIL;
-	    }
+	    fps_putc(fps, '\n');
 	}
 	nr--;
     }
     if (fps->ptype == P_HTML) {
-	if (fprintf(fps->file, "%s</span></pre></td></tr>\n  </table>\n",
-		    current_high? "</b>": "") < 0) {
-	    FAIL;
-	}
+	vb_appendf(fps->vb, "%s</span></pre></td></tr>\n  </table>\n",
+		current_high? "</b>": "");
     }
     fps->need_separator = true;
     fps->screens++;
     rv = FPS_STATUS_SUCCESS_WRITTEN; /* wrote a screen */
 
 done:
+    if (!fps_flush(fps)) {
+	rv = FPS_STATUS_ERROR;
+    }
     if (FPS_IS_ERROR(rv)) {
 	fps->broken = true;
     }
@@ -907,14 +889,12 @@ fprint_screen_done(fps_t *ofps)
     if (!fps->broken) {
 	switch (fps->ptype) {
 	case P_RTF:
-	    if (fprintf(fps->file, "\n}\n%c", 0) < 0) {
-		rv = FPS_STATUS_ERROR;
-	    }
+	    vb_appends(fps->vb, "\n}\n");
+	    vb_append(fps->vb, "", 1);
 	    break;
 	case P_HTML:
-	    if (!(fps->opts & FPS_NO_HEADER) &&
-		    fprintf(fps->file, " </body>\n</html>\n") < 0) {
-		rv = FPS_STATUS_ERROR;
+	    if (!(fps->opts & FPS_NO_HEADER)) {
+		vb_appends(fps->vb, " </body>\n</html>\n");
 	    }
 	    break;
 #if defined(_WIN32) /*[*/
@@ -928,11 +908,15 @@ fprint_screen_done(fps_t *ofps)
 	default:
 	    break;
 	}
+	if (!fps_flush(fps)) {
+	    rv = FPS_STATUS_ERROR;
+	}
     }
 
     /* Done with the context. */
     Free(fps->caption);
     Free(fps->printer_name);
+    vb_free(&fps->obuf);
     memset(fps, '\0', sizeof(*fps));
     Free(*(void **)ofps);
     *(void **)ofps = NULL;
@@ -941,17 +925,17 @@ fprint_screen_done(fps_t *ofps)
 }
 
 /*
- * Write a header, screen image, and trailer to a file.
+ * Write a header, screen image, and trailer to a file or a buffer.
  */
-fps_status_t
-fprint_screen(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
-	const char *printer_name, void *wait_context)
+static fps_status_t
+fps_print(FILE *f, varbuf_t *vb, ptype_t ptype, unsigned opts,
+	const char *caption, const char *printer_name, void *wait_context)
 {
     fps_t fps;
     fps_status_t srv;
     fps_status_t srv_body;
 
-    srv = fprint_screen_start(f, ptype, opts, caption, printer_name, &fps,
+    srv = fps_start(f, vb, ptype, opts, caption, printer_name, &fps,
 	    wait_context);
     if (FPS_IS_ERROR(srv) || srv == FPS_STATUS_WAIT) {
 	return srv;
@@ -967,3 +951,26 @@ fprint_screen(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
     }
     return srv_body;
 }
+
+/*
+ * Write a header, screen image, and trailer to a file.
+ */
+fps_status_t
+fprint_screen(FILE *f, ptype_t ptype, unsigned opts, const char *caption,
+	const char *printer_name, void *wait_context)
+{
+    return fps_print(f, NULL, ptype, opts, caption, printer_name,
+	    wait_context);
+}
+
+/*
+ * Append a header, screen image, and trailer to a buffer, without going
+ * through a file. Not valid for P_GDI.
+ */
+fps_status_t
+fprint_screen_vb(varbuf_t *vb, ptype_t ptype, unsigned opts,
+	const char *caption)
+{
+    assert(ptype != P_GDI);
+    return fps_print(NULL, vb, ptype, opts, caption, NULL, NULL);
+}
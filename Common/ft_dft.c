@@ -54,6 +54,7 @@
 #define END_TRANSFER	"TRANS03"	/* Message for xfer complete */
 
 #define DFT_MAX_UNGETC	32
+#define DFT_INBUF	65536		/* local file read size */
 
 /* Typedefs. */
 struct data_buffer {
@@ -78,6 +79,16 @@ static size_t dft_savebuf_len = 0;
 static size_t dft_savebuf_max = 0;
 static unsigned char dft_ungetc_cache[DFT_MAX_UNGETC];
 static size_t dft_ungetc_count = 0;
+static unsigned char *dft_inbuf = NULL;	/* block read from the local file */
+static size_t dft_inbuf_len = 0;
+static size_t dft_inbuf_ix = 0;
+static short dft_xlate[256];		/* single-byte upload translation,
+					   -1 if multi-byte or DBCS */
+static unsigned char *dft_nextbuf = NULL; /* data read ahead for next Get */
+static size_t dft_nextbuf_len = 0;
+static size_t dft_nextbuf_max = 0;
+static bool dft_nextbuf_valid = false;
+static int dft_read_errno = 0;
 
 static void dft_abort(const char *s, unsigned short code);
 static void dft_close_request(void);
@@ -86,6 +97,7 @@ static void dft_get_request(void);
 static void dft_insert_request(void);
 static void dft_open_request(unsigned short len, unsigned char *cp);
 static void dft_set_cur_req(void);
+static void dft_xlate_init(void);
 
 /* Process a Transfer Data structured field from the host. */
 void
@@ -177,6 +189,13 @@ dft_open_request(unsigned short len, unsigned char *cp)
     dft_eof = false;
     recnum = 1;
     dft_ungetc_count = 0;
+    dft_inbuf_len = 0;
+    dft_inbuf_ix = 0;
+    dft_nextbuf_valid = false;
+    dft_read_errno = 0;
+    if (!message_flag && !ftc->receive_flag) {
+	dft_xlate_init();
+    }
 
     /* Acknowledge the Open. */
     trace_ds("> WriteStructuredField FileTransferData OpenAck\n");
@@ -431,8 +450,81 @@ store_inbyte(unsigned char c, unsigned char **bufptr, size_t *numbytes)
     }
 }
 
+/* Get a byte from the local file, reading it in blocks. */
+static int
+dft_getc(void)
+{
+    if (dft_inbuf_ix >= dft_inbuf_len) {
+	if (dft_inbuf == NULL) {
+	    dft_inbuf = (unsigned char *)Malloc(DFT_INBUF);
+	}
+	dft_inbuf_len = fread(dft_inbuf, 1, DFT_INBUF, fts.local_file);
+	dft_inbuf_ix = 0;
+	if (!dft_inbuf_len) {
+	    return EOF;
+	}
+    }
+    return dft_inbuf[dft_inbuf_ix++];
+}
+
 /*
- * Read a character from a local file in ASCII mode.
+ * Translate a character for upload, inverting the host's fixed
+ * EBCDIC-to-ASCII conversion table and applying the host code page.
+ * Control codes are treated as Unicode and mapped directly.
+ */
+static ebc_t
+dft_unicode_to_ebcdic(ucs4_t u)
+{
+    if (u < 0x20 || ((u >= 0x80 && u < 0x9f))) {
+	return i_asc2ft[u];
+    } else if (u == 0x9f) {
+	return 0xff;
+    } else {
+	return unicode_to_ebcdic(u);
+    }
+}
+
+/*
+ * Build the translation table for an upload: for each local byte that is a
+ * complete single-byte character, the byte to send to the host.
+ */
+static void
+dft_xlate_init(void)
+{
+    int c;
+
+    for (c = 0; c < 256; c++) {
+	char mb = (char)c;
+	int consumed;
+	enum me_fail error = ME_NONE;
+	ucs4_t u;
+	ebc_t e;
+
+	if (!ftc->remap_flag) {
+	    dft_xlate[c] = c;
+	    continue;
+	}
+	u = ft_multibyte_to_unicode(&mb, 1, &consumed, &error);
+	if (error == ME_SHORT) {
+	    dft_xlate[c] = -1;
+	    continue;
+	}
+	if (error == ME_INVALID) {
+	    mb = '?';
+	    error = ME_NONE;
+	    u = ft_multibyte_to_unicode(&mb, 1, &consumed, &error);
+	}
+	e = dft_unicode_to_ebcdic(u);
+	if (e & 0xff00) {
+	    dft_xlate[c] = -1;
+	} else {
+	    dft_xlate[c] = e? i_ft2asc[e]: '?';
+	}
+    }
+}
+
+/*
+ * Read characters from a local file in ASCII mode.
  * Stores the data in 'bufptr' and returns the number of bytes stored.
  * Returns -1 for EOF.
  */
@@ -468,12 +560,42 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
 	return nm;
     }
 
+    /* Translate single-byte characters from the table, a block at a time. */
+    if (!fts.last_dbcs) {
+	unsigned char *bp0 = bufptr;
+
+	while (numbytes && dft_inbuf_ix < dft_inbuf_len) {
+	    unsigned char b = dft_inbuf[dft_inbuf_ix];
+
+	    if (dft_xlate[b] < 0) {
+		break;
+	    }
+	    if (b == '\n' && ftc->cr_flag && !fts.last_cr) {
+		/* Expand NL to CR/LF. */
+		if (numbytes < 2) {
+		    break;
+		}
+		*bufptr++ = '\r';
+		*bufptr++ = '\n';
+		numbytes -= 2;
+	    } else {
+		*bufptr++ = (unsigned char)dft_xlate[b];
+		numbytes--;
+	    }
+	    fts.last_cr = (b == '\r');
+	    dft_inbuf_ix++;
+	}
+	if (bufptr != bp0) {
+	    return bufptr - bp0;
+	}
+    }
+
     if (ftc->remap_flag) {
 	/* Read bytes until we have a legal multibyte sequence. */
 	do {
 	    int consumed;
 
-	    c = fgetc(fts.local_file);
+	    c = dft_getc();
 	    if (c == EOF) {
 		if (fts.last_dbcs) {
 		    *bufptr = EBC_si;
@@ -493,7 +615,7 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
 	} while (error == ME_SHORT);
     } else {
 	/* Get a byte from the file. */
-	c = fgetc(fts.local_file);
+	c = dft_getc();
 	if (c == EOF) {
 	    return -1;
 	}
@@ -523,20 +645,9 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
 	return 1;
     }
 
-    /*
-     * Translate, inverting the host's fixed EBCDIC-to-ASCII conversion
-     * table and applying the host code page.
-     * Control codes are treated as Unicode and mapped directly.
-     * We also handle DBCS here.
-     */
+    /* Translate, handling DBCS. */
     u = ft_multibyte_to_unicode(inbuf, in_ix, &consumed, &error);
-    if (u < 0x20 || ((u >= 0x80 && u < 0x9f))) {
-	e = i_asc2ft[u];
-    } else if (u == 0x9f) {
-	e = 0xff;
-    } else {
-	e = unicode_to_ebcdic(u);
-    }
+    e = dft_unicode_to_ebcdic(u);
     if (e & 0xff00) {
 	unsigned char *bp0 = bufptr;
 
@@ -562,27 +673,16 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
     }
 }
 
-/* Process a Get request. */
-static void
-dft_get_request(void)
+/*
+ * Read up to 'numbytes' bytes of upload data into 'bufptr'.
+ * Returns the number of bytes read.
+ */
+static size_t
+dft_fill(unsigned char *bufptr, size_t numbytes)
 {
-    size_t numbytes;
     size_t numread;
     size_t total_read = 0;
-    unsigned char *bufptr;
-
-    trace_ds(" Get\n");
 
-    if (!message_flag && ft_state == FT_ABORT_WAIT) {
-	dft_abort(get_message("ftUserCancel"), TR_GET_REQ);
-	return;
-    }
-
-    /* Read a buffer's worth. */
-    space3270out(ftc->dft_buffersize);
-    numbytes = ftc->dft_buffersize - 27; /* always read 5 bytes less than we're
-				            allowed */
-    bufptr = obuf + 17;
     while (!dft_eof && numbytes) {
 	if (ftc->ascii_flag && (ftc->remap_flag || ftc->cr_flag)) {
 	    numread = dft_ascii_read(bufptr, numbytes);
@@ -611,11 +711,47 @@ dft_get_request(void)
 	}
     }
 
+    /* Remember a read error until it can be reported. */
+    if (ferror(fts.local_file) && !dft_read_errno) {
+	dft_read_errno = errno? errno: EIO;
+    }
+    return total_read;
+}
+
+/* Process a Get request. */
+static void
+dft_get_request(void)
+{
+    size_t numbytes;
+    size_t total_read;
+    unsigned char *bufptr;
+
+    trace_ds(" Get\n");
+
+    if (!message_flag && ft_state == FT_ABORT_WAIT) {
+	dft_abort(get_message("ftUserCancel"), TR_GET_REQ);
+	return;
+    }
+
+    /* Read a buffer's worth, unless it was read ahead. */
+    space3270out(ftc->dft_buffersize);
+    numbytes = ftc->dft_buffersize - 27; /* always read 5 bytes less than we're
+				            allowed */
+    bufptr = obuf + 17;
+    if (dft_nextbuf_valid) {
+	total_read = dft_nextbuf_len;
+	memcpy(bufptr, dft_nextbuf, total_read);
+	dft_nextbuf_valid = false;
+    } else {
+	total_read = dft_fill(bufptr, numbytes);
+    }
+
     /* Check for read error. */
-    if (ferror(fts.local_file)) {
+    if (dft_read_errno) {
 	char *buf;
 
-	buf = Asprintf("read(%s): %s", ftc->local_filename, strerror(errno));
+	buf = Asprintf("read(%s): %s", ftc->local_filename,
+		strerror(dft_read_errno));
 	dft_abort(buf, TR_GET_REQ);
 	Free(buf);
 	return;
@@ -666,6 +802,19 @@ dft_get_request(void)
     /* Write the data. */
     net_output();
     ft_update_length();
+
+    /*
+     * Read and translate the next buffer now, while the host is processing
+     * this one.
+     */
+    if (total_read && !dft_eof) {
+	if (numbytes > dft_nextbuf_max) {
+	    dft_nextbuf_max = numbytes;
+	    Replace(dft_nextbuf, (unsigned char *)Malloc(dft_nextbuf_max));
+	}
+	dft_nextbuf_len = dft_fill(dft_nextbuf, numbytes);
+	dft_nextbuf_valid = true;
+    }
 }
 
 /* Process a Close request. */
@@ -450,6 +450,7 @@ set_appres_defaults(void)
     appres.contention_resolution = true;
     appres.new_environ = true;
     appres.max_recent = 5;
+    appres.expect_buffer_size = NVT_SAVE_SIZE;
 
     appres.ft.dft_buffer_size = DFT_BUF;
 
@@ -860,6 +861,8 @@ static res_t base_resources[] = {
     { ResDbcsCgcsgid, aoffset(dbcs_cgcsgid),	XRM_STRING },
     { ResDevName,	aoffset(devname),	XRM_STRING },
     { ResEof,		aoffset(linemode.eof),	XRM_STRING },
+    { ResEventBackend,	aoffset(event_backend),	XRM_STRING },
+    { ResExpectBufferSize,aoffset(expect_buffer_size),XRM_INT },
     { ResErase,		aoffset(linemode.erase),	XRM_STRING },
     { ResExtendedDataStream, aoffset(extended_data_stream),	XRM_BOOLEAN },
     { ResFtAllocation,	aoffset(ft.allocation),	XRM_STRING },
@@ -926,6 +929,8 @@ static res_t base_resources[] = {
     { ResTermName,	aoffset(termname),	XRM_STRING },
     { ResTraceDir,	aoffset(trace_dir),	XRM_STRING },
     { ResTraceFile,	aoffset(trace_file),	XRM_STRING },
+    { ResTraceBinaryFile,aoffset(trace_binary_file),XRM_STRING },
+    { ResTraceBufferSize,aoffset(trace_buffer_size),XRM_STRING },
     { ResTraceFileSize,aoffset(trace_file_size),	XRM_STRING },
     { ResTraceMonitor,aoffset(trace_monitor),	XRM_BOOLEAN },
     { ResUnlockDelay,aoffset(unlock_delay),	XRM_BOOLEAN },
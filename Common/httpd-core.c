@@ -115,6 +115,9 @@ typedef struct {
     /* Global state */
     void *mhandle;	/* the handle from the main procedure */
     unsigned long seq;	/* connection sequence number, for tracing */
+    varbuf_t pipeline;	/* pipelined input held while a request is pending */
+    varbuf_t obuf;	/* output not yet sent */
+    bool processing;	/* processing input */
 
     /* Per-request state */
     request_t request;
@@ -253,6 +256,7 @@ httpd_data_trace(httpd_t *h, const char *direction, const char *buf,
 
 /**
  * Send data on a connection.
+ * The data is accumulated and written out by httpd_flush().
  *
  * @param[in] h		State
  * @param[in] buf	Data buffer
@@ -262,7 +266,21 @@ static void
 httpd_send(httpd_t *h, const char *buf, size_t len)
 {
     httpd_data_trace(h, ">", buf, len, &h->request.ot_offset);
-    hio_send(h->mhandle, buf, len);
+    vb_append(&h->obuf, buf, len);
+}
+
+/**
+ * Write accumulated output to the socket.
+ *
+ * @param[in,out] h	State
+ */
+static void
+httpd_flush(httpd_t *h)
+{
+    if (vb_len(&h->obuf)) {
+	hio_send(h->mhandle, vb_buf(&h->obuf), vb_len(&h->obuf));
+	vb_reset(&h->obuf);
+    }
 }
 
 /**
@@ -439,6 +457,9 @@ httpd_reinit_request(request_t *r)
     r->rll = 0;
     r->http_1_0 = false;
     r->persistent = true;
+    r->uri = NULL;
+    r->query = NULL;
+    r->fragment = NULL;
     free_fields(&r->fields);
     r->fields_start = NULL;
     free_fields(&r->queries);
@@ -492,6 +513,8 @@ static void
 httpd_init_state(httpd_t *h, void *mhandle)
 {
     httpd_init_request(&h->request);
+    vb_init(&h->pipeline);
+    vb_init(&h->obuf);
 
     h->mhandle = mhandle;
     h->seq = httpd_seq++;
@@ -537,6 +560,8 @@ httpd_http_header(httpd_t *h, int status_code, bool do_close,
     httpd_print(h, HP_BUFFER, "Server: %s\n", build);
     if (do_close) {
 	httpd_print(h, HP_BUFFER, "Connection: close\n");
+    } else if (r->http_1_0) {
+	httpd_print(h, HP_BUFFER, "Connection: keep-alive\n");
     }
     if (status_code == 301 && r->location != NULL) {
 	httpd_print(h, HP_BUFFER, "Location: %s\n", r->location);
@@ -1605,8 +1630,9 @@ httpd_digest_fields(httpd_t *h)
      * Parse the fields.
      *  We ignore fields we don't understand.
      *  We require, but actually pay no attention to, the host field.
-     *  We understand 'connection: close', but ignore other 'connection:'
-     *   values. The close state is left in r->persistent.
+     *  We understand 'connection: close', and 'connection: keep-alive' from
+     *   HTTP 1.0 clients, but ignore other 'connection:' values. The close
+     *   state is left in r->persistent.
      * I'm sure this is HTTP 1.1 blasphemy.
      */
     while (*s) {
@@ -1696,9 +1722,12 @@ httpd_digest_fields(httpd_t *h)
     }
 
     /* Check for connection close request. */
-    if ((connection = lookup_field("Connection", r->fields)) != NULL &&
-	    !strcasecmp(connection, "close")) {
-	r->persistent = false;
+    if ((connection = lookup_field("Connection", r->fields)) != NULL) {
+	if (!strcasecmp(connection, "close")) {
+	    r->persistent = false;
+	} else if (r->http_1_0 && !strcasecmp(connection, "keep-alive")) {
+	    r->persistent = true;
+	}
     }
 
     /* Decode the content type. */
@@ -1816,80 +1845,202 @@ httpd_digest_request(httpd_t *h)
 }
 
 /**
- * Process a byte of incoming HTTP data.
+ * Report a request that is too big to store.
  *
  * @param[in,out] h	State
- * @param[in] c		Next input character
  *
  * @return httpd_status_t
  */
-static int
-httpd_input_char(httpd_t *h, char c)
+static httpd_status_t
+httpd_too_big(httpd_t *h)
+{
+    return httpd_error(h,
+	    h->request.saw_first? ERRMODE_FATAL: ERRMODE_NON_HTTP,
+	    CT_HTML, 400, "The request is too big.");
+}
+
+/**
+ * Process a line of incoming HTTP data.
+ *
+ * The line, with CRs removed, has already been stored in r->request_buf.
+ *
+ * @param[in,out] h	State
+ *
+ * @return httpd_status_t
+ */
+static httpd_status_t
+httpd_input_line(httpd_t *h)
 {
     request_t *r = &h->request;
+    httpd_status_t rv;
 
-    /* If there's no room to store the character, we're done. */
-    if (r->nr >= MAX_HTTPD_REQUEST) {
-	return httpd_error(h,
-		r->saw_first? ERRMODE_FATAL: ERRMODE_NON_HTTP,
-		CT_HTML, 400, "The request is too big.");
+    if (r->rll == 0) {
+	/* Empty line: digest the fields. */
+	if (!r->saw_first) {
+	    return httpd_error(h, ERRMODE_FATAL, CT_HTML, 400,
+		    "Missing request.");
+	}
+	r->request_buf[r->nr] = '\0';
+	rv = httpd_digest_fields(h);
+	if (rv != HS_CONTINUE) {
+	    return rv;
+	}
+	if (!r->content_length) {
+	    /* No content, process the entire request. */
+	    return httpd_digest_request(h);
+	}
+	return rv;
     }
 
-    if (!r->content_length_left && c == '\r') {
-	return HS_CONTINUE;
+    /* Beginning of new line; set the length to 0. */
+    r->rll = 0;
+
+    /* If this is the first line, validate it. */
+    if (!r->saw_first) {
+	r->request_buf[r->nr - 1] = '\0';
+	r->fields_start = &r->request_buf[r->nr];
+	r->saw_first = true;
+	return httpd_digest_request_line(h);
     }
 
-    /* Store the character. */
-    r->request_buf[r->nr++] = c;
+    /* Not done yet. */
+    return HS_CONTINUE;
+}
 
-    /* Check for content. */
-    if (r->content_length_left) {
-	if (!--r->content_length_left) {
-	    r->request_buf[r->nr] = '\0';
-	    return httpd_digest_request(h);
-	}
-	return HS_CONTINUE;
-    }
+/**
+ * Process a block of incoming HTTP data.
+ *
+ * Header lines are copied a line at a time, skipping CRs, and content is
+ * copied in one piece. Processing stops at the end of the data or as soon as
+ * a request is complete, whichever comes first.
+ *
+ * @param[in,out] h	State
+ * @param[in] data	Data buffer
+ * @param[in] len	Length of data
+ * @param[out] consumed	Number of bytes processed
+ *
+ * @return httpd_status_t
+ */
+static httpd_status_t
+httpd_input_block(httpd_t *h, const char *data, size_t len, size_t *consumed)
+{
+    request_t *r = &h->request;
+    size_t pos = 0;
+    httpd_status_t rv = HS_CONTINUE;
 
-    /* Check for a newline. */
-    if (c == '\n') {
-	if (r->rll == 0) {
-	    httpd_status_t rv;
+    while (pos < len && rv == HS_CONTINUE) {
+	const char *nl;
+	size_t eol;
 
-	    /* Empty line: digest the fields. */
-	    if (!r->saw_first) {
-		return httpd_error(h, ERRMODE_FATAL, CT_HTML, 400,
-			"Missing request.");
+	/* Check for content. */
+	if (r->content_length_left) {
+	    size_t n = len - pos;
+
+	    if (r->content_length_left > 0 &&
+		    (size_t)r->content_length_left < n) {
+		n = r->content_length_left;
 	    }
-	    r->request_buf[r->nr] = '\0';
-	    rv = httpd_digest_fields(h);
-	    if (rv != HS_CONTINUE) {
-		return rv;
+	    if (r->nr + n > MAX_HTTPD_REQUEST) {
+		rv = httpd_too_big(h);
+		break;
 	    }
-	    if (!r->content_length) {
-		/* No content, process the entire request. */
-		return httpd_digest_request(h);
+	    memcpy(&r->request_buf[r->nr], data + pos, n);
+	    r->nr += (int)n;
+	    r->content_length_left -= (int)n;
+	    pos += n;
+	    if (!r->content_length_left) {
+		r->request_buf[r->nr] = '\0';
+		rv = httpd_digest_request(h);
 	    }
-	    return rv;
-	} else {
-	    /* Beginning of new line; set the length to 0. */
-	    r->rll = 0;
-
-	    /* If this is the first line, validate it. */
-	    if (!r->saw_first) {
-		r->request_buf[r->nr - 1] = '\0';
-		r->fields_start = &r->request_buf[r->nr];
-		r->saw_first = true;
-		return httpd_digest_request_line(h);
+	    continue;
+	}
+
+	/* Store the text up to the next newline, skipping CRs. */
+	nl = memchr(data + pos, '\n', len - pos);
+	eol = (nl != NULL)? (size_t)(nl - data): len;
+	while (pos < eol) {
+	    const char *cr = memchr(data + pos, '\r', eol - pos);
+	    size_t run = ((cr != NULL)? (size_t)(cr - data): eol) - pos;
+
+	    if (r->nr + run > MAX_HTTPD_REQUEST) {
+		rv = httpd_too_big(h);
+		break;
+	    }
+	    memcpy(&r->request_buf[r->nr], data + pos, run);
+	    r->nr += (int)run;
+	    r->rll += (int)run;
+	    pos += run;
+	    if (cr != NULL) {
+		pos++;
 	    }
 	}
-    } else {
-	/* Non-newline character: increment the line length. */
-	r->rll++;
+	if (rv != HS_CONTINUE || nl == NULL) {
+	    break;
+	}
+
+	/* Store the newline and process the line. */
+	if (r->nr >= MAX_HTTPD_REQUEST) {
+	    rv = httpd_too_big(h);
+	    break;
+	}
+	r->request_buf[r->nr++] = '\n';
+	pos++;
+	rv = httpd_input_line(h);
     }
 
-    /* Not done yet. */
-    return HS_CONTINUE;
+    *consumed = pos;
+    return rv;
+}
+
+/**
+ * Process incoming HTTP data, which may hold several pipelined requests.
+ *
+ * If a request is pending, the data after it is held until httpd_resume() is
+ * called.
+ *
+ * @param[in,out] h	State
+ * @param[in] data	Data buffer
+ * @param[in] len	Length of data
+ *
+ * @return httpd_status_t
+ */
+static httpd_status_t
+httpd_process(httpd_t *h, const char *data, size_t len)
+{
+    request_t *r = &h->request;
+    httpd_status_t rv = HS_CONTINUE;
+    size_t consumed;
+
+    h->processing = true;
+    while (len > 0) {
+	rv = httpd_input_block(h, data, len, &consumed);
+	data += consumed;
+	len -= consumed;
+	if (rv == HS_SUCCESS_OPEN || rv == HS_ERROR_OPEN) {
+	    /*
+	     * A method that completed synchronously can leave a
+	     * non-persistent request behind.
+	     */
+	    if (!r->persistent) {
+		rv = (rv == HS_SUCCESS_OPEN)? HS_SUCCESS_CLOSE: HS_ERROR_CLOSE;
+		break;
+	    }
+
+	    /* Go on to the next request. */
+	    httpd_reinit_request(r);
+	} else if (rv == HS_PENDING) {
+	    /* Request pending, hold off further input. */
+	    vb_append(&h->pipeline, data, len);
+	    break;
+	} else if (rv != HS_CONTINUE) {
+	    /* Close the socket. */
+	    break;
+	}
+    }
+    h->processing = false;
+
+    httpd_flush(h);
+    return rv;
 }
 
 /*****************************************************************************
@@ -2107,36 +2258,31 @@ httpd_status_t
 httpd_input(void *dhandle, const char *data, size_t len)
 {
     httpd_t *h = (httpd_t *)dhandle;
-    request_t *r = &h->request;
-    size_t i;
-    httpd_status_t rv = HS_CONTINUE;
 
-    httpd_data_trace(h, "<", data, len, &r->it_offset);
+    httpd_data_trace(h, "<", data, len, &h->request.it_offset);
+    return httpd_process(h, data, len);
+}
 
-    /* Process a byte at a time, skipping CRs. */
-    for (i = 0; i < len; i++) {
-	switch ((rv = httpd_input_char(h, data[i]))) {
-	case HS_CONTINUE:
-	    /* Keep parsing. */
-	    continue;
-	case HS_SUCCESS_OPEN:
-	    httpd_reinit_request(r);
-	    return rv;
-	case HS_ERROR_OPEN:
-	    /* Request failed, but keep the socket open. */
-	    httpd_reinit_request(r);
-	    /* fall through */
-	case HS_ERROR_CLOSE:
-	    /* Request failed, close the socket. */
-	case HS_SUCCESS_CLOSE:
-	    /* Request succeeded, close the socket. */
-	case HS_PENDING:
-	    /* Request pending, hold off further input. */
-	    return rv;
-	}
-    }
+/**
+ * Resume processing input after a pending request completes.
+ *
+ * Called when asynchronous processing is finished, to process any requests
+ * that were pipelined behind the pending one.
+ *
+ * @param[in] dhandle	handle returned by httpd_new
+ *
+ * @return httpd_status_t
+ */
+httpd_status_t
+httpd_resume(void *dhandle)
+{
+    httpd_t *h = (httpd_t *)dhandle;
+    varbuf_t pipeline = h->pipeline;
+    httpd_status_t rv;
 
-    /* Success, at least so far. */
+    vb_init(&h->pipeline);
+    rv = httpd_process(h, vb_buf(&pipeline), vb_len(&pipeline));
+    vb_free(&pipeline);
     return rv;
 }
 
@@ -2153,8 +2299,13 @@ httpd_close(void *dhandle, const char *why)
 
     vtrace("h> [%lu] Close: %s\n", h->seq, why);
 
+    /* Write any output that is still pending. */
+    httpd_flush(h);
+
     /* Wipe the existing request state. */
     httpd_free_request(&h->request);
+    vb_free(&h->pipeline);
+    vb_free(&h->obuf);
 
     /* Free it. */
     memset(h, 0, sizeof(*h));
@@ -2239,6 +2390,11 @@ httpd_dyn_complete(void *dhandle, const char *format, ...)
 	break;
     }
 
+    /* Write it, unless we are in the middle of processing input. */
+    if (!h->processing) {
+	httpd_flush(h);
+    }
+
     /* Return status. */
     if (!r->persistent) {
 	return HS_SUCCESS_CLOSE;
@@ -2279,6 +2435,9 @@ httpd_dyn_error(void *dhandle, content_t content_type, int status_code,
     rv = httpd_verror(h, ERRMODE_NONFATAL, content_type, status_code, r->verb,
 	    jresult, format, ap);
     va_end(ap);
+    if (!h->processing) {
+	httpd_flush(h);
+    }
 
     return rv;
 }
@@ -35,6 +35,7 @@
 #if !defined(_WIN32) /*[*/
 # include <unistd.h>
 # include <netinet/in.h>
+# include <netinet/tcp.h>
 # include <sys/select.h>
 # include <arpa/inet.h>
 #endif /*]*/
@@ -67,6 +68,7 @@
 #endif /*]*/
 
 #define IDLE_MAX	15
+#define INPUT_BUFSIZE	16384
 
 struct hio_listener {
     llist_t link;	/* list linkage */
@@ -93,6 +95,7 @@ typedef struct {
     int idle;
     ioid_t ioid;	/* AddInput ID */
     ioid_t toid;	/* AddTimeOut ID */
+    bool in_input;	/* processing input */
 
     struct {		/* pending command state: */
 	sendto_callback_t *callback; /* callback function */
@@ -105,6 +108,8 @@ typedef struct {
 } session_t;
 llist_t sessions = LLIST_INIT(sessions);
 
+static void hio_input_status(session_t *session, httpd_status_t rv);
+
 /**
  * Return the text for the most recent socket error.
  *
@@ -212,7 +217,7 @@ void
 hio_socket_input(iosrc_t fd, ioid_t id)
 {
     session_t *session;
-    char buf[1024];
+    char buf[INPUT_BUFSIZE];
     ssize_t nr;
 
     session = NULL;
@@ -258,18 +263,53 @@ hio_socket_input(iosrc_t fd, ioid_t id)
     } else {
 	httpd_status_t rv;
 
+	session->in_input = true;
 	rv = httpd_input(session->dhandle, buf, nr);
-	if (rv < 0) {
-	    httpd_close(session->dhandle, "protocol error");
-	    hio_socket_close(session);
-	} else if (rv == HS_PENDING) {
-	    /* Stop input on this socket. */
+	session->in_input = false;
+	hio_input_status(session, rv);
+    }
+}
+
+/**
+ * Act on the status returned by the httpd core after processing input.
+ *
+ * @param[in] session	Session
+ * @param[in] rv	Status
+ */
+static void
+hio_input_status(session_t *session, httpd_status_t rv)
+{
+    if (rv < 0) {
+	httpd_close(session->dhandle, "protocol error");
+	hio_socket_close(session);
+	return;
+    }
+
+    if (rv == HS_PENDING) {
+	/* Stop input on this socket. */
+	if (session->ioid != NULL_IOID) {
 	    RemoveInput(session->ioid);
 	    session->ioid = NULL_IOID;
-	} else if (session->toid == NULL_IOID) {
-	    /* Leave input enabled and start the timeout. */
-	    session->toid = AddTimeOut(IDLE_MAX * 1000, hio_timeout);
 	}
+	return;
+    }
+
+    /* Allow more input. */
+    if (session->ioid == NULL_IOID) {
+#if !defined(_WIN32) /*[*/
+	session->ioid = AddInput(session->s, hio_socket_input);
+#else /*][*/
+	session->ioid = AddInput(session->event, hio_socket_input);
+#endif /*]*/
+    }
+
+    /*
+     * Set a timeout for that input to arrive. We didn't set this timeout
+     * as soon as the last input arrived, because it might have taken us a
+     * long time to proces the last request.
+     */
+    if (session->toid == NULL_IOID) {
+	session->toid = AddTimeOut(IDLE_MAX * 1000, hio_timeout);
     }
 }
 
@@ -293,6 +333,7 @@ hio_connection(iosrc_t fd, ioid_t id)
     socklen_t len;
     char hostbuf[128];
     session_t *session;
+    int on = 1;
 
     /* Find the listener. */
     FOREACH_LLIST(&listeners, l, hio_listener_t *) {
@@ -324,6 +365,12 @@ hio_connection(iosrc_t fd, ioid_t id)
     fcntl(t, F_SETFD, 1);
 #endif /*]*/
 
+    /* Responses are written in one piece, so don't delay them. */
+    if (setsockopt(t, IPPROTO_TCP, TCP_NODELAY, (char *)&on,
+		sizeof(on)) < 0) {
+	vtrace("httpd setsockopt(TCP_NODELAY): %s\n", socket_errtext());
+    }
+
     session = Malloc(sizeof(session_t));
     memset(session, 0, sizeof(session_t));
     session->listener = l;
@@ -654,18 +701,25 @@ hio_complete(task_cbh handle, bool success, bool abort)
 {
     session_t *s = handle;
     char *prompt = task_cb_prompt(handle);
+    varbuf_t result = s->pending.result;
+    json_t *jresult = s->pending.jresult;
 
     /* We're done. */
     s->pending.done = true;
 
+    /*
+     * Get ready for the next command. This is done first, because the
+     * callback can close the session.
+     */
+    vb_init(&s->pending.result);
+    s->pending.jresult = NULL;
+
     /* Pass the result up to the node. */
     s->pending.callback(s->dhandle, success? SC_SUCCESS: SC_USER_ERROR,
-	    vb_buf(&s->pending.result), vb_len(&s->pending.result),
-	    s->pending.jresult, prompt, strlen(prompt));
+	    vb_buf(&result), vb_len(&result), jresult, prompt, strlen(prompt));
 
-    /* Get ready for the next command. */
-    vb_reset(&s->pending.result);
-    json_free(s->pending.jresult);
+    vb_free(&result);
+    json_free(jresult);
 
     /* This is always the end of the command. */
     return true;
@@ -802,28 +856,21 @@ hio_async_done(void *dhandle, httpd_status_t rv)
 {
     session_t *session = httpd_mhandle(dhandle);
 
-    if (rv < 0) {
-	hio_socket_close(session);
+    /*
+     * If the request completed while its input was still being processed,
+     * the input logic will take care of the status.
+     */
+    if (session->in_input) {
 	return;
     }
 
-    /* Allow more input. */
-    if (session->ioid == NULL_IOID) {
-#if !defined(_WIN32) /*[*/
-	session->ioid = AddInput(session->s, hio_socket_input);
-#else /*][*/
-	session->ioid = AddInput(session->event, hio_socket_input);
-#endif /*]*/
-    }
-
-    /*
-     * Set a timeout for that input to arrive. We didn't set this timeout
-     * as soon as the last input arrived, because it might have taken us a
-     * long time to proces the last request.
-     */
-    if (session->toid == NULL_IOID) {
-	session->toid = AddTimeOut(IDLE_MAX * 1000, hio_timeout);
+    /* Process any requests that were pipelined behind this one. */
+    if (rv >= 0) {
+	session->in_input = true;
+	rv = httpd_resume(dhandle);
+	session->in_input = false;
     }
+    hio_input_status(session, rv);
 }
 
 /**
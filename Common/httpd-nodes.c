@@ -42,21 +42,17 @@
 #include <fcntl.h>
 #include <assert.h>
 
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #include "json.h"
 #include "s3270_proto.h"
 #include "txa.h"
-#include "varbuf.h"
 
 #include "httpd-core.h"
 #include "httpd-io.h"
 #include "httpd-nodes.h"
 #include "task.h"
 
-#if defined(_WIN32) /*[*/
-# include "winprint.h"
-#endif /*]*/
-
 extern unsigned char favicon[];
 extern unsigned favicon_size;
 
@@ -72,72 +68,23 @@ extern unsigned favicon_size;
 static bool
 hn_image(void *dhandle, varbuf_t *image, httpd_status_t *status)
 {
-    httpd_status_t rv;
-    int fd;
-    FILE *f;
-    char *temp_name;
-    char buf[8192];
-
-    /* Open the temporary file. */
-#if defined(_WIN32) /*[*/
-    fd = win_mkstemp(&temp_name, P_HTML);
-#else /*][*/
-    temp_name = NewString("/tmp/x3hXXXXXX");
-    fd = mkstemp(temp_name);
-#endif /*]*/
-    if (fd < 0) {
-	rv = httpd_dyn_error(dhandle, CT_HTML, 400, NULL,
-		"Internal error (open)");
-	unlink(temp_name);
-	Free(temp_name);
-	*status = rv;
-	return false;
-    }
-    f = fdopen(fd, "w+");
-    if (f == NULL) {
-	rv = httpd_dyn_error(dhandle, CT_HTML, 400, NULL,
-		"Internal error (fdopen)");
-	close(fd);
-	unlink(temp_name);
-	Free(temp_name);
-	*status = rv;
-	return false;
-    }
-
-    /* Write the screen to it in HTML. */
-    switch (fprint_screen(f, P_HTML, FPS_NO_HEADER | FPS_OIA, NULL, NULL,
-		NULL)) {
+    /* Write the screen into the buffer in HTML. */
+    vb_init(image);
+    switch (fprint_screen_vb(image, P_HTML, FPS_NO_HEADER | FPS_OIA, NULL)) {
     case FPS_STATUS_SUCCESS:
     case FPS_STATUS_SUCCESS_WRITTEN:
 	break;
     case FPS_STATUS_ERROR:
     case FPS_STATUS_CANCEL:
-	rv = httpd_dyn_error(dhandle, CT_HTML, 400, NULL,
+	vb_free(image);
+	*status = httpd_dyn_error(dhandle, CT_HTML, 400, NULL,
 		"Internal error (fprint_screen)");
-	fclose(f);
-	unlink(temp_name);
-	Free(temp_name);
-	*status = rv;
 	return false;
     case FPS_STATUS_WAIT:
 	assert(false);
 	return false;
     }
 
-
-    /* Read it back into a varbuf_t. */
-    fflush(f);
-    rewind(f);
-    vb_init(image);
-    while (fgets(buf, sizeof(buf), f) != NULL) {
-	vb_appends(image, buf);
-    }
-
-    /* Dispose of the file. */
-    fclose(f);
-    unlink(temp_name);
-    Free(temp_name);
-
     /* Success. */
     return true;
 }
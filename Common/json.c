@@ -66,10 +66,42 @@ typedef enum {
     JK_BAREWORD,	/* bare word */
     JK_NUMBER,		/* number */
     JK_STRING,		/* string */
-    JK_STRING_BS,	/* backslash inside string */
-    JK_TERMINAL		/* parsing complete */
+    JK_STRING_BS	/* backslash inside string */
 } json_token_state_t;
 
+/* States for parsing the inside of an array or object. */
+typedef enum {
+    JF_ARRAY_VALUE,	/* array: expecting a value, ',' or ']' */
+    JF_ARRAY_NEXT,	/* array: expecting ',' or ']' */
+    JF_OBJECT_KEY,	/* object: expecting a key or '}' */
+    JF_OBJECT_COLON,	/* object: expecting ':' */
+    JF_OBJECT_VALUE,	/* object: expecting a value */
+    JF_OBJECT_NEXT	/* object: expecting ',' or '}' */
+} json_frame_state_t;
+
+/* An array or object being parsed. */
+typedef struct {
+    json_t *json;		/* array or object being built */
+    json_frame_state_t state;	/* parsing state */
+    unsigned alloc;		/* allocated members */
+    char *key;			/* pending object key */
+    size_t key_length;		/* pending object key length */
+} json_frame_t;
+
+/* Incremental parser state. */
+struct json_stream {
+    json_token_state_t token_state; /* token state */
+    varbuf_t token;		/* current token, in UTF-8 */
+    json_frame_t *frames;	/* stack of open arrays and objects */
+    unsigned depth;		/* number of open arrays and objects */
+    unsigned frames_alloc;	/* allocated frames */
+    char partial[6];		/* UTF-8 sequence split across calls */
+    int partial_len;		/* length of split sequence */
+    int line;			/* line number */
+    int column;			/* column number */
+    size_t offset;		/* byte offset */
+};
+
 /* Number parsing return values. */
 typedef enum {
     NP_SUCCESS,		/* successful parsing */
@@ -83,11 +115,6 @@ typedef enum {
     SP_FAILURE		/* unsuccessful parsing */
 } sp_ret_t;
 
-/* Barewords. */
-static ucs4_t u_null[] = { 'n', 'u', 'l', 'l', 0 };
-static ucs4_t u_true[] = { 't', 'r', 'u', 'e', 0 };
-static ucs4_t u_false[] = { 'f', 'a', 'l', 's', 'e', 0 };
-
 /**
  * Check is a character is a JSON whitespace character.
  * @param[in] ucs4	Character to inspect
@@ -109,31 +136,23 @@ is_json_space(ucs4_t ucs4)
 }
 
 /**
- * Validate and parse a UCS-4 string as an integer.
- * @param[in] s		String to parse
- * @param[in] len	Length of string
+ * Validate and parse a string as an integer.
+ * @param[in] s		NUL-terminated string to parse
  * @param[out] ret	Returned integer
  * @returns np_ret_t
  */
 static np_ret_t
-valid_integer(ucs4_t *s, size_t len, int64_t *ret)
+valid_integer(const char *s, int64_t *ret)
 {
-    char *str;
-    size_t i;
     long long l;
     char *end;
 
     if (!*s) {
 	return NP_FAILURE;
     }
-    str = Malloc(len + 1);
-    for (i = 0; i < len; i++) {
-	str[i] = (char)s[i];
-    }
-    str[len] = '\0';
-    l = strtoll(str, &end, 10);
-    Free(str);
-    if (end != &str[len]) {
+    errno = 0;
+    l = strtoll(s, &end, 10);
+    if (*end != '\0') {
 	return NP_FAILURE;
     }
     if ((l == LLONG_MIN || l == LLONG_MAX) && errno == ERANGE) {
@@ -159,27 +178,18 @@ valid_integer(ucs4_t *s, size_t len, int64_t *ret)
 }
 
 /**
- * Validate and parse a UCS-4 string as a double.
- * @param[in] s		String to parse
- * @param[in] len	Length of string
+ * Validate and parse a string as a double.
+ * @param[in] s		NUL-terminated string to parse
  * @param[out] ret	Returned double
  * @returns np_ret_t
  */
 static np_ret_t
-valid_double(ucs4_t *s, size_t len, double *ret)
+valid_double(const char *s, double *ret)
 {
-    char *str;
-    size_t i;
     char *end;
 
-    str = Malloc(len + 1);
-    for (i = 0; i < len; i++) {
-	str[i] = (char)s[i];
-    }
-    str[len] = '\0';
-    *ret = strtod(str, &end);
-    Free(str);
-    if (end != &str[len])
+    *ret = strtod(s, &end);
+    if (*end != '\0')
     {
 	return NP_FAILURE;
     }
@@ -190,20 +200,20 @@ valid_double(ucs4_t *s, size_t len, double *ret)
 }
 
 /**
- * Validate and parse a UCS-4 string as a string.
- * @param[in] s		String to parse
+ * Validate and parse the body of a quoted string, expanding escapes.
+ * @param[in] s		String to parse, in UTF-8
  * @param[in] len	Length of string
  * @param[out] s_ret	Returned string
  * @param[out] len_ret	Returned string length
  * @returns sp_ret_t
  */
 static sp_ret_t
-valid_string(ucs4_t *s, size_t len, char **s_ret, size_t *len_ret)
+valid_string(const char *s, size_t len, char **s_ret, size_t *len_ret)
 {
-    char *ret = NULL;
+    /* Expanding escapes never makes the string longer. */
+    char *ret = Malloc(len + 1);
     size_t rlen = 0;
-    ucs4_t c;
-    bool backslash = false;
+    char c;
     size_t i;
     char xbuf[5];
     ucs4_t u;
@@ -211,103 +221,95 @@ valid_string(ucs4_t *s, size_t len, char **s_ret, size_t *len_ret)
     int j;
     int nr;
     ucs4_t surrogate_lead = 0;
-#   define STASH(c) do { \
-    ret = (char *)Realloc(ret, rlen + 1); \
-    ret[rlen++] = c; \
-} while (false)
 #   define DUMP_LEAD do { \
     nr = unicode_to_utf8(surrogate_lead, ubuf); \
     for (j = 0; j < nr; j++) { \
-	STASH(ubuf[j]); \
+	ret[rlen++] = ubuf[j]; \
     } \
     surrogate_lead = 0; \
 } while (false)
 
     for (i = 0; i < len; i++) {
 	c = s[i];
-	if (backslash) {
-	    if ((surrogate_lead != 0) && c != 'u') {
+	if (c != '\\') {
+	    if (surrogate_lead != 0) {
 		DUMP_LEAD;
 	    }
-	    switch (c) {
-	    case '\\':
-		STASH('\\');
-		break;
-	    case '/':
-		STASH('/');
-		break;
-	    case 'r':
-		STASH('\r');
-		break;
-	    case 'n':
-		STASH('\n');
-		break;
-	    case 't':
-		STASH('\t');
-		break;
-	    case 'f':
-		STASH('\f');
-		break;
-	    case 'u':
-		/* We need 4 hex digits. */
-		for (j = 0; j < 4; j++) {
-		    if (++i >= len || !isxdigit((int)s[i])) {
-			Free(ret);
-			return SP_FAILURE;
-		    }
-		    xbuf[j] = (char)s[i];
-		}
-		xbuf[j] = '\0';
-		u = (ucs4_t)strtoul(xbuf, NULL, 16);
-		if ((surrogate_lead != 0) &&
-			!LOW_SURROGATE(u) &&
-			!HIGH_SURROGATE(u)) {
-		    DUMP_LEAD;
-		}
-		if (HIGH_SURROGATE(u)) {
-		    if (surrogate_lead != 0) {
-			DUMP_LEAD;
-		    }
-		    surrogate_lead = u;
-		    break;
-		}
-		if (LOW_SURROGATE(u)) {
-		    if (surrogate_lead != 0) {
-			/* Encode the surrogate pair as a single codepoint. */
-			u += SURROGATE_OFFSET + (surrogate_lead << SHIFT_BITS);
-			surrogate_lead = 0;
-		    }
-		}
-		nr = unicode_to_utf8(u, ubuf);
-		if (nr < 0) {
+	    ret[rlen++] = c;
+	    continue;
+	}
+
+	if (++i >= len) {
+	    Free(ret);
+	    return SP_FAILURE;
+	}
+	c = s[i];
+	if ((surrogate_lead != 0) && c != 'u') {
+	    DUMP_LEAD;
+	}
+	switch (c) {
+	case '"':
+	case '\\':
+	case '/':
+	    ret[rlen++] = c;
+	    break;
+	case 'b':
+	    ret[rlen++] = '\b';
+	    break;
+	case 'r':
+	    ret[rlen++] = '\r';
+	    break;
+	case 'n':
+	    ret[rlen++] = '\n';
+	    break;
+	case 't':
+	    ret[rlen++] = '\t';
+	    break;
+	case 'f':
+	    ret[rlen++] = '\f';
+	    break;
+	case 'u':
+	    /* We need 4 hex digits. */
+	    for (j = 0; j < 4; j++) {
+		if (++i >= len || !isxdigit((unsigned char)s[i])) {
 		    Free(ret);
 		    return SP_FAILURE;
 		}
-		for (j = 0; j < nr; j++) {
-		    STASH(ubuf[j]);
-		}
-		break;
-	    default:
-		Free(ret);
-		return SP_FAILURE;
+		xbuf[j] = s[i];
 	    }
-	    backslash = false;
-	} else {
-	    if (c == '\\') {
-		backslash = true;
-	    } else {
+	    xbuf[j] = '\0';
+	    u = (ucs4_t)strtoul(xbuf, NULL, 16);
+	    if ((surrogate_lead != 0) &&
+		    !LOW_SURROGATE(u) &&
+		    !HIGH_SURROGATE(u)) {
+		DUMP_LEAD;
+	    }
+	    if (HIGH_SURROGATE(u)) {
 		if (surrogate_lead != 0) {
 		    DUMP_LEAD;
 		}
-		nr = unicode_to_utf8(c, ubuf);
-		if (nr < 0) {
-		    Free(ret);
-		    return SP_FAILURE;
-		}
-		for (j = 0; j < nr; j++) {
-		    STASH(ubuf[j]);
+		surrogate_lead = u;
+		break;
+	    }
+	    if (LOW_SURROGATE(u)) {
+		if (surrogate_lead != 0) {
+		    /* Encode the surrogate pair as a single codepoint. */
+		    u += SURROGATE_OFFSET + (surrogate_lead << SHIFT_BITS);
+		    surrogate_lead = 0;
 		}
 	    }
+	    nr = unicode_to_utf8(u, ubuf);
+	    if (nr < 0) {
+		Free(ret);
+		return SP_FAILURE;
+	    }
+	    for (j = 0; j < nr; j++) {
+		ret[rlen++] = ubuf[j];
+	    }
+	    break;
+	default:
+	    Free(ret);
+	    return SP_FAILURE;
 	}
     }
 
@@ -315,37 +317,13 @@ valid_string(ucs4_t *s, size_t len, char **s_ret, size_t *len_ret)
 	DUMP_LEAD;
     }
 
-    STASH('\0');
+    ret[rlen] = '\0';
     *s_ret = ret;
-    *len_ret = rlen - 1;
+    *len_ret = rlen;
     return SP_SUCCESS;
-#   undef STASH
 #   undef DUMP_LEAD
 }
 
-/**
- * Compare two null-terminated UCS-4 strings.
- * @param[in] a		First string
- * @param[in] b		Second string
- * @returns true if equal
- */
-static bool
-ucs4streq(ucs4_t *a, ucs4_t *b)
-{
-    ucs4_t ac, bc;
-
-    while (true) {
-	ac = *a++;
-	bc = *b++;
-	if (ac == 0 && bc == 0) {
-	    return true;
-	}
-	if (ac != bc) {
-	    return false;
-	}
-    }
-}
-
 /**
  * Format an error message that ends with a Unicode character.
  * @param[in] text	Body of message
@@ -362,380 +340,677 @@ format_uerror(const char *text, ucs4_t u)
 }
 
 /**
- * Parse text into JSON.
- * @param[in,out] line	Line number
- * @param[in,out] column Column number
- * @param[in] text	Text to parse
- * @param[in,out] offset Offset to start of text
- * @param[in] len	Length of text in bytes
- * @param[out] result	Result if successful
- * @param[out] error	Error if not successful
- * @param[out] stop_token Character after this element
- * @param[out] any	True if something parsed
+ * Allocate a parse error.
+ * @param[in] errcode	Error code
+ * @param[in] line	Line number
+ * @param[in] column	Column number
+ * @param[in] offset	Byte offset
+ * @param[in] errmsg	Error message, which the error takes ownership of
+ * @returns Parse error
+ */
+static json_parse_error_t *
+new_error(json_errcode_t errcode, int line, int column, size_t offset,
+	char *errmsg)
+{
+    json_parse_error_t *error =
+	(json_parse_error_t *)Malloc(sizeof(json_parse_error_t));
+
+    error->errcode = errcode;
+    error->line = line;
+    error->column = column? column: 1;
+    error->errmsg = errmsg;
+    error->offset = offset;
+    return error;
+}
+
+/**
+ * Discard a partially-parsed value.
+ * @param[in,out] js	Parser state
+ */
+static void
+stream_clear(json_stream_t *js)
+{
+    unsigned i;
+
+    for (i = 0; i < js->depth; i++) {
+	json_free(js->frames[i].json);
+	Replace(js->frames[i].key, NULL);
+    }
+    js->depth = 0;
+    js->token_state = JK_BASE;
+    vb_reset(&js->token);
+    js->partial_len = 0;
+}
+
+/**
+ * Open an array or object.
+ * @param[in,out] js	Parser state
+ * @param[in] type	JT_ARRAY or JT_OBJECT
+ */
+static void
+stream_push(json_stream_t *js, json_type_t type)
+{
+    json_frame_t *f;
+
+    if (js->depth >= js->frames_alloc) {
+	js->frames_alloc = js->frames_alloc? js->frames_alloc * 2: 8;
+	js->frames = (json_frame_t *)Realloc(js->frames,
+		js->frames_alloc * sizeof(json_frame_t));
+    }
+    f = &js->frames[js->depth++];
+    if (type == JT_OBJECT) {
+	f->json = json_object();
+	f->state = JF_OBJECT_KEY;
+    } else {
+	f->json = json_array();
+	f->state = JF_ARRAY_VALUE;
+    }
+    f->alloc = 0;
+    f->key = NULL;
+    f->key_length = 0;
+}
+
+/**
+ * Add a completed value to the innermost open array or object.
+ * @param[in,out] js	Parser state
+ * @param[in] value	Value
+ * @param[out] result	Returned value, if it is at the top level
+ * @param[out] done	Returned true if the value is at the top level
+ * @returns JE_OK, or JE_SYNTAX if the value is an object key but not a string
+ */
+static json_errcode_t
+stream_add(json_stream_t *js, json_t *value, json_t **result, bool *done)
+{
+    json_frame_t *f;
+    json_t *j;
+
+    *done = false;
+    if (js->depth == 0) {
+	*result = value;
+	*done = true;
+	return JE_OK;
+    }
+
+    /* Arrays and objects grow geometrically while they are being parsed. */
+    f = &js->frames[js->depth - 1];
+    j = f->json;
+    if (f->state == JF_OBJECT_KEY) {
+	if (json_type(value) != JT_STRING) {
+	    json_free(value);
+	    return JE_SYNTAX;
+	}
+	f->key = (char *)value->value.v_string.text;
+	f->key_length = value->value.v_string.length;
+	Free(value);
+	f->state = JF_OBJECT_COLON;
+    } else if (f->state == JF_ARRAY_VALUE) {
+	if (j->value.v_array.length >= f->alloc) {
+	    f->alloc = f->alloc? f->alloc * 2: 8;
+	    j->value.v_array.array = (json_t **)Realloc(j->value.v_array.array,
+		    f->alloc * sizeof(json_t *));
+	}
+	j->value.v_array.array[j->value.v_array.length++] = value;
+	f->state = JF_ARRAY_NEXT;
+    } else {
+	key_value_t *kv;
+
+	assert(f->state == JF_OBJECT_VALUE);
+	if (j->value.v_object.length >= f->alloc) {
+	    f->alloc = f->alloc? f->alloc * 2: 8;
+	    j->value.v_object.key_values =
+		(key_value_t *)Realloc(j->value.v_object.key_values,
+			f->alloc * sizeof(key_value_t));
+	}
+	kv = &j->value.v_object.key_values[j->value.v_object.length++];
+	kv->key_length = f->key_length;
+	kv->key = f->key;
+	kv->value = value;
+	f->key = NULL;
+	f->state = JF_OBJECT_NEXT;
+    }
+    return JE_OK;
+}
+
+/**
+ * Close the innermost array or object.
+ * @param[in,out] js	Parser state
+ * @param[out] result	Returned value, if it is at the top level
+ * @param[out] done	Returned true if the value is at the top level
+ * @returns JE_OK, or JE_SYNTAX if the value is an object key
+ */
+static json_errcode_t
+stream_pop(json_stream_t *js, json_t **result, bool *done)
+{
+    json_frame_t *f = &js->frames[--js->depth];
+    json_t *j = f->json;
+
+    /* Give back the slack. */
+    if (j->type == JT_ARRAY) {
+	if (j->value.v_array.length) {
+	    j->value.v_array.array = (json_t **)Realloc(j->value.v_array.array,
+		    j->value.v_array.length * sizeof(json_t *));
+	}
+    } else if (j->value.v_object.length) {
+	j->value.v_object.key_values =
+	    (key_value_t *)Realloc(j->value.v_object.key_values,
+		    j->value.v_object.length * sizeof(key_value_t));
+    }
+    f->json = NULL;
+    return stream_add(js, j, result, done);
+}
+
+/**
+ * Start parsing a value.
+ * @param[in,out] js	Parser state
+ * @param[in] ucs4	First character of the value
+ * @returns false if the character cannot start a value
+ */
+static bool
+stream_start(json_stream_t *js, ucs4_t ucs4)
+{
+    char c = (char)ucs4;
+
+    switch (ucs4) {
+    case '{':
+	stream_push(js, JT_OBJECT);
+	return true;
+    case '[':
+	stream_push(js, JT_ARRAY);
+	return true;
+    case '"':
+	js->token_state = JK_STRING;
+	vb_reset(&js->token);
+	return true;
+    default:
+	if (ucs4 == '-' || (ucs4 < 0x80 && isdigit((int)ucs4))) {
+	    js->token_state = JK_NUMBER;
+	} else if (ucs4 < 0x80 && isalpha((int)ucs4)) {
+	    js->token_state = JK_BAREWORD;
+	} else {
+	    return false;
+	}
+	vb_reset(&js->token);
+	vb_append(&js->token, &c, 1);
+	return true;
+    }
+}
+
+/**
+ * Finish parsing a bareword or number.
+ * @param[in,out] js	Parser state
+ * @param[out] value	Returned value
+ * @param[out] errmsg	Returned error message
  * @returns error code
  */
 static json_errcode_t
-json_parse_internal(int *line, int *column, const char *text, size_t *offset,
-	size_t len, json_t **result, json_parse_error_t **error,
-	ucs4_t *stop_token, bool *any)
+stream_scalar(json_stream_t *js, json_t **value, char **errmsg)
 {
-    json_token_state_t token_state = JK_BASE;
-    ucs4_t *token_buf = NULL;
-    size_t token_buf_len = 0;
-    json_errcode_t e;
-    unsigned length;
-    ucs4_t internal_stop;
+    const char *token = vb_buf(&js->token);
+    int64_t i_ret;
+    double d_ret;
+    np_ret_t np;
+
+    *value = NULL;
+    if (js->token_state == JK_BAREWORD) {
+	if (!strcmp(token, "null")) {
+	    return JE_OK;
+	}
+	if (!strcmp(token, "true") || !strcmp(token, "false")) {
+	    *value = json_boolean(token[0] == 't');
+	    return JE_OK;
+	}
+	*errmsg = NewString("Invalid bareword");
+	return JE_SYNTAX;
+    }
+
+    np = valid_integer(token, &i_ret);
+    if (np == NP_SUCCESS) {
+	*value = json_integer(i_ret);
+	return JE_OK;
+    }
+    if (np == NP_OVERFLOW) {
+	*errmsg = NewString("Integer overflow");
+	return JE_OVERFLOW;
+    }
+    np = valid_double(token, &d_ret);
+    if (np == NP_SUCCESS) {
+	*value = json_double(d_ret);
+	return JE_OK;
+    }
+    if (np == NP_OVERFLOW) {
+	*errmsg = NewString("Floating-point overflow");
+	return JE_OVERFLOW;
+    }
+    *errmsg = NewString("Invalid number");
+    return JE_SYNTAX;
+}
+
+/**
+ * Create an incremental parser.
+ * @returns Parser state
+ */
+json_stream_t *
+json_stream_init(void)
+{
+    json_stream_t *js = (json_stream_t *)Calloc(1, sizeof(json_stream_t));
+
+    vb_init(&js->token);
+    js->token_state = JK_BASE;
+    js->line = 1;
+    return js;
+}
+
+/**
+ * Check an incremental parser for a partially-parsed value.
+ * @param[in] js	Parser state
+ * @returns true if nothing has been parsed since the last complete value
+ */
+bool
+json_stream_idle(const json_stream_t *js)
+{
+    return js->depth == 0 && js->token_state == JK_BASE &&
+	js->partial_len == 0;
+}
+
+/**
+ * Free an incremental parser.
+ * @param[in,out] js	Parser state, or NULL
+ * @returns NULL
+ */
+json_stream_t *
+_json_stream_free(json_stream_t *js)
+{
+    if (js != NULL) {
+	stream_clear(js);
+	vb_free(&js->token);
+	Free(js->frames);
+	Free(js);
+    }
+    return NULL;
+}
+
+/**
+ * Incrementally parse text into JSON.
+ *
+ * Parsing stops as soon as a top-level value is complete. Text that arrives
+ * in pieces can be passed in as it arrives; the parser keeps its state between
+ * calls. After an error, the parser is ready to parse a new value.
+ *
+ * @param[in,out] js	Parser state
+ * @param[in] text	Text to parse, in UTF-8
+ * @param[in] len	Length of text in bytes
+ * @param[out] consumed	Number of bytes of text consumed
+ * @param[out] result	Value if complete
+ * @param[out] error	Error if not successful
+ * @returns JE_OK if a value is complete, JE_INCOMPLETE if all of the text was
+ *  consumed without completing a value, otherwise an error code
+ */
+json_errcode_t
+json_stream_parse(json_stream_t *js, const char *text, size_t len,
+	size_t *consumed, json_t **result, json_parse_error_t **error)
+{
+    size_t pos = 0;
 
     *result = NULL;
     *error = NULL;
-    *stop_token = 0;
-    *any = false;
 
 #   define FAIL(e, m) do { \
-    Replace(token_buf, NULL); \
-    *error = (json_parse_error_t *)Malloc(sizeof(json_parse_error_t)); \
-    (*error)->errcode = e; \
-    (*error)->line = *line; \
-    (*error)->column = (*column)? *column: 1; \
-    (*error)->errmsg = m; \
-    (*error)->offset = *offset; \
-    json_free(*result); \
+    *error = new_error(e, js->line, js->column + 1, js->offset, m); \
+    stream_clear(js); \
+    *consumed = pos; \
     return e; \
 } while (false)
 
-#   define ADD_TOKEN(u) do { \
-    token_buf = (ucs4_t *)Realloc(token_buf, \
-	    (token_buf_len + 1) * sizeof(ucs4_t)); \
-    token_buf[token_buf_len++] = u; \
-} while (false)
-
-#   define BAREWORD_DONE do { \
-    ADD_TOKEN(0); \
-    if (ucs4streq(token_buf, u_null)) { \
-	*any = true; \
-	*result = NULL; \
-    } else if (ucs4streq(token_buf, u_true)) { \
-	*any = true; \
-	*result = (json_t *)Calloc(1, sizeof(json_t)); \
-	(*result)->type = JT_BOOLEAN; \
-	(*result)->value.v_boolean = true; \
-    } else if (ucs4streq(token_buf, u_false)) { \
-	*any = true; \
-	*result = (json_t *)Calloc(1, sizeof(json_t)); \
-	(*result)->type = JT_BOOLEAN; \
-	(*result)->value.v_boolean = false; \
-    } else { \
-	FAIL(JE_SYNTAX, NewString("Invalid bareword")); \
-    } \
-    Replace(token_buf, NULL); \
-} while (false)
-
-#   define NUMBER_DONE do { \
-    int64_t i_ret; \
-    double d_ret; \
-    np_ret_t np; \
-    np = valid_integer(token_buf, token_buf_len, &i_ret); \
-    if (np == NP_OVERFLOW) { \
-	FAIL(JE_OVERFLOW, NewString("Integer overflow")); \
-    } else if (np == NP_SUCCESS) { \
-	Replace(token_buf, NULL); \
-	*any = true; \
-	*result = (json_t *)Calloc(1, sizeof(json_t)); \
-	(*result)->type = JT_INTEGER; \
-	(*result)->value.v_integer = i_ret; \
-    } else { \
-	np = valid_double(token_buf, token_buf_len, &d_ret); \
-	if (np == NP_OVERFLOW) { \
-	    FAIL(JE_OVERFLOW, NewString("Floating-point overflow")); \
-	} else if (np == NP_SUCCESS) { \
-	    Replace(token_buf, NULL); \
-	    *any = true; \
-	    *result = (json_t *)Calloc(1, sizeof(json_t)); \
-	    (*result)->type = JT_DOUBLE; \
-	    (*result)->value.v_double = d_ret; \
-	} else { \
-	    FAIL(JE_SYNTAX, NewString("Invalid number")); \
-	} \
-    } \
-    Replace(token_buf, NULL); \
-} while (false)
-
-    /* Start parsing. */
-    while (*offset < len) {
+    while (pos < len || js->partial_len) {
+	const char *cp;
 	int nr;
 	ucs4_t ucs4;
-
-	/* Decode the next UTF-8 character. */
-	nr = utf8_to_unicode(text + *offset, len - *offset, &ucs4);
-	if (nr <= 0) {
-	    FAIL(JE_UTF8, NewString("UTF-8 decoding error"));
-	}
-
-	/* Account for it. */
-	*offset += nr;
-	if (ucs4 == '\n') {
-	    (*line)++;
-	    *column = 0;
+	bool from_partial = false;
+	bool done = false;
+	json_frame_t *f;
+	json_t *value;
+
+	if (js->partial_len) {
+	    /* Finish a character split across calls. */
+	    while ((nr = utf8_to_unicode(js->partial, js->partial_len,
+			    &ucs4)) == 0 &&
+		    pos < len &&
+		    js->partial_len < (int)sizeof(js->partial)) {
+		js->partial[js->partial_len++] = text[pos++];
+	    }
+	    if (nr == 0) {
+		if (pos >= len) {
+		    *consumed = pos;
+		    return JE_INCOMPLETE;
+		}
+		nr = -1;
+	    }
+	    cp = js->partial;
+	    from_partial = true;
+	} else if (js->token_state == JK_STRING) {
+	    size_t run = pos;
+
+	    /* Copy ordinary string text in bulk. */
+	    while (run < len &&
+		    text[run] != '"' &&
+		    text[run] != '\\' &&
+		    text[run] != '\n' &&
+		    !(text[run] & 0x80)) {
+		run++;
+	    }
+	    if (run > pos) {
+		vb_append(&js->token, text + pos, run - pos);
+		js->column += (int)(run - pos);
+		js->offset += run - pos;
+		pos = run;
+		continue;
+	    }
+	    cp = text + pos;
+	    nr = utf8_to_unicode(cp, len - pos, &ucs4);
 	} else {
-	    (*column)++;
+	    cp = text + pos;
+	    nr = utf8_to_unicode(cp, len - pos, &ucs4);
+	}
+	if (nr == 0) {
+	    /* Save the start of a split character. */
+	    memcpy(js->partial, text + pos, len - pos);
+	    js->partial_len = (int)(len - pos);
+	    *consumed = len;
+	    return JE_INCOMPLETE;
+	}
+	if (nr < 0) {
+	    FAIL(JE_UTF8, NewString("UTF-8 decoding error"));
 	}
 
-	switch (token_state) {
-	    case JK_TERMINAL:
-		/* Skip white space until we get something useful. */
-		if (is_json_space(ucs4)) {
-		    continue;
+    again:
+	switch (js->token_state) {
+	case JK_STRING:
+	    /* Have seen an opening double quote. */
+	    if (ucs4 == '"') {
+		char *s_ret;
+		size_t len_ret;
+
+		if (valid_string(vb_buf(&js->token), vb_len(&js->token),
+			    &s_ret, &len_ret) == SP_FAILURE) {
+		    FAIL(JE_SYNTAX, NewString("Invalid string"));
 		}
+		js->token_state = JK_BASE;
+		value = (json_t *)Calloc(1, sizeof(json_t));
+		value->type = JT_STRING;
+		value->value.v_string.length = len_ret;
+		value->value.v_string.text = s_ret;
+		if (stream_add(js, value, result, &done) != JE_OK) {
+		    FAIL(JE_SYNTAX, NewString("Expected string"));
+		}
+	    } else {
+		if (ucs4 == '\\') {
+		    js->token_state = JK_STRING_BS;
+		}
+		vb_append(&js->token, cp, nr);
+	    }
+	    break;
+	case JK_STRING_BS:
+	    /* Have seen a backslash within a string. */
+	    vb_append(&js->token, cp, nr);
+	    js->token_state = JK_STRING;
+	    break;
+	case JK_NUMBER:
+	case JK_BAREWORD:
+	    /* Have seen the start of a number or bareword. */
+	    if (ucs4 < 0x80 &&
+		    ((js->token_state == JK_NUMBER &&
+		      (isdigit((int)ucs4) ||
+		       ucs4 == '.' ||
+		       ucs4 == 'e' ||
+		       ucs4 == '-' ||
+		       ucs4 == '+')) ||
+		     (js->token_state == JK_BAREWORD &&
+		      isalpha((int)ucs4)))) {
+		vb_append(&js->token, cp, nr);
+	    } else {
+		char *errmsg;
+		json_errcode_t e;
 
-		/* Return whatever follows an element. */
-		*stop_token = ucs4;
-		return JE_OK;
-	    case JK_BASE:
-		/* Ground state. */
-		if (is_json_space(ucs4)) {
-		    continue;
+		e = stream_scalar(js, &value, &errmsg);
+		if (e != JE_OK) {
+		    FAIL(e, errmsg);
 		}
-		switch (ucs4) {
-		    case '{':
-			/* A struct. */
-			*any = true;
-			*result = (json_t *)Calloc(1, sizeof(json_t));
-			(*result)->type = JT_OBJECT;
-			do {
-			    json_t *element = NULL;
-			    bool r_any = false;
-			    char *key;
-			    key_value_t kv;
-			    size_t key_length;
-
-			    /* Parse what should be a string followed by ':'. */
-			    e = json_parse_internal(line, column, text, offset,
-				    len, &element, error, &internal_stop,
-				    &r_any);
-			    if (e != JE_OK) {
-				json_free(*result);
-				return e;
-			    }
-			    if (!r_any && internal_stop == '}') {
-				break;
-			    }
-			    if (internal_stop != ':') {
-				json_free(element);
-				if (internal_stop == 0) {
-				    FAIL(JE_INCOMPLETE,
-					    NewString("Incomplete struct"));
-				} else {
-				    FAIL(JE_SYNTAX,
-					    format_uerror("Expected ':', got",
-						internal_stop));
-				}
-			    }
-			    if (element == NULL) {
-				FAIL(JE_SYNTAX,
-					NewString("Expected string, got ':'"));
-			    }
-			    if (element->type != JT_STRING) {
-				json_free(element);
-				FAIL(JE_SYNTAX, NewString("Expected string"));
-			    }
-
-			    /* Save the key. */
-			    key_length = element->value.v_string.length;
-			    key = Malloc(key_length + 1);
-			    memcpy(key, element->value.v_string.text,
-				    key_length);
-			    key[key_length] = '\0';
-			    json_free(element);
-
-			    /* Parse the value, followed by ',' or '}'. */
-			    e = json_parse_internal(line, column, text, offset,
-				    len, &element, error, &internal_stop,
-				    &r_any);
-			    if (e != JE_OK) {
-				Replace(key, NULL);
-				json_free(*result);
-				return e;
-			    }
-			    if (internal_stop != ',' && internal_stop != '}') {
-				Replace(key, NULL);
-				json_free(element);
-				if (internal_stop == 0) {
-				    FAIL(JE_INCOMPLETE,
-					    NewString("Incomplete struct"));
-				} else {
-				    FAIL(JE_SYNTAX,
-					    format_uerror("Expected ',' or '}'"
-						", got", internal_stop));
-				}
-			    }
-			    if (!r_any) {
-				assert(element == NULL);
-				Replace(key, NULL);
-				FAIL(JE_SYNTAX,
-					NewString("Missing element value"));
-			    }
-
-			    /* Save the key-value pair. */
-			    kv.key_length = key_length;
-			    kv.key = key;
-			    kv.value = element;
-			    length = ++((*result)->value.v_object.length);
-			    (*result)->value.v_object.key_values =
-				Realloc((key_value_t *)(*result)->
-					    value.v_object.key_values,
-					length * sizeof(key_value_t));
-			    (*result)->value.v_object.key_values[length - 1] =
-				kv; /* struct copy */
-			} while (internal_stop == ',');
-			token_state = JK_TERMINAL;
-			break;
-		    case '[':
-			/* An array. */
-			*any = true;
-			*result = (json_t *)Calloc(1, sizeof(json_t));
-			(*result)->type = JT_ARRAY;
-			do {
-			    json_t *element = NULL;
-			    bool r_any = false;
-
-			    e = json_parse_internal(line, column, text, offset,
-				    len, &element, error, &internal_stop,
-				    &r_any);
-			    if (e != JE_OK) {
-				json_free(*result);
-				return e;
-			    }
-			    if (r_any) {
-				length = ++((*result)->value.v_array.length);
-				(*result)->value.v_array.array =
-				    Realloc((*result)->value.v_array.array,
-					    length * sizeof(json_t *));
-				(*result)->value.v_array.array[length - 1] =
-				    element;
-			    }
-			} while (internal_stop == ',');
-			if (internal_stop == 0) {
-			    FAIL(JE_INCOMPLETE, NewString("Incomplete array"));
-			} else if (internal_stop != ']') {
-			    FAIL(JE_SYNTAX,
-				    format_uerror("Improperly terminated "
-					"array at", ucs4));
-			}
-			token_state = JK_TERMINAL;
-			break;
-		    case '"':
-			/* The start of a string. */
-			token_state = JK_STRING;
-			break;
-		    default:
-			if (ucs4 == '-' || isdigit((int)ucs4)) {
-			    /* The start of a number. */
-			    ADD_TOKEN(ucs4);
-			    token_state = JK_NUMBER;
-			} else if (isalpha((int)ucs4)) {
-			    /* The start of a bareword. */
-			    ADD_TOKEN(ucs4);
-			    token_state = JK_BAREWORD;
-			} else {
-			    *stop_token = ucs4;
-			    return JE_OK;
-			}
+		js->token_state = JK_BASE;
+		if (stream_add(js, value, result, &done) != JE_OK) {
+		    FAIL(JE_SYNTAX, NewString("Expected string"));
 		}
+		if (done) {
+		    /* The character after a top-level value is not ours. */
+		    *consumed = pos;
+		    return JE_OK;
+		}
+		goto again;
+	    }
+	    break;
+	case JK_BASE:
+	    /* Between tokens. */
+	    if (is_json_space(ucs4)) {
 		break;
-	    case JK_BAREWORD:
-		/* Have seen at least one bareword character. */
-		if (isalpha((int)ucs4)) {
-		    ADD_TOKEN(ucs4);
-		} else {
-		    BAREWORD_DONE;
-		    if (is_json_space(ucs4)) {
-			token_state = JK_TERMINAL;
-		    } else {
-			*stop_token = ucs4;
-			return JE_OK;
+	    }
+	    if (js->depth == 0) {
+		if (!stream_start(js, ucs4)) {
+		    FAIL(JE_SYNTAX, format_uerror("Unexpected text", ucs4));
+		}
+		break;
+	    }
+	    f = &js->frames[js->depth - 1];
+	    switch (f->state) {
+	    case JF_ARRAY_VALUE:
+		if (ucs4 == ',') {
+		    /* Empty elements are ignored. */
+		    break;
+		}
+		if (ucs4 == ']') {
+		    if (stream_pop(js, result, &done) != JE_OK) {
+			FAIL(JE_SYNTAX, NewString("Expected string"));
 		    }
+		} else if (!stream_start(js, ucs4)) {
+		    FAIL(JE_SYNTAX,
+			    format_uerror("Improperly terminated array at",
+				ucs4));
 		}
 		break;
-	    case JK_NUMBER:
-		/* Have seen at least one part of a number. */
-		if (isdigit((int)ucs4) ||
-			ucs4 == '.' ||
-			ucs4 == 'e' ||
-			ucs4 == '-' ||
-			ucs4 == '+') {
-		    ADD_TOKEN(ucs4);
-		} else {
-		    NUMBER_DONE;
-		    if (is_json_space(ucs4)) {
-			token_state = JK_TERMINAL;
-		    } else {
-			*stop_token = ucs4;
-			return JE_OK;
+	    case JF_ARRAY_NEXT:
+		if (ucs4 == ',') {
+		    f->state = JF_ARRAY_VALUE;
+		} else if (ucs4 == ']') {
+		    if (stream_pop(js, result, &done) != JE_OK) {
+			FAIL(JE_SYNTAX, NewString("Expected string"));
 		    }
+		} else {
+		    FAIL(JE_SYNTAX,
+			    format_uerror("Improperly terminated array at",
+				ucs4));
 		}
 		break;
-	    case JK_STRING:
-		/* Have seen an opening double quote. */
-		if (ucs4 == '\\') {
-		    token_state = JK_STRING_BS;
-		} else if (ucs4 == '"') {
-		    sp_ret_t sp;
-		    char *s_ret;
-		    size_t len_ret;
-
-		    sp = valid_string(token_buf, token_buf_len, &s_ret,
-			    &len_ret);
-		    if (sp == SP_FAILURE) {
-			FAIL(JE_SYNTAX, NewString("Invalid string"));
+	    case JF_OBJECT_KEY:
+		if (ucs4 == '}') {
+		    if (stream_pop(js, result, &done) != JE_OK) {
+			FAIL(JE_SYNTAX, NewString("Expected string"));
 		    }
-		    Replace(token_buf, NULL);
-		    *any = true;
-		    *result = (json_t *)Calloc(1, sizeof(json_t));
-		    (*result)->type = JT_STRING;
-		    (*result)->value.v_string.length = len_ret;
-		    (*result)->value.v_string.text = s_ret;
-		    token_state = JK_TERMINAL;
+		} else if (!stream_start(js, ucs4)) {
+		    FAIL(JE_SYNTAX, format_uerror("Expected string, got",
+				ucs4));
+		}
+		break;
+	    case JF_OBJECT_COLON:
+		if (ucs4 == ':') {
+		    f->state = JF_OBJECT_VALUE;
 		} else {
-		    ADD_TOKEN(ucs4);
+		    FAIL(JE_SYNTAX, format_uerror("Expected ':', got", ucs4));
 		}
 		break;
-	    case JK_STRING_BS:
-		/* Have seen a backslash within a string. */
-		if (ucs4 == '"') {
-		    ADD_TOKEN(ucs4);
+	    case JF_OBJECT_VALUE:
+		if (ucs4 == ',' || ucs4 == '}') {
+		    FAIL(JE_SYNTAX, NewString("Missing element value"));
+		}
+		if (!stream_start(js, ucs4)) {
+		    FAIL(JE_SYNTAX, format_uerror("Expected value, got",
+				ucs4));
+		}
+		break;
+	    case JF_OBJECT_NEXT:
+		if (ucs4 == ',') {
+		    f->state = JF_OBJECT_KEY;
+		} else if (ucs4 == '}') {
+		    if (stream_pop(js, result, &done) != JE_OK) {
+			FAIL(JE_SYNTAX, NewString("Expected string"));
+		    }
 		} else {
-		    ADD_TOKEN('\\');
-		    ADD_TOKEN(ucs4);
+		    FAIL(JE_SYNTAX, format_uerror("Expected ',' or '}', got",
+				ucs4));
 		}
-		token_state = JK_STRING;
 		break;
+	    }
+	    break;
+	}
+
+	/* Account for the character. */
+	if (from_partial) {
+	    js->partial_len = 0;
+	} else {
+	    pos += nr;
+	}
+	js->offset += nr;
+	if (ucs4 == '\n') {
+	    js->line++;
+	    js->column = 0;
+	} else {
+	    js->column++;
+	}
+	if (done) {
+	    *consumed = pos;
+	    return JE_OK;
 	}
     }
 
-    switch (token_state) {
-    case JK_BASE:
-	FAIL(JE_INCOMPLETE, NewString("Empty input or incomplete object"));
-	break;
-    case JK_BAREWORD:
-	BAREWORD_DONE;
-	return JE_OK;
-    case JK_NUMBER:
-	NUMBER_DONE;
-	return JE_OK;
+    *consumed = pos;
+    return JE_INCOMPLETE;
+
+#   undef FAIL
+}
+
+/**
+ * Finish incremental parsing at the end of the input.
+ * @param[in,out] js	Parser state
+ * @param[out] result	Value if complete
+ * @param[out] error	Error if not successful
+ * @returns error code
+ */
+json_errcode_t
+json_stream_end(json_stream_t *js, json_t **result, json_parse_error_t **error)
+{
+    char *errmsg;
+    json_errcode_t e;
+
+    *result = NULL;
+    *error = NULL;
+
+#   define FAIL(e, m) do { \
+    *error = new_error(e, js->line, js->column, js->offset, m); \
+    stream_clear(js); \
+    return e; \
+} while (false)
+
+    if (js->partial_len) {
+	FAIL(JE_UTF8, NewString("UTF-8 decoding error"));
+    }
+
+    switch (js->token_state) {
     case JK_STRING:
     case JK_STRING_BS:
 	FAIL(JE_INCOMPLETE, NewString("Unterminated string"));
 	break;
+    case JK_NUMBER:
+    case JK_BAREWORD:
+	/* The end of the input ends a number or bareword. */
+	{
+	    json_t *value;
+	    bool done;
+
+	    e = stream_scalar(js, &value, &errmsg);
+	    if (e != JE_OK) {
+		FAIL(e, errmsg);
+	    }
+	    js->token_state = JK_BASE;
+	    if (stream_add(js, value, result, &done) != JE_OK) {
+		FAIL(JE_SYNTAX, NewString("Expected string"));
+	    }
+	    if (done) {
+		return JE_OK;
+	    }
+	}
+	break;
     default:
-    case JK_TERMINAL:
-	/* Success. */
-	return JE_OK;
+	break;
     }
 
-#   undef ADD_TOKEN
+    if (js->depth == 0) {
+	FAIL(JE_INCOMPLETE, NewString("Empty input or incomplete object"));
+    }
+    FAIL(JE_INCOMPLETE,
+	    NewString((js->frames[js->depth - 1].json->type == JT_OBJECT)?
+		"Incomplete struct": "Incomplete array"));
+
 #   undef FAIL
-#   undef BAREWORD_DONE
-#   undef NUMBER_DONE
+}
+
+/**
+ * Check that nothing but white space follows a complete value.
+ * @param[in,out] js	Parser state
+ * @param[in] text	Text following the value
+ * @param[in] len	Length of text in bytes
+ * @param[out] error	Error if not successful
+ * @returns JE_OK, JE_EXTRA or JE_UTF8
+ */
+json_errcode_t
+json_stream_trailing(json_stream_t *js, const char *text, size_t len,
+	json_parse_error_t **error)
+{
+    size_t offset = 0;
+
+    *error = NULL;
+    while (js->partial_len || offset < len) {
+	ucs4_t ucs4;
+	int nr;
+
+	if (js->partial_len) {
+	    /* The character that ended the value was split across calls. */
+	    nr = utf8_to_unicode(js->partial, js->partial_len, &ucs4);
+	} else {
+	    nr = utf8_to_unicode(text + offset, len - offset, &ucs4);
+	}
+	if (nr <= 0) {
+	    *error = new_error(JE_UTF8, js->line, js->column + 1, js->offset,
+		    NewString("UTF-8 decoding error"));
+	    stream_clear(js);
+	    return JE_UTF8;
+	}
+	if (!is_json_space(ucs4)) {
+	    *error = new_error(JE_EXTRA, js->line, js->column + 1, js->offset,
+		    format_uerror("Extra text", ucs4));
+	    stream_clear(js);
+	    return JE_EXTRA;
+	}
+	if (js->partial_len) {
+	    js->partial_len = 0;
+	} else {
+	    offset += nr;
+	}
+	js->offset += nr;
+	if (ucs4 == '\n') {
+	    js->line++;
+	    js->column = 0;
+	} else {
+	    js->column++;
+	}
+    }
+    return JE_OK;
 }
 
 /**
@@ -750,30 +1025,22 @@ json_errcode_t
 json_parse(const char *text, ssize_t len, json_t **result,
 	json_parse_error_t **error)
 {
-    int line = 1;
-    int column = 0;
-    size_t offset = 0;
+    json_stream_t *js;
+    size_t consumed;
     json_errcode_t e;
-    ucs4_t stop_token;
-    bool r_any;
 
     if (len < 0) {
 	len = strlen(text);
     }
 
-    e = json_parse_internal(&line, &column, text, &offset, len, result, error,
-	    &stop_token, &r_any);
-    if (e == JE_OK && stop_token != 0) {
-	const char *adj = r_any? "Extra text": "Unexpected text";
-
-	e = r_any? JE_EXTRA: JE_SYNTAX;
-	*error = (json_parse_error_t *)Malloc(sizeof(json_parse_error_t));
-	(*error)->errcode = e;
-	(*error)->line = line;
-	(*error)->column = column;
-	(*error)->errmsg = format_uerror(adj, stop_token);
-	(*error)->offset = offset - 1;
+    js = json_stream_init();
+    e = json_stream_parse(js, text, len, &consumed, result, error);
+    if (e == JE_INCOMPLETE) {
+	e = json_stream_end(js, result, error);
+    } else if (e == JE_OK) {
+	e = json_stream_trailing(js, text + consumed, len - consumed, error);
     }
+    json_stream_free(js);
     return e;
 }
 
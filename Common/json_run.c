@@ -220,6 +220,25 @@ fail:
     return false;
 }
 
+/**
+ * Split parsed JSON into commands, then free it.
+ *
+ * @param[in] json	Parsed JSON
+ * @param[out] cmds	Parsed actions and arguments
+ * @param[out] single	Parsed single action
+ * @param[out] errmsg	Error message if splitting fails
+ *
+ * @return HJ_OK or HJ_BAD_CONTENT
+ */
+static hjparse_ret_t
+hjson_split_free(json_t *json, cmd_t ***cmds, char **single, char **errmsg)
+{
+    bool ok = hjson_split(json, cmds, single, errmsg);
+
+    json_free(json);
+    return ok? HJ_OK: HJ_BAD_CONTENT;
+}
+
 /**
  * Parse a JSON-formatted command or a set of commands.
  *
@@ -323,11 +342,49 @@ hjson_parse(const char *cmd, size_t cmd_len, cmd_t ***cmds, char **single,
 	return (errcode == JE_INCOMPLETE)? HJ_INCOMPLETE: HJ_BAD_SYNTAX;
     }
 
-    if (!hjson_split(json, cmds, single, errmsg)) {
-	json_free(json);
-	return HJ_BAD_CONTENT;
+    return hjson_split_free(json, cmds, single, errmsg);
+}
+
+/**
+ * Incrementally parse a JSON-formatted command or a set of commands.
+ *
+ * @param[in,out] js	Incremental parser state
+ * @param[in] cmd	Next piece of the command, in JSON format
+ * @param[in] cmd_len	Length of the piece
+ * @param[out] cmds	Parsed actions and arguments
+ * @param[out] single	Parsed single action
+ * @param[out] errmsg	Error message if parsing fails
+ *
+ * @return hjparse_ret_t; HJ_INCOMPLETE if more input is needed
+ */
+hjparse_ret_t
+hjson_parse_stream(json_stream_t *js, const char *cmd, size_t cmd_len,
+	cmd_t ***cmds, char **single, char **errmsg)
+{
+    json_t *json;
+    json_errcode_t errcode;
+    json_parse_error_t *error;
+    size_t consumed;
+
+    *cmds = NULL;
+    *single = NULL;
+    *errmsg = NULL;
+
+    /* Parse the JSON. */
+    errcode = json_stream_parse(js, cmd, cmd_len, &consumed, &json, &error);
+    if (errcode == JE_INCOMPLETE) {
+	return HJ_INCOMPLETE;
+    }
+    if (errcode == JE_OK) {
+	errcode = json_stream_trailing(js, cmd + consumed, cmd_len - consumed,
+		&error);
+    }
+    if (errcode != JE_OK) {
+	*errmsg = Asprintf("JSON parse error: line %d, column %d: %s",
+		error->line, error->column, error->errmsg);
+	json_free_both(json, error);
+	return HJ_BAD_SYNTAX;
     }
 
-    json_free(json);
-    return HJ_OK;
+    return hjson_split_free(json, cmds, single, errmsg);
 }
@@ -1,6 +1,6 @@
 # Object files for lib3270.
-LIB3270_OBJECTS = Malloc.o XtGlue.o actions.o b8.o bind-opt.o child.o \
-	childscript.o codepage.o cookiefile.o ctlr.o devname.o event.o \
+LIB3270_OBJECTS = Malloc.o XtGlue.o actions.o b8.o bind-opt.o bintrace.o \
+	child.o childscript.o codepage.o cookiefile.o ctlr.o devname.o event.o \
 	favicon.o fprint_screen.o ft.o ft_cut.o ft_dft.o glue.o host.o \
 	httpd-core.o httpd-io.o httpd-nodes.o icmd.o idle.o json.o json_run.o \
 	kybd.o linemode.o llist.o login_macro.o model.o nvt.o output.o \
@@ -1,7 +1,8 @@
 # Object files for lib32xx.
-LIB32XX_OBJECTS = apl.o asprintf.o base64.o boolstr.o copyright.o indent_s.o \
-	min_version.o popup_an_error.o popup_separator.o popups_glue.o \
-	pr3287_session.o prefer.o proxy.o proxy_http.o proxy_passthru.o \
-	proxy_socks4.o proxy_socks5.o proxy_telnet.o proxy_toggle.o \
-	resolver.o see.o sioc.o split_host.o tables.o toupper.o txa.o \
-	unicode.o unicode_dbcs.o utf8.o varbuf.o xs_buffer.o
+LIB32XX_OBJECTS = apl.o asprintf.o base64.o bintrace_fmt.o boolstr.o \
+	copyright.o indent_s.o min_version.o popup_an_error.o \
+	popup_separator.o popups_glue.o pr3287_session.o prefer.o proxy.o \
+	proxy_http.o proxy_passthru.o proxy_socks4.o proxy_socks5.o \
+	proxy_telnet.o proxy_toggle.o resolver.o see.o sioc.o split_host.o \
+	tables.o toupper.o txa.o unicode.o unicode_dbcs.o utf8.o varbuf.o \
+	varint.o xs_buffer.o
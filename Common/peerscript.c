@@ -38,6 +38,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #endif /*]*/
 
@@ -144,6 +145,7 @@ typedef struct {
     void *irhandle;	/* input request handle */
     task_cb_ir_state_t ir_state; /* named input request state */
     json_t *json_result; /* pending JSON result */
+    varbuf_t output;	/* output not yet sent */
 } peer_t;
 static llist_t peer_scripts = LLIST_INIT(peer_scripts);
 
@@ -185,6 +187,7 @@ close_peer(peer_t *p)
     }
     Replace(p->buf, NULL);
     Replace(p->name, NULL);
+    vb_free(&p->output);
 
     if (p->listener == NULL || p->listener->mode == PLM_ONCE) {
 	vtrace("once-only socket closed, exiting\n");
@@ -407,8 +410,25 @@ check_send(socket_t s, const char *data, size_t len, const char *sender)
     }
 }
 
+/**
+ * Send accumulated output to a peer.
+ *
+ * @param[in,out] p	Peer
+ * @param[in] sender	Sending function
+ */
+static void
+peer_flush(peer_t *p, const char *sender)
+{
+    if (vb_len(&p->output)) {
+	check_send(p->socket, vb_buf(&p->output), vb_len(&p->output), sender);
+	vb_reset(&p->output);
+    }
+}
+
 /**
  * Callback for data returned to peer socket command.
+ * The data is sent along with the command's completion, so a command's
+ * entire response is written at once.
  *
  * @param[in] handle	Callback handle
  * @param[in] buf	Buffer
@@ -429,7 +449,7 @@ peer_data(task_cbh handle, const char *buf, size_t len, bool success)
 
     s3data(buf, len, success, p->capabilities, p->json_result, NULL, &cooked);
     if (cooked != NULL) {
-	check_send(p->socket, cooked, strlen(cooked), "peer_data");
+	vb_appends(&p->output, cooked);
 	Free(cooked);
     }
 
@@ -457,7 +477,8 @@ peer_reqinput(task_cbh handle, const char *buf, size_t len, bool echo)
     recursing = true;
 
     s = Asprintf("%s%.*s\n", echo? INPUT_PREFIX: PWINPUT_PREFIX, (int)len, buf);
-    check_send(p->socket, s, strlen(s), "peer_reqinput");
+    vb_appends(&p->output, s);
+    peer_flush(p, "peer_reqinput");
     Free(s);
     recursing = false;
 }
@@ -476,10 +497,10 @@ peer_done(task_cbh handle, bool success, bool abort)
 {
     peer_t *p = (peer_t *)handle;
     char *out;
-    bool new_child = false;
 
     s3done(handle, success, &p->json_result, &out);
-    check_send(p->socket, out, strlen(out), "peer_done");
+    vb_appends(&p->output, out);
+    peer_flush(p, "peer_done");
     Free(out);
 
     if (abort || !p->enabled) {
@@ -488,8 +509,7 @@ peer_done(task_cbh handle, bool success, bool abort)
     }
 
     /* Run any pending command that we already read in. */
-    new_child = run_next(p);
-    if (!new_child && p->id == NULL_IOID) {
+    if (!run_next(p) && p->id == NULL_IOID) {
 	/* Allow more input. */
 #if defined(_WIN32) /*[*/
 	p->id = AddInput(p->event, peer_input);
@@ -499,10 +519,10 @@ peer_done(task_cbh handle, bool success, bool abort)
     }
 
     /*
-     * If there was a new child, we're still active. Otherwise, let our sms
-     * be popped.
+     * Let our CB be popped. A pending command runs in a new CB, on its own
+     * taskq, so keeping this one would leave it behind for good.
      */
-    return !new_child;
+    return true;
 }
 
 /**
@@ -725,10 +745,17 @@ void
 peer_accepted(socket_t s, void *listener)
 {
     peer_t *p = (peer_t *)Calloc(1, sizeof(peer_t));
+    int on = 1;
 #if defined(_WIN32) /*[*/
     HANDLE event;
 #endif /*]*/
 
+    /*
+     * Responses are written in one piece, so don't delay them. This fails
+     * harmlessly on Unix-domain sockets.
+     */
+    (void) setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&on, sizeof(on));
+
 #if !defined(_WIN32) /*[*/
     fcntl(s, F_SETFD, 1);
 #else /*][*/
@@ -754,6 +781,7 @@ peer_accepted(socket_t s, void *listener)
 #endif /*]*/
     p->buf = NULL;
     p->buf_len = 0;
+    vb_init(&p->output);
     p->enabled = true;
     task_cb_init_ir_state(&p->ir_state);
     LLIST_APPEND(&p->llist, peer_scripts);
@@ -831,7 +859,7 @@ peer_init(struct sockaddr *sa, socklen_t sa_len, peer_listen_mode mode)
 	goto fail;
     }
 
-    if (listen(listener->socket, 1) < 0) {
+    if (listen(listener->socket, (mode == PLM_MULTI)? SOMAXCONN: 1) < 0) {
 #if !defined(_WIN32) /*[*/
 	popup_an_errno(errno, "script socket listen");
 #else /*][*/
@@ -56,6 +56,7 @@
 #include <assert.h>
 
 #include "bind-opt.h"
+#include "bintrace.h"
 #include "resolver.h"
 #include "sa_malloc.h"
 
@@ -81,6 +82,11 @@ static enum {
 } tstate = T_NONE;
 bool fdisp = false;
 
+/* Binary trace state. */
+static FILE *bfile = NULL;		/* binary trace file, or NULL */
+static bintrace_record_t brec;		/* current record */
+static size_t brec_off = 0;		/* data already sent from brec */
+
 static void process(FILE *f, socket_t s);
 typedef enum {
     STEP_LINE,	/* step one line in the file */
@@ -89,6 +95,8 @@ typedef enum {
     STEP_BIDIR,	/* step bidirectionally */
 } step_t;
 static bool step(FILE *f, socket_t s, step_t type);
+static bool step_binary(socket_t s, step_t type);
+static bool match_emulator(socket_t s, const char *data, size_t len);
 static int process_command(FILE *f, socket_t s);
 void trace_netdata(char *direction, unsigned char *buf, size_t len);
 
@@ -205,7 +213,7 @@ main(int argc, char *argv[])
 #endif /*]*/
 
     /* Open the file. */
-    f = fopen(argv[optind], "r");
+    f = fopen(argv[optind], "rb");
     if (f == NULL) {
 	perror(argv[optind]);
 	exit(1);
@@ -284,6 +292,7 @@ main(int argc, char *argv[])
 	} else {
 	    printf("Waiting for connection.\n");
 	}
+	fflush(stdout);
 	for (;;) {
 #if !defined(_WIN32) /*[*/
 	    fd_set rfds;
@@ -365,6 +374,8 @@ main(int argc, char *argv[])
 #endif /*]*/
 	wait = false;
 	rewind(f);
+	bfile = bintrace_is_binary(f)? f: NULL;
+	brec_off = brec.len = 0;
 	pstate = BASE;
 	fdisp = false;
 	if (bidir) {
@@ -689,6 +700,10 @@ step(FILE *f, socket_t s, step_t type)
     char other_dchar = dchars[!direction];
 #   define NO_FDISP { if (fdisp) { printf("\n"); fdisp = false; } }
 
+    if (bfile != NULL) {
+	return step_binary(s, type);
+    }
+
 top:
     while (again || ((c = fgetc(f)) != EOF)) {
 	if (c == '\r') {
@@ -855,53 +870,9 @@ run_it:
 	}
     }
 
-    if (type == STEP_BIDIR && direction == FROM_EMUL && (cp != obuf)) {
-	char ibuf[BSIZE];
-	ssize_t n2r = cp - obuf;
-	size_t offset = 0;
-
-	/* Match input from the emulator. */
-	/* XXX: Need a non-Windows timeout here. */
-	while (n2r > 0) {
-#if defined(_WIN32) /*[*/
-	    HANDLE ha[1];
-	    DWORD ret;
-#endif /*]*/
-	    int nr;
-
-	    printf("Waiting for %u bytes from emulator\n", (unsigned)n2r);
-	    fflush(stdout);
-#if defined(_WIN32) /*[*/
-	    ha[0] = socket2_event;
-	    ret = WaitForMultipleObjects(1, ha, FALSE, 1000);
-	    switch (ret) {
-	    case WAIT_OBJECT_0: /* socket input */
-		break;
-	    case WAIT_FAILED:
-		win32_perror("WaitForMultipleObjects");
-		exit(2);
-	    }
-#endif /*]*/
-	    nr = recv(s, ibuf + offset, (int)n2r, 0);
-	    if (nr < 0) {
-		sockerr("playback: emulator recv");
-		return false;
-	    }
-	    if (nr == 0) {
-		fprintf(stderr, "Socket EOF\n");
-		return false;
-	    }
-	    printf("Got %u bytes from emulator\n", (unsigned)nr);
-	    trace_netdata("emul", (unsigned char *)ibuf, nr);
-	    offset += nr;
-	    n2r -= nr;
-	}
-	if (memcmp(ibuf, obuf, cp - obuf)) {
-	    fprintf(stderr, "Emulator data mismatch\n");
-	    exit(2);
-	}
-	printf("Matched %u bytes from emulator\n", (unsigned)(cp - obuf));
-	fflush(stdout);
+    if (type == STEP_BIDIR && direction == FROM_EMUL && (cp != obuf) &&
+	    !match_emulator(s, obuf, cp - obuf)) {
+	return false;
     }
 
     if ((type == STEP_MARK && !at_mark) || type == STEP_BIDIR) {
@@ -920,6 +891,130 @@ done:
     return false;
 }
 
+/*
+ * Match input from the emulator.
+ *
+ * Returns false for EOF or error, true otherwise. Exits on a mismatch.
+ */
+static bool
+match_emulator(socket_t s, const char *data, size_t len)
+{
+    char ibuf[BSIZE];
+    size_t n2r = len;
+    size_t offset = 0;
+
+    /* XXX: Need a non-Windows timeout here. */
+    while (n2r > 0) {
+#if defined(_WIN32) /*[*/
+	HANDLE ha[1];
+	DWORD ret;
+#endif /*]*/
+	int nr;
+
+	printf("Waiting for %u bytes from emulator\n", (unsigned)n2r);
+	fflush(stdout);
+#if defined(_WIN32) /*[*/
+	ha[0] = socket2_event;
+	ret = WaitForMultipleObjects(1, ha, FALSE, 1000);
+	switch (ret) {
+	case WAIT_OBJECT_0: /* socket input */
+	    break;
+	case WAIT_FAILED:
+	    win32_perror("WaitForMultipleObjects");
+	    exit(2);
+	}
+#endif /*]*/
+	nr = recv(s, ibuf, (int)((n2r > BSIZE)? BSIZE: n2r), 0);
+	if (nr < 0) {
+	    sockerr("playback: emulator recv");
+	    return false;
+	}
+	if (nr == 0) {
+	    fprintf(stderr, "Socket EOF\n");
+	    return false;
+	}
+	printf("Got %u bytes from emulator\n", (unsigned)nr);
+	trace_netdata("emul", (unsigned char *)ibuf, nr);
+	if (memcmp(ibuf, data + offset, nr)) {
+	    fprintf(stderr, "Emulator data mismatch\n");
+	    exit(2);
+	}
+	offset += nr;
+	n2r -= nr;
+    }
+    printf("Matched %u bytes from emulator\n", (unsigned)len);
+    fflush(stdout);
+    return true;
+}
+
+/*
+ * Step through a binary trace file.
+ *
+ * Binary traces have no marks, so STEP_MARK plays to EOF. Otherwise the
+ * step types work the same way as for text traces.
+ *
+ * Returns false for EOF or error, true otherwise.
+ */
+static bool
+step_binary(socket_t s, step_t type)
+{
+    for (;;) {
+	size_t len;
+	bool at_eor = false;
+
+	/* Get the next record, if the last one is used up. */
+	if (brec_off >= brec.len) {
+	    switch (bintrace_read(bfile, &brec)) {
+	    case BTR_EOF:
+		printf("Playback file EOF.\n");
+		return false;
+	    case BTR_ERROR:
+		printf("Playback file is truncated or damaged.\n");
+		return false;
+	    case BTR_RECORD:
+		break;
+	    }
+	    brec_off = 0;
+	    if (brec.direction == BINTRACE_EMUL) {
+		brec_off = brec.len;
+		if (type == STEP_BIDIR && brec.len &&
+			!match_emulator(s, (char *)brec.buf, brec.len)) {
+		    return false;
+		}
+		continue;
+	    }
+	}
+
+	/* Send host data, stopping after IAC EOR if stepping by record. */
+	len = brec.len - brec_off;
+	if (type == STEP_EOR) {
+	    size_t i;
+
+	    for (i = brec_off; i < brec.len; i++) {
+		if (tstate == T_IAC) {
+		    tstate = T_NONE;
+		    if (brec.buf[i] == EOR) {
+			at_eor = true;
+			len = i + 1 - brec_off;
+			break;
+		    }
+		} else if (brec.buf[i] == IAC) {
+		    tstate = T_IAC;
+		}
+	    }
+	}
+	trace_netdata("host", brec.buf + brec_off, len);
+	if (send(s, (char *)brec.buf + brec_off, (int)len, 0) < 0) {
+	    sockerr("send");
+	    return false;
+	}
+	brec_off += len;
+	if (type == STEP_LINE || at_eor) {
+	    return true;
+	}
+    }
+}
+
 /* Local copy of ut_getenv(), which always fails. */
 const char *
 ut_getenv(const char *name)
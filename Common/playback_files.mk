@@ -1,2 +1,3 @@
 # playback-specific object files
 PLAYBACK_OBJECTS = playback.o sa_malloc.o
+BTRC2TRC_OBJECTS = btrc2trc.o sa_malloc.o
@@ -45,9 +45,11 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #if !defined(_WIN32) /*[*/
+#include <sys/uio.h>
 #include <sys/wait.h>
 #endif /*]*/
 #include <signal.h>
+#include <fcntl.h>
 #include "globals.h"
 #include "pr3287.h"
 #include "3270ds.h"
@@ -57,6 +59,8 @@
 #include "sf.h"
 #include "tables.h"
 #include "unicodec.h"
+#include "utils.h"
+#include "varbuf.h"
 #include "xtablec.h"
 #if defined(_WIN32) /*[*/
 #include "wsc.h"
@@ -80,64 +84,152 @@
 
 #define FCORDER_NOP	0x0001	/* dummy filler for DBCS right half */
 
+#define JOB_CHUNK	8192	/* job output passed to the sink at a time */
+
 static const char *ll_name[] = { "unformatted132", "formatted40", "formatted64", "formatted80" };
 static int ll_len[] = { 132, 40, 64, 80 };
 
-/* 3270 (formatted mode) data */
-static unsigned char default_gr;
-static unsigned char default_cs;
-static int line_length;
-static ucs4_t page_buf[MAX_BUF];
-static unsigned char *xlate_buf[MAX_BUF];
-int xlate_len[MAX_BUF];
-static int baddr = 0;
-static bool page_buf_initted = false;
-static bool any_3270_printable = false;
-static int any_3270_output = 0;
+
+/* SCS constants. */
+#define MAX_MPP	132
+#define MAX_MPL	108
+
+/*
+ * Per-session printer state. pr3287 normally has just one session; with -lus
+ * it has one for each LU, and switches between them with ctlr_session_set().
+ */
+struct ctlr_session {
+    char *name;			/* session name, for spool files */
+    unsigned long jobs;		/* number of jobs started */
+
+    /* 3270 (formatted mode) data */
+    unsigned char default_gr;
+    unsigned char default_cs;
+    int line_length;
+    ucs4_t page_buf[MAX_BUF];
+    unsigned char *xlate_buf[MAX_BUF];
+    int xlate_len[MAX_BUF];
+    int baddr;
+    bool page_buf_initted;
+    bool any_3270_printable;
+    int any_3270_output;
 #if !defined(_WIN32) /*[*/
-static FILE *prfile = NULL;
-static int prpid = -1;
+    FILE *prfile;
+    int prpid;
+    int prfd;			/* file descriptor to write the job to */
+    char *spool_name;		/* temporary spool file name */
 #else /*][*/
-static int ws_initted = 0;
-static int ws_needpre = 1;
+    int ws_initted;
+    int ws_needpre;
 #endif /*]*/
-static unsigned char wcc_line_length;
+    unsigned char wcc_line_length;
+
+    /* SCS data */
+    ucs4_t linebuf[MAX_MPP+1];
+    struct {
+	unsigned malloc_len;
+	unsigned data_len;
+	char *buf;
+    } trnbuf[MAX_MPP+1];
+    char htabs[MAX_MPP+1];
+    char vtabs[MAX_MPL+1];
+    int lm, tm, bm, mpp, mpl, scs_any;
+    int pp;
+    int line;
+    bool scs_initted;
+    bool any_scs_output;
+    size_t scs_leftover_len;
+    int scs_leftover_buf[256];
+    int scs_dbcs_subfield;
+    unsigned char scs_dbcs_c1;
+    unsigned scs_cs;
+    bool ffeoj_last;
+
+    /* Unformatted 3270 output */
+    struct {
+	char buf;		/* printable data */
+	unsigned char *trn;	/* transparent data */
+	unsigned trn_len;	/* length of transparent data */
+    } uo_data[MAX_UNF_MPP + 2];	/* room for full line plus carriage control */
+    unsigned uo_col;		/* current output column */
+    unsigned uo_maxcol;		/* maximum column buffered */
+    bool uo_last_cr;		/* last data was CR */
+
+    /* Print job output */
+    varbuf_t pre;		/* -trnpre data not yet sent to the sink */
+    varbuf_t job;		/* output not yet sent to the sink */
+    varbuf_t post;		/* -trnpost data not yet sent to the sink */
+    bool in_job;		/* a print job is in progress */
+    bool job_started;		/* the job has been started on the sink */
+};
+
+static ctlr_session_t *ctx;	/* current session */
 
 static int ctlr_erase(void);
 static int dump_formatted(void);
 static int dump_unformatted(void);
 static int stash(unsigned char c);
+static int stash_buf(const char *buf, size_t len);
+static int stash_newline(void);
 static int prflush(void);
-static int copyfile(const char *filename);
+static int copyfile(const char *filename, varbuf_t *vb);
 
 #define DECODE_BADDR(c1, c2) \
     ((((c1) & 0xC0) == 0x00) ? \
     (((c1) & 0x3F) << 8) | (c2) : \
     (((c1) & 0x3F) << 6) | ((c2) & 0x3F))
 
-/* SCS constants and data. */
-#define MAX_MPP	132
-#define MAX_MPL	108
 
-static ucs4_t linebuf[MAX_MPP+1];
-static struct {
-    unsigned malloc_len;
-    unsigned data_len;
-    char *buf;
-} trnbuf[MAX_MPP+1];
-static char htabs[MAX_MPP+1];
-static char vtabs[MAX_MPL+1];
-static int lm, tm, bm, mpp, mpl, scs_any;
-static int pp;
-static int line;
-static bool scs_initted = false;
-static bool any_scs_output = false;
-static size_t scs_leftover_len = 0;
-static int scs_leftover_buf[256];
-static int scs_dbcs_subfield = 0;
-static unsigned char scs_dbcs_c1 = 0;
-static unsigned scs_cs = 0;
-static bool ffeoj_last = false;
+/*
+ * Create a printer session.
+ * The name is used to label the session's spool files.
+ */
+ctlr_session_t *
+ctlr_session_new(const char *name)
+{
+    ctlr_session_t *s = (ctlr_session_t *)Calloc(1, sizeof(ctlr_session_t));
+
+    s->name = NewString(name);
+#if !defined(_WIN32) /*[*/
+    s->prpid = -1;
+    s->prfd = -1;
+#else /*][*/
+    s->ws_needpre = 1;
+#endif /*]*/
+    vb_init(&s->pre);
+    vb_init(&s->job);
+    vb_init(&s->post);
+    return s;
+}
+
+/* Free a printer session. Any print job should already have been ended. */
+void
+ctlr_session_free(ctlr_session_t *s)
+{
+    int i;
+
+    for (i = 0; i < MAX_MPP + 1; i++) {
+	Free(s->trnbuf[i].buf);
+    }
+    for (i = 0; i < MAX_UNF_MPP + 2; i++) {
+	Free(s->uo_data[i].trn);
+    }
+    vb_free(&s->pre);
+    vb_free(&s->job);
+    vb_free(&s->post);
+    Free(s->name);
+    if (ctx == s) {
+	ctx = NULL;
+    }
+    Free(s);
+}
+
+/* Make a printer session the current one. */
+void
+ctlr_session_set(ctlr_session_t *s)
+{
+    ctx = s;
+}
 
 /*
 * Interpret an incoming 3270 command.
@@ -165,7 +257,7 @@ process_ds(unsigned char *buf, size_t buflen)
 	if (ctlr_erase() < 0 || prflush() < 0) {
 	    return PDS_FAILED;
 	}
-	baddr = 0;
+	ctx->baddr = 0;
 	ctlr_write(buf, buflen, true);
 	return PDS_OKAY_NO_OUTPUT;
     case CMD_EW:	/* erase/write */
@@ -174,7 +266,7 @@ process_ds(unsigned char *buf, size_t buflen)
 	if (ctlr_erase() < 0 || prflush() < 0) {
 	    return PDS_FAILED;
 	}
-	baddr = 0;
+	ctx->baddr = 0;
 	ctlr_write(buf, buflen, true);
 	return PDS_OKAY_NO_OUTPUT;
     case CMD_W:	/* write */
@@ -230,7 +322,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 #define END_TEXT(cmd)	{ END_TEXT0; trace_ds(" %s", cmd); }
 
 #define START_FIELD(fa) { \
-	    ctlr_add(0, FA_IS_ZERO(fa)?INVISIBLE:VISIBLE, 0, default_gr); \
+	    ctlr_add(0, FA_IS_ZERO(fa)?INVISIBLE:VISIBLE, 0, ctx->default_gr); \
 	    trace_ds(see_attr(fa)); \
 	}
 
@@ -238,30 +330,30 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	return;
     }
 
-    if (!page_buf_initted) {
-	memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-	memset(xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
-	memset(xlate_len, '\0', MAX_BUF * sizeof(int));
-	page_buf_initted = true;
-	baddr = 0;
+    if (!ctx->page_buf_initted) {
+	memset(ctx->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+	memset(ctx->xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
+	memset(ctx->xlate_len, '\0', MAX_BUF * sizeof(int));
+	ctx->page_buf_initted = true;
+	ctx->baddr = 0;
     }
 
-    default_gr = 0;
-    default_cs = 0;
+    ctx->default_gr = 0;
+    ctx->default_cs = 0;
 
     if (WCC_RESET(buf[1])) {
 	trace_ds("%sreset", paren);
 	paren = ",";
     }
-    wcc_line_length = WCC_LINE_LENGTH(buf[1]);
-    if (wcc_line_length) {
-	trace_ds("%s%s", paren, ll_name[wcc_line_length >> 4]);
+    ctx->wcc_line_length = WCC_LINE_LENGTH(buf[1]);
+    if (ctx->wcc_line_length) {
+	trace_ds("%s%s", paren, ll_name[ctx->wcc_line_length >> 4]);
 	paren = ",";
     } else {
 	trace_ds("%sunformatted", paren);
 	paren = ",";
     }
-    line_length = ll_len[wcc_line_length >> 4];
+    ctx->line_length = ll_len[ctx->wcc_line_length >> 4];
     wcc_sound_alarm = WCC_SOUND_ALARM(buf[1]);
     if (wcc_sound_alarm) {
 	trace_ds("%salarm", paren);
@@ -298,24 +390,24 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    cp += 2;	/* skip buffer address */
 	    xbaddr = DECODE_BADDR(*(cp - 1), *cp);
 	    END_TEXT("SetBufferAddress");
-	    if (wcc_line_length) {
-		trace_ds("(%d,%d)", 1 + (xbaddr / line_length),
-			1 + (xbaddr % line_length));
+	    if (ctx->wcc_line_length) {
+		trace_ds("(%d,%d)", 1 + (xbaddr / ctx->line_length),
+			1 + (xbaddr % ctx->line_length));
 	    } else {
-		    trace_ds("(%d[%+d])", xbaddr, xbaddr - baddr);
+		    trace_ds("(%d[%+d])", xbaddr, xbaddr - ctx->baddr);
 	    }
 	    if (xbaddr >= MAX_BUF) {
 		/* Error! */
-		baddr = 0;
+		ctx->baddr = 0;
 		return;
 	    }
-	    if (wcc_line_length) {
+	    if (ctx->wcc_line_length) {
 		/* Formatted. */
-		baddr = xbaddr;
-	    } else if (xbaddr > baddr) {
+		ctx->baddr = xbaddr;
+	    } else if (xbaddr > ctx->baddr) {
 		/* Unformatted. */
-		while (baddr < xbaddr) {
-		    ctlr_add(0, ' ', default_cs, default_gr);
+		while (ctx->baddr < xbaddr) {
+		    ctlr_add(0, ' ', ctx->default_cs, ctx->default_gr);
 		}
 	    }
 	    previous = SBA;
@@ -332,11 +424,11 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    cp += 2;	/* skip buffer address */
 	    xbaddr = DECODE_BADDR(*(cp-1), *cp);
 	    END_TEXT("RepeatToAddress");
-	    if (wcc_line_length) {
-		trace_ds("(%d,%d)", 1 + (xbaddr / line_length),
-			1 + (xbaddr % line_length));
+	    if (ctx->wcc_line_length) {
+		trace_ds("(%d,%d)", 1 + (xbaddr / ctx->line_length),
+			1 + (xbaddr % ctx->line_length));
 	    } else {
-		trace_ds("(%d[%+d])", xbaddr, xbaddr - baddr);
+		trace_ds("(%d[%+d])", xbaddr, xbaddr - ctx->baddr);
 	    }
 	    cp++;		/* skip char to repeat */
 	    if (*cp == ORDER_GE){
@@ -348,8 +440,8 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    }
 	    trace_ds("'%s'", see_ebc(*cp));
 	    previous = ORDER;
-	    if (xbaddr > MAX_BUF || xbaddr < baddr) {
-		baddr = 0;
+	    if (xbaddr > MAX_BUF || xbaddr < ctx->baddr) {
+		ctx->baddr = 0;
 		return;
 	    }
 	    /* Translate '*cp' once. */
@@ -369,9 +461,9 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 		}
 		break;
 	    }
-	    while (baddr < xbaddr) {
-		ctlr_add(ra_ge? 0: *cp, ra_xlate, ra_ge? CS_GE: default_cs,
-			default_gr);
+	    while (ctx->baddr < xbaddr) {
+		ctlr_add(ra_ge? 0: *cp, ra_xlate, ra_ge? CS_GE: ctx->default_cs,
+			ctx->default_gr);
 	    }
 	    break;
 	case ORDER_EUA:	/* erase unprotected to address */
@@ -392,7 +484,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 		trace_ds("'");
 	    }
 	    ctlr_add(0, ebcdic_to_unicode(*cp, CS_GE, EUO_NONE), CS_GE,
-		    default_gr);
+		    ctx->default_gr);
 	    break;
 	case ORDER_MF:	/* modify field */
 	    END_TEXT("ModifyField");
@@ -435,7 +527,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    if (!any_fa) {
 		START_FIELD(0);
 	    }
-	    ctlr_add(0, '\0', 0, default_gr);
+	    ctlr_add(0, '\0', 0, ctx->default_gr);
 	    break;
 	case ORDER_SA:	/* set attribute */
 	    END_TEXT("SetAttribtue");
@@ -445,14 +537,14 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
 	    } else if (*cp == XA_HIGHLIGHTING)  {
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
-		default_gr = *(cp + 1) & 0x07;
+		ctx->default_gr = *(cp + 1) & 0x07;
 	    } else if (*cp == XA_ALL)  {
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
-		default_gr = 0;
-		default_cs = 0;
+		ctx->default_gr = 0;
+		ctx->default_cs = 0;
 	    } else if (*cp == XA_CHARSET) {
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
-		default_cs = (*(cp + 1) == 0xf1) ? 1 : 0;
+		ctx->default_cs = (*(cp + 1) == 0xf1) ? 1 : 0;
 	    } else {
 		trace_ds("%s[unsupported]", see_efa(*cp, *(cp + 1)));
 	    }
@@ -461,45 +553,45 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	case FCORDER_FF:	/* Form Feed */
 	    END_TEXT("FF");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_FF, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_FF, ctx->default_cs, ctx->default_gr);
 	    break;
 	case FCORDER_CR:	/* Carriage Return */
 	    END_TEXT("CR");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_CR, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_CR, ctx->default_cs, ctx->default_gr);
 	    break;
 	case FCORDER_NL:	/* New Line */
 	    END_TEXT("NL");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_NL, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_NL, ctx->default_cs, ctx->default_gr);
 	    break;
 	case FCORDER_EM:	/* End of Media */
 	    END_TEXT("EM");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_EM, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_EM, ctx->default_cs, ctx->default_gr);
 	    break;
 	case FCORDER_DUP:	/* Visible control characters */
 	case FCORDER_FM:
 	    END_TEXT(see_ebc(*cp));
 	    previous = ORDER;
-	    ctlr_add(0, ebc2asc0[*cp], default_cs, default_gr);
+	    ctlr_add(0, ebc2asc0[*cp], ctx->default_cs, ctx->default_gr);
 	    break;
 	case FCORDER_SUB:	/* misc format control orders */
 	case FCORDER_EO:
 	    END_TEXT(see_ebc(*cp));
 	    previous = ORDER;
-	    ctlr_add(0, '\0', default_cs, default_gr);
+	    ctlr_add(0, '\0', ctx->default_cs, ctx->default_gr);
 	    break;
 	case FCORDER_NULL:
 	    END_TEXT("NULL");
 	    previous = NULLCH;
-	    ctlr_add(0, '\0', default_cs, default_gr);
+	    ctlr_add(0, '\0', ctx->default_cs, ctx->default_gr);
 	    break;
 	default:	/* enter character */
 	    if (*cp <= 0x3F) {
 		END_TEXT("ILLEGAL-ORDER ");
 		previous = ORDER;
-		ctlr_add(0, '\0', default_cs, default_gr);
+		ctlr_add(0, '\0', ctx->default_cs, ctx->default_gr);
 		trace_ds("%s", see_ebc(*cp));
 		break;
 	    }
@@ -508,8 +600,8 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    }
 	    previous = TEXT;
 	    trace_ds("%s", see_ebc(*cp));
-	    ctlr_add(*cp, ebcdic_to_unicode(*cp, default_cs, EUO_NONE),
-		    default_cs, default_gr);
+	    ctlr_add(*cp, ebcdic_to_unicode(*cp, ctx->default_cs, EUO_NONE),
+		    ctx->default_cs, ctx->default_gr);
 	    break;
 	}
     }
@@ -533,11 +625,11 @@ init_scs_horiz(void)
 {
     int i;
 
-    mpp = MAX_MPP;
-    lm = 1;
-    htabs[1] = 1;
+    ctx->mpp = MAX_MPP;
+    ctx->lm = 1;
+    ctx->htabs[1] = 1;
     for (i = 2; i <= MAX_MPP; i++) {
-	htabs[i] = 0;
+	ctx->htabs[i] = 0;
     }
 }
 
@@ -546,12 +638,12 @@ init_scs_vert(void)
 {
     int i;
 
-    mpl = 1;
-    tm = 1;
-    bm = mpl;
-    vtabs[1] = 1;
+    ctx->mpl = 1;
+    ctx->tm = 1;
+    ctx->bm = ctx->mpl;
+    ctx->vtabs[1] = 1;
     for (i = 0; i <= MAX_MPL; i++) {
-	vtabs[i] = 0;
+	ctx->vtabs[i] = 0;
     }
 }
 
@@ -560,33 +652,33 @@ init_scs(void)
 {
     int i;
 
-    if (scs_initted) {
+    if (ctx->scs_initted) {
 	return;
     }
 
     trace_ds("Initializing SCS virtual 3287.\n");
     init_scs_horiz();
     init_scs_vert();
-    pp = 1;
-    line = 1;
-    scs_any = 0;
+    ctx->pp = 1;
+    ctx->line = 1;
+    ctx->scs_any = 0;
     for (i = 0; i < MAX_MPP+1; i++) {
-	linebuf[i] = ' ';
+	ctx->linebuf[i] = ' ';
     }
     for (i = 0; i < MAX_MPP+1; i++) {
-	if (trnbuf[i].malloc_len != 0) {
-	    Free(trnbuf[i].buf);
-	    trnbuf[i].buf = NULL;
-	    trnbuf[i].malloc_len = 0;
+	if (ctx->trnbuf[i].malloc_len != 0) {
+	    Free(ctx->trnbuf[i].buf);
+	    ctx->trnbuf[i].buf = NULL;
+	    ctx->trnbuf[i].malloc_len = 0;
 	}
-	trnbuf[i].data_len = 0;
+	ctx->trnbuf[i].data_len = 0;
     }
-    scs_leftover_len = 0;
-    scs_dbcs_subfield = 0;
-    scs_dbcs_c1 = 0;
-    scs_cs = 0;
+    ctx->scs_leftover_len = 0;
+    ctx->scs_dbcs_subfield = 0;
+    ctx->scs_dbcs_c1 = 0;
+    ctx->scs_cs = 0;
 
-    scs_initted = true;
+    ctx->scs_initted = true;
 }
 
 #if defined(_WIN32) /*[*/
@@ -627,10 +719,12 @@ dump_scs_line(bool reset_pp, bool always_nl)
 {
     int i;
     bool any_data = false;
+    char out[1024];		/* output, collected to stash in one piece */
+    size_t olen = 0;
 
     /* Find the last non-space character in the line buffer. */
-    for (i = mpp; i >= 1; i--) {
-	if (trnbuf[i].data_len != 0 || linebuf[i] != ' ') {
+    for (i = ctx->mpp; i >= 1; i--) {
+	if (ctx->trnbuf[i].data_len != 0 || ctx->linebuf[i] != ' ') {
 	    break;
 	}
     }
@@ -653,73 +747,79 @@ dump_scs_line(bool reset_pp, bool always_nl)
 	     * Dump and transparent data that precedes this
 	     * character.
 	     */
-	    if (trnbuf[j].data_len) {
-		unsigned k;
-
+	    if (ctx->trnbuf[j].data_len) {
 #if defined(DEBUG_FF) /*[*/
-		n_trn += trnbuf[j].data_len;
+		n_trn += ctx->trnbuf[j].data_len;
 #endif /*]*/
-		for (k = 0; k < trnbuf[j].data_len; k++) {
-		    if (stash(trnbuf[j].buf[k]) < 0) {
-			return -1;
-		    }
+		if (stash_buf(out, olen) < 0 ||
+			stash_buf(ctx->trnbuf[j].buf,
+			    ctx->trnbuf[j].data_len) < 0) {
+		    return -1;
 		}
-		trnbuf[j].data_len = 0;
+		olen = 0;
+		ctx->trnbuf[j].data_len = 0;
 	    }
-	    if (j < i || linebuf[j] != ' ') {
-		char mb[16];
+	    if (j < i || ctx->linebuf[j] != ' ') {
 		int len;
 
-		if (linebuf[j] == FCORDER_NOP) {
+		if (ctx->linebuf[j] == FCORDER_NOP) {
 		    continue;
 		}
 #if defined(DEBUG_FF) /*[*/
 		n_data++;
 #endif /*]*/
 		any_data = true;
-		scs_any = true;
+		ctx->scs_any = true;
+		if (sizeof(out) - olen < 16) {
+		    if (stash_buf(out, olen) < 0) {
+			return -1;
+		    }
+		    olen = 0;
+		}
 #if !defined(_WIN32) /*[*/
-		len = unicode_to_multibyte(linebuf[j], mb, sizeof(mb));
+		len = unicode_to_multibyte(ctx->linebuf[j], out + olen, 16);
 #else /*][*/
-		len = unicode_to_printer(linebuf[j], mb, sizeof(mb));
+		len = unicode_to_printer(ctx->linebuf[j], out + olen, 16);
 #endif /*]*/
 		if (len == 0) {
-		    mb[0] = ' ';
+		    out[olen] = ' ';
 		    len = 1;
 		} else {
 		    len--;
 		}
-		for (k = 0; k < len; k++) {
-		    if (stash(mb[k]) < 0) {
-			return -1;
-		    }	
-		}
+		olen += len;
 	    }
 	}
 #if defined(DEBUG_FF) /*[*/
 	trace_ds(" [dumping %d+%dt]", n_data, n_trn);
 #endif /*]*/
 	for (k = 0; k < MAX_MPP+1; k++) {
-	    linebuf[k] = ' ';
+	    ctx->linebuf[k] = ' ';
 	}
     }
     if (any_data || always_nl) {
-	if (options.crlf) {
-	    if (stash('\r') < 0) {
+	if (sizeof(out) - olen < 2) {
+	    if (stash_buf(out, olen) < 0) {
 		return -1;
 	    }
+	    olen = 0;
+	}
+	if (options.crlf) {
+	    out[olen++] = '\r';
 	}
-	if (stash('\n') < 0)
+	out[olen++] = '\n';
+	ctx->line++;
+    }
+    if (stash_buf(out, olen) < 0) {
 	return -1;
-	line++;
     }
 #if defined(DEBUG_FF) /*[*/
-    trace_ds(" [line=%d]", line);
+    trace_ds(" [line=%d]", ctx->line);
 #endif /*]*/
     if (reset_pp) {
-	pp = lm;
+	ctx->pp = ctx->lm;
     }
-    any_scs_output = false;
+    ctx->any_scs_output = false;
     return 0;
 }
 
@@ -735,7 +835,7 @@ scs_formfeed(bool explicit)
      * In ffskip mode, if it's an explicit formfeed, and we haven't
      * printed any non-transparent data, do nothing.
      */
-    if (options.ffskip && explicit && !scs_any) {
+    if (options.ffskip && explicit && !ctx->scs_any) {
 	return 0;
     }
 
@@ -747,48 +847,38 @@ scs_formfeed(bool explicit)
 	    if (stash('\f') < 0) {
 		return -1;
 	    }
-	    scs_any = 0;
+	    ctx->scs_any = 0;
 	}
-	line = 1;
+	ctx->line = 1;
 	return 0;
     }
 
     if (explicit) {
-	scs_any = 0;
+	ctx->scs_any = 0;
     }
 
-    if (mpl > 1) {
+    if (ctx->mpl > 1) {
 	/* Skip to the end of the physical page. */
-	while (line <= mpl) {
-	    if (options.crlf) {
-		if (stash('\r') < 0) {
-		    return -1;
-		}
-	    }
-	    if (stash('\n') < 0) {
+	while (ctx->line <= ctx->mpl) {
+	    if (stash_newline() < 0) {
 		return -1;
 	    }
 #if defined(DEBUG_FF) /*[*/
 	    nls++;
 #endif /*]*/
-	    line++;
+	    ctx->line++;
 	}
-	line = 1;
+	ctx->line = 1;
 
 	/* Skip the top margin. */
-	while (line < tm) {
-	    if (options.crlf) {
-		if (stash('\r') < 0) {
-		    return -1;
-		}
-	    }
-	    if (stash('\n') < 0) {
+	while (ctx->line < ctx->tm) {
+	    if (stash_newline() < 0) {
 		return -1;
 	    }
 #if defined(DEBUG_FF) /*[*/
 	    nls++;
 #endif /*]*/
-	    line++;
+	    ctx->line++;
 	}
 #if defined(DEBUG_FF) /*[*/
 	if (nls) {
@@ -797,7 +887,7 @@ scs_formfeed(bool explicit)
 	}
 #endif /*]*/
     } else {
-	line = 1;
+	ctx->line = 1;
     }
     return 0;
 }
@@ -816,7 +906,7 @@ add_scs(ucs4_t c)
      * If the line is past the bottom margin, we need to skip to the
      * MPL, and then past the top margin.
      */
-    if (line > bm) {
+    if (ctx->line > ctx->bm) {
 	if (scs_formfeed(false) < 0) {
 	    return -1;
 	}
@@ -826,7 +916,7 @@ add_scs(ucs4_t c)
      * If this character would overflow the line, then dump the current
      * line and start over at the left margin.
      */
-    if (pp > mpp) {
+    if (ctx->pp > ctx->mpp) {
 	if (dump_scs_line(true, true) < 0) {
 	    return -1;
 	}
@@ -837,12 +927,12 @@ add_scs(ucs4_t c)
      * position.
      */
     if (c != ' ') {
-	linebuf[pp++] = c;
+	ctx->linebuf[ctx->pp++] = c;
     } else {
-	pp++;
+	ctx->pp++;
     }
-    any_scs_output = true;
-    ffeoj_last = false;
+    ctx->any_scs_output = true;
+    ctx->ffeoj_last = false;
     return 0;
 }
 
@@ -860,15 +950,15 @@ add_scs_trn(unsigned char *cp, int cnt)
 	trace_ds(" %02x", cp[i]);
     }
 
-    new_malloc_len = trnbuf[pp].data_len + cnt;
-    while (trnbuf[pp].malloc_len < new_malloc_len) {
-	trnbuf[pp].malloc_len += BUFSZ;
-	trnbuf[pp].buf = Realloc(trnbuf[pp].buf, trnbuf[pp].malloc_len);
+    new_malloc_len = ctx->trnbuf[ctx->pp].data_len + cnt;
+    while (ctx->trnbuf[ctx->pp].malloc_len < new_malloc_len) {
+	ctx->trnbuf[ctx->pp].malloc_len += BUFSZ;
+	ctx->trnbuf[ctx->pp].buf = Realloc(ctx->trnbuf[ctx->pp].buf, ctx->trnbuf[ctx->pp].malloc_len);
     }
-    memcpy(trnbuf[pp].buf + trnbuf[pp].data_len, cp, cnt);
-    trnbuf[pp].data_len += cnt;
-    any_scs_output = true;
-    ffeoj_last = true;
+    memcpy(ctx->trnbuf[ctx->pp].buf + ctx->trnbuf[ctx->pp].data_len, cp, cnt);
+    ctx->trnbuf[ctx->pp].data_len += cnt;
+    ctx->any_scs_output = true;
+    ctx->ffeoj_last = true;
 }
 
 /*
@@ -908,8 +998,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
     }
 #   define LEFTOVER { \
 	    trace_ds(" [pending]"); \
-	    scs_leftover_len = buflen - (cp - buf); \
-	    memcpy(scs_leftover_buf, cp, scs_leftover_len); \
+	    ctx->scs_leftover_len = buflen - (cp - buf); \
+	    memcpy(ctx->scs_leftover_buf, cp, ctx->scs_leftover_len); \
 	    cp = buf + buflen; \
     }
 
@@ -921,16 +1011,16 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	switch (*cp) {
 	case SCS_BS:	/* back space */
 	    END_TEXT("BS");
-	    if (pp != 1) {
-		pp--;
+	    if (ctx->pp != 1) {
+		ctx->pp--;
 	    }
-	    if (scs_dbcs_subfield && pp != 1) {
-		pp--;
+	    if (ctx->scs_dbcs_subfield && ctx->pp != 1) {
+		ctx->pp--;
 	    }
 	    break;
 	case SCS_CR:	/* carriage return */
 	    END_TEXT("CR");
-	    pp = lm;
+	    ctx->pp = ctx->lm;
 	    break;
 	case SCS_ENP:	/* enable presentation */
 	    END_TEXT("ENP");
@@ -952,13 +1042,13 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    break;
 	case SCS_HT:	/* horizontal tab */
 	    END_TEXT("HT");
-	    for (i = pp + 1; i <= mpp; i++) {
-		if (htabs[i]) {
+	    for (i = ctx->pp + 1; i <= ctx->mpp; i++) {
+		if (ctx->htabs[i]) {
 		    break;
 		}
 	    }
-	    if (i <= mpp) {
-		pp = i;
+	    if (i <= ctx->mpp) {
+		ctx->pp = i;
 	    } else {
 		if (add_scs(' ') < 0) {
 		    return PDS_FAILED;
@@ -981,8 +1071,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    break;
 	case SCS_VT:	/* vertical tab */
 	    END_TEXT("VT");
-	    for (i = line + 1; i <= MAX_MPL; i++){
-		if (vtabs[i]) {
+	    for (i = ctx->line + 1; i <= MAX_MPL; i++){
+		if (ctx->vtabs[i]) {
 		    break;
 		}
 	    }
@@ -990,16 +1080,11 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		if (dump_scs_line(false, true) < 0) {
 		    return PDS_FAILED;
 		}
-		while (line < i) {
-		    if (options.crlf) {
-			if (stash('\r') < 0) {
-			    return PDS_FAILED;
-			}
-		    }
-		    if (stash('\n') < 0) {
+		while (ctx->line < i) {
+		    if (stash_newline() < 0) {
 			return PDS_FAILED;
 		    }
-		    line++;
+		    ctx->line++;
 		}
 		break;
 	    } else {
@@ -1039,21 +1124,21 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    switch (*(cp + 1)) {
 	    case SCS_SA_RESET:
 		trace_ds(" Reset(%02x)", *(cp + 2));
-		scs_dbcs_subfield = 0;
-		scs_cs = 0;
+		ctx->scs_dbcs_subfield = 0;
+		ctx->scs_cs = 0;
 		break;
 	    case SCS_SA_HIGHLIGHT:
 		trace_ds(" Highlight(%02x)", *(cp + 2));
 		break;
 	    case SCS_SA_CS:
 		trace_ds(" CharacterSet(%02x)", *(cp + 2));
-		if (scs_cs != *(cp + 2)) {
-		    if (scs_cs == 0xf8) {
-			scs_dbcs_subfield = 0;
+		if (ctx->scs_cs != *(cp + 2)) {
+		    if (ctx->scs_cs == 0xf8) {
+			ctx->scs_dbcs_subfield = 0;
 		    } else if (*(cp + 2) == 0xf8) {
-			scs_dbcs_subfield = 1;
+			ctx->scs_dbcs_subfield = 1;
 		    }
-		    scs_cs = *(cp + 2);
+		    ctx->scs_cs = *(cp + 2);
 		}
 		break;
 	    case SCS_SA_GRID:
@@ -1089,7 +1174,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    /* Copy out the data literally. */
 	    add_scs_trn(cp+1, cnt);
 	    cp += cnt;
-	    scs_dbcs_subfield = 0;
+	    ctx->scs_dbcs_subfield = 0;
 	    break;
 	case SCS_SET:	/* set... */
 	    /* Skip over the first byte of the order. */
@@ -1118,20 +1203,20 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The MPP is next. */
-		mpp = *++cp;
-		trace_ds(" mpp=%d", mpp);
-		if (!mpp || mpp > MAX_MPP) {
-		    mpp = MAX_MPP;
+		ctx->mpp = *++cp;
+		trace_ds(" mpp=%d", ctx->mpp);
+		if (!ctx->mpp || ctx->mpp > MAX_MPP) {
+		    ctx->mpp = MAX_MPP;
 		}
 		/* Skip over the MPP. */
 		if (!--cnt || cp + 1 >= buf + buflen) {
 		    break;
 		}
 		/* The LM is next. */
-		lm = *++cp;
-		trace_ds(" lm=%d", lm);
-		if (lm < 1 || lm >= mpp) {
-		    lm = 1;
+		ctx->lm = *++cp;
+		trace_ds(" lm=%d", ctx->lm);
+		if (ctx->lm < 1 || ctx->lm >= ctx->mpp) {
+		    ctx->lm = 1;
 		}
 		/* Skip over the LM. */
 		if (!--cnt || cp + 1 >= buf + buflen) {
@@ -1144,8 +1229,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		while (--cnt && cp + 1 < buf + buflen) {
 		    tab = *++cp;
 		    trace_ds(" tab=%d", tab);
-		    if (tab >= 1 && tab <= mpp) {
-			htabs[tab] = 1;
+		    if (tab >= 1 && tab <= ctx->mpp) {
+			ctx->htabs[tab] = 1;
 		    }
 		}
 		break;
@@ -1200,13 +1285,13 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The MPL is next. */
-		mpl = *cp;
-		trace_ds(" mpl=%d", mpl);
-		if (!mpl || mpl > MAX_MPL) {
-		    mpl = 1;
+		ctx->mpl = *cp;
+		trace_ds(" mpl=%d", ctx->mpl);
+		if (!ctx->mpl || ctx->mpl > MAX_MPL) {
+		    ctx->mpl = 1;
 		}
 		if (cnt < 2) {
-		    bm = mpl;
+		    ctx->bm = ctx->mpl;
 		    break;
 		}
 		/* Skip over the MPL. */
@@ -1216,10 +1301,10 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The TM is next. */
-		tm = *cp;
-		trace_ds(" tm=%d", tm);
-		if (tm < 1 || tm >= mpl) {
-		    tm = 1;
+		ctx->tm = *cp;
+		trace_ds(" tm=%d", ctx->tm);
+		if (ctx->tm < 1 || ctx->tm >= ctx->mpl) {
+		    ctx->tm = 1;
 		}
 		if (cnt < 2) {
 		    break;
@@ -1231,10 +1316,10 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The BM is next. */
-		bm = *cp;
-		trace_ds(" bm=%d", bm);
-		if (bm < tm || bm >= mpl) {
-		    bm = mpl;
+		ctx->bm = *cp;
+		trace_ds(" bm=%d", ctx->bm);
+		if (ctx->bm < ctx->tm || ctx->bm >= ctx->mpl) {
+		    ctx->bm = ctx->mpl;
 		}
 		if (cnt < 2) {
 		    break;
@@ -1246,8 +1331,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		while (cnt > 1 && cp < buf + buflen) {
 		    tab = *cp;
 		    trace_ds(" tab=%d", tab);
-		    if (tab >= 1 && tab <= mpp) {
-			vtabs[tab] = 1;
+		    if (tab >= 1 && tab <= ctx->mpp) {
+			ctx->vtabs[tab] = 1;
 		    }
 		    cp++;
 		    cnt--;
@@ -1262,11 +1347,11 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    break;
 	case SCS_SO:	/* DBCS subfield start */
 	    END_TEXT("SO");
-	    scs_dbcs_subfield = 1;
+	    ctx->scs_dbcs_subfield = 1;
 	    break;
 	case SCS_SI:	/* DBCS subfield end */
 	    END_TEXT("SI");
-	    scs_dbcs_subfield = 0;
+	    ctx->scs_dbcs_subfield = 0;
 	    break;
 	default:
 	    /*
@@ -1287,15 +1372,15 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    } else if (last == ORDER) {
 		trace_ds(" '");
 	    }
-	    if (scs_dbcs_subfield && dbcs) {
-		if (scs_dbcs_subfield % 2) {
-		    scs_dbcs_c1 = *cp;
+	    if (ctx->scs_dbcs_subfield && dbcs) {
+		if (ctx->scs_dbcs_subfield % 2) {
+		    ctx->scs_dbcs_c1 = *cp;
 		} else {
-		    uc = ebcdic_to_unicode( (scs_dbcs_c1 << 8) | *cp, CS_BASE,
+		    uc = ebcdic_to_unicode( (ctx->scs_dbcs_c1 << 8) | *cp, CS_BASE,
 			    EUO_NONE);
 		    if (uc == 0) {
 			/* No translation. */
-			trace_ds("?DBCS(X'%02x%02x')", scs_dbcs_c1, *cp);
+			trace_ds("?DBCS(X'%02x%02x')", ctx->scs_dbcs_c1, *cp);
 			if (add_scs(' ') < 0) {
 			    return PDS_FAILED;
 			}
@@ -1308,7 +1393,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 			 * and a no-op to account for
 			 * the right-hand side.
 			 */
-			trace_ds("DBCS(X'%02x%02x')", scs_dbcs_c1, *cp);
+			trace_ds("DBCS(X'%02x%02x')", ctx->scs_dbcs_c1, *cp);
 			if (add_scs(uc) < 0) {
 			    return PDS_FAILED;
 			}
@@ -1317,7 +1402,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 			}
 		    }
 		}
-		scs_dbcs_subfield++;
+		ctx->scs_dbcs_subfield++;
 		last = DATA;
 		break;
 	    }
@@ -1355,14 +1440,14 @@ process_scs(unsigned char *buf, size_t buflen)
 {
     enum pds r;
 
-    if (scs_leftover_len) {
-	unsigned char *contig = Malloc(scs_leftover_len + buflen);
+    if (ctx->scs_leftover_len) {
+	unsigned char *contig = Malloc(ctx->scs_leftover_len + buflen);
 	size_t total_len;
 
-	memcpy(contig, scs_leftover_buf, scs_leftover_len);
-	memcpy(contig + scs_leftover_len, buf, buflen);
-	total_len = scs_leftover_len + buflen;
-	scs_leftover_len = 0;
+	memcpy(contig, ctx->scs_leftover_buf, ctx->scs_leftover_len);
+	memcpy(contig + ctx->scs_leftover_len, buf, buflen);
+	total_len = ctx->scs_leftover_len + buflen;
+	ctx->scs_leftover_len = 0;
 	r = process_scs_contig(contig, total_len);
 	Free(contig);
     } else {
@@ -1386,7 +1471,7 @@ sigchld_handler(int sig)
  * Special version of popen where the child ignores SIGINT.
  */
 static FILE *
-popen_no_sigint(const char *command)
+popen_no_sigint(const char *command, int *pidp)
 {
     int fds[2];
     FILE *f;
@@ -1403,12 +1488,13 @@ popen_no_sigint(const char *command)
 	close(fds[1]);
 	return NULL;
     }
+    fcntl(fds[1], F_SETFD, 1);
 
     /* Handle SIGCHLD signals. */
     signal(SIGCHLD, sigchld_handler);
 
     /* Fork a child process. */
-    switch ((prpid = fork())) {
+    switch ((*pidp = fork())) {
     case 0:		/* child */
 	fclose(f);
 	dup2(fds[0], 0);
@@ -1432,68 +1518,326 @@ popen_no_sigint(const char *command)
 }
 
 static int
-pclose_no_sigint(FILE *f)
+pclose_no_sigint(FILE *f, int *pidp)
 {
     int rc;
     int status;
 
     fclose(f);
     do {
-	rc = waitpid(prpid, &status, 0);
+	rc = waitpid(*pidp, &status, 0);
     } while (rc < 0 && errno == EINTR);
-    prpid = -1;
+    *pidp = -1;
     if (rc < 0) {
 	return rc;
     } else {
 	return status;
     }
 }
+
+/* Report the exit status of a print command. */
+static int
+command_status(const char *command, int rc)
+{
+    if (rc) {
+	if (rc < 0) {
+	    errmsg("Close error on '%s': %s", command, strerror(errno));
+	} else if (WIFEXITED(rc)) {
+	    errmsg("'%s' exited with status %d", command, WEXITSTATUS(rc));
+	} else if (WIFSIGNALED(rc)) {
+	    errmsg("'%s' terminated by signal %d", command, WTERMSIG(rc));
+	} else {
+	    errmsg("'%s' returned status %d", command, rc);
+	}
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * Print job sinks.
+ *
+ * Printer output is collected in the session's job buffer and handed to the
+ * sink in large pieces, together with any pending -trnpre or -trnpost data,
+ * in a single writev(). A sink shared between sessions gets each job in one
+ * piece, so jobs from different LUs do not interleave.
+ */
+typedef struct {
+    bool whole_jobs;		/* must be given each job in one piece */
+    int (*start)(void);		/* start a job */
+    int (*write)(struct iovec *iov, int iovcnt); /* write job data */
+    int (*end)(void);		/* end a job */
+} sink_t;
+
+/*
+ * Write an I/O vector to a file descriptor, coping with short writes.
+ * Returns 0 for success, -1 for failure (with errno set).
+ */
+static int
+writev_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+	ssize_t nw = writev(fd, iov, iovcnt);
+
+	if (nw < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    return -1;
+	}
+
+	/* Skip over what was written. */
+	while (iovcnt > 0 && (size_t)nw >= iov->iov_len) {
+	    nw -= iov->iov_len;
+	    iov++;
+	    iovcnt--;
+	}
+	if (iovcnt > 0) {
+	    iov->iov_base = (char *)iov->iov_base + nw;
+	    iov->iov_len -= nw;
+	}
+    }
+    return 0;
+}
+
+/* Command sink: run -command for each job. */
+static int
+command_start(void)
+{
+    ctx->prfile = popen_no_sigint(options.command, &ctx->prpid);
+    if (ctx->prfile == NULL) {
+	errmsg("%s: %s", options.command, strerror(errno));
+	return -1;
+    }
+    ctx->prfd = fileno(ctx->prfile);
+    return 0;
+}
+
+static int
+command_write(struct iovec *iov, int iovcnt)
+{
+    if (writev_all(ctx->prfd, iov, iovcnt) < 0) {
+	errmsg("Write error to '%s': %s", options.command, strerror(errno));
+	pclose_no_sigint(ctx->prfile, &ctx->prpid);
+	ctx->prfile = NULL;
+	ctx->prfd = -1;
+	return -1;
+    }
+    return 0;
+}
+
+static int
+command_end(void)
+{
+    int rc = pclose_no_sigint(ctx->prfile, &ctx->prpid);
+
+    ctx->prfile = NULL;
+    ctx->prfd = -1;
+    return command_status(options.command, rc);
+}
+
+/* Spool sink: write each job to its own file in -spooldir. */
+static int
+spool_start(void)
+{
+    ctx->spool_name = Asprintf("%s/.%s.%u.%lu", options.spooldir, ctx->name,
+	    (unsigned)getpid(), ctx->jobs);
+    ctx->prfd = open(ctx->spool_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (ctx->prfd < 0) {
+	errmsg("%s: %s", ctx->spool_name, strerror(errno));
+	Replace(ctx->spool_name, NULL);
+	return -1;
+    }
+    fcntl(ctx->prfd, F_SETFD, 1);
+    return 0;
+}
+
+static int
+spool_write(struct iovec *iov, int iovcnt)
+{
+    if (writev_all(ctx->prfd, iov, iovcnt) < 0) {
+	errmsg("Write error to '%s': %s", ctx->spool_name, strerror(errno));
+	close(ctx->prfd);
+	ctx->prfd = -1;
+	unlink(ctx->spool_name);
+	Replace(ctx->spool_name, NULL);
+	return -1;
+    }
+    return 0;
+}
+
+static int
+spool_end(void)
+{
+    char *final_name;
+    int rc = 0;
+
+    /* The file appears under its final name only when it is complete. */
+    final_name = Asprintf("%s/%s.%u.%lu", options.spooldir, ctx->name,
+	    (unsigned)getpid(), ctx->jobs);
+    if (close(ctx->prfd) < 0) {
+	errmsg("Close error on '%s': %s", ctx->spool_name, strerror(errno));
+	unlink(ctx->spool_name);
+	rc = -1;
+    } else if (rename(ctx->spool_name, final_name) < 0) {
+	errmsg("rename(%s): %s", final_name, strerror(errno));
+	unlink(ctx->spool_name);
+	rc = -1;
+    }
+    ctx->prfd = -1;
+    Replace(ctx->spool_name, NULL);
+    Free(final_name);
+    return rc;
+}
+
+/* Pipe sink: one long-lived -pipe command shared by every session. */
+static FILE *pipe_file = NULL;
+static int pipe_pid = -1;
+
+static int
+pipe_start(void)
+{
+    if (pipe_file == NULL) {
+	pipe_file = popen_no_sigint(options.pipe, &pipe_pid);
+	if (pipe_file == NULL) {
+	    errmsg("%s: %s", options.pipe, strerror(errno));
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+static int
+pipe_write(struct iovec *iov, int iovcnt)
+{
+    if (writev_all(fileno(pipe_file), iov, iovcnt) < 0) {
+	errmsg("Write error to '%s': %s", options.pipe, strerror(errno));
+	command_status(options.pipe, pclose_no_sigint(pipe_file, &pipe_pid));
+	pipe_file = NULL;
+	return -1;
+    }
+    return 0;
+}
+
+static int
+pipe_end(void)
+{
+    return 0;
+}
+
+static const sink_t command_sink = {
+    false, command_start, command_write, command_end
+};
+static const sink_t spool_sink = { false, spool_start, spool_write, spool_end };
+static const sink_t pipe_sink = { true, pipe_start, pipe_write, pipe_end };
+
+/* Select the sink for print jobs. */
+static const sink_t *
+job_sink(void)
+{
+    if (options.spooldir != NULL) {
+	return &spool_sink;
+    }
+    if (options.pipe != NULL) {
+	return &pipe_sink;
+    }
+    return &command_sink;
+}
+
+/* Discard any buffered job output. */
+static void
+job_discard(void)
+{
+    vb_reset(&ctx->pre);
+    vb_reset(&ctx->job);
+    vb_reset(&ctx->post);
+}
+
+/*
+ * Hand the buffered job output to the sink, starting the job on the sink if
+ * necessary. The data is traced here, one chunk at a time.
+ */
+static int
+job_write(const sink_t *sink)
+{
+    varbuf_t *parts[3];
+    struct iovec iov[3];
+    int iovcnt = 0;
+    int i;
+    int rc = 0;
+
+    if (!ctx->job_started) {
+	if (sink->start() < 0) {
+	    job_discard();
+	    return -1;
+	}
+	ctx->job_started = true;
+    }
+
+    parts[0] = &ctx->pre;
+    parts[1] = &ctx->job;
+    parts[2] = &ctx->post;
+    for (i = 0; i < 3; i++) {
+	if (vb_len(parts[i]) > 0) {
+	    iov[iovcnt].iov_base = (void *)vb_buf(parts[i]);
+	    iov[iovcnt].iov_len = vb_len(parts[i]);
+	    trace_pdb(iov[iovcnt].iov_base, iov[iovcnt].iov_len);
+	    iovcnt++;
+	}
+    }
+    if (iovcnt > 0 && sink->write(iov, iovcnt) < 0) {
+	/* The sink has abandoned the job; further output starts it again. */
+	ctx->job_started = false;
+	rc = -1;
+    }
+    job_discard();
+    return rc;
+}
 #endif /*]*/
 
 /*
- * Send a character to the printer.
+ * Send a buffer full of data to the printer.
  */
 static int
-stash(unsigned char c)
+stash_buf(const char *buf, size_t len)
 {
+    if (len == 0) {
+	return 0;
+    }
+
 #if defined(_WIN32) /*[*/
-    if (!ws_initted) {
+    if (!ctx->ws_initted) {
 	if (ws_start(options.printer) < 0) {
 	    return -1;
 	}
-	ws_initted = 1;
+	ctx->ws_initted = 1;
     }
-    if (ws_needpre) {
-	if ((options.trnpre != NULL) && copyfile(options.trnpre) < 0) {
+    if (ctx->ws_needpre) {
+	if ((options.trnpre != NULL) && copyfile(options.trnpre, NULL) < 0) {
 	    return -1;
 	}
-	ws_needpre = 0;
+	ctx->ws_needpre = 0;
     }
 
-    trace_pdc(c);
-    if (ws_putc(c)) {
+    trace_pdb((const unsigned char *)buf, len);
+    if (ws_write((char *)buf, (int)len) < 0) {
 	return -1;
     }
 #else /*][*/
-    if (prfile == NULL) {
-	prfile = popen_no_sigint(options.command);
-	if (prfile == NULL) {
-	    errmsg("%s: %s", options.command, strerror(errno));
-	    return -1;
-	}
-	if ((options.trnpre != NULL) && copyfile(options.trnpre) < 0) {
-	    pclose_no_sigint(prfile);
-	    prfile = NULL;
+    if (!ctx->in_job) {
+	ctx->in_job = true;
+	ctx->jobs++;
+	if ((options.trnpre != NULL) &&
+		copyfile(options.trnpre, &ctx->pre) < 0) {
+	    job_discard();
+	    ctx->in_job = false;
 	    return -1;
 	}
     }
 
-    trace_pdc(c);
-    if (fputc(c, prfile) == EOF) {
-	errmsg("Write error to '%s': %s", options.command, strerror(errno));
-	pclose_no_sigint(prfile);
-	prfile = NULL;
-	return -1;
+    vb_append(&ctx->job, buf, len);
+    if (vb_len(&ctx->job) >= JOB_CHUNK && !job_sink()->whole_jobs) {
+	return job_write(job_sink());
     }
 #endif /*]*/
 
@@ -1501,24 +1845,39 @@ stash(unsigned char c)
 }
 
 /*
- * Flush the pipe going to the printer process, to try to flush out any
- * pending errors.
+ * Send a character to the printer.
+ */
+static int
+stash(unsigned char c)
+{
+    char ch = (char)c;
+
+    return stash_buf(&ch, 1);
+}
+
+/*
+ * Send a newline to the printer, expanded to CR/LF if -crlf is in effect.
+ */
+static int
+stash_newline(void)
+{
+    return options.crlf? stash_buf("\r\n", 2): stash_buf("\n", 1);
+}
+
+/*
+ * Flush the pending output to the printer, to try to flush out any pending
+ * errors.
  */
 static int
 prflush(void)
 {
 #if defined(_WIN32) /*[*/
-    if (ws_initted && ws_flush() < 0) {
+    if (ctx->ws_initted && ws_flush() < 0) {
 	return -1;
     }
 #else /*][*/
-    if (prfile != NULL) {
-	if (fflush(prfile) < 0) {
-	    errmsg("Flush error to '%s': %s", options.command, strerror(errno));
-	    pclose_no_sigint(prfile);
-	    prfile = NULL;
-	    return -1;
-	}
+    if (vb_len(&ctx->job) > 0 && !job_sink()->whole_jobs) {
+	return job_write(job_sink());
     }
 #endif /*]*/
     return 0;
@@ -1532,7 +1891,7 @@ ctlr_add(unsigned char ebc, ucs4_t c, unsigned char cs, unsigned char gr)
 {
     /* Map control characters, according to the write mode. */
     if (c < ' ') {
-	if (wcc_line_length) {
+	if (ctx->wcc_line_length) {
 	    /*
 	     * When formatted, all control characters but FFs and
 	     * the funky VISIBLE/INVISIBLE controls are translated
@@ -1555,50 +1914,36 @@ ctlr_add(unsigned char ebc, ucs4_t c, unsigned char cs, unsigned char gr)
     }
 
     /* Add the character. */
-    page_buf[baddr] = c;
+    ctx->page_buf[ctx->baddr] = c;
     if (ebc >= 0x40)
-	    xlate_len[baddr] = xtable_lookup(ebc, &xlate_buf[baddr]);
-    baddr = (baddr + 1) % MAX_BUF;
-    any_3270_output = 1;
-    ffeoj_last = false;
+	    ctx->xlate_len[ctx->baddr] = xtable_lookup(ebc, &ctx->xlate_buf[ctx->baddr]);
+    ctx->baddr = (ctx->baddr + 1) % MAX_BUF;
+    ctx->any_3270_output = 1;
+    ctx->ffeoj_last = false;
 
     /* Implement -emflush mode. */
-    if (options.emflush && !wcc_line_length && c == FCORDER_EM) {
+    if (options.emflush && !ctx->wcc_line_length && c == FCORDER_EM) {
 	/* XXX: Unfortunately, we do not return error status here. */
 	dump_unformatted();
-	baddr = 1;
-	any_3270_output = 0;
+	ctx->baddr = 1;
+	ctx->any_3270_output = 0;
     }
 }
 
-static struct {
-    char buf;			/* printable data */
-    unsigned char *trn;		/* transparent data */
-    unsigned trn_len;		/* length of transparent data */
-} uo_data[MAX_UNF_MPP + 2];	/* room for full line plus carriage control */
-static unsigned uo_col;		/* current output column */
-static unsigned uo_maxcol;	/* maximum column buffered */
-static bool uo_last_cr = false; /* last data was CR */
-
 /*
  * Dump and free any transparent unformatted data at col.
  */
 static int
 dump_uo_trn(unsigned col)
 {
-    unsigned i;
     int rv = 0;
 
-    if (uo_data[col].trn != NULL) {
-	for (i = 0; i < uo_data[col].trn_len; i++) {
-	    if (stash(uo_data[col].trn[i]) < 0) {
-		rv = -1;
-		break;
-	    }
-	}
-	Free(uo_data[col].trn);
-	uo_data[col].trn = NULL;
-	uo_data[col].trn_len = 0;
+    if (ctx->uo_data[col].trn != NULL) {
+	rv = stash_buf((char *)ctx->uo_data[col].trn,
+		ctx->uo_data[col].trn_len);
+	Free(ctx->uo_data[col].trn);
+	ctx->uo_data[col].trn = NULL;
+	ctx->uo_data[col].trn_len = 0;
     }
     return rv;
 }
@@ -1610,20 +1955,27 @@ static int
 dump_uo(void)
 {
     unsigned i;
+    char line[MAX_UNF_MPP + 2];
+    size_t len = 0;
 
-    for (i = 0; i < uo_maxcol; i++) {
-	if (dump_uo_trn(i) < 0) {
-	    return -1;
+    /* Collect runs of printable data, interrupted by transparent data. */
+    for (i = 0; i < ctx->uo_maxcol; i++) {
+	if (ctx->uo_data[i].trn != NULL) {
+	    if (stash_buf(line, len) < 0 || dump_uo_trn(i) < 0) {
+		return -1;
+	    }
+	    len = 0;
 	}
 	if (!i && options.skipcc) {
 	    continue;
 	}
-	if (stash(uo_data[i].buf) < 0) {
-	    return -1;
-	}
+	line[len++] = ctx->uo_data[i].buf;
     }
-    if (uo_maxcol < MAX_UNF_MPP + 2) {
-	if (dump_uo_trn(uo_maxcol) < 0) {
+    if (len > 0 && stash_buf(line, len) < 0) {
+	return -1;
+    }
+    if (ctx->uo_maxcol < MAX_UNF_MPP + 2) {
+	if (dump_uo_trn(ctx->uo_maxcol) < 0) {
 	    return -1;
 	}
     }
@@ -1654,17 +2006,17 @@ uoutput(char c)
 	    if (stash(c) < 0) {
 		return -1;
 	    }
-	    uo_col = uo_maxcol = 0;
-	    uo_last_cr = true;
+	    ctx->uo_col = ctx->uo_maxcol = 0;
+	    ctx->uo_last_cr = true;
 	} else {
-	    uo_col = 0;
+	    ctx->uo_col = 0;
 	}
 	break;
     case '\n':
 	if (dump_uo() < 0) {
 	    return -1;
 	}
-	if (options.crlf && !uo_last_cr) {
+	if (options.crlf && !ctx->uo_last_cr) {
 	    if (stash('\r') < 0) {
 		return -1;
 	    }
@@ -1672,12 +2024,12 @@ uoutput(char c)
 	if (stash(c) < 0) {
 	    return -1;
 	}
-	uo_col = uo_maxcol = 0;
-	uo_last_cr = false;
+	ctx->uo_col = ctx->uo_maxcol = 0;
+	ctx->uo_last_cr = false;
 	break;
     case '\f':
-	uo_last_cr = false;
-	if (any_3270_printable || !options.ffskip) {
+	ctx->uo_last_cr = false;
+	if (ctx->any_3270_printable || !options.ffskip) {
 	    if (dump_uo() < 0) {
 		return -1;
 	    }
@@ -1685,24 +2037,24 @@ uoutput(char c)
 		return -1;
 	    }
 	}
-	uo_col = uo_maxcol = 0;
+	ctx->uo_col = ctx->uo_maxcol = 0;
 	break;
     default:
-	uo_last_cr = false;
+	ctx->uo_last_cr = false;
 
 	/* Don't overwrite with spaces. */
 	if (c == ' ') {
-	    if (uo_col >= uo_maxcol) {
-		uo_data[uo_col++].buf = c;
+	    if (ctx->uo_col >= ctx->uo_maxcol) {
+		ctx->uo_data[ctx->uo_col++].buf = c;
 	    } else {
-		uo_col++;
+		ctx->uo_col++;
 	    }
 	} else {
-	    uo_data[uo_col++].buf = c;
-	    any_3270_printable = true;
+	    ctx->uo_data[ctx->uo_col++].buf = c;
+	    ctx->any_3270_printable = true;
 	}
-	if (uo_col > uo_maxcol) {
-	    uo_maxcol = uo_col;
+	if (ctx->uo_col > ctx->uo_maxcol) {
+	    ctx->uo_maxcol = ctx->uo_col;
 	}
 	break;
     }
@@ -1720,13 +2072,13 @@ uoutput_trn(const unsigned char *s, int len)
     if (len <= 0) {
 	return;
     }
-    new = Realloc(uo_data[uo_col].trn, uo_data[uo_col].trn_len + len);
-    if (uo_data[uo_col].trn != NULL) {
-	memcpy(new, uo_data[uo_col].trn, uo_data[uo_col].trn_len);
+    new = Realloc(ctx->uo_data[ctx->uo_col].trn, ctx->uo_data[ctx->uo_col].trn_len + len);
+    if (ctx->uo_data[ctx->uo_col].trn != NULL) {
+	memcpy(new, ctx->uo_data[ctx->uo_col].trn, ctx->uo_data[ctx->uo_col].trn_len);
     }
-    memcpy(new + uo_data[uo_col].trn_len, s, len);
-    uo_data[uo_col].trn = new;
-    uo_data[uo_col].trn_len += len;
+    memcpy(new + ctx->uo_data[ctx->uo_col].trn_len, s, len);
+    ctx->uo_data[ctx->uo_col].trn = new;
+    ctx->uo_data[ctx->uo_col].trn_len += len;
 }
 
 /*
@@ -1749,12 +2101,12 @@ dump_unformatted(void)
     int len;
     int j;
 
-    if (!any_3270_output) {
+    if (!ctx->any_3270_output) {
 	return 0;
     }
 
     for (i = 0; i < MAX_BUF && !done; i++) {
-	switch (c = page_buf[i]) {
+	switch (c = ctx->page_buf[i]) {
 	case '\0':
 	    break;
 	case FCORDER_NOP:
@@ -1801,8 +2153,8 @@ dump_unformatted(void)
 	    }
 
 	    /* Handle transparent data. */
-	    if (xlate_buf[i] != NULL) {
-		uoutput_trn(xlate_buf[i], xlate_len[i]);
+	    if (ctx->xlate_buf[i] != NULL) {
+		uoutput_trn(ctx->xlate_buf[i], ctx->xlate_len[i]);
 		break;
 	    }
 
@@ -1836,32 +2188,26 @@ dump_unformatted(void)
     }
 
     /* Clear out the buffer. */
-    memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-    memset(xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
-    memset(xlate_len, '\0', MAX_BUF * sizeof(int));
+    memset(ctx->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+    memset(ctx->xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
+    memset(ctx->xlate_len, '\0', MAX_BUF * sizeof(int));
 
     /* Clear the output state. */
     for (i = 0; i < MAX_UNF_MPP + 2; i++) {
-	uo_data[i].buf = 0;
-	if (uo_data[i].trn != NULL) {
-	    Free(uo_data[i].trn);
+	ctx->uo_data[i].buf = 0;
+	if (ctx->uo_data[i].trn != NULL) {
+	    Free(ctx->uo_data[i].trn);
 	}
-	uo_data[i].trn = NULL;
-	uo_data[i].trn_len = 0;
+	ctx->uo_data[i].trn = NULL;
+	ctx->uo_data[i].trn_len = 0;
     }
-    uo_col = 0;
-    uo_maxcol = 0;
-    uo_last_cr = false;
+    ctx->uo_col = 0;
+    ctx->uo_maxcol = 0;
+    ctx->uo_last_cr = false;
 
     /* Flush buffered data. */
-#if defined(_WIN32) /*[*/
-    if (ws_initted) {
-	ws_flush();
-    }
-#else /*][*/
-    fflush(prfile);
-#endif /*]*/
-    any_3270_output = 0;
+    prflush();
+    ctx->any_3270_output = 0;
 
     return 0;
 }
@@ -1884,12 +2230,12 @@ static int
 dump_formatted(void)
 {
     int i;
-    ucs4_t *cp = page_buf;
+    ucs4_t *cp = ctx->page_buf;
     int visible = 1;
     int newlines = 0;
     bool data_without_newline = false;
 
-    if (!any_3270_output) {
+    if (!ctx->any_3270_output) {
 	return 0;
     }
     for (i = 0; i < MAX_UNF_MPP; i++) {
@@ -1897,7 +2243,7 @@ dump_formatted(void)
 	int any_data = 0;
 	int j;
 
-	for (j = 0; j < line_length && ((i * line_length) + j) < MAX_BUF; j++) {
+	for (j = 0; j < ctx->line_length && ((i * ctx->line_length) + j) < MAX_BUF; j++) {
 	    char c = *cp++;
 
 	    switch (c) {
@@ -1911,18 +2257,13 @@ dump_formatted(void)
 		break;
 	    case '\f':
 		while (newlines) {
-		    if (options.crlf) {
-			if (stash('\r') < 0) {
-			    return -1;
-			}
-		    }
-		    if (stash('\n') < 0) {
+		    if (stash_newline() < 0) {
 			return -1;
 		    }
 		    newlines--;
 		    data_without_newline = false;
 		}
-		if (any_3270_printable || !options.ffskip) {
+		if (ctx->any_3270_printable || !options.ffskip) {
 		    if (stash('\f') < 0) {
 			return -1;
 		    }
@@ -1939,22 +2280,21 @@ dump_formatted(void)
 		break;
 	    default:
 		while (newlines) {
-		    if (options.crlf) {
-			if (stash('\r') < 0) {
-			    return -1;
-			}
-		    }
-		    if (stash('\n') < 0) {
+		    if (stash_newline() < 0) {
 			return -1;
 		    }
 		    newlines--;
 		    data_without_newline = false;
 		}
 		while (blanks) {
-		    if (stash(' ') < 0) {
+		    static const char spaces[] = "                ";
+		    int n = (blanks < (int)sizeof(spaces) - 1)?
+			blanks: (int)sizeof(spaces) - 1;
+
+		    if (stash_buf(spaces, n) < 0) {
 			return -1;
 		    }
-		    blanks--;
+		    blanks -= n;
 		}
 		any_data++;
 		data_without_newline = true;
@@ -1965,7 +2305,6 @@ dump_formatted(void)
 		} else {
 		    char mb[16];
 		    int len;
-		    int j;
 
 #if !defined(_WIN32) /*[*/
 		    len = unicode_to_multibyte(c, mb, sizeof(mb));
@@ -1978,15 +2317,13 @@ dump_formatted(void)
 		    } else {
 			len--;
 		    }
-		    for (j = 0; j < len; j++) {
-			if (stash(mb[j]) < 0) {
-			    return -1;
-			}
+		    if (stash_buf(mb, len) < 0) {
+			return -1;
 		    }
 
 		}
 		if (visible) {
-		    any_3270_printable = true;
+		    ctx->any_3270_printable = true;
 		}
 		break;
 	    }
@@ -1998,26 +2335,15 @@ dump_formatted(void)
 
     /* If there was data on the last line, put out a newline. */
     if (data_without_newline) {
-	if (options.crlf) {
-	    if (stash('\r') < 0) {
-		return -1;
-	    }
-	}
-	if (stash('\n') < 0) {
+	if (stash_newline() < 0) {
 	    return -1;
 	}
     }
 
     /* Clear the buffer. */
-    memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-#if defined(_WIN32) /*[*/
-    if (ws_initted) {
-	    ws_flush();
-    }
-#else /*][*/
-    fflush(prfile);
-#endif /*]*/
-    any_3270_output = 0;
+    memset(ctx->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+    prflush();
+    ctx->any_3270_output = 0;
 
     return 0;
 }
@@ -2028,8 +2354,8 @@ print_eoj(void)
     int rc = 0;
 
     /* Dump any pending 3270-mode output. */
-    if (any_3270_output) {
-	if (wcc_line_length) {
+    if (ctx->any_3270_output) {
+	if (ctx->wcc_line_length) {
 	    if (dump_formatted() < 0) {
 		rc = -1;
 	    }
@@ -2041,15 +2367,15 @@ print_eoj(void)
     }
 
     /* Dump any pending SCS-mode output. */
-    if (any_scs_output) {
+    if (ctx->any_scs_output) {
 	if (dump_scs_line(true, false) < 0) {
 	    rc = -1;
 	}
     }
 
     /* Handle -ffeoj, which blindly adds a formfeed to every page. */
-    if (options.ffeoj && !ffeoj_last) {
-	if (scs_any) {
+    if (options.ffeoj && !ctx->ffeoj_last) {
+	if (ctx->scs_any) {
 	    trace_ds("Automatic SCS EOJ formfeed.\n");
 	    scs_formfeed(true);
 	    if (dump_scs_line(true, false) < 0) {
@@ -2057,9 +2383,9 @@ print_eoj(void)
 	    }
 	} else {
 	    trace_ds("Automatic 3270 %s EOJ formfeed.\n",
-		    wcc_line_length? "formatted": "unformatted");
-	    ctlr_add(0, FCORDER_FF, default_cs, default_gr);
-	    if (wcc_line_length) {
+		    ctx->wcc_line_length? "formatted": "unformatted");
+	    ctlr_add(0, FCORDER_FF, ctx->default_cs, ctx->default_gr);
+	    if (ctx->wcc_line_length) {
 		if (dump_formatted() < 0) {
 		    rc = -1;
 		}
@@ -2069,52 +2395,45 @@ print_eoj(void)
 		}
 	    }
 	}
-	ffeoj_last = true;
+	ctx->ffeoj_last = true;
     }
 
     /* Close the stream to the print process. */
 #if defined(_WIN32) /*[*/
-    if (ws_initted) {
+    if (ctx->ws_initted) {
 	trace_ds("End of print job.\n");
-	if (options.trnpost != NULL && copyfile(options.trnpost) < 0) {
+	if (options.trnpost != NULL && copyfile(options.trnpost, NULL) < 0) {
 	    rc = -1;
 	}
 	if (ws_endjob() < 0) {
 	    rc = -1;
 	}
-	ws_needpre = 1;
+	ctx->ws_needpre = 1;
     }
-#else /*]*/
-    if (prfile != NULL) {
+#else /*][*/
+    if (ctx->in_job) {
+	const sink_t *sink = job_sink();
+
 	trace_ds("End of print job.\n");
-	if (options.trnpost != NULL && copyfile(options.trnpost) < 0) {
+	if (options.trnpost != NULL &&
+		copyfile(options.trnpost, &ctx->post) < 0) {
 	    rc = -1;
 	}
-	rc = pclose_no_sigint(prfile);
-	if (rc) {
-	    if (rc < 0) {
-		errmsg("Close error on '%s': %s", options.command,
-			strerror(errno));
-	    } else if (WIFEXITED(rc)) {
-		errmsg("'%s' exited with status %d", options.command,
-			WEXITSTATUS(rc));
-	    } else if (WIFSIGNALED(rc)) {
-		errmsg("'%s' terminated by signal %d", options.command,
-			WTERMSIG(rc));
-	    } else {
-		errmsg("'%s' returned status %d", options.command, rc);
-	    }
+	if (job_write(sink) < 0) {
+	    rc = -1;
+	} else if (sink->end() < 0) {
 	    rc = -1;
 	}
-	prfile = NULL;
+	ctx->in_job = false;
+	ctx->job_started = false;
     }
 #endif /*]*/
 
     /* Make sure the next 3270 job starts with clean conditions. */
-    page_buf_initted = 0;
+    ctx->page_buf_initted = 0;
 
     /* Reset the FF suprpession logic. */
-    any_3270_printable = false;
+    ctx->any_3270_printable = false;
 
     return rc;
 }
@@ -2125,7 +2444,7 @@ print_unbind(void)
     /*
      * Make sure that the next SCS job starts with clean conditions.
      */
-    scs_initted = false;
+    ctx->scs_initted = false;
 }
 
 static int
@@ -2133,7 +2452,7 @@ ctlr_erase(void)
 {
     /* Dump whatever we've got so far. */
     /* Dump any pending 3270-mode output. */
-    if (wcc_line_length) {
+    if (ctx->wcc_line_length) {
 	if (dump_formatted() < 0) {
 		return -1;
 	}
@@ -2144,46 +2463,47 @@ ctlr_erase(void)
     }
 
     /* Dump any pending SCS-mode output. */
-    if (any_scs_output) {
+    if (ctx->any_scs_output) {
 	if (dump_scs_line(true, false) < 0) { /* XXX: 1st true? */
 	    return -1;
 	}
     }
 
     /* Make sure the buffer is clean. */
-    memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-    any_3270_output = 0;
-    baddr = 0;
+    memset(ctx->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+    ctx->any_3270_output = 0;
+    ctx->baddr = 0;
     return 0;
 }
 
 /*
- * Copy a -trnpre/-trnpost file to the printer.  We open and read the file
- * for each print job, so someone can change their contents while we are
- * running (hopefully between print jobs).
+ * Copy a -trnpre/-trnpost file to the printer (on POSIX, into a buffer that
+ * is sent along with the job).  We open and read the file for each print job,
+ * so someone can change their contents while we are running (hopefully
+ * between print jobs).
  */
 static int
-copyfile(const char *filename)
+copyfile(const char *filename, varbuf_t *vb)
 {
     FILE *f;
-    int c;
+    char buf[BUFSIZ];
+    size_t nr;
     int rc = 0;
 
     if ((f = fopen(filename, "rb")) == NULL) {
 	errmsg("%s: %s", filename, strerror(errno));
 	return -1;
     }
-    while ((c = fgetc(f)) != EOF) {
-	trace_pdc((unsigned char)c);
+    while ((nr = fread(buf, 1, sizeof(buf), f)) > 0) {
 #if defined(_WIN32) /*[*/
-	if (ws_putc(c) < 0) {
-#else /*][*/
-	if (fputc(c, prfile) < 0) {
-	    errmsg("write(%s): %s", options.command, strerror(errno));
-#endif /*]*/
+	trace_pdb((unsigned char *)buf, nr);
+	if (ws_write(buf, (int)nr) < 0) {
 	    rc = -1;
 	    break;
 	}
+#else /*][*/
+	vb_append(vb, buf, nr);
+#endif /*]*/
     }
     fclose(f);
     return rc;
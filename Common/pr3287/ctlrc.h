@@ -38,6 +38,11 @@ enum pds {
     PDS_FAILED = -3		/* command failed */
 };
 
+typedef struct ctlr_session ctlr_session_t;
+ctlr_session_t *ctlr_session_new(const char *name);
+void ctlr_session_free(ctlr_session_t *s);
+void ctlr_session_set(ctlr_session_t *s);
+
 void ctlr_add(unsigned char ebc, ucs4_t c, unsigned char cs, unsigned char gr);
 void ctlr_write(unsigned char buf[], size_t buflen, bool erase);
 int print_eoj(void);
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2026 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ *	multilu.c
+ *		Multi-LU mode (-lus): one pr3287 process serving many printer
+ *		LUs, sharing a single poll() loop.
+ */
+
+#include "globals.h"
+
+#if !defined(_WIN32) /*[*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "ctlrc.h"
+#include "multilu.h"
+#include "pr3287.h"
+#include "pr_telnet.h"
+#include "telnet_core.h"
+#include "trace.h"
+#include "utils.h"
+
+#define RETRY_SECS	5	/* delay before reconnecting after an error */
+
+/* Per-LU state. */
+typedef struct {
+    char *name;			/* LU name */
+    ctlr_session_t *ctlr;	/* printer state */
+    net_session_t *net;		/* TELNET state */
+    enum {
+	LU_WAITING,		/* waiting to connect */
+	LU_ACTIVE,		/* connected or negotiating */
+	LU_DONE			/* finished, not reconnecting */
+    } state;
+    socket_t s;			/* socket */
+    bool negotiated;		/* TN3270 negotiation complete */
+    time_t retry;		/* when to connect, in LU_WAITING state */
+    time_t last_input;		/* time of last host input */
+    bool eoj_pending;		/* -eojtimeout has not fired since input */
+} lu_t;
+
+static lu_t *lus;
+static int n_lus;
+static lu_t *current_lu;
+static const char *mhost;
+static char *mport;
+static bool any_error;		/* an LU finished with an error */
+
+/* Signal self-pipe, and what the signals asked for. */
+static int sig_pipe[2] = { -1, -1 };
+static volatile sig_atomic_t fatal_sig;
+static volatile sig_atomic_t flush_sig;
+
+/* Signal handler: remember the signal and wake up the poll loop. */
+static void
+multilu_signal(int sig)
+{
+    int save_errno = errno;
+
+    if (sig == SIGUSR1) {
+	flush_sig = 1;
+    } else {
+	fatal_sig = sig;
+    }
+    if (write(sig_pipe[1], "", 1) < 0) {
+	/* Pipe is full, so a wakeup is already pending. */
+    }
+    errno = save_errno;
+}
+
+/* Switch the printer and TELNET modules to an LU. */
+static void
+lu_set(lu_t *l)
+{
+    if (l != current_lu) {
+	current_lu = l;
+	ctlr_session_set(l->ctlr);
+	net_session_set(l->net);
+	vtrace("[LU %s]\n", l->name);
+    }
+}
+
+/* Parse the -lus list and set up the LUs. */
+static bool
+lus_init(void)
+{
+    char *list = NewString(options.lus);
+    char *name;
+    char *ptr;
+    int n = 1;
+
+    for (ptr = list; *ptr; ptr++) {
+	if (*ptr == ',') {
+	    n++;
+	}
+    }
+    lus = (lu_t *)Calloc(n, sizeof(lu_t));
+    for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+	lu_t *l = &lus[n_lus++];
+
+	l->name = NewString(name);
+	l->ctlr = ctlr_session_new(name);
+	l->net = net_session_new();
+	l->state = LU_WAITING;
+	l->s = INVALID_SOCKET;
+    }
+    Free(list);
+    return n_lus > 0;
+}
+
+/* Finish with an LU's connection, scheduling a reconnect if needed. */
+static void
+lu_disconnect(lu_t *l, bool error)
+{
+    lu_set(l);
+    print_eoj();
+    net_disconnect(true);
+    l->s = INVALID_SOCKET;
+    l->negotiated = false;
+    l->eoj_pending = false;
+    if (options.verbose) {
+	fprintf(stderr, "LU %s: disconnected (%s).\n", l->name,
+		error? "error": "eof");
+    }
+    if (options.reconnect) {
+	l->state = LU_WAITING;
+	l->retry = time(NULL) + (error? RETRY_SECS: 0);
+    } else {
+	l->state = LU_DONE;
+	if (error) {
+	    any_error = true;
+	}
+    }
+}
+
+/*
+ * Connect an LU to the host and start negotiating.
+ * The connect (and TLS and proxy negotiation, if any) blocks; everything
+ * after that is driven by the poll loop.
+ */
+static bool
+lu_connect(lu_t *l)
+{
+    unsigned short p;
+
+    lu_set(l);
+    l->s = pr_connect(mhost, mport, &p);
+    if (l->s == INVALID_SOCKET) {
+	lu_disconnect(l, true);
+	return false;
+    }
+    l->state = LU_ACTIVE;
+    if (!pr_net_start(mhost, l->s, l->name, NULL)) {
+	lu_disconnect(l, true);
+	return false;
+    }
+
+    if (options.verbose) {
+	fprintf(stderr, "LU %s: connected to %s, port %u%s\n", l->name,
+		mhost, p, options.tls_host? " via TLS": "");
+    }
+    vtrace("Connected to %s, port %u%s\n", mhost, p,
+	    options.tls_host? " via TLS": "");
+    vtrace("Connecting to LU %s\n", l->name);
+    return true;
+}
+
+/* Flush pending output on every connected LU. */
+static void
+lus_eoj(void)
+{
+    int i;
+
+    for (i = 0; i < n_lus; i++) {
+	if (lus[i].state == LU_ACTIVE) {
+	    lu_set(&lus[i]);
+	    print_eoj();
+	}
+    }
+}
+
+/* Disconnect every LU. */
+static void
+lus_disconnect(void)
+{
+    int i;
+
+    for (i = 0; i < n_lus; i++) {
+	if (lus[i].state == LU_ACTIVE) {
+	    lu_set(&lus[i]);
+	    print_eoj();
+	    net_disconnect(true);
+	}
+    }
+}
+
+/* Pull a wakeup deadline earlier. */
+static void
+wake_at(time_t *deadline, time_t t)
+{
+    if (*deadline == 0 || t < *deadline) {
+	*deadline = t;
+    }
+}
+
+/*
+ * Serve each of the LUs in options.lus.
+ * Returns when no LUs are left, i.e., when every LU has disconnected and
+ * -reconnect is not in effect.
+ */
+int
+multilu_run(const char *host, char *port)
+{
+    struct pollfd *pfds;
+    lu_t **pfd_lu;
+    int rc = 0;
+    int i;
+
+    mhost = host;
+    mport = port;
+    if (!lus_init()) {
+	errmsg("No LUs specified with -lus");
+	return 1;
+    }
+    vtrace("Serving %d LU%s\n", n_lus, (n_lus == 1)? "": "s");
+
+    /* Catch signals through a self-pipe, so they interrupt the poll. */
+    if (pipe(sig_pipe) < 0) {
+	errmsg("pipe: %s", strerror(errno));
+	return 1;
+    }
+    for (i = 0; i < 2; i++) {
+	fcntl(sig_pipe[i], F_SETFD, 1);
+	fcntl(sig_pipe[i], F_SETFL, fcntl(sig_pipe[i], F_GETFL) | O_NONBLOCK);
+    }
+    signal(SIGTERM, multilu_signal);
+    signal(SIGINT, multilu_signal);
+    signal(SIGHUP, multilu_signal);
+    signal(SIGUSR1, multilu_signal);
+
+    /* One slot per LU, plus the signal pipe and syncsock. */
+    pfds = (struct pollfd *)Calloc(n_lus + 2, sizeof(struct pollfd));
+    pfd_lu = (lu_t **)Calloc(n_lus + 2, sizeof(lu_t *));
+
+    for (;;) {
+	time_t now = time(NULL);
+	time_t deadline = 0;
+	bool any = false;
+	int nfds = 0;
+	int timeout = -1;
+	int nr;
+
+	/* Connect the LUs that are due. */
+	for (i = 0; i < n_lus; i++) {
+	    if (lus[i].state == LU_WAITING && lus[i].retry <= now) {
+		if (lu_connect(&lus[i])) {
+		    lus[i].last_input = now;
+		}
+	    }
+	}
+
+	/* Gather the sockets and figure out when to wake up. */
+	now = time(NULL);
+	for (i = 0; i < n_lus; i++) {
+	    lu_t *l = &lus[i];
+
+	    switch (l->state) {
+	    case LU_ACTIVE:
+		pfds[nfds].fd = l->s;
+		pfds[nfds].events = POLLIN;
+		pfd_lu[nfds++] = l;
+		if (options.eoj_timeout && l->eoj_pending) {
+		    wake_at(&deadline, l->last_input + options.eoj_timeout);
+		}
+		any = true;
+		break;
+	    case LU_WAITING:
+		wake_at(&deadline, l->retry);
+		any = true;
+		break;
+	    case LU_DONE:
+		break;
+	    }
+	}
+	if (!any) {
+	    break;
+	}
+	pfds[nfds].fd = sig_pipe[0];
+	pfds[nfds].events = POLLIN;
+	pfd_lu[nfds++] = NULL;
+	if (syncsock != INVALID_SOCKET) {
+	    pfds[nfds].fd = syncsock;
+	    pfds[nfds].events = POLLIN;
+	    pfd_lu[nfds++] = NULL;
+	}
+	if (deadline != 0) {
+	    timeout = (deadline > now)? (int)(deadline - now) * 1000: 0;
+	}
+
+	nr = poll(pfds, nfds, timeout);
+	if (nr < 0 && errno != EINTR) {
+	    errmsg("poll: %s", strerror(errno));
+	    rc = 1;
+	    break;
+	}
+
+	/* Handle signals. */
+	if (fatal_sig) {
+	    vtrace("Fatal signal %d\n", (int)fatal_sig);
+	    lus_eoj();
+	    errmsg("Exiting on signal %d", (int)fatal_sig);
+	    exit(0);
+	}
+	if (flush_sig) {
+	    char buf[16];
+
+	    flush_sig = 0;
+	    vtrace("Flush signal %d\n", SIGUSR1);
+	    lus_eoj();
+	    while (read(sig_pipe[0], buf, sizeof(buf)) > 0) {
+	    }
+	}
+
+	/* Process host input. */
+	now = time(NULL);
+	for (i = 0; nr > 0 && i < nfds; i++) {
+	    lu_t *l = pfd_lu[i];
+
+	    if (!pfds[i].revents) {
+		continue;
+	    }
+	    nr--;
+	    if (l == NULL) {
+		if (pfds[i].fd == syncsock) {
+		    vtrace("Input on syncsock -- exiting.\n");
+		    lus_disconnect();
+		    pr3287_exit(0);
+		}
+		continue;
+	    }
+	    lu_set(l);
+	    if (!pr_net_input()) {
+		lu_disconnect(l, true);
+		continue;
+	    }
+	    if (!pr_net_connected()) {
+		lu_disconnect(l, false);
+		continue;
+	    }
+	    if (!l->negotiated && pr_net_negotiated()) {
+		l->negotiated = true;
+		if (options.verbose) {
+		    fprintf(stderr, "LU %s: negotiated.\n", l->name);
+		}
+	    }
+	    l->last_input = now;
+	    l->eoj_pending = true;
+	}
+
+	/* Time out print jobs. */
+	if (options.eoj_timeout) {
+	    for (i = 0; i < n_lus; i++) {
+		lu_t *l = &lus[i];
+
+		if (l->state == LU_ACTIVE && l->eoj_pending &&
+			now >= l->last_input + (time_t)options.eoj_timeout) {
+		    lu_set(l);
+		    print_eoj();
+		    l->eoj_pending = false;
+		}
+	    }
+	}
+    }
+
+    /* Clean up. */
+    for (i = 0; i < n_lus; i++) {
+	ctlr_session_free(lus[i].ctlr);
+	net_session_free(lus[i].net);
+	Free(lus[i].name);
+    }
+    Free(lus);
+    Free(pfds);
+    Free(pfd_lu);
+    return any_error? 1: rc;
+}
+
+#endif /*]*/
@@ -73,12 +73,16 @@
  *          -keyfile file
  *          -keyfiletype type
  *          -keypasswd type:text
+ *          -lus lu[,lu...]
+ *              serve each of the LUs at once (POSIX only)
  *          -mpp n
  *              set the maximum presentation position (unformatted line length)
  *          -nocrlf
  *		expand newlines to CR/LF (Windows only)
  *          -noverifycert
  *          	do not verify host certificates for TLS connections
+ *	    -pipe "string"
+ *		long-lived command to write every job to (POSIX only)
  *	    -printer "printer name"
  *	        printer to use (default is $PRINTER or system default,
  *	        Windows only)
@@ -92,6 +96,8 @@
  *	        allow self-signed host certificates
  *	    -skipcc
  *	    	skip ASA carriage control characters in host output
+ *	    -spooldir dir
+ *	    	write each job to a file in dir (POSIX only)
  *          -syncport port
  *              TCP port for login session synchronization
  *	    -trace
@@ -143,6 +149,7 @@
 #include "codepage.h"
 #include "trace.h"
 #include "ctlrc.h"
+#include "multilu.h"
 #include "popups.h"
 #include "pr3287.h"
 #include "proxy.h"
@@ -298,6 +305,10 @@ cmdline_help(void)
     }
     fprintf(stderr,
 "  -ignoreeoj       ignore PRINT-EOJ commands\n"
+#if !defined(_WIN32) /*[*/
+"  -lus <lu>[,<lu>...]\n"
+"                   serve all of the LUs at once\n"
+#endif /*]*/
 "  -mpp <n>         define the Maximum Presentation Position (unformatted\n"
 "                   line length)\n");
     if (tls_options & TLS_OPT_VERIFY_HOST_CERT) {
@@ -313,10 +324,16 @@ cmdline_help(void)
 "                   code page for output (default is system ANSI code page)\n"
 #endif /*]*/
 "  -proxy <spec>    connect to host via specified proxy\n"
+#if !defined(_WIN32) /*[*/
+"  -pipe \"<cmd>\"   write every job to one long-lived <cmd>\n"
+#endif /*]*/
 "  " OptReconnect "       keep trying to reconnect\n");
     fprintf(stderr,
 "  -skipcc          skip ASA carriage control characters in unformatted host\n"
 "                   output\n"
+#if !defined(_WIN32) /*[*/
+"  -spooldir <dir>  write each job to a new file in <dir>\n"
+#endif /*]*/
 "  -syncport port   TCP port for login session synchronization\n"
 #if defined(_WIN32) /*[*/
 "  " OptTrace "           trace data stream to <wc3270appData>/x3trc.<pid>.txt\n"
@@ -407,9 +424,12 @@ Malloc(size_t len)
 void *
 Calloc(size_t nelem, size_t elem_size)
 {
-    void *p = Malloc(nelem * elem_size);
+    void *p = calloc(nelem, elem_size);
 
-    memset(p, 0, nelem * elem_size);
+    if (p == NULL) {
+	errmsg("Out of memory");
+	pr3287_exit(1);
+    }
     return p;
 }
 
@@ -557,6 +577,109 @@ init_options(void)
     options.verbose		= 0;
 }
 
+/*
+ * Resolve the host (or proxy) name and connect to it, negotiating with the
+ * proxy if one is configured.
+ * Returns the socket, or INVALID_SOCKET if something failed. Returns the port
+ * number in *portp.
+ */
+socket_t
+pr_connect(const char *host, char *port, unsigned short *portp)
+{
+    typedef union {
+	struct sockaddr sa;
+	struct sockaddr_in sin;
+	struct sockaddr_in6 sin6;
+    } sockaddr_46_t;
+#   define NUM_HA 4
+    sockaddr_46_t ha[NUM_HA];
+    socklen_t ha_len[NUM_HA];
+    int ha_ix;
+    char *errtxt;
+    int n_ha;
+    socket_t s = INVALID_SOCKET;
+    unsigned short p;
+    char hn[256], pn[256];
+
+    /* Resolve the host name. */
+    if (proxy_type > 0) {
+	unsigned long lport;
+	char *ptr;
+	struct servent *sp;
+
+	if (resolve_host_and_port(proxy_host, proxy_portname, &proxy_port,
+		    &ha[0].sa, sizeof(sockaddr_46_t), ha_len, &errtxt,
+		    NUM_HA, &n_ha) < 0) {
+	    popup_an_error("%s", errtxt);
+	    return INVALID_SOCKET;
+	}
+
+	lport = strtoul(port, &ptr, 0);
+	if (ptr == port || *ptr != '\0' || lport == 0L || lport & ~0xffff) {
+	    if (!(sp = getservbyname(port, "tcp"))) {
+		popup_an_error("Unknown port number or service: %s", port);
+		return INVALID_SOCKET;
+	    }
+	    p = ntohs(sp->s_port);
+	} else {
+	    p = (unsigned short)lport;
+	}
+    } else {
+	if (resolve_host_and_port(host, port, &p, &ha[0].sa,
+		    sizeof(sockaddr_46_t), ha_len, &errtxt, NUM_HA,
+		    &n_ha) < 0) {
+	    popup_an_error("%s", errtxt);
+	    return INVALID_SOCKET;
+	}
+    }
+
+    for (ha_ix = 0; ha_ix < n_ha; ha_ix++) {
+
+	/* Connect to the host. */
+	s = socket(ha[ha_ix].sa.sa_family, SOCK_STREAM, 0);
+	if (s == INVALID_SOCKET) {
+	    popup_a_sockerr("socket");
+	    pr3287_exit(1);
+	}
+
+	if (numeric_host_and_port(&ha[ha_ix].sa, ha_len[ha_ix], hn,
+		    sizeof(hn), pn, sizeof(pn), &errtxt)) {
+	    vtrace("Trying %s, port %s...\n", hn, pn);
+	}
+	if (connect(s, &ha[ha_ix].sa, ha_len[ha_ix]) == 0) {
+	    /* Success! */
+	    if (ha[ha_ix].sa.sa_family == AF_INET) {
+		p = htons(ha[ha_ix].sin.sin_port);
+	    } else {
+		p = htons(ha[ha_ix].sin6.sin6_port);
+	    }
+	    break;
+	}
+
+	popup_a_sockerr("%s", (proxy_type > 0)? proxy_host: host);
+	SOCK_CLOSE(s);
+	s = INVALID_SOCKET;
+    }
+    if (s == INVALID_SOCKET) {
+	return INVALID_SOCKET;
+    }
+
+    if (proxy_type > 0) {
+	/* Connect to the host through the proxy. */
+	if (options.verbose) {
+	    fprintf(stderr, "Connected to proxy server %s, port %u\n",
+		    proxy_host, proxy_port);
+	}
+	if (proxy_negotiate(s, proxy_user, host, p, true) != PX_SUCCESS) {
+	    SOCK_CLOSE(s);
+	    return INVALID_SOCKET;
+	}
+    }
+
+    *portp = p;
+    return s;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -573,8 +696,6 @@ main(int argc, char *argv[])
     int rc = 0;
     int report_success = 0;
     unsigned tls_options = sio_all_options_supported();
-    char hn[256];
-    char pn[256];
     const char *bo;
 
     /* Learn our name. */
@@ -737,6 +858,26 @@ main(int argc, char *argv[])
 	    i++;
 	} else if (!strcmp(argv[i], "-ignoreeoj")) {
 	    options.ignoreeoj = 1;
+#if !defined(_WIN32) /*[*/
+	} else if (!strcmp(argv[i], "-lus")) {
+	    if (argc <= i + 1 || !argv[i + 1][0]) {
+		missing_value("-lus");
+	    }
+	    options.lus = argv[i + 1];
+	    i++;
+	} else if (!strcmp(argv[i], "-pipe")) {
+	    if (argc <= i + 1 || !argv[i + 1][0]) {
+		missing_value("-pipe");
+	    }
+	    options.pipe = argv[i + 1];
+	    i++;
+	} else if (!strcmp(argv[i], "-spooldir")) {
+	    if (argc <= i + 1 || !argv[i + 1][0]) {
+		missing_value("-spooldir");
+	    }
+	    options.spooldir = argv[i + 1];
+	    i++;
+#endif /*]*/
 	} else if (!strcmp(argv[i], "-ffeoj")) {
 	    options.ffeoj = 1;
 	} else if (!strcmp(argv[i], "-ffthru")) {
@@ -883,6 +1024,12 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 	usage(NULL);
     }
 
+#if !defined(_WIN32) /*[*/
+    if (options.lus != NULL && (lu != NULL || options.assoc != NULL)) {
+	usage("-lus cannot be combined with an LU name or -assoc");
+    }
+#endif /*]*/
+
     if (options.tls_host && !sio_supported()) {
 	fprintf(stderr, "Secure connections not supported.\n");
 	pr3287_exit(1);
@@ -895,6 +1042,15 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
     }
 #endif /*]*/
 
+    /* Set up the printer and network state for a single LU. */
+#if !defined(_WIN32) /*[*/
+    if (options.lus == NULL)
+#endif /*]*/
+    {
+	ctlr_session_set(ctlr_session_new((lu != NULL)? lu: "pr3287"));
+	net_session_set(net_session_new());
+    }
+
     /* Set up the character set. */
     if (codepage_init(options.codepage) != CS_OKAY) {
 	pr3287_exit(1);
@@ -1077,103 +1233,26 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
     /* Set up -4/-6 host lookup preference. */
     set_46(options.prefer_ipv4, options.prefer_ipv6);
 
+#if !defined(_WIN32) /*[*/
+    /* Serve several LUs at once. */
+    if (options.lus != NULL) {
+	pr3287_exit(multilu_run(host, port));
+    }
+#endif /*]*/
+
     /*
      * One-time initialization is now complete.
      * (Most) everything beyond this will now be retried, if the -reconnect
      * option is in effect.
      */
     for (;;) {
-	typedef union {
-	    struct sockaddr sa;
-	    struct sockaddr_in sin;
-	    struct sockaddr_in6 sin6;
-	} sockaddr_46_t;
-#       define NUM_HA 4
-	sockaddr_46_t ha[NUM_HA];
-	socklen_t ha_len[NUM_HA];
-	int ha_ix;
-	char *errtxt;
-	int n_ha;
-
-	/* Resolve the host name. */
-	if (proxy_type > 0) {
-	    unsigned long lport;
-	    char *ptr;
-	    struct servent *sp;
-
-	    if (resolve_host_and_port(proxy_host, proxy_portname, &proxy_port,
-			&ha[0].sa, sizeof(sockaddr_46_t), ha_len, &errtxt,
-			NUM_HA, &n_ha) < 0) {
-		popup_an_error("%s", errtxt);
-		rc = 1;
-		goto retry;
-	    }
-
-	    lport = strtoul(port, &ptr, 0);
-	    if (ptr == port || *ptr != '\0' || lport == 0L || lport & ~0xffff) {
-		if (!(sp = getservbyname(port, "tcp"))) {
-		    popup_an_error("Unknown port number or service: %s", port);
-		    rc = 1;
-		    goto retry;
-		}
-		p = ntohs(sp->s_port);
-	    } else {
-		p = (unsigned short)lport;
-	    }
-	} else {
-	    if (resolve_host_and_port(host, port, &p, &ha[0].sa,
-			sizeof(sockaddr_46_t), ha_len, &errtxt, NUM_HA,
-			&n_ha) < 0) {
-		popup_an_error("%s", errtxt);
-		rc = 1;
-		goto retry;
-	    }
-	}
-
-	for (ha_ix = 0; ha_ix < n_ha; ha_ix++) {
-
-	    /* Connect to the host. */
-	    s = socket(ha[ha_ix].sa.sa_family, SOCK_STREAM, 0);
-	    if (s == INVALID_SOCKET) {
-		popup_a_sockerr("socket");
-		pr3287_exit(1);
-	    }
-
-	    if (numeric_host_and_port(&ha[ha_ix].sa, ha_len[ha_ix], hn,
-			sizeof(hn), pn, sizeof(pn), &errtxt)) {
-		vtrace("Trying %s, port %s...\n", hn, pn);
-	    }
-	    if (connect(s, &ha[ha_ix].sa, ha_len[ha_ix]) == 0) {
-		/* Success! */
-		if (ha[ha_ix].sa.sa_family == AF_INET) {
-		    p = htons(ha[ha_ix].sin.sin_port);
-		} else {
-		    p = htons(ha[ha_ix].sin6.sin6_port);
-		}
-		break;
-	    }
-
-	    popup_a_sockerr("%s", (proxy_type > 0)? proxy_host: host);
-	    SOCK_CLOSE(s);
-	    s = INVALID_SOCKET;
-	}
+	/* Connect to the host. */
+	s = pr_connect(host, port, &p);
 	if (s == INVALID_SOCKET) {
 	    rc = 1;
 	    goto retry;
 	}
 
-	if (proxy_type > 0) {
-	    /* Connect to the host through the proxy. */
-	    if (options.verbose) {
-		fprintf(stderr, "Connected to proxy server %s, port %u\n",
-			proxy_host, proxy_port);
-	    }
-	    if (proxy_negotiate(s, proxy_user, host, p, true) != PX_SUCCESS) {
-		rc = 1;
-		goto retry;
-	    }
-	}
-
 	/* Say hello. */
 	if (options.verbose) {
 	    fprintf(stderr, "Connected to %s, port %u%s\n", host, p,
@@ -1204,8 +1283,7 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 #endif /*]*/
 
 	/* Negotiate. */
-	if (!pr_net_negotiate(host, &ha[ha_ix].sa, ha_len[ha_ix], s, lu,
-		    options.assoc)) {
+	if (!pr_net_negotiate(host, s, lu, options.assoc)) {
 	    rc = 1;
 	    goto retry;
 	}
@@ -53,6 +53,10 @@ typedef struct {
 	int ffthru;		/* -ffthru */
 	int ffskip;		/* -ffskip */
 	int ignoreeoj;		/* -ignoreeoj */
+#if !defined(_WIN32) /*[*/
+	const char *lus;	/* LUs to serve at once (-lus) */
+	const char *pipe;	/* long-lived command to print to (-pipe) */
+#endif /*]*/
 #if defined(_WIN32) /*[*/
 	const char *printer;	/* printer to use (-printer) */
 	int printercp;		/* -printercp */
@@ -60,6 +64,9 @@ typedef struct {
 	const char *proxy_spec;	/* proxy specification */
 	int reconnect;		/* -reconnect */
 	int skipcc;		/* -skipcc */
+#if !defined(_WIN32) /*[*/
+	const char *spooldir;	/* directory to spool jobs into (-spooldir) */
+#endif /*]*/
 	int mpp;		/* -mpp */
 	bool tls_host;		/* L: */
 	tls_config_t tls;	/* TLS options */
@@ -83,6 +90,8 @@ extern char *common_appdata;
 extern socket_t syncsock;
 
 extern void pr3287_exit(int exit_code);
+extern socket_t pr_connect(const char *host, char *port,
+	unsigned short *portp);
 
 #define MIN_UNF_MPP	40	/* minimum value for unformatted MPP */
 #define MAX_UNF_MPP	256	/* maximum value for unformatted MPP */
@@ -1,2 +1,2 @@
 # Object files common to 3287 emulators
-PR3287_OBJECTS = codepage.o ctlr.o pr3287.o sf.o telnet.o trace.o xtable.o
+PR3287_OBJECTS = codepage.o ctlr.o multilu.o pr3287.o sf.o telnet.o trace.o xtable.o
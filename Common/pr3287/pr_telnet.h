@@ -31,6 +31,16 @@
  *		from) what is declared in telnet_core.h.
  */
 
-extern bool pr_net_negotiate(const char *host, struct sockaddr *sa,
-	socklen_t len, socket_t s, char *lu, const char *assoc);
+typedef struct net_session net_session_t;
+extern net_session_t *net_session_new(void);
+extern void net_session_free(net_session_t *s);
+extern void net_session_set(net_session_t *s);
+
+extern bool pr_net_start(const char *host, socket_t s, char *lu,
+	const char *assoc);
+extern bool pr_net_negotiated(void);
+extern bool pr_net_connected(void);
+extern bool pr_net_input(void);
+extern bool pr_net_negotiate(const char *host, socket_t s, char *lu,
+	const char *assoc);
 extern bool pr_net_process(socket_t s);
@@ -100,25 +100,22 @@ enum cstate {
     CONNECTED_TN3270E,	/* connected in TN3270E mode, 3270 mode */
     NUM_CSTATE		/* number of cstates */
 };
-enum cstate cstate = NOT_CONNECTED;
 
-#define PCONNECTED	((int)cstate >= (int)TCP_PENDING)
-#define HALF_CONNECTED	(cstate == TCP_PENDING)
-#define CONNECTED	((int)cstate >= (int)CONNECTED_INITIAL)
-#define IN_NVT		(cstate == CONNECTED_NVT || cstate == CONNECTED_E_NVT)
-#define IN_3270		(cstate == CONNECTED_3270 || cstate == CONNECTED_TN3270E || cstate == CONNECTED_SSCP)
-#define IN_SSCP		(cstate == CONNECTED_SSCP)
-#define IN_TN3270E	(cstate == CONNECTED_TN3270E)
-#define IN_E		(cstate >= CONNECTED_INITIAL_E)
-
-static char *connected_lu = NULL;
-static char *connected_type = NULL;
-static char *hostname = NULL;
+#define PCONNECTED	((int)ctx->cstate >= (int)TCP_PENDING)
+#define HALF_CONNECTED	(ctx->cstate == TCP_PENDING)
+#define CONNECTED	((int)ctx->cstate >= (int)CONNECTED_INITIAL)
+#define IN_NVT		(ctx->cstate == CONNECTED_NVT || ctx->cstate == CONNECTED_E_NVT)
+#define IN_3270		(ctx->cstate == CONNECTED_3270 || ctx->cstate == CONNECTED_TN3270E || ctx->cstate == CONNECTED_SSCP)
+#define IN_SSCP		(ctx->cstate == CONNECTED_SSCP)
+#define IN_TN3270E	(ctx->cstate == CONNECTED_TN3270E)
+#define IN_E		(ctx->cstate >= CONNECTED_INITIAL_E)
 
 #define BUFSZ		4096
 
 #define N_OPTS		256
 
+#define LU_MAX		32
+
 static int on = 1;
 
 /* Globals */
@@ -134,36 +131,55 @@ bool            linemode = true;
 const char     *termtype = "IBM-3287-1";
 
 
+/*
+ * Per-session state. pr3287 normally has just one session; with -lus it
+ * has one for each LU, and switches between them with net_session_set().
+ */
+struct net_session {
+    enum cstate cstate;		/* connection state */
+    socket_t sock;		/* active socket */
+    unsigned char myopts[N_OPTS], hisopts[N_OPTS];
+				/* telnet option flags */
+    unsigned char *ibuf;	/* 3270 input buffer */
+    unsigned char *ibptr;
+    int ibuf_size;		/* size of ibuf */
+    unsigned char *sbbuf;	/* telnet sub-option buffer */
+    unsigned char *sbptr;
+    unsigned char telnet_state;
+    int syncing;
+
+    unsigned long e_funcs;	/* negotiated TN3270E functions */
+    unsigned short e_xmit_seq;	/* transmit sequence number */
+    int response_required;
+
+    int tn3270e_negotiated;
+    enum { E_NONE, E_3270, E_NVT, E_SSCP } tn3270e_submode;
+    int tn3270e_bound;
+    char **lus;
+    char **curr_lu;
+    char *try_lu;
+    char *try_assoc;
+    char *connected_lu;
+    char *connected_type;
+    char reported_lu[LU_MAX + 1];
+    char reported_type[LU_MAX + 1];
+    char *hostname;
+
+    bool secure_connection;
+    bool secure_unverified;
+    sio_t sio;
+    bool need_tls_follows;
+    bool refused_tls;
+    bool ever_3270;
+};
+
 /* Statics */
 static struct timeval ds_ts;
-static socket_t sock = INVALID_SOCKET;	/* active socket */
-static unsigned char myopts[N_OPTS], hisopts[N_OPTS];
-			/* telnet option flags */
-static unsigned char *ibuf = (unsigned char *) NULL;
-			/* 3270 input buffer */
-static unsigned char *ibptr;
-static int      ibuf_size = 0;	/* size of ibuf */
 static unsigned char *obuf_base = NULL;
 static unsigned char *netrbuf = NULL;
 			/* network input buffer */
-static unsigned char *sbbuf = NULL;
-			/* telnet sub-option buffer */
-static unsigned char *sbptr;
-static unsigned char telnet_state;
-static int      syncing;
-
-static unsigned long e_funcs;	/* negotiated TN3270E functions */
 #define E_OPT(n)	(1 << (n))
-static unsigned short e_xmit_seq; /* transmit sequence number */
-static int response_required;
-
-static int tn3270e_negotiated = 0;
-static enum { E_NONE, E_3270, E_NVT, E_SSCP } tn3270e_submode = E_NONE;
-static int tn3270e_bound = 0;
-static char **lus = NULL;
-static char **curr_lu = NULL;
-static char *try_lu = NULL;
-static char *try_assoc = NULL;
+static net_session_t *ctx;	/* current session */
 
 static void setup_lus(char *luname, const char *assoc);
 static bool telnet_fsm(unsigned char c);
@@ -240,13 +256,7 @@ const char *neg_type[4] = { "COMMAND-REJECT", "INTERVENTION-REQUIRED",
 #define e_neg_type(n)	(((n) <= TN3270E_NEG_COMPONENT_DISCONNECTED) ? \
 			    neg_type[n]: "??")
 
-bool secure_connection = false;
-bool secure_unverified = false;
-static sio_t sio;
-static bool need_tls_follows = false;
 static int continue_tls(unsigned char *sbbuf, int len);
-static bool refused_tls = false;
-static bool ever_3270 = false;
 
 char *
 sockerrmsg(void)
@@ -283,22 +293,59 @@ popup_a_sockerr(const char *fmt, ...)
     Free(buf);
 }
 
+/* Create a network session. */
+net_session_t *
+net_session_new(void)
+{
+    net_session_t *s = (net_session_t *)Calloc(1, sizeof(net_session_t));
+
+    s->cstate = NOT_CONNECTED;
+    s->sock = INVALID_SOCKET;
+    s->tn3270e_submode = E_NONE;
+    return s;
+}
+
+/* Free a network session. It should already be disconnected. */
+void
+net_session_free(net_session_t *s)
+{
+    Free(s->ibuf);
+    Free(s->sbbuf);
+    Free(s->lus);
+    Free(s->try_assoc);
+    Free(s->hostname);
+    if (ctx == s) {
+	ctx = NULL;
+    }
+    Free(s);
+}
+
+/* Make a network session the current one. */
+void
+net_session_set(net_session_t *s)
+{
+    ctx = s;
+}
+
 /*
- * pr_net_negotiate
- *	Initialize the connection, and negotiate TN3270 options with the host.
+ * pr_net_start
+ *	Initialize the connection, and start negotiating TN3270 options with
+ *	the host. The rest of the negotiation happens as input arrives.
  *
  * Returns true for success, false for failure.
  */
 bool
-pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
-	socket_t s, char *lu, const char *assoc)
+pr_net_start(const char *host, socket_t s, char *lu, const char *assoc)
 {
     bool data = false;
 
+    /* Remember the socket, so net_disconnect() can clean up after a failure. */
+    ctx->sock = s;
+
     /* Save the hostname. */
     char *h = Malloc(strlen(host) + 1);
     strcpy(h, host);
-    Replace(hostname, h);
+    Replace(ctx->hostname, h);
 
     /* Set options for inline out-of-band data and keepalives. */
     if (setsockopt(s, SOL_SOCKET, SO_OOBINLINE, (char *)&on, sizeof(on)) < 0) {
@@ -316,21 +363,21 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
 #endif /*]*/
 
     /* Init TLS */
-    if (options.tls_host && !secure_connection) {
+    if (options.tls_host && !ctx->secure_connection) {
 	char *session, *cert;
 
-	if (sio_init(&options.tls, NULL, &sio) != SI_SUCCESS) {
+	if (sio_init(&options.tls, NULL, &ctx->sio) != SI_SUCCESS) {
 	    errmsg("%s\n", sio_last_error());
 	    return false;
 	}
-	if (sio_negotiate(sio, s, host, &data) != SIG_SUCCESS) {
+	if (sio_negotiate(ctx->sio, s, host, &data) != SIG_SUCCESS) {
 	    errmsg("%s\n", sio_last_error());
 	    return false;
 	}
 
-	secure_connection = true;
-	session = indent_s(sio_session_info(sio));
-	cert = indent_s(sio_server_cert_info(sio));
+	ctx->secure_connection = true;
+	session = indent_s(sio_session_info(ctx->sio));
+	cert = indent_s(sio_server_cert_info(ctx->sio));
 	vtrace("TLS tunneled connection complete.  "
 		"Connection is now secure.\n"
 		"Session:\n%s\nServer certificate:\n%s\n",
@@ -343,27 +390,27 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
     if (netrbuf == NULL) {
 	netrbuf = (unsigned char *)Malloc(BUFSZ);
     }
-    if (ibuf == NULL) {
-	ibuf = (unsigned char *)Malloc(BUFSIZ);
+    if (ctx->ibuf == NULL) {
+	ctx->ibuf = (unsigned char *)Malloc(BUFSIZ);
     }
-    ibuf_size = BUFSIZ;
-    ibptr = ibuf;
+    ctx->ibuf_size = BUFSIZ;
+    ctx->ibptr = ctx->ibuf;
 
     /* Set up the LU list. */
     setup_lus(lu, assoc);
 
     /* Set up telnet options. */
-    memset((char *) myopts, 0, sizeof(myopts));
-    memset((char *) hisopts, 0, sizeof(hisopts));
-    e_funcs = E_OPT(TN3270E_FUNC_BIND_IMAGE) |
+    memset((char *) ctx->myopts, 0, sizeof(ctx->myopts));
+    memset((char *) ctx->hisopts, 0, sizeof(ctx->hisopts));
+    ctx->e_funcs = E_OPT(TN3270E_FUNC_BIND_IMAGE) |
 	      E_OPT(TN3270E_FUNC_DATA_STREAM_CTL) |
 	      E_OPT(TN3270E_FUNC_RESPONSES) |
 	      E_OPT(TN3270E_FUNC_SCS_CTL_CODES) |
 	      E_OPT(TN3270E_FUNC_SYSREQ);
-    e_xmit_seq = 0;
-    response_required = TN3270E_RSF_NO_RESPONSE;
-    need_tls_follows = false;
-    telnet_state = TNS_DATA;
+    ctx->e_xmit_seq = 0;
+    ctx->response_required = TN3270E_RSF_NO_RESPONSE;
+    ctx->need_tls_follows = false;
+    ctx->telnet_state = TNS_DATA;
 
     /* Clear statistics and flags. */
     time(&ns_time);
@@ -371,17 +418,31 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
     ns_rrcvd = 0;
     ns_bsent = 0;
     ns_rsent = 0;
-    syncing = 0;
-    tn3270e_negotiated = 0;
-    tn3270e_submode = E_NONE;
-    tn3270e_bound = 0;
+    ctx->syncing = 0;
+    ctx->tn3270e_negotiated = 0;
+    ctx->tn3270e_submode = E_NONE;
+    ctx->tn3270e_bound = 0;
+
+    ctx->cstate = CONNECTED_INITIAL;
+    return true;
+}
+
+/*
+ * pr_net_negotiate
+ *	Initialize the connection, and negotiate TN3270 options with the host.
+ *
+ * Returns true for success, false for failure.
+ */
+bool
+pr_net_negotiate(const char *host, socket_t s, char *lu, const char *assoc)
+{
+    if (!pr_net_start(host, s, lu, assoc)) {
+	return false;
+    }
 
     /* Speak with the host until we suceed or give up. */
-    cstate = CONNECTED_INITIAL;
-    sock = s; /* hack! */
-    while (!tn3270e_negotiated &&	/* TN3270E */
-	   cstate != CONNECTED_3270 &&	/* TN3270 */
-	   cstate != NOT_CONNECTED) {	/* gave up */
+    while (!pr_net_negotiated() &&
+	   ctx->cstate != NOT_CONNECTED) {	/* gave up */
 
 	if (!net_input(s)) {
 	    return false;
@@ -392,10 +453,41 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
     return true;
 }
 
+/* Returns true if negotiation with the host is complete. */
+bool
+pr_net_negotiated(void)
+{
+    return ctx->tn3270e_negotiated ||		/* TN3270E */
+	ctx->cstate == CONNECTED_3270;		/* TN3270 */
+}
+
+/* Returns true if the session is connected to the host. */
+bool
+pr_net_connected(void)
+{
+    return ctx->cstate != NOT_CONNECTED;
+}
+
+/*
+ * pr_net_input
+ *	Process input that is available on the session's socket.
+ *
+ * Returns true for success, false for failure.
+ */
+bool
+pr_net_input(void)
+{
+    bool rv = net_input(ctx->sock);
+
+    /* Free transaction memory. */
+    txflush();
+    return rv;
+}
+
 bool
 pr_net_process(socket_t s)
 {
-    while (cstate != NOT_CONNECTED) {
+    while (ctx->cstate != NOT_CONNECTED) {
 	fd_set rfds;
 	struct timeval t;
 	struct timeval *tp;
@@ -447,23 +539,23 @@ pr_net_process(socket_t s)
 void
 net_disconnect(bool including_tls)
 {
-    if (sock != INVALID_SOCKET) {
+    if (ctx->sock != INVALID_SOCKET) {
 	vtrace("SENT disconnect\n");
-	SOCK_CLOSE(sock);
-	sock = INVALID_SOCKET;
-	if (sio != NULL) {
-	    sio_close(sio);
-	    sio = NULL;
+	SOCK_CLOSE(ctx->sock);
+	ctx->sock = INVALID_SOCKET;
+	if (ctx->sio != NULL) {
+	    sio_close(ctx->sio);
+	    ctx->sio = NULL;
 	}               
-	secure_connection = false;
-	secure_unverified = false;
+	ctx->secure_connection = false;
+	ctx->secure_unverified = false;
 
-	if (refused_tls && !ever_3270) {
+	if (ctx->refused_tls && !ctx->ever_3270) {
 	    errmsg("Connection failed:\n"
 		    "Host requested TLS but TLS not supported");
 	}
-	refused_tls = false;
-	ever_3270 = false;
+	ctx->refused_tls = false;
+	ctx->ever_3270 = false;
     }
 }
 
@@ -476,18 +568,18 @@ setup_lus(char *luname, const char *assoc)
     int n_lus = 1;
     int i;
 
-    connected_lu = NULL;
-    connected_type = NULL;
-    curr_lu = NULL;
-    try_lu = NULL;
+    ctx->connected_lu = NULL;
+    ctx->connected_type = NULL;
+    ctx->curr_lu = NULL;
+    ctx->try_lu = NULL;
 
-    if (lus) {
-	Free(lus);
-	lus = NULL;
+    if (ctx->lus) {
+	Free(ctx->lus);
+	ctx->lus = NULL;
     }
 
     if (assoc != NULL) {
-	try_assoc = NewString(assoc);
+	ctx->try_assoc = NewString(assoc);
 	return;
     }
 
@@ -509,23 +601,23 @@ setup_lus(char *luname, const char *assoc)
      * Allocate enough memory to construct an argv[] array for
      * the LUs.
      */
-    lus = (char **)Malloc((n_lus+1) * sizeof(char *) + strlen(luname) + 1);
+    ctx->lus = (char **)Malloc((n_lus+1) * sizeof(char *) + strlen(luname) + 1);
 
     /* Copy each LU into the array. */
-    lu = (char *)(lus + n_lus + 1);
+    lu = (char *)(ctx->lus + n_lus + 1);
     strcpy(lu, luname);
     i = 0;
     do {
-	lus[i++] = lu;
+	ctx->lus[i++] = lu;
 	comma = strchr(lu, ',');
 	if (comma != NULL) {
 	    *comma = '\0';
 	    lu = comma + 1;
 	}
     } while (comma != NULL);
-    lus[i] = NULL;
-    curr_lu = lus;
-    try_lu = *curr_lu;
+    ctx->lus[i] = NULL;
+    ctx->curr_lu = ctx->lus;
+    ctx->try_lu = *ctx->curr_lu;
 }
 
 /*
@@ -540,31 +632,31 @@ net_input(socket_t s)
     register unsigned char *cp;
     ssize_t nr;
 
-    if (sio != NULL) {
-	nr = sio_read(sio, (char *)netrbuf, BUFSZ);
+    if (ctx->sio != NULL) {
+	nr = sio_read(ctx->sio, (char *)netrbuf, BUFSZ);
     } else {
 	nr = recv(s, (char *)netrbuf, BUFSZ, 0);
     }
     if (nr < 0) {
-	if ((sio != NULL && nr == SIO_EWOULDBLOCK) ||
-	    (sio == NULL && socket_errno() == SE_EWOULDBLOCK)) {
+	if ((ctx->sio != NULL && nr == SIO_EWOULDBLOCK) ||
+	    (ctx->sio == NULL && socket_errno() == SE_EWOULDBLOCK)) {
 	    vtrace("EWOULDBLOCK\n");
 	    return true;
 	}
-	if (sio != NULL) {
+	if (ctx->sio != NULL) {
 	    vtrace("RCVD sio error %s\n", sio_last_error());
 	    errmsg("%s\n", sio_last_error());
-	    cstate = NOT_CONNECTED;
+	    ctx->cstate = NOT_CONNECTED;
 	    return false;
 	}
 	vtrace("RCVD socket error %s\n", sockerrmsg());
 	popup_a_sockerr("Socket read");
-	cstate = NOT_CONNECTED;
+	ctx->cstate = NOT_CONNECTED;
 	return false;
     } else if (nr == 0) {
 	/* Host disconnected. */
 	trace_str("RCVD disconnect\n");
-	cstate = NOT_CONNECTED;
+	ctx->cstate = NOT_CONNECTED;
 	return true;
     }
 
@@ -574,7 +666,7 @@ net_input(socket_t s)
     ns_brcvd += nr;
     for (cp = netrbuf; cp < (netrbuf + nr); cp++) {
 	if (!telnet_fsm(*cp)) {
-	    cstate = NOT_CONNECTED;
+	    ctx->cstate = NOT_CONNECTED;
 	    return false;
 	}
     }
@@ -585,8 +677,8 @@ net_input(socket_t s)
 static void
 next_lu(void)
 {
-    if (curr_lu != NULL && (try_lu = *++curr_lu) == NULL) {
-	curr_lu = NULL;
+    if (ctx->curr_lu != NULL && (ctx->try_lu = *++ctx->curr_lu) == NULL) {
+	ctx->curr_lu = NULL;
     }
 }
 
@@ -598,10 +690,10 @@ next_lu(void)
 static bool
 telnet_fsm(unsigned char c)
 {
-    switch (telnet_state) {
+    switch (ctx->telnet_state) {
     case TNS_DATA:	/* normal data processing */
 	if (c == IAC) {	/* got a telnet command */
-	    telnet_state = TNS_IAC;
+	    ctx->telnet_state = TNS_IAC;
 	    break;
 	}
 	if (IN_NVT && !IN_E) {
@@ -622,45 +714,45 @@ telnet_fsm(unsigned char c)
 	    } else {
 		store3270in(c);
 	    }
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case EOR:	/* eor, process accumulated input */
 	    trace_str("RCVD EOR");
-	    if (IN_3270 || (IN_E && tn3270e_negotiated)) {
+	    if (IN_3270 || (IN_E && ctx->tn3270e_negotiated)) {
 		trace_str("\n");
 		ns_rrcvd++;
 		process_eor();
 	    } else {
 		trace_str(" (ignored -- not in 3270 mode)\n");
 	    }
-	    ibptr = ibuf;
-	    telnet_state = TNS_DATA;
+	    ctx->ibptr = ctx->ibuf;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case WILL:
-	    telnet_state = TNS_WILL;
+	    ctx->telnet_state = TNS_WILL;
 	    break;
 	case WONT:
-	    telnet_state = TNS_WONT;
+	    ctx->telnet_state = TNS_WONT;
 	    break;
 	case DO:
-	    telnet_state = TNS_DO;
+	    ctx->telnet_state = TNS_DO;
 	    break;
 	case DONT:
-	    telnet_state = TNS_DONT;
+	    ctx->telnet_state = TNS_DONT;
 	    break;
 	case SB:
-	    telnet_state = TNS_SB;
-	    if (sbbuf == NULL) {
-		sbbuf = (unsigned char *)Malloc(1024);
+	    ctx->telnet_state = TNS_SB;
+	    if (ctx->sbbuf == NULL) {
+		ctx->sbbuf = (unsigned char *)Malloc(1024);
 	    }
-	    sbptr = sbbuf;
+	    ctx->sbptr = ctx->sbbuf;
 	    break;
 	case DM:
 	    trace_str("\n");
-	    if (syncing) {
-		syncing = 0;
+	    if (ctx->syncing) {
+		ctx->syncing = 0;
 	    }
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case AO:
 	    if (IN_3270 && !IN_E) {
@@ -671,17 +763,17 @@ telnet_fsm(unsigned char c)
 	    } else {
 		trace_str(" (ignored -- not in TN3270 mode)\n");
 	    }
-	    ibptr = ibuf;
-	    telnet_state = TNS_DATA;
+	    ctx->ibptr = ctx->ibuf;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case GA:
 	case NOP:
 	    trace_str("\n");
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	default:
 	    trace_str(" (ignored -- unsupported)\n");
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	}
 	break;
@@ -694,15 +786,15 @@ telnet_fsm(unsigned char c)
 	    case TELOPT_TTYPE:
 	    case TELOPT_ECHO:
 	    case TELOPT_TN3270E:
-		if (!hisopts[c]) {
-		    hisopts[c] = 1;
+		if (!ctx->hisopts[c]) {
+		    ctx->hisopts[c] = 1;
 		    do_opt[2] = c;
 		    net_rawout(do_opt, sizeof(do_opt));
 		    vtrace("SENT %s %s\n", cmd(DO), opt(c));
 
 		    /* For UTS, volunteer to do EOR when they do. */
-		    if (c == TELOPT_EOR && !myopts[c]) {
-			myopts[c] = 1;
+		    if (c == TELOPT_EOR && !ctx->myopts[c]) {
+			ctx->myopts[c] = 1;
 			will_opt[2] = c;
 			net_rawout(will_opt, sizeof(will_opt));
 			vtrace("SENT %s %s\n", cmd(WILL), opt(c));
@@ -717,18 +809,18 @@ telnet_fsm(unsigned char c)
 		vtrace("SENT %s %s\n", cmd(DONT), opt(c));
 		break;
 	    }
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case TNS_WONT:	/* telnet WONT DO OPTION command */
 	    vtrace("%s\n", opt(c));
-	    if (hisopts[c]) {
-		hisopts[c] = 0;
+	    if (ctx->hisopts[c]) {
+		ctx->hisopts[c] = 0;
 		dont_opt[2] = c;
 		net_rawout(dont_opt, sizeof(dont_opt));
 		vtrace("SENT %s %s\n", cmd(DONT), opt(c));
 		check_in3270();
 	    }
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case TNS_DO:	/* telnet PLEASE DO OPTION command */
 	    vtrace("%s\n", opt(c));
@@ -741,12 +833,12 @@ telnet_fsm(unsigned char c)
 	    case TELOPT_TN3270E:
 	    case TELOPT_STARTTLS:
 		if (c == TELOPT_STARTTLS && !sio_supported()) {
-		    refused_tls = true;
+		    ctx->refused_tls = true;
 		    goto wont;
 		}
-		if (!myopts[c]) {
+		if (!ctx->myopts[c]) {
 		    if (c != TELOPT_TM) {
-			myopts[c] = 1;
+			ctx->myopts[c] = 1;
 		    }
 		    will_opt[2] = c;
 		    net_rawout(will_opt, sizeof(will_opt));
@@ -767,7 +859,7 @@ telnet_fsm(unsigned char c)
 			    cmd(SB),
 			    opt(TELOPT_STARTTLS),
 			    cmd(SE));
-		    need_tls_follows = true;
+		    ctx->need_tls_follows = true;
 		}
 		break;
 	    wont:
@@ -777,50 +869,50 @@ telnet_fsm(unsigned char c)
 		vtrace("SENT %s %s\n", cmd(WONT), opt(c));
 		break;
 	    }
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case TNS_DONT:	/* telnet PLEASE DON'T DO OPTION command */
 	    vtrace("%s\n", opt(c));
-	    if (myopts[c]) {
-		myopts[c] = 0;
+	    if (ctx->myopts[c]) {
+		ctx->myopts[c] = 0;
 		wont_opt[2] = c;
 		net_rawout(wont_opt, sizeof(wont_opt));
 		vtrace("SENT %s %s\n", cmd(WONT), opt(c));
 		check_in3270();
 	    }
-	    telnet_state = TNS_DATA;
+	    ctx->telnet_state = TNS_DATA;
 	    break;
 	case TNS_SB:	/* telnet sub-option string command */
 	    if (c == IAC) {
-		telnet_state = TNS_SB_IAC;
+		ctx->telnet_state = TNS_SB_IAC;
 	    } else {
-		*sbptr++ = c;
+		*ctx->sbptr++ = c;
 	    }
 	    break;
 	case TNS_SB_IAC:	/* telnet sub-option string command */
-	    *sbptr++ = c;
+	    *ctx->sbptr++ = c;
 	    if (c == SE) {
-		telnet_state = TNS_DATA;
-		if (sbbuf[0] == TELOPT_TTYPE &&
-		    sbbuf[1] == TELQUAL_SEND) {
+		ctx->telnet_state = TNS_DATA;
+		if (ctx->sbbuf[0] == TELOPT_TTYPE &&
+		    ctx->sbbuf[1] == TELQUAL_SEND) {
 		    size_t tt_len, tb_len;
 		    char *tt_out;
 
-		    vtrace("%s %s\n", opt(sbbuf[0]), telquals[sbbuf[1]]);
+		    vtrace("%s %s\n", opt(ctx->sbbuf[0]), telquals[ctx->sbbuf[1]]);
 
-		    if (lus != NULL &&
-			try_assoc == NULL &&
-			try_lu == NULL) {
+		    if (ctx->lus != NULL &&
+			ctx->try_assoc == NULL &&
+			ctx->try_lu == NULL) {
 			/* None of the LUs worked. */
 			errmsg("Cannot connect to specified LU");
 			return false;
 		    }
 		    tt_len = strlen(termtype);
-		    if (try_lu != NULL && *try_lu) {
-			tt_len += strlen(try_lu) + 1;
-			connected_lu = try_lu;
+		    if (ctx->try_lu != NULL && *ctx->try_lu) {
+			tt_len += strlen(ctx->try_lu) + 1;
+			ctx->connected_lu = ctx->try_lu;
 		    } else {
-			connected_lu = NULL;
+			ctx->connected_lu = NULL;
 		    }
 
 		    tb_len = 4 + tt_len + 2;
@@ -828,8 +920,8 @@ telnet_fsm(unsigned char c)
 		    sprintf(tt_out, "%c%c%c%c%s%s%s%c%c",
 			    IAC, SB, TELOPT_TTYPE, TELQUAL_IS,
 			    termtype,
-			    (try_lu != NULL && *try_lu) ? "@" : "",
-			    (try_lu != NULL && *try_lu) ? try_lu : "",
+			    (ctx->try_lu != NULL && *ctx->try_lu) ? "@" : "",
+			    (ctx->try_lu != NULL && *ctx->try_lu) ? ctx->try_lu : "",
 			    IAC, SE);
 		    net_rawout((unsigned char *)tt_out, tb_len);
 
@@ -842,20 +934,20 @@ telnet_fsm(unsigned char c)
 
 		    /* Advance to the next LU name. */
 		    next_lu();
-		} else if (myopts[TELOPT_TN3270E] &&
-			   sbbuf[0] == TELOPT_TN3270E) {
+		} else if (ctx->myopts[TELOPT_TN3270E] &&
+			   ctx->sbbuf[0] == TELOPT_TN3270E) {
 		    if (tn3270e_negotiate()) {
 			return false;
 		    }
-		} else if (need_tls_follows &&
-				myopts[TELOPT_STARTTLS] &&
-				sbbuf[0] == TELOPT_STARTTLS) {
-		    if (continue_tls(sbbuf, (int)(sbptr - sbbuf)) < 0) {
+		} else if (ctx->need_tls_follows &&
+				ctx->myopts[TELOPT_STARTTLS] &&
+				ctx->sbbuf[0] == TELOPT_STARTTLS) {
+		    if (continue_tls(ctx->sbbuf, (int)(ctx->sbptr - ctx->sbbuf)) < 0) {
 			return false;
 		    }
 		}
 	    } else {
-		telnet_state = TNS_SB;
+		ctx->telnet_state = TNS_SB;
 	    }
 	    break;
     }
@@ -872,10 +964,10 @@ tn3270e_request(void)
     char *t;
 
     tt_len = strlen(termtype);
-    if (try_assoc != NULL) {
-	tt_len += strlen(try_assoc) + 1;
-    } else if (try_lu != NULL && *try_lu) {
-	tt_len += strlen(try_lu) + 1;
+    if (ctx->try_assoc != NULL) {
+	tt_len += strlen(ctx->try_assoc) + 1;
+    } else if (ctx->try_lu != NULL && *ctx->try_lu) {
+	tt_len += strlen(ctx->try_lu) + 1;
     }
 
     tb_len = 5 + tt_len + 2;
@@ -885,10 +977,10 @@ tn3270e_request(void)
 	    IAC, SB, TELOPT_TN3270E, TN3270E_OP_DEVICE_TYPE,
 	    TN3270E_OP_REQUEST, termtype);
 
-    if (try_assoc != NULL) {
-	t += sprintf(t, "%c%s", TN3270E_OP_ASSOCIATE, try_assoc);
-    } else if (try_lu != NULL && *try_lu) {
-	t += sprintf(t, "%c%s", TN3270E_OP_CONNECT, try_lu);
+    if (ctx->try_assoc != NULL) {
+	t += sprintf(t, "%c%s", TN3270E_OP_ASSOCIATE, ctx->try_assoc);
+    } else if (ctx->try_lu != NULL && *ctx->try_lu) {
+	t += sprintf(t, "%c%s", TN3270E_OP_CONNECT, ctx->try_lu);
     }
 
     sprintf(t, "%c%c", IAC, SE);
@@ -897,10 +989,10 @@ tn3270e_request(void)
 
     vtrace("SENT %s %s DEVICE-TYPE REQUEST %.*s%s%s%s%s %s\n",
 	    cmd(SB), opt(TELOPT_TN3270E), strlen(termtype), tt_out + 5,
-	    (try_assoc != NULL) ? " ASSOCIATE " : "",
-	    (try_assoc != NULL) ? try_assoc : "",
-	    (try_lu != NULL && *try_lu) ? " CONNECT " : "",
-	    (try_lu != NULL && *try_lu) ? try_lu : "",
+	    (ctx->try_assoc != NULL) ? " ASSOCIATE " : "",
+	    (ctx->try_assoc != NULL) ? ctx->try_assoc : "",
+	    (ctx->try_lu != NULL && *ctx->try_lu) ? " CONNECT " : "",
+	    (ctx->try_lu != NULL && *ctx->try_lu) ? ctx->try_lu : "",
 	    cmd(SE));
 
     Free(tt_out);
@@ -913,33 +1005,30 @@ tn3270e_request(void)
 static int
 tn3270e_negotiate(void)
 {
-#define LU_MAX	32
-    static char reported_lu[LU_MAX + 1];
-    static char reported_type[LU_MAX + 1];
     int sblen;
     unsigned long e_rcvd;
 
     /* Find out how long the subnegotiation buffer is. */
     for (sblen = 0; ; sblen++) {
-	if (sbbuf[sblen] == SE) {
+	if (ctx->sbbuf[sblen] == SE) {
 	    break;
 	}
     }
 
     vtrace("TN3270E ");
 
-    switch (sbbuf[1]) {
+    switch (ctx->sbbuf[1]) {
 
     case TN3270E_OP_SEND:
 
-	if (sbbuf[2] == TN3270E_OP_DEVICE_TYPE) {
+	if (ctx->sbbuf[2] == TN3270E_OP_DEVICE_TYPE) {
 
 	    /* Host wants us to send our device type. */
 	    vtrace("SEND DEVICE-TYPE SE\n");
 
 	    tn3270e_request();
 	} else {
-	    vtrace("SEND ??%u SE\n", sbbuf[2]);
+	    vtrace("SEND ??%u SE\n", ctx->sbbuf[2]);
 	}
 	break;
 
@@ -948,7 +1037,7 @@ tn3270e_negotiate(void)
 	/* Device type negotiation. */
 	vtrace("DEVICE-TYPE ");
 
-	switch (sbbuf[2]) {
+	switch (ctx->sbbuf[2]) {
 	case TN3270E_OP_IS: {
 	    int tnlen, snlen;
 
@@ -956,40 +1045,40 @@ tn3270e_negotiate(void)
 
 	    /* Isolate the terminal type and session. */
 	    tnlen = 0;
-	    while (sbbuf[3 + tnlen] != SE &&
-		   sbbuf[3 + tnlen] != TN3270E_OP_CONNECT) {
+	    while (ctx->sbbuf[3 + tnlen] != SE &&
+		   ctx->sbbuf[3 + tnlen] != TN3270E_OP_CONNECT) {
 		tnlen++;
 	    }
 	    snlen = 0;
-	    if (sbbuf[3 + tnlen] == TN3270E_OP_CONNECT) {
-		while(sbbuf[3 + tnlen+1+snlen] != SE) {
+	    if (ctx->sbbuf[3 + tnlen] == TN3270E_OP_CONNECT) {
+		while(ctx->sbbuf[3 + tnlen+1+snlen] != SE) {
 		    snlen++;
 		}
 	    }
 	    vtrace("IS %.*s CONNECT %.*s SE\n",
-		    tnlen, &sbbuf[3],
-		    snlen, &sbbuf[3 + tnlen+1]);
+		    tnlen, &ctx->sbbuf[3],
+		    snlen, &ctx->sbbuf[3 + tnlen+1]);
 
 	    /* Remember the LU. */
 	    if (tnlen) {
 		if (tnlen > LU_MAX) {
 		    tnlen = LU_MAX;
 		}
-		strncpy(reported_type, (char *)&sbbuf[3], tnlen);
-		    reported_type[tnlen] = '\0';
-		    connected_type = reported_type;
+		strncpy(ctx->reported_type, (char *)&ctx->sbbuf[3], tnlen);
+		    ctx->reported_type[tnlen] = '\0';
+		    ctx->connected_type = ctx->reported_type;
 	    }
 	    if (snlen) {
 		if (snlen > LU_MAX) {
 		    snlen = LU_MAX;
 		}
-		strncpy(reported_lu, (char *)&sbbuf[3 + tnlen + 1], snlen);
-		reported_lu[snlen] = '\0';
-		connected_lu = reported_lu;
+		strncpy(ctx->reported_lu, (char *)&ctx->sbbuf[3 + tnlen + 1], snlen);
+		ctx->reported_lu[snlen] = '\0';
+		ctx->connected_lu = ctx->reported_lu;
 	    }
 
 	    /* Tell them what we can do. */
-	    tn3270e_subneg_send(TN3270E_OP_REQUEST, e_funcs);
+	    tn3270e_subneg_send(TN3270E_OP_REQUEST, ctx->e_funcs);
 	    break;
 	    }
 
@@ -997,29 +1086,29 @@ tn3270e_negotiate(void)
 
 	    /* Device type failure. */
 
-	    vtrace("REJECT REASON %s SE\n", rsn(sbbuf[4]));
+	    vtrace("REJECT REASON %s SE\n", rsn(ctx->sbbuf[4]));
 
-	    if (try_assoc != NULL) {
-		errmsg("Cannot associate with specified LU: %s", rsn(sbbuf[4]));
+	    if (ctx->try_assoc != NULL) {
+		errmsg("Cannot associate with specified LU: %s", rsn(ctx->sbbuf[4]));
 		return -1;
 	    }
 	    next_lu();
-	    if (try_lu != NULL) {
+	    if (ctx->try_lu != NULL) {
 		/* Try the next LU. */
 		tn3270e_request();
-	    } else if (lus != NULL) {
+	    } else if (ctx->lus != NULL) {
 		/* No more LUs to try.  Give up. */
-		errmsg("Cannot connect to specified LU: %s", rsn(sbbuf[4]));
+		errmsg("Cannot connect to specified LU: %s", rsn(ctx->sbbuf[4]));
 		return -1;
 	    } else {
 		errmsg("Device type rejected, cannot connect: %s",
-			rsn(sbbuf[4]));
+			rsn(ctx->sbbuf[4]));
 		return -1;
 	    }
 
 	    break;
 	default:
-	    vtrace("??%u SE\n", sbbuf[2]);
+	    vtrace("??%u SE\n", ctx->sbbuf[2]);
 	    break;
 	}
 	break;
@@ -1029,20 +1118,20 @@ tn3270e_negotiate(void)
 	/* Functions negotiation. */
 	vtrace("FUNCTIONS ");
 
-	switch (sbbuf[2]) {
+	switch (ctx->sbbuf[2]) {
 
 	case TN3270E_OP_REQUEST:
 
 	    /* Host is telling us what functions they want. */
 	    vtrace("REQUEST %s SE\n",
-		    tn3270e_function_names(sbbuf + 3, sblen - 3));
+		    tn3270e_function_names(ctx->sbbuf + 3, sblen - 3));
 
-	    e_rcvd = tn3270e_fdecode(sbbuf + 3, sblen - 3);
-	    if ((e_rcvd == e_funcs) || (e_funcs & ~e_rcvd)) {
+	    e_rcvd = tn3270e_fdecode(ctx->sbbuf + 3, sblen - 3);
+	    if ((e_rcvd == ctx->e_funcs) || (ctx->e_funcs & ~e_rcvd)) {
 		/* They want what we want, or less.  Done. */
-		e_funcs = e_rcvd;
-		tn3270e_subneg_send(TN3270E_OP_IS, e_funcs);
-		tn3270e_negotiated = 1;
+		ctx->e_funcs = e_rcvd;
+		tn3270e_subneg_send(TN3270E_OP_IS, ctx->e_funcs);
+		ctx->tn3270e_negotiated = 1;
 		vtrace("TN3270E option negotiation complete.\n");
 		check_in3270();
 	    } else {
@@ -1050,20 +1139,20 @@ tn3270e_negotiate(void)
 		 * They want us to do something we can't.
 		 * Request the common subset.
 		 */
-		e_funcs &= e_rcvd;
-		tn3270e_subneg_send(TN3270E_OP_REQUEST, e_funcs);
+		ctx->e_funcs &= e_rcvd;
+		tn3270e_subneg_send(TN3270E_OP_REQUEST, ctx->e_funcs);
 	    }
 	    break;
 
 	case TN3270E_OP_IS:
 
 	    /* They accept our last request. */
-	    vtrace("IS %s SE\n", tn3270e_function_names(sbbuf + 3, sblen - 3));
-	    e_rcvd = tn3270e_fdecode(sbbuf + 3, sblen - 3);
-	    if (e_rcvd != e_funcs) {
-		if (e_funcs & ~e_rcvd) {
+	    vtrace("IS %s SE\n", tn3270e_function_names(ctx->sbbuf + 3, sblen - 3));
+	    e_rcvd = tn3270e_fdecode(ctx->sbbuf + 3, sblen - 3);
+	    if (e_rcvd != ctx->e_funcs) {
+		if (ctx->e_funcs & ~e_rcvd) {
 		    /* They've removed something.  Fine. */
-		    e_funcs &= e_rcvd;
+		    ctx->e_funcs &= e_rcvd;
 		} else {
 		    /*
 		     * They've added something.  Abandon
@@ -1074,24 +1163,24 @@ tn3270e_negotiate(void)
 		    wont_opt[2] = TELOPT_TN3270E;
 		    net_rawout(wont_opt, sizeof(wont_opt));
 		    vtrace("SENT %s %s\n", cmd(WONT), opt(TELOPT_TN3270E));
-		    myopts[TELOPT_TN3270E] = 0;
+		    ctx->myopts[TELOPT_TN3270E] = 0;
 		    check_in3270();
 		    break;
 		}
 	    }
-	    tn3270e_negotiated = 1;
+	    ctx->tn3270e_negotiated = 1;
 	    vtrace("TN3270E option negotiation complete.\n");
 	    check_in3270();
 	    break;
 
 	default:
-	    vtrace("??%u SE\n", sbbuf[2]);
+	    vtrace("??%u SE\n", ctx->sbbuf[2]);
 	    break;
 	}
 	break;
 
     default:
-	vtrace("??%u SE\n", sbbuf[1]);
+	vtrace("??%u SE\n", ctx->sbbuf[1]);
     }
 
     /* Good enough for now. */
@@ -1167,12 +1256,12 @@ process_eor(void)
 {
     enum pds rv;
 
-    if (syncing || !(ibptr - ibuf)) {
+    if (ctx->syncing || !(ctx->ibptr - ctx->ibuf)) {
 	return;
     }
 
     if (IN_E) {
-	tn3270e_header *h = (tn3270e_header *)ibuf;
+	tn3270e_header *h = (tn3270e_header *)ctx->ibuf;
 
 	vtrace("RCVD TN3270E(%s%s %s %u)\n",
 		e_dt(h->data_type),
@@ -1183,42 +1272,42 @@ process_eor(void)
 	switch (h->data_type) {
 	case TN3270E_DT_3270_DATA:
 	case TN3270E_DT_SCS_DATA:
-	    if ((e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE)) && !tn3270e_bound) {
+	    if ((ctx->e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE)) && !ctx->tn3270e_bound) {
 		return;
 	    }
-	    tn3270e_submode = E_3270;
+	    ctx->tn3270e_submode = E_3270;
 	    check_in3270();
-	    response_required = h->response_flag;
+	    ctx->response_required = h->response_flag;
 	    if (h->data_type == TN3270E_DT_3270_DATA) {
-		rv = process_ds(ibuf + EH_SIZE, (ibptr - ibuf) - EH_SIZE);
+		rv = process_ds(ctx->ibuf + EH_SIZE, (ctx->ibptr - ctx->ibuf) - EH_SIZE);
 	    } else {
-		rv = process_scs(ibuf + EH_SIZE, (ibptr - ibuf) - EH_SIZE);
+		rv = process_scs(ctx->ibuf + EH_SIZE, (ctx->ibptr - ctx->ibuf) - EH_SIZE);
 	    }
-	    if (rv < 0 && response_required != TN3270E_RSF_NO_RESPONSE) {
+	    if (rv < 0 && ctx->response_required != TN3270E_RSF_NO_RESPONSE) {
 		tn3270e_nak(rv);
 	    } else if (rv == PDS_OKAY_NO_OUTPUT &&
-		    response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
+		    ctx->response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
 		tn3270e_ack();
 	    }
-	    response_required = TN3270E_RSF_NO_RESPONSE;
+	    ctx->response_required = TN3270E_RSF_NO_RESPONSE;
 	    return;
 	case TN3270E_DT_BIND_IMAGE:
-	    if (!(e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
+	    if (!(ctx->e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
 		return;
 	    }
-	    tn3270e_bound = 1;
+	    ctx->tn3270e_bound = 1;
 	    check_in3270();
 	    if (h->response_flag) {
 		tn3270e_ack();
 	    }
 	    return;
 	case TN3270E_DT_UNBIND:
-	    if (!(e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
+	    if (!(ctx->e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
 		return;
 	    }
-	    tn3270e_bound = 0;
-	    if (tn3270e_submode == E_3270) {
-		tn3270e_submode = E_NONE;
+	    ctx->tn3270e_bound = 0;
+	    if (ctx->tn3270e_submode == E_3270) {
+		ctx->tn3270e_submode = E_NONE;
 	    }
 	    check_in3270();
 	    if (print_eoj() == 0) {
@@ -1261,7 +1350,7 @@ process_eor(void)
 	}
     } else {
 	/* Plain old 3270 mode. */
-	rv = process_ds(ibuf, ibptr - ibuf);
+	rv = process_ds(ctx->ibuf, ctx->ibptr - ctx->ibuf);
 	if (rv < 0) {
 	    tn3270_nak(rv);
 	} else {
@@ -1279,8 +1368,8 @@ void
 net_exception(void)
 {
     trace_str("RCVD urgent data indication\n");
-    if (!syncing) {
-	syncing = 1;
+    if (!ctx->syncing) {
+	ctx->syncing = 1;
     }
 }
 
@@ -1316,27 +1405,27 @@ net_rawout(unsigned const char *buf, size_t len)
 #else
 #	define n2w len
 #endif
-	if (sio != NULL) {
-	    nw = sio_write(sio, (const char *)buf, (int)n2w);
+	if (ctx->sio != NULL) {
+	    nw = sio_write(ctx->sio, (const char *)buf, (int)n2w);
 	} else {
-	    nw = send(sock, (const char *) buf, (int)n2w, 0);
+	    nw = send(ctx->sock, (const char *) buf, (int)n2w, 0);
 	}
 	if (nw < 0) {
-	    if (sio != NULL) {
+	    if (ctx->sio != NULL) {
 		vtrace("RCVD socket error: %s\n", sio_last_error());
 		errmsg("%s\n", sio_last_error());
-		cstate = NOT_CONNECTED;
+		ctx->cstate = NOT_CONNECTED;
 		return;
 	    }
 	    vtrace("RCVD socket error %s\n", sockerrmsg());
 	    if (socket_errno() == SE_EPIPE || socket_errno() == SE_ECONNRESET) {
-		cstate = NOT_CONNECTED;
+		ctx->cstate = NOT_CONNECTED;
 		return;
 	    } else if (socket_errno() == SE_EINTR) {
 		goto bot;
 	    } else {
 		popup_a_sockerr("Socket write");
-		cstate = NOT_CONNECTED;
+		ctx->cstate = NOT_CONNECTED;
 		return;
 	    }
 	}
@@ -1373,11 +1462,11 @@ check_in3270(void)
 	"TN3270E 3270"
     };
 
-    if (myopts[TELOPT_TN3270E]) {
-	if (!tn3270e_negotiated) {
+    if (ctx->myopts[TELOPT_TN3270E]) {
+	if (!ctx->tn3270e_negotiated) {
 	    new_cstate = CONNECTED_INITIAL_E;
 	} else {
-	    switch (tn3270e_submode) {
+	    switch (ctx->tn3270e_submode) {
 	    case E_NONE:
 		new_cstate = CONNECTED_INITIAL_E;
 		break;
@@ -1386,39 +1475,39 @@ check_in3270(void)
 		break;
 	    case E_3270:
 		new_cstate = CONNECTED_TN3270E;
-		ever_3270 = true;
+		ctx->ever_3270 = true;
 		break;
 	    case E_SSCP:
 		new_cstate = CONNECTED_SSCP;
 		break;
 	    }
 	}
-    } else if (myopts[TELOPT_BINARY] &&
-	       myopts[TELOPT_EOR] &&
-	       myopts[TELOPT_TTYPE] &&
-	       hisopts[TELOPT_BINARY] &&
-	       hisopts[TELOPT_EOR]) {
+    } else if (ctx->myopts[TELOPT_BINARY] &&
+	       ctx->myopts[TELOPT_EOR] &&
+	       ctx->myopts[TELOPT_TTYPE] &&
+	       ctx->hisopts[TELOPT_BINARY] &&
+	       ctx->hisopts[TELOPT_EOR]) {
 	new_cstate = CONNECTED_3270;
-	ever_3270 = true;
-    } else if (cstate == CONNECTED_INITIAL) {
+	ctx->ever_3270 = true;
+    } else if (ctx->cstate == CONNECTED_INITIAL) {
 	/* Nothing has happened, yet. */
 	return;
     } else {
 	new_cstate = CONNECTED_NVT;
     }
 
-    if (new_cstate != cstate) {
+    if (new_cstate != ctx->cstate) {
 	int was_in_e = IN_E;
 
 	vtrace("Now operating in %s mode.\n", state_name[new_cstate]);
-	cstate =  new_cstate;
+	ctx->cstate =  new_cstate;
 
 	/*
 	 * If the user specified an association, and the host has
 	 * entered TELNET NVT mode or TN3270 (non-TN3270E) mode,
 	 * give up.
 	 */
-	if (try_assoc != NULL && !IN_E) {
+	if (ctx->try_assoc != NULL && !IN_E) {
 	    errmsg("Host does not support TN3270E, cannot associate with "
 		    "specified LU");
 	    /* No return value, gotta abort here. */
@@ -1430,23 +1519,23 @@ check_in3270(void)
 	 * TN3270E state, reset the LU list so we can try again
 	 * in the new mode.
 	 */
-	if (lus != NULL && was_in_e != IN_E) {
-	    curr_lu = lus;
-	    try_lu = *curr_lu;
+	if (ctx->lus != NULL && was_in_e != IN_E) {
+	    ctx->curr_lu = ctx->lus;
+	    ctx->try_lu = *ctx->curr_lu;
 	}
 
 	/* Allocate the initial 3270 input buffer. */
-	if (new_cstate >= CONNECTED_INITIAL && !ibuf_size) {
-	    ibuf = (unsigned char *)Malloc(BUFSIZ);
-	    ibuf_size = BUFSIZ;
-	    ibptr = ibuf;
+	if (new_cstate >= CONNECTED_INITIAL && !ctx->ibuf_size) {
+	    ctx->ibuf = (unsigned char *)Malloc(BUFSIZ);
+	    ctx->ibuf_size = BUFSIZ;
+	    ctx->ibptr = ctx->ibuf;
 	}
 
 	/* If we fell out of TN3270E, remove the state. */
-	if (!myopts[TELOPT_TN3270E]) {
-	    tn3270e_negotiated = 0;
-	    tn3270e_submode = E_NONE;
-	    tn3270e_bound = 0;
+	if (!ctx->myopts[TELOPT_TN3270E]) {
+	    ctx->tn3270e_negotiated = 0;
+	    ctx->tn3270e_submode = E_NONE;
+	    ctx->tn3270e_bound = 0;
 	}
     }
 }
@@ -1459,12 +1548,12 @@ check_in3270(void)
 static void
 store3270in(unsigned char c)
 {
-    if (ibptr - ibuf >= ibuf_size) {
-	ibuf_size += BUFSIZ;
-	ibuf = (unsigned char *)Realloc((char *)ibuf, ibuf_size);
-	ibptr = ibuf + ibuf_size - BUFSIZ;
+    if (ctx->ibptr - ctx->ibuf >= ctx->ibuf_size) {
+	ctx->ibuf_size += BUFSIZ;
+	ctx->ibuf = (unsigned char *)Realloc((char *)ctx->ibuf, ctx->ibuf_size);
+	ctx->ibptr = ctx->ibuf + ctx->ibuf_size - BUFSIZ;
     }
-    *ibptr++ = c;
+    *ctx->ibptr++ = c;
 }
 
 /*
@@ -1585,9 +1674,9 @@ net_output(void)
 	tn3270e_header *h = (tn3270e_header *)obuf_base;
 
 	/* Check for sending a TN3270E response. */
-	if (response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
+	if (ctx->response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
 	    tn3270e_ack();
-	    response_required = TN3270E_RSF_NO_RESPONSE;
+	    ctx->response_required = TN3270E_RSF_NO_RESPONSE;
 	}
 
 	/* Set the outbound TN3270E header. */
@@ -1595,8 +1684,8 @@ net_output(void)
 		TN3270E_DT_3270_DATA : TN3270E_DT_SSCP_LU_DATA;
 	h->request_flag = 0;
 	h->response_flag = 0;
-	h->seq_number[0] = (e_xmit_seq >> 8) & 0xff;
-	h->seq_number[1] = e_xmit_seq & 0xff;
+	h->seq_number[0] = (ctx->e_xmit_seq >> 8) & 0xff;
+	h->seq_number[1] = ctx->e_xmit_seq & 0xff;
     }
 
     /* Count the number of IACs in the message. */
@@ -1634,9 +1723,9 @@ net_output(void)
     *obptr++ = EOR;
     if (IN_TN3270E || IN_SSCP) {
 	vtrace("SENT TN3270E(%s NO-RESPONSE %u)\n",
-		IN_TN3270E ? "3270-DATA" : "SSCP-LU-DATA", e_xmit_seq);
-	if (e_funcs & E_OPT(TN3270E_FUNC_RESPONSES)) {
-	    e_xmit_seq = (e_xmit_seq + 1) & 0x7fff;
+		IN_TN3270E ? "3270-DATA" : "SSCP-LU-DATA", ctx->e_xmit_seq);
+	if (ctx->e_funcs & E_OPT(TN3270E_FUNC_RESPONSES)) {
+	    ctx->e_xmit_seq = (ctx->e_xmit_seq + 1) & 0x7fff;
 	}
     }
     net_rawout(BSTART, obptr - BSTART);
@@ -1712,7 +1801,7 @@ tn3270e_ack(void)
     int rsp_len = EH_SIZE;
 
     h = (tn3270e_header *)rsp_buf;
-    h_in = (tn3270e_header *)ibuf;
+    h_in = (tn3270e_header *)ctx->ibuf;
 
     h->data_type = TN3270E_DT_RESPONSE;
     h->request_flag = 0;
@@ -1739,7 +1828,7 @@ tn3270e_nak(enum pds rv)
     int rsp_len = EH_SIZE;
 
     h = (tn3270e_header *)rsp_buf;
-    h_in = (tn3270e_header *)ibuf;
+    h_in = (tn3270e_header *)ctx->ibuf;
 
     h->data_type = TN3270E_DT_RESPONSE;
     h->request_flag = 0;
@@ -1790,18 +1879,18 @@ tn3270e_cleared(void)
     h->data_type = TN3270E_OP_REQUEST;
     h->request_flag = TN3270E_RQF_ERR_COND_CLEARED;
     h->response_flag = 0;
-    h->seq_number[0] = (e_xmit_seq >> 8) & 0xff;
-    h->seq_number[1] = e_xmit_seq & 0xff;
+    h->seq_number[0] = (ctx->e_xmit_seq >> 8) & 0xff;
+    h->seq_number[1] = ctx->e_xmit_seq & 0xff;
 
     if (h->seq_number[1] == IAC) {
 	rsp_buf[rsp_len++] = IAC;
     }
     rsp_buf[rsp_len++] = IAC;
     rsp_buf[rsp_len++] = EOR;
-    vtrace("SENT TN3270E(REQUEST ERR-COND-CLEARED %u)\n", e_xmit_seq);
+    vtrace("SENT TN3270E(REQUEST ERR-COND-CLEARED %u)\n", ctx->e_xmit_seq);
     net_rawout(rsp_buf, rsp_len);
 
-    e_xmit_seq = (e_xmit_seq + 1) & 0x7fff;
+    ctx->e_xmit_seq = (ctx->e_xmit_seq + 1) & 0x7fff;
 }
 
 /* Add a dummy TN3270E header to the output buffer. */
@@ -1810,14 +1899,14 @@ net_add_dummy_tn3270e(void)
 {
     tn3270e_header *h;
 
-    if (!IN_E || tn3270e_submode == E_NONE) {
+    if (!IN_E || ctx->tn3270e_submode == E_NONE) {
 	return false;
     }
 
     space3270out(EH_SIZE);
     h = (tn3270e_header *)obptr;
 
-    switch (tn3270e_submode) {
+    switch (ctx->tn3270e_submode) {
     case E_NONE:
 	break;
     case E_NVT:
@@ -1856,7 +1945,7 @@ continue_tls(unsigned char *sbbuf, int len)
     char *session, *cert;
 
     /* Whatever happens, we're not expecting another SB STARTTLS. */
-    need_tls_follows = false;
+    ctx->need_tls_follows = false;
 
     /* Make sure the option is FOLLOWS. */
     if (len < 2 || sbbuf[1] != TLS_FOLLOWS) {
@@ -1870,20 +1959,20 @@ continue_tls(unsigned char *sbbuf, int len)
     vtrace("%s FOLLOWS %s\n", opt(TELOPT_STARTTLS), cmd(SE));
 
     /* Initialize the TLS library. */
-    if (sio_init(&options.tls, NULL, &sio) != SI_SUCCESS) {
+    if (sio_init(&options.tls, NULL, &ctx->sio) != SI_SUCCESS) {
 	errmsg("%s\n", sio_last_error());
 	return -1;
     }
-    if (sio_negotiate(sio, sock, hostname, &data) != SIG_SUCCESS) {
+    if (sio_negotiate(ctx->sio, ctx->sock, ctx->hostname, &data) != SIG_SUCCESS) {
 	errmsg("%s\n", sio_last_error());
 	return -1;
     }
 
-    secure_connection = true;
+    ctx->secure_connection = true;
 
     /* Success. */
-    session = indent_s(sio_session_info(sio));
-    cert = indent_s(sio_server_cert_info(sio));
+    session = indent_s(sio_session_info(ctx->sio));
+    cert = indent_s(sio_server_cert_info(ctx->sio));
     vtrace("TLS negotiated connection complete.  "
 	      "Connection is now secure.\n"
 	      "Session:\n%s\nServer certificate:\n%s\n",
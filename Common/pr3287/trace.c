@@ -268,11 +268,44 @@ trace_pds(unsigned char *s)
     }
 }
 
-/* Trace a buffer full of data going to the raw print stream. */
+/*
+ * Trace a buffer full of data going to the raw print stream.
+ * The lines are formatted locally and written in large pieces, rather than
+ * with a printf per byte.
+ */
 void
-trace_pdb(unsigned char *s, size_t len)
+trace_pdb(const unsigned char *s, size_t len)
 {
+    static const char hex[] = "0123456789abcdef";
+    char obuf[4096];
+    size_t olen = 0;
+
+    if (tracef == NULL || len == 0) {
+	return;
+    }
+
+    clear_tmode(TM_PD);
+
     while (len-- > 0) {
-	trace_pdc(*s++);
+	if (!tscnt) {
+	    memcpy(obuf + olen, "<Print> ", 8);
+	    olen += 8;
+	    tscnt = 8;
+	}
+	obuf[olen++] = hex[*s >> 4];
+	obuf[olen++] = hex[*s++ & 0xf];
+	tscnt += 2;
+	if (tscnt >= PD_MAX) {
+	    obuf[olen++] = '\n';
+	    tscnt = 0;
+	    if (olen > sizeof(obuf) - (PD_MAX + 2)) {
+		fwrite(obuf, 1, olen, tracef);
+		olen = 0;
+	    }
+	}
+    }
+    if (olen) {
+	fwrite(obuf, 1, olen, tracef);
     }
+    tmode = tscnt? TM_PD: TM_BASE;
 }
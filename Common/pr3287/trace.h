@@ -43,7 +43,7 @@ const char *see_qcode(unsigned char id);
 void trace_ds(const char *fmt, ...);
 void vtrace(const char *fmt, ...);
 void vtrace_nts(const char *fmt, ...);
-void trace_pdb(unsigned char *buf, size_t len);
+void trace_pdb(const unsigned char *buf, size_t len);
 void trace_pdc(unsigned char c);
 void trace_pds(unsigned char *buf);
 const char *unknown(unsigned char value);
@@ -45,6 +45,7 @@
 
 #include "actions.h"
 #include "codepage.h"
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #include "names.h"
 #include "popups.h"
@@ -43,6 +43,7 @@
 #include "names.h"
 #include "popups.h"
 #include "query.h"
+#include "resolver.h"
 #include "split_host.h"
 #include "telnet.h"
 #include "task.h"
@@ -337,6 +338,7 @@ query_register(void)
 	{ KwModel, get_full_model, NULL, true, false },
 	{ KwPrefixes, host_prefixes, NULL, false, false },
 	{ KwProxy, get_proxy, NULL, false, false },
+	{ KwResolver, resolver_query_stats, NULL, false, true },
 	{ KwScreenCurSize, ctlr_query_cur_size_old, NULL, true, false },
 	{ KwScreenMaxSize, ctlr_query_max_size_old, NULL, true, false },
 	{ KwScreenSizeCurrent, ctlr_query_cur_size, NULL, false, false },
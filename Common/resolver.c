@@ -42,6 +42,7 @@
 #endif /*]*/
 
 #include <stdio.h>
+#include <time.h>
 #include "resolver.h"
 #include "txa.h"
 #include "utils.h"
@@ -54,14 +55,64 @@
 # define ASYNC_RESOLVER 1
 #endif /*]*/
 
+#define RESULT_MAX	16	/* maximum addresses kept per result */
+#define CACHE_MAX	64	/* maximum number of cached results */
+#define CACHE_TTL	300	/* seconds to cache a successful result */
+#define CACHE_NEG_TTL	30	/* seconds to cache a failed result */
+
+/* A resolution result. */
+typedef struct {
+    rhp_t rv;			/* status */
+    bool transient;		/* true if failure is temporary */
+    char *errmsg;		/* error message, if rv is an error */
+    unsigned short port;	/* port, if rv is success */
+    int naddr;			/* number of addresses */
+    struct sockaddr_storage addr[RESULT_MAX]; /* addresses */
+    socklen_t addr_len[RESULT_MAX]; /* address lengths */
+} result_t;
+
+/* A cached result. */
+typedef struct cache {
+    struct cache *next;		/* next entry, most recently used first */
+    char *host;			/* host name */
+    char *port;			/* port name, or NULL */
+    int family;			/* address family requested */
+    time_t expiry;		/* when the entry expires */
+    result_t result;		/* result */
+} cache_t;
+static cache_t *cache;
+static int cache_count;
+
+/* Statistics. */
+static struct {
+    unsigned long requests;	/* resolution requests */
+    unsigned long hits;		/* requests answered from the cache */
+    unsigned long negative_hits; /* requests answered with a cached failure */
+    unsigned long coalesced;	/* requests that waited for an identical one */
+    unsigned long lookups;	/* lookups actually done */
+    unsigned long failures;	/* lookups that failed */
+    unsigned long max_queued;	/* most requests ever queued at once */
+} stats;
+
 #if defined(ASYNC_RESOLVER) /*[*/
-# define GAI_SLOTS	10
+# define RESOLVER_WORKERS	4	/* maximum concurrent lookups */
+
+typedef enum {
+    GAI_FREE,			/* slot is free */
+    GAI_QUEUED,			/* waiting for a worker */
+    GAI_RUNNING,		/* lookup in progress */
+    GAI_DONE			/* result is ready */
+} gai_state_t;
+
 static struct gai {
-    bool busy;			/* true if busy */
-    bool done;			/* true if done */
+    gai_state_t state;		/* state */
+    int slot;			/* slot number */
+    int next;			/* next free or queued slot */
     int pipe;			/* pipe to write status into */
     char *host;			/* host name */
     char *port;			/* port name */
+    int family;			/* address family requested */
+    result_t result;		/* result, once done */
 # if !defined(_WIN32) /*[*/
     struct gaicb gaicb;		/* control block */
     struct gaicb *gaicbs;	/* control blocks (just one) */
@@ -69,10 +120,17 @@ static struct gai {
     struct addrinfo hints;	/* hints */
 # else /*][*/
     int rc;			/* return code */
-    struct addrinfo *result;	/* result */
+    struct addrinfo *ai_result;	/* result */
     HANDLE event;		/* event to signal */
 # endif /*]*/
-} gai[GAI_SLOTS];
+} **gai;
+static int gai_count;		/* number of slots allocated */
+static int gai_free = -1;	/* first free slot */
+static int gai_queue_head = -1;	/* first queued slot */
+static int gai_queue_tail = -1;	/* last queued slot */
+static int gai_queued;		/* number of queued slots */
+static int gai_running[RESOLVER_WORKERS]; /* running slots */
+static int gai_nrunning;	/* number of running slots */
 #endif /*]*/
 
 bool prefer_ipv4;
@@ -109,103 +167,352 @@ my_gai_strerror(int rc)
 # else /*][*/
 # define my_gai_strerror(x)	gai_strerror(x)
 # endif /*]*/
-/*
- * Resolve a hostname and port using getaddrinfo, allowing IPv4 or IPv6.
- * Synchronous version.
- */
-static rhp_t
-resolve_host_and_port_v46(const char *host, char *portname,
-	bool abs, unsigned short *pport, struct sockaddr *sa, size_t sa_len,
-	socklen_t *sa_rlen, char **errmsg, int max, int *nr)
-{
-    struct addrinfo hints, *res0, *res;
-    int rc;
-    int i;
-    void *rsa = sa;
-
-    *nr = 0;
 
-    /* getaddrinfo() does not appear to range-check the port. Do that here. */
-    if (portname != NULL) {
-	unsigned long l;
+/* getaddrinfo() does not appear to range-check the port. Do that here. */
+static bool
+bad_port(const char *host, const char *portname, char **errmsg)
+{
+    unsigned long l;
 
-	if ((l = strtoul(portname, NULL, 0)) && (l & ~0xffffL)) {
-	    if (errmsg) {
-		*errmsg = txAsprintf("%s/%s:\n%s", host, portname, "Invalid port");
-	    }
-	    return RHP_CANNOT_RESOLVE;
+    if (portname != NULL &&
+	    (l = strtoul(portname, NULL, 0)) && (l & ~0xffffL)) {
+	if (errmsg) {
+	    *errmsg = txAsprintf("%s/%s:\n%s", host, portname, "Invalid port");
 	}
+	return true;
     }
+    return false;
+}
 
-    memset(&hints, '\0', sizeof(struct addrinfo));
-    hints.ai_flags = 0;
-    hints.ai_family = abs? PF_UNSPEC: want_pf();
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-    rc = getaddrinfo(host, portname, &hints, &res0);
+/* Fill in a result from getaddrinfo(). */
+static void
+result_from_addrinfo(result_t *r, int rc, struct addrinfo *res0,
+	const char *host, const char *portname)
+{
+    struct addrinfo *res;
+
+    memset(r, 0, sizeof(result_t));
     if (rc != 0) {
-	if (errmsg) {
-	    *errmsg = txAsprintf("%s/%s:\n%s", host, portname? portname: "(none)",
-		    my_gai_strerror(rc));
-	}
-	return RHP_CANNOT_RESOLVE;
+	r->rv = RHP_CANNOT_RESOLVE;
+	r->errmsg = Asprintf("%s/%s:\n%s", host, portname? portname: "(none)",
+		my_gai_strerror(rc));
+	r->transient = rc == EAI_AGAIN || rc == EAI_MEMORY
+#if defined(EAI_SYSTEM) /*[*/
+	    || rc == EAI_SYSTEM
+#endif /*]*/
+	    ;
+	return;
     }
-    res = res0;
 
-    /* Return the addresses. */
-    for (i = 0; i < max && res != NULL; i++, res = res->ai_next) {
-	memcpy(rsa, res->ai_addr, res->ai_addrlen);
-	sa_rlen[*nr] = (socklen_t)res->ai_addrlen;
-	if (i == 0) {
+    for (res = res0; res != NULL && r->naddr < RESULT_MAX;
+	    res = res->ai_next) {
+	if (r->naddr == 0) {
 	    /* Return the port. */
 	    switch (res->ai_family) {
 	    case AF_INET:
-		*pport =
+		r->port =
 		    ntohs(((struct sockaddr_in *) res->ai_addr)->sin_port);
 		break;
 	    case AF_INET6:
-		*pport =
+		r->port =
 		    ntohs(((struct sockaddr_in6 *) res->ai_addr)->sin6_port);
 		break;
 	    default:
-		if (errmsg) {
-		    *errmsg = txAsprintf("%s:\nunknown family %d", host,
-			    res->ai_family);
-		}
-		freeaddrinfo(res0);
-		return RHP_FATAL;
+		r->rv = RHP_FATAL;
+		r->errmsg = Asprintf("%s:\nunknown family %d", host,
+			res->ai_family);
+		return;
 	    }
 	}
+	memcpy(&r->addr[r->naddr], res->ai_addr, res->ai_addrlen);
+	r->addr_len[r->naddr++] = (socklen_t)res->ai_addrlen;
+    }
 
-	rsa = (char *)rsa + sa_len;
-	(*nr)++;
+    if (r->naddr == 0) {
+	r->rv = RHP_CANNOT_RESOLVE;
+	r->errmsg = Asprintf("%s/%s:\n%s", host, portname? portname: "(none)",
+		"no suitable resolution");
+    } else {
+	r->rv = RHP_SUCCESS;
     }
+}
 
-    freeaddrinfo(res0);
+/* Copy a result out to the caller. */
+static rhp_t
+copy_result(const result_t *r, unsigned short *pport, struct sockaddr *sa,
+	size_t sa_len, socklen_t *sa_rlen, char **errmsg, int max, int *nr)
+{
+    int i;
+
+    *nr = 0;
+    if (RHP_IS_ERROR(r->rv)) {
+	if (errmsg) {
+	    *errmsg = txdFree(NewString(r->errmsg));
+	}
+	return r->rv;
+    }
+
+    for (i = 0; i < r->naddr && i < max; i++) {
+	memcpy((char *)sa + (i * sa_len), &r->addr[i], r->addr_len[i]);
+	sa_rlen[i] = r->addr_len[i];
+	(*nr)++;
+    }
+    *pport = r->port;
     return RHP_SUCCESS;
 }
 
+/* Free the storage in a result. */
+static void
+result_free(result_t *r)
+{
+    Replace(r->errmsg, NULL);
+}
+
+/* Free a cache entry. */
+static void
+cache_free(cache_t *c)
+{
+    Free(c->host);
+    Free(c->port);
+    result_free(&c->result);
+    Free(c);
+    cache_count--;
+}
+
+/* Check a cache entry for a match. */
+static bool
+cache_match(const cache_t *c, const char *host, const char *portname,
+	int family)
+{
+    return c->family == family && !strcmp(c->host, host) &&
+	((c->port == NULL && portname == NULL) ||
+	 (c->port != NULL && portname != NULL && !strcmp(c->port, portname)));
+}
+
+/*
+ * Look up a result in the cache, discarding expired entries along the way.
+ * A hit moves to the front of the list.
+ */
+static const result_t *
+cache_find(const char *host, const char *portname, int family)
+{
+    time_t now = time(NULL);
+    cache_t **pp = &cache;
+    cache_t *c;
+
+    while ((c = *pp) != NULL) {
+	if (c->expiry <= now) {
+	    *pp = c->next;
+	    cache_free(c);
+	    continue;
+	}
+	if (cache_match(c, host, portname, family)) {
+	    *pp = c->next;
+	    c->next = cache;
+	    cache = c;
+	    return &c->result;
+	}
+	pp = &c->next;
+    }
+    return NULL;
+}
+
+/* Count a cache hit. */
+static const result_t *
+cache_hit(const result_t *r)
+{
+    if (RHP_IS_ERROR(r->rv)) {
+	stats.negative_hits++;
+    } else {
+	stats.hits++;
+    }
+    return r;
+}
+
+/*
+ * Add a result to the cache, replacing any existing entry for the same
+ * request and trimming the least-recently used entries.
+ */
+static void
+cache_add(const char *host, const char *portname, int family,
+	const result_t *r)
+{
+    cache_t **pp = &cache;
+    cache_t *c;
+    int n = 0;
+
+    if (r->rv == RHP_FATAL || r->transient) {
+	return;
+    }
+
+    c = Malloc(sizeof(cache_t));
+    c->host = NewString(host);
+    c->port = portname? NewString(portname): NULL;
+    c->family = family;
+    c->expiry = time(NULL) + (RHP_IS_ERROR(r->rv)? CACHE_NEG_TTL: CACHE_TTL);
+    c->result = *r;
+    c->result.errmsg = r->errmsg? NewString(r->errmsg): NULL;
+    c->next = cache;
+    cache = c;
+    cache_count++;
+
+    pp = &c->next;
+    while ((c = *pp) != NULL) {
+	if (cache_match(c, host, portname, family) || ++n >= CACHE_MAX) {
+	    *pp = c->next;
+	    cache_free(c);
+	} else {
+	    pp = &c->next;
+	}
+    }
+}
+
+/**
+ * Mock the behavior of the synchronous resolver.
+ *
+ * @param[in] m		Mock definition
+ * @param[in] host	Host name
+ * @param[in] portname	Port name
+ * @param[out] r	Returned result
+ */
+static void
+mock_sync_resolver(const char *m, const char *host, char *portname,
+	result_t *r)
+{
+    /*
+     * m is a string that looks like:
+     *  address/port[;address/port...]
+     * address is a numeric IPv4 or IPv6 address
+     * port is a port name or number
+     */
+    char *mdup = NewString(m);
+    char *outer_saveptr = NULL, *inner_saveptr = NULL;
+    char *outer_chunk, *inner_chunk;
+    char *outer_str, *inner_str;
+    struct addrinfo hints;
+
+    memset(r, 0, sizeof(result_t));
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    hints.ai_family = PF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    outer_str = mdup;
+    while (r->naddr < RESULT_MAX &&
+	    (outer_chunk = strtok_r(outer_str, ";", &outer_saveptr)) != NULL) {
+	int np = 0;
+	char *inner[2];
+	struct addrinfo *res = NULL;
+
+	outer_str = NULL;
+	inner_str = outer_chunk;
+	while ((inner_chunk = strtok_r(inner_str, "/", &inner_saveptr))
+		!= NULL) {
+	    inner_str = NULL;
+	    assert(np < 2);
+	    inner[np++] = inner_chunk;
+	}
+	assert(np == 2);
+
+	assert(getaddrinfo(inner[0], inner[1], &hints, &res) == 0);
+	if (r->naddr == 0) {
+	    r->port = (res->ai_family == AF_INET6)?
+		ntohs(((struct sockaddr_in6 *)res->ai_addr)->sin6_port):
+		ntohs(((struct sockaddr_in *)res->ai_addr)->sin_port);
+	}
+	memcpy(&r->addr[r->naddr], res->ai_addr, res->ai_addrlen);
+	r->addr_len[r->naddr++] = (socklen_t)res->ai_addrlen;
+	freeaddrinfo(res);
+    }
+
+    Free(mdup);
+    r->rv = RHP_SUCCESS;
+}
+
+/* Do a synchronous lookup, or consult the mock resolver. */
+static void
+lookup(const char *host, char *portname, int family, const char *mock,
+	result_t *r)
+{
+    stats.lookups++;
+    if (mock != NULL) {
+	mock_sync_resolver(mock, host, portname, r);
+    } else {
+	struct addrinfo hints, *res0 = NULL;
+	int rc;
+
+	memset(&hints, '\0', sizeof(struct addrinfo));
+	hints.ai_flags = 0;
+	hints.ai_family = family;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	rc = getaddrinfo(host, portname, &hints, &res0);
+	result_from_addrinfo(r, rc, res0, host, portname);
+	if (res0 != NULL) {
+	    freeaddrinfo(res0);
+	}
+    }
+    if (RHP_IS_ERROR(r->rv)) {
+	stats.failures++;
+    }
+}
+
+/*
+ * Resolve a hostname and port using getaddrinfo, allowing IPv4 or IPv6.
+ * Synchronous version, using the cache.
+ */
+static rhp_t
+resolve_host_and_port_v46(const char *host, char *portname, int family,
+	const char *mock, unsigned short *pport, struct sockaddr *sa,
+	size_t sa_len, socklen_t *sa_rlen, char **errmsg, int max, int *nr)
+{
+    const result_t *cr;
+    result_t r;
+    rhp_t rv;
+
+    *nr = 0;
+    stats.requests++;
+    if (bad_port(host, portname, errmsg)) {
+	return RHP_CANNOT_RESOLVE;
+    }
+
+    if ((cr = cache_find(host, portname, family)) != NULL) {
+	return copy_result(cache_hit(cr), pport, sa, sa_len, sa_rlen, errmsg,
+		max, nr);
+    }
+
+    lookup(host, portname, family, mock, &r);
+    cache_add(host, portname, family, &r);
+    rv = copy_result(&r, pport, sa, sa_len, sa_rlen, errmsg, max, nr);
+    result_free(&r);
+    return rv;
+}
+
 #if defined(ASYNC_RESOLVER) /*[*/
 
-# if !defined(_WIN32) /*[*/
-/* Notification function for lookup completion. */
+/* Tell the owner of a slot that it is done. */
 static void
-gai_notify(union sigval sigval)
+gai_post(struct gai *gaip)
 {
-    char slot = (char)sigval.sival_int;
-    struct gai *gaip = &gai[(int)slot];
     ssize_t nw;
 
-    assert(gaip->busy == true);
-    assert(gaip->done == false);
-    gaip->done = true;
-
     /*
      * Write our slot number into the pipe, so the main thread can poll us for
      * the completion status.
      */
-    nw = write(gaip->pipe, &slot, 1);
-    assert(nw == 1);
+    nw = write(gaip->pipe, &gaip->slot, sizeof(gaip->slot));
+    assert(nw == sizeof(gaip->slot));
+# if defined(_WIN32) /*[*/
+    SetEvent(gaip->event);
+# endif /*]*/
+}
+
+# if !defined(_WIN32) /*[*/
+/* Notification function for lookup completion. */
+static void
+gai_notify(union sigval sigval)
+{
+    gai_post((struct gai *)sigval.sival_ptr);
 }
 
 # else /*][*/
@@ -215,29 +522,17 @@ static DWORD WINAPI
 async_resolve(LPVOID parameter)
 {
     struct gai *gaip = (struct gai *)parameter;
-    char slot = (char)(gaip - gai);
     struct addrinfo hints;
-    ssize_t nw;
 
-    assert(gaip->busy == true);
-    assert(gaip->done == false);
-    gaip->done = true;
     memset(&hints, '\0', sizeof(struct addrinfo));
     hints.ai_flags = 0;
-    hints.ai_family = want_pf();
+    hints.ai_family = gaip->family;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
-    gaip->rc = getaddrinfo(gaip->host, gaip->port, &hints, &gaip->result);
-
-    /*
-     * Write our slot number into the pipe, so the main thread can poll us for
-     * the completion status.
-     */
-    nw = write(gaip->pipe, &slot, 1);
-    assert(nw == 1);
+    gaip->rc = getaddrinfo(gaip->host, gaip->port, &hints, &gaip->ai_result);
 
     /* Tell the main thread we are done. */
-    SetEvent(gaip->event);
+    gai_post(gaip);
 
     /* Exit the thread. */
     return 0;
@@ -245,273 +540,330 @@ async_resolve(LPVOID parameter)
 
 # endif /*]*/
 
-/*
- * Clean up a partially-complete slot.
- */
-static void
-cleanup_partial_slot(int slot)
+/* Allocate a slot, growing the table as needed. */
+static struct gai *
+gai_alloc(void)
 {
-    struct gai *gaip = &gai[slot];
+    struct gai *gaip;
+
+    if (gai_free < 0) {
+	int n = gai_count? gai_count * 2: 16;
+	int i;
 
-    assert(gaip->busy == true);
-    assert(gaip->done == false);
+	/*
+	 * The slots are allocated individually, so running lookups keep
+	 * valid pointers when the table moves.
+	 */
+	gai = Realloc(gai, n * sizeof(struct gai *));
+	for (i = n - 1; i >= gai_count; i--) {
+	    gai[i] = Calloc(1, sizeof(struct gai));
+	    gai[i]->slot = i;
+	    gai[i]->pipe = -1;
+	    gai[i]->next = gai_free;
+# if defined(_WIN32) /*[*/
+	    gai[i]->event = INVALID_HANDLE_VALUE;
+# endif /*]*/
+	    gai_free = i;
+	}
+	gai_count = n;
+    }
 
-    gaip->busy = false;
+    gaip = gai[gai_free];
+    gai_free = gaip->next;
+    gaip->next = -1;
+    return gaip;
+}
+
+/* Free a slot. */
+static void
+gai_release(struct gai *gaip)
+{
+    assert(gaip->state == GAI_DONE || gaip->state == GAI_RUNNING);
+    gaip->state = GAI_FREE;
     gaip->pipe = -1;
     Replace(gaip->host, NULL);
     Replace(gaip->port, NULL);
+    result_free(&gaip->result);
 # if defined(_WIN32) /*[*/
     gaip->event = INVALID_HANDLE_VALUE;
 # endif /*]*/
+    gaip->next = gai_free;
+    gai_free = gaip->slot;
 }
 
-/*
- * Resolve a hostname and port using getaddrinfo_a, allowing IPv4 or IPv6.
- * Asynchronous version.
- */
-static rhp_t
-resolve_host_and_port_v46_a(const char *host, char *portname,
-	unsigned short *pport, struct sockaddr *sa, size_t sa_len,
-	socklen_t *sa_rlen, char **errmsg, int max, int *nr, int *slot,
-	int pipe, iosrc_t event)
+/* Returns true if a lookup for the same name is already running. */
+static bool
+gai_duplicate(const struct gai *gaip)
 {
-    static bool initted = false;
-# if !defined(_WIN32) /*[*/
-    int rc;
-# else /*][*/
-    HANDLE thread;
-# endif /*]*/
-
-    if (!initted) {
-	int i;
-	for (i = 0; i < GAI_SLOTS; i++) {
-	    gai[i].pipe = -1;
-# if defined(_WIN32) /*[*/
-	    gai[i].event = INVALID_HANDLE_VALUE;
-# endif /*]*/
-	}
-	initted = true;
-    }
-
-    *nr = 0;
+    int i;
 
-    /* getaddrinfo() does not appear to range-check the port. Do that here. */
-    if (portname != NULL) {
-	unsigned long l;
+    for (i = 0; i < gai_nrunning; i++) {
+	struct gai *r = gai[gai_running[i]];
 
-	if ((l = strtoul(portname, NULL, 0)) && (l & ~0xffffL)) {
-	    if (errmsg) {
-		*errmsg = txAsprintf("%s/%s:\n%s", host, portname, "Invalid port");
-	    }
-	    return RHP_CANNOT_RESOLVE;
+	if (r->family == gaip->family && !strcmp(r->host, gaip->host) &&
+		((r->port == NULL && gaip->port == NULL) ||
+		 (r->port != NULL && gaip->port != NULL &&
+		  !strcmp(r->port, gaip->port)))) {
+	    return true;
 	}
     }
+    return false;
+}
 
-    /* Find an empty slot. */
-    for (*slot = 0; *slot < GAI_SLOTS; (*slot)++) {
-	if (!gai[*slot].busy) {
-	    break;
-	}
+/* Add a slot to the end of the queue. */
+static void
+gai_enqueue(struct gai *gaip)
+{
+    gaip->state = GAI_QUEUED;
+    gaip->next = -1;
+    if (gai_queue_tail >= 0) {
+	gai[gai_queue_tail]->next = gaip->slot;
+    } else {
+	gai_queue_head = gaip->slot;
     }
-    if (*slot >= GAI_SLOTS) {
-	*slot = -1;
-	if (errmsg) {
-	    *errmsg = txdFree(NewString("Too many resolver reqests pending"));
-	}
-	return RHP_FATAL;
+    gai_queue_tail = gaip->slot;
+    if ((unsigned long)++gai_queued > stats.max_queued) {
+	stats.max_queued = gai_queued;
     }
+}
 
-    gai[*slot].pipe = pipe;
-    gai[*slot].busy = true;
-    gai[*slot].done = false;
-# if defined(_WIN32) /*[*/
-    gai[*slot].event = event;
+/*
+ * Start a lookup.
+ * Returns true for success, false (with an error message in the result) for
+ * failure.
+ */
+static bool
+gai_start(struct gai *gaip)
+{
+# if !defined(_WIN32) /*[*/
+    int rc;
+# else /*][*/
+    HANDLE thread;
 # endif /*]*/
 
-    gai[*slot].host = NewString(host);
-    gai[*slot].port = portname? NewString(portname) : NULL;
-
+    stats.lookups++;
 # if !defined(_WIN32) /*[*/
-    gai[*slot].hints.ai_flags = AI_ADDRCONFIG;
-    gai[*slot].hints.ai_family = want_pf();
-    gai[*slot].hints.ai_socktype = SOCK_STREAM;
-    gai[*slot].hints.ai_protocol = IPPROTO_TCP;
-
-    gai[*slot].gaicbs = &gai[*slot].gaicb;
-    gai[*slot].gaicb.ar_name = host;
-    gai[*slot].gaicb.ar_service = gai[*slot].port;
-    gai[*slot].gaicb.ar_request = &gai[*slot].hints;
-    gai[*slot].gaicb.ar_result = NULL;
-
-    gai[*slot].sigevent.sigev_notify = SIGEV_THREAD;
-    gai[*slot].sigevent.sigev_value.sival_int = *slot;
-    gai[*slot].sigevent.sigev_notify_function = gai_notify;
-
-    rc = getaddrinfo_a(GAI_NOWAIT, &gai[*slot].gaicbs, 1, &gai[*slot].sigevent);
+    memset(&gaip->hints, 0, sizeof(struct addrinfo));
+    gaip->hints.ai_flags = AI_ADDRCONFIG;
+    gaip->hints.ai_family = gaip->family;
+    gaip->hints.ai_socktype = SOCK_STREAM;
+    gaip->hints.ai_protocol = IPPROTO_TCP;
+
+    memset(&gaip->gaicb, 0, sizeof(struct gaicb));
+    gaip->gaicbs = &gaip->gaicb;
+    gaip->gaicb.ar_name = gaip->host;
+    gaip->gaicb.ar_service = gaip->port;
+    gaip->gaicb.ar_request = &gaip->hints;
+    gaip->gaicb.ar_result = NULL;
+
+    memset(&gaip->sigevent, 0, sizeof(struct sigevent));
+    gaip->sigevent.sigev_notify = SIGEV_THREAD;
+    gaip->sigevent.sigev_value.sival_ptr = gaip;
+    gaip->sigevent.sigev_notify_function = gai_notify;
+
+    gaip->state = GAI_RUNNING;
+    rc = getaddrinfo_a(GAI_NOWAIT, &gaip->gaicbs, 1, &gaip->sigevent);
     if (rc != 0) {
-	if (errmsg) {
-	    *errmsg = txAsprintf("%s/%s:\n%s", host, portname? portname: "(none)",
-		    my_gai_strerror(rc));
-	}
-	cleanup_partial_slot(*slot);
-	return RHP_CANNOT_RESOLVE;
+	result_from_addrinfo(&gaip->result, rc, NULL, gaip->host, gaip->port);
+	gaip->result.transient = true;
+	gaip->state = GAI_DONE;
+	stats.failures++;
+	return false;
     }
 # else /*][*/
-    thread = CreateThread(NULL, 0, async_resolve, &gai[*slot], 0, NULL);
+    gaip->state = GAI_RUNNING;
+    gaip->ai_result = NULL;
+    thread = CreateThread(NULL, 0, async_resolve, gaip, 0, NULL);
     if (thread == INVALID_HANDLE_VALUE) {
-	if (errmsg) {
-	    *errmsg = txAsprintf("%s/%s:\n%s", host, portname? portname: "(none)",
-		    win32_strerror(GetLastError()));
-	}
-	cleanup_partial_slot(*slot);
-	return RHP_CANNOT_RESOLVE;
+	memset(&gaip->result, 0, sizeof(result_t));
+	gaip->result.rv = RHP_CANNOT_RESOLVE;
+	gaip->result.transient = true;
+	gaip->result.errmsg = Asprintf("%s/%s:\n%s", gaip->host,
+		gaip->port? gaip->port: "(none)",
+		win32_strerror(GetLastError()));
+	gaip->state = GAI_DONE;
+	stats.failures++;
+	return false;
     }
     CloseHandle(thread);
 # endif /*]*/
 
-    return RHP_PENDING;
+    gai_running[gai_nrunning++] = gaip->slot;
+    return true;
 }
 
-#endif /*]*/
+/*
+ * Walk the queue. Requests that can be answered from the cache are
+ * completed, and others are started as workers become available.
+ */
+static void
+gai_dispatch(void)
+{
+    int prev = -1;
+    int slot = gai_queue_head;
+
+    while (slot >= 0) {
+	struct gai *gaip = gai[slot];
+	int next = gaip->next;
+	const result_t *cr;
+	bool dequeue = true;
+
+	if ((cr = cache_find(gaip->host, gaip->port, gaip->family)) != NULL) {
+	    gaip->result = *cache_hit(cr);
+	    gaip->result.errmsg = cr->errmsg? NewString(cr->errmsg): NULL;
+	    gaip->state = GAI_DONE;
+	} else if (gai_nrunning < RESOLVER_WORKERS && !gai_duplicate(gaip)) {
+	    gai_start(gaip);
+	} else {
+	    dequeue = false;
+	}
 
-/* Collect the status for a slot. */
-rhp_t
-collect_host_and_port(int slot, struct sockaddr *sa, size_t sa_len,
-	socklen_t *sa_rlen, unsigned short *pport, char **errmsg, int max,
-	int *nr)
+	if (dequeue) {
+	    if (prev >= 0) {
+		gai[prev]->next = next;
+	    } else {
+		gai_queue_head = next;
+	    }
+	    if (gai_queue_tail == slot) {
+		gai_queue_tail = prev;
+	    }
+	    gai_queued--;
+	    gaip->next = -1;
+	    if (gaip->state == GAI_DONE) {
+		gai_post(gaip);
+	    }
+	} else {
+	    prev = slot;
+	}
+	slot = next;
+    }
+}
+
+/*
+ * Gather the result of a completed slot, add it to the cache and let any
+ * waiting requests proceed.
+ */
+static void
+gai_finish(struct gai *gaip)
 {
-#if defined(ASYNC_RESOLVER) /*[*/
-# if !defined(_WIN32) /*[*/
-    int rc;
-# endif /*]*/
-    struct addrinfo *res;
     int i;
-    void *rsa = sa;
-    struct gai *gaip = &gai[slot];
 
-    assert(gaip->busy == true);
-    assert(gaip->done == true);
-    gaip->busy = false;
-    gaip->done = false;
+    if (gaip->state != GAI_RUNNING) {
+	assert(gaip->state == GAI_DONE);
+	return;
+    }
 
-    *nr = 0;
-# if !defined(_WIN32) /*[*/
-    switch ((rc = gai_error(&gaip->gaicb))) {
-    case 0:			/* success */
-	/* Return the addresses. */
-	res = gaip->gaicb.ar_result;
-	for (i = 0; *nr < max && res != NULL; i++, res = res->ai_next) {
-	    memcpy(rsa, res->ai_addr, res->ai_addrlen);
-	    sa_rlen[*nr] = (socklen_t)res->ai_addrlen;
-	    if (i == 0) {
-		/* Return the port. */
-		switch (res->ai_family) {
-		case AF_INET:
-		    *pport =
-			ntohs(((struct sockaddr_in *)res->ai_addr)->sin_port);
-		    break;
-		case AF_INET6:
-		    *pport =
-			ntohs(((struct sockaddr_in6 *)res->ai_addr)->sin6_port);
-		    break;
-		}
-	    }
-	    rsa = (char *)rsa + sa_len;
-	    (*nr)++;
-	}
-	if (gaip->gaicb.ar_result != NULL) {
-	    freeaddrinfo(gaip->gaicb.ar_result);
-	    gaip->gaicb.ar_result = NULL;
-	}
-	if (*nr) {
-	    Replace(gai->host, NULL);
-	    Replace(gai->port, NULL);
-	    return RHP_SUCCESS;
-	} else {
-	    if (errmsg) {
-		*errmsg = txAsprintf("%s/%s:\n%s", gaip->host,
-			gaip->port? gaip->port: "(none)",
-			"no suitable resolution");
-	    }
-	    Replace(gai->host, NULL);
-	    Replace(gai->port, NULL);
-	    return RHP_CANNOT_RESOLVE;
+    for (i = 0; i < gai_nrunning; i++) {
+	if (gai_running[i] == gaip->slot) {
+	    gai_running[i] = gai_running[--gai_nrunning];
+	    break;
 	}
-    case EAI_INPROGRESS:	/* still pending, should not happen */
-    case EAI_CANCELED:		/* canceled, should not happen */
+    }
+
+# if !defined(_WIN32) /*[*/
+    {
+	int rc = gai_error(&gaip->gaicb);
+
+	/* Still pending or canceled should not happen. */
 	assert(rc != EAI_INPROGRESS && rc != EAI_CANCELED);
+	result_from_addrinfo(&gaip->result, rc, gaip->gaicb.ar_result,
+		gaip->host, gaip->port);
 	if (gaip->gaicb.ar_result != NULL) {
 	    freeaddrinfo(gaip->gaicb.ar_result);
 	    gaip->gaicb.ar_result = NULL;
 	}
-	Replace(gai->host, NULL);
-	Replace(gai->port, NULL);
-	return RHP_FATAL;
-    default:			/* failure */
-	if (gaip->gaicb.ar_result != NULL) {
-	    freeaddrinfo(gaip->gaicb.ar_result);
-	    gaip->gaicb.ar_result = NULL;
-	}
-	if (errmsg) {
-	    *errmsg = txAsprintf("%s/%s:\n%s", gaip->host,
-		    gaip->port? gaip->port: "(none)",
-		    my_gai_strerror(rc));
-	}
-	Replace(gai->host, NULL);
-	Replace(gai->port, NULL);
-	return RHP_CANNOT_RESOLVE;
     }
-
 # else /*][*/
+    result_from_addrinfo(&gaip->result, gaip->rc,
+	    (gaip->rc == 0)? gaip->ai_result: NULL, gaip->host, gaip->port);
+    if (gaip->rc == 0 && gaip->ai_result != NULL) {
+	freeaddrinfo(gaip->ai_result);
+	gaip->ai_result = NULL;
+    }
+# endif /*]*/
+    gaip->state = GAI_DONE;
+    if (RHP_IS_ERROR(gaip->result.rv)) {
+	stats.failures++;
+    }
 
-    if (gaip->rc != 0) {
-	if (errmsg) {
-	    *errmsg = txAsprintf("%s/%s:\n%s", gaip->host,
-		    gaip->port? gaip->port: "(none)",
-		    my_gai_strerror(gaip->rc));
-	}
-	Replace(gai->host, NULL);
-	Replace(gai->port, NULL);
+    cache_add(gaip->host, gaip->port, gaip->family, &gaip->result);
+    gai_dispatch();
+}
+
+/*
+ * Resolve a hostname and port using getaddrinfo_a, allowing IPv4 or IPv6.
+ * Asynchronous version.
+ */
+static rhp_t
+resolve_host_and_port_v46_a(const char *host, char *portname,
+	unsigned short *pport, struct sockaddr *sa, size_t sa_len,
+	socklen_t *sa_rlen, char **errmsg, int max, int *nr, int *slot,
+	int pipe, iosrc_t event)
+{
+    int family = want_pf();
+    const result_t *cr;
+    struct gai *gaip;
+
+    *nr = 0;
+    *slot = -1;
+    stats.requests++;
+    if (bad_port(host, portname, errmsg)) {
 	return RHP_CANNOT_RESOLVE;
     }
 
-    /* Return the addresses. */
-    res = gaip->result;
-    for (i = 0; i < max && res != NULL; i++, res = res->ai_next) {
-	memcpy(rsa, res->ai_addr, res->ai_addrlen);
-	sa_rlen[*nr] = (socklen_t)res->ai_addrlen;
-	if (i == 0) {
-	    /* Return the port. */
-	    switch (res->ai_family) {
-	    case AF_INET:
-		*pport =
-		    ntohs(((struct sockaddr_in *) res->ai_addr)->sin_port);
-		break;
-	    case AF_INET6:
-		*pport =
-		    ntohs(((struct sockaddr_in6 *) res->ai_addr)->sin6_port);
-		break;
-	    default:
-		if (errmsg) {
-		    *errmsg = txAsprintf("%s:\nunknown family %d", gaip->host,
-			    res->ai_family);
-		}
-		freeaddrinfo(gaip->result);
-		Replace(gai->host, NULL);
-		Replace(gai->port, NULL);
-		return RHP_FATAL;
-	    }
-	}
-
-	rsa = (char *)rsa + sa_len;
-	(*nr)++;
+    /* Answer from the cache, if possible. */
+    if ((cr = cache_find(host, portname, family)) != NULL) {
+	return copy_result(cache_hit(cr), pport, sa, sa_len, sa_rlen, errmsg,
+		max, nr);
     }
 
-    freeaddrinfo(gaip->result);
-    Replace(gai->host, NULL);
-    Replace(gai->port, NULL);
-    return RHP_SUCCESS;
+    gaip = gai_alloc();
+    gaip->pipe = pipe;
+# if defined(_WIN32) /*[*/
+    gaip->event = event;
 # endif /*]*/
+    gaip->host = NewString(host);
+    gaip->port = portname? NewString(portname) : NULL;
+    gaip->family = family;
+
+    /*
+     * Queue the request if the workers are busy, or if an identical lookup
+     * is already running.
+     */
+    if (gai_duplicate(gaip)) {
+	stats.coalesced++;
+	gai_enqueue(gaip);
+    } else if (gai_nrunning >= RESOLVER_WORKERS) {
+	gai_enqueue(gaip);
+    } else if (!gai_start(gaip)) {
+	rhp_t rv = copy_result(&gaip->result, pport, sa, sa_len, sa_rlen,
+		errmsg, max, nr);
+
+	gai_release(gaip);
+	return rv;
+    }
+
+    *slot = gaip->slot;
+    return RHP_PENDING;
+}
+
+#endif /*]*/
+
+/* Collect the status for a slot. */
+rhp_t
+collect_host_and_port(int slot, struct sockaddr *sa, size_t sa_len,
+	socklen_t *sa_rlen, unsigned short *pport, char **errmsg, int max,
+	int *nr)
+{
+#if defined(ASYNC_RESOLVER) /*[*/
+    struct gai *gaip = gai[slot];
+    rhp_t rv;
+
+    gai_finish(gaip);
+    rv = copy_result(&gaip->result, pport, sa, sa_len, sa_rlen, errmsg, max,
+	    nr);
+    gai_release(gaip);
+    return rv;
 #else /*][*/
     if (errmsg != NULL) {
 	*errmsg =
@@ -526,109 +878,13 @@ void
 cleanup_host_and_port(int slot)
 {
 #if defined(ASYNC_RESOLVER) /*[*/
-    struct gai *gaip = &gai[slot];
-# if !defined(_WIN32) /*[*/
-    int rc;
-# endif /*]*/
-
-    assert(gaip->busy == true);
-    assert(gaip->done == true);
-    gaip->busy = false;
-    gaip->done = false;
-
-# if !defined(_WIN32) /*[*/
-    switch ((rc = gai_error(&gaip->gaicb))) {
-    case 0:			/* success */
-	freeaddrinfo(gaip->gaicb.ar_result);
-	gaip->gaicb.ar_result = NULL;
-	break;
-    case EAI_INPROGRESS:	/* still pending, should not happen */
-    case EAI_CANCELED:		/* canceled, should not happen */
-	assert(rc != EAI_INPROGRESS && rc != EAI_CANCELED);
-	break;
-    default:			/* failure */
-	break;
-    }
-# else /*][*/
-    if (gaip->rc == 0) {
-	freeaddrinfo(gaip->result);
-	gaip->result = NULL;
-    }
-# endif /*]*/
+    struct gai *gaip = gai[slot];
 
-    Replace(gaip->host, NULL);
-    Replace(gaip->port, NULL);
+    gai_finish(gaip);
+    gai_release(gaip);
 #endif /*]*/
 }
 
-/**
- * Mock the behavior of the synchronous resolver.
- *
- * @param[in] m		Mock definition
- * @param[in] host	Host name
- * @param[in] portname	Port name
- * @param[out] pport	Returned numeric port
- * @param[out] sa	Returned array of addresses
- * @param[in] sa_len	Number of elements in sa
- * @param[out] sa_rlen	Returned size of elements in sa
- * @param[out] errmsg	Returned error message
- * @param[in] max	Maximum number of elements to return
- * @param[out] nr	Number of elements returned
- *
- * @returns @ref rhp_t status
- */
-static rhp_t
-mock_sync_resolver(const char *m, const char *host, char *portname,
-	unsigned short *pport, struct sockaddr *sa, size_t sa_len,
-	socklen_t *sa_rlen, char **errmsg, int max, int *nr)
-{
-    /*
-     * m is a string that looks like:
-     *  address/port[;address/port...]
-     * address is a numeric IPv4 or IPv6 address
-     * port is a port name or number
-     */
-    char *mdup = NewString(m);
-    char *outer_saveptr = NULL, *inner_saveptr = NULL;
-    char *outer_chunk, *inner_chunk;
-    char *outer_str, *inner_str;
-    struct addrinfo hints;
-
-    *nr = 0;
-    memset(&hints, 0, sizeof(struct addrinfo));
-    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
-    hints.ai_family = PF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-
-    outer_str = mdup;
-    while (*nr < max &&
-	    (outer_chunk = strtok_r(outer_str, ";", &outer_saveptr)) != NULL) {
-	int np = 0;
-	char *inner[2];
-	struct addrinfo *res = NULL;
-
-	outer_str = NULL;
-	inner_str = outer_chunk;
-	while ((inner_chunk = strtok_r(inner_str, "/", &inner_saveptr))
-		!= NULL) {
-	    inner_str = NULL;
-	    assert(np < 2);
-	    inner[np++] = inner_chunk;
-	}
-	assert(np == 2);
-
-	assert(getaddrinfo(inner[0], inner[1], &hints, &res) == 0);
-	memcpy(sa, res->ai_addr, res->ai_addrlen);
-	sa_rlen[*nr] = (socklen_t)res->ai_addrlen;
-	freeaddrinfo(res);
-	sa = (struct sockaddr *)((char *)sa + sa_len);
-	++(*nr);
-    }
-
-    Free(mdup);
-    return RHP_SUCCESS;
-}
-
 /**
  * Resolve a hostname and port.
  * Synchronous version.
@@ -652,12 +908,9 @@ resolve_host_and_port(const char *host, char *portname, unsigned short *pport,
 {
     const char *m = ut_getenv("MOCK_SYNC_RESOLVER");
 
-    if (m != NULL && *m != '\0') {
-	return mock_sync_resolver(m, host, portname, pport, sa, sa_len,
-		sa_rlen, errmsg, max, nr);
-    }
-    return resolve_host_and_port_v46(host, portname, false, pport, sa, sa_len,
-	    sa_rlen, errmsg, max, nr);
+    return resolve_host_and_port_v46(host, portname, want_pf(),
+	    (m != NULL && *m != '\0')? m: NULL, pport, sa, sa_len, sa_rlen,
+	    errmsg, max, nr);
 }
 
 /**
@@ -681,13 +934,15 @@ resolve_host_and_port_abs(const char *host, char *portname,
 	unsigned short *pport, struct sockaddr *sa, size_t sa_len,
 	socklen_t *sa_rlen, char **errmsg, int max, int *nr)
 {
-    return resolve_host_and_port_v46(host, portname, true, pport, sa, sa_len,
-	    sa_rlen, errmsg, max, nr);
+    return resolve_host_and_port_v46(host, portname, PF_UNSPEC, NULL, pport,
+	    sa, sa_len, sa_rlen, errmsg, max, nr);
 }
 
 /*
  * Resolve a hostname and port.
- * Asynchronous version.
+ * Asynchronous version. The result may come from the cache, in which case
+ * RHP_SUCCESS is returned immediately and *slot is set to -1. Otherwise the
+ * slot number is written into the pipe when the result is ready.
  *
  * @param[in] host	Host name
  * @param[in] portname	Port name
@@ -706,15 +961,38 @@ resolve_host_and_port_a(const char *host, char *portname, unsigned short *pport,
 	struct sockaddr *sa, size_t sa_len, socklen_t *sa_rlen, char **errmsg,
 	int max, int *nr, int *slot, int pipe, iosrc_t event)
 {
+    const char *m = ut_getenv("MOCK_SYNC_RESOLVER");
+
+    *slot = -1;
+    if (m != NULL && *m != '\0') {
+	return resolve_host_and_port_v46(host, portname, want_pf(), m, pport,
+		sa, sa_len, sa_rlen, errmsg, max, nr);
+    }
 #if defined(ASYNC_RESOLVER) /*[*/
     if (ut_getenv("SYNC_RESOLVER") == NULL) {
 	return resolve_host_and_port_v46_a(host, portname, pport, sa, sa_len,
 		sa_rlen, errmsg, max, nr, slot, pipe, event);
     }
 #endif /*]*/
-    *slot = -1;
-    return resolve_host_and_port_v46(host, portname, false, pport, sa, sa_len,
-	    sa_rlen, errmsg, max, nr);
+    return resolve_host_and_port_v46(host, portname, want_pf(), NULL, pport,
+	    sa, sa_len, sa_rlen, errmsg, max, nr);
+}
+
+/* Returns resolver statistics, for Query(). */
+const char *
+resolver_query_stats(void)
+{
+    return txAsprintf("requests %lu hits %lu negative-hits %lu coalesced %lu "
+	    "lookups %lu failures %lu running %d queued %d max-queued %lu "
+	    "cached %d",
+	    stats.requests, stats.hits, stats.negative_hits, stats.coalesced,
+	    stats.lookups, stats.failures,
+#if defined(ASYNC_RESOLVER) /*[*/
+	    gai_nrunning, gai_queued,
+#else /*][*/
+	    0, 0,
+#endif /*]*/
+	    stats.max_queued, cache_count);
 }
 
 #if defined(_WIN32) /*[*/
@@ -35,6 +35,7 @@
 
 #include "actions.h"
 #include "ctlr.h"
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #include "kybd.h"
 #include "names.h"
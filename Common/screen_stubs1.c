@@ -39,11 +39,15 @@
 #include "globals.h"
 
 #include "ctlr.h"
+#include "ctlrc.h"
 #include "screen.h"
 
 void
 cursor_move(int baddr)
 {
+    if (baddr != cursor_addr) {
+	screen_generation++;	/* the cursor is part of the screen image */
+    }
     cursor_addr = baddr;
 }
 
@@ -46,6 +46,7 @@
 #include "codepage.h"
 #include "ctlrc.h"
 #include "find_console.h"
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #include "menubar.h"
 #include "names.h"
@@ -50,6 +50,7 @@
 #include "toggles.h"
 #include "trace.h"
 #include "utils.h"
+#include "varint.h"
 #include "vstatus.h"
 
 /* Globals */
@@ -57,8 +58,41 @@ bool	scroll_initted = false;
 
 /* Statics */
 
-/* Saved screens. */
-static struct ea **ea_save = (struct ea **) NULL;
+/*
+ * Saved rows.
+ *
+ * Each row is stored run-length encoded, as:
+ *  2 bytes	width of the row, in cells
+ *  2 bytes	number of cells with text; the rest are empty
+ *  1 byte	text encoding (RT_xxx)
+ *  attribute runs, covering the width of the row:
+ *   2 bytes	run length, in cells
+ *   7 bytes	fa, fg, bg, gr, cs, ic, db
+ *  text, one entry per cell with text:
+ *   RT_EC:	1 byte EBCDIC code (ucs4 is 0)
+ *   RT_UCS4:	ucs4 as a variable-length integer (ec is 0)
+ *   RT_BOTH:	1 byte EBCDIC code, then ucs4 as a variable-length integer
+ * Variable-length integers are encoded with varint_encode().
+ *
+ * A row of default cells (padding) is stored as NULL data.
+ */
+typedef struct {
+    unsigned char *data;	/* encoded row, or NULL */
+    size_t len;			/* length of encoded row */
+} saved_row_t;
+
+#define RT_EC		0	/* EBCDIC text only */
+#define RT_UCS4		1	/* Unicode text only */
+#define RT_BOTH		2	/* both */
+#define ROW_HDR_LEN	5	/* length of encoded row header */
+#define ROW_ATTR_LEN	7	/* length of an encoded attribute set */
+
+/* Saved rows, a ring of up to scroll_max rows. */
+static saved_row_t *saved_rows = NULL;
+static int	rows_alloc = 0;		/* allocated size of saved_rows */
+static int	row_first = 0;		/* index of the oldest row */
+static size_t	saved_bytes = 0;	/* total encoded size */
+static unsigned char *row_scratch = NULL; /* encoding buffer */
 
 /* Number of lines saved. */
 static int      n_saved = 0;
@@ -67,9 +101,7 @@ static int      scroll_next = 0;
 static int      scrolled_back = 0;
 static bool  need_saving = true;
 static bool  vscreen_swapped = false;
-static char    *sbuf = NULL;
-static int      sa_bufsize;
-static char    *zbuf = NULL;
+static struct ea *screen_save = NULL;	/* live screen, while scrolled back */
 static struct ea *defaults_buf = NULL;
 
 /* Thumb state: */
@@ -90,6 +122,278 @@ static void sync_scroll(int sb);
 static void save_image(void);
 static void scroll_reset(void);
 
+/*
+ * Free all of the saved rows.
+ */
+static void
+free_rows(void)
+{
+    int i;
+
+    for (i = 0; i < n_saved; i++) {
+	Free(saved_rows[(row_first + i) % rows_alloc].data);
+    }
+    Replace(saved_rows, NULL);
+    rows_alloc = 0;
+    row_first = 0;
+    n_saved = 0;
+    saved_bytes = 0;
+}
+
+/*
+ * Returns true if two cells have the same attributes.
+ */
+static bool
+same_attrs(const struct ea *a, const struct ea *b)
+{
+    return a->fa == b->fa && a->fg == b->fg && a->bg == b->bg &&
+	a->gr == b->gr && a->cs == b->cs && a->ic == b->ic && a->db == b->db;
+}
+
+/*
+ * Encode a row of cells.
+ * Returns the encoded length, and an allocated copy of the encoding in
+ * *data. A row of default cells is returned as NULL data.
+ */
+static size_t
+encode_row(const struct ea *ea, int width, unsigned char **data)
+{
+    unsigned char *s = row_scratch;
+    int n_text = 0;
+    int mode = RT_EC;
+    bool has_ec = false;
+    bool has_ucs4 = false;
+    int i;
+
+    if (width == maxCOLS &&
+	    !memcmp(ea, defaults_buf, maxCOLS * sizeof(struct ea))) {
+	*data = NULL;
+	return 0;
+    }
+
+    /* Find the last cell with text, and the encoding to use. */
+    for (i = 0; i < width; i++) {
+	if (ea[i].ec) {
+	    has_ec = true;
+	    n_text = i + 1;
+	}
+	if (ea[i].ucs4) {
+	    has_ucs4 = true;
+	    n_text = i + 1;
+	}
+    }
+    if (has_ucs4) {
+	mode = has_ec? RT_BOTH: RT_UCS4;
+    }
+
+    /* Header. */
+    *s++ = width & 0xff;
+    *s++ = (width >> 8) & 0xff;
+    *s++ = n_text & 0xff;
+    *s++ = (n_text >> 8) & 0xff;
+    *s++ = mode;
+
+    /* Attribute runs. */
+    i = 0;
+    while (i < width) {
+	int j = i + 1;
+
+	while (j < width && same_attrs(&ea[i], &ea[j])) {
+	    j++;
+	}
+	*s++ = (j - i) & 0xff;
+	*s++ = ((j - i) >> 8) & 0xff;
+	*s++ = ea[i].fa;
+	*s++ = ea[i].fg;
+	*s++ = ea[i].bg;
+	*s++ = ea[i].gr;
+	*s++ = ea[i].cs;
+	*s++ = ea[i].ic;
+	*s++ = ea[i].db;
+	i = j;
+    }
+
+    /* Text. */
+    for (i = 0; i < n_text; i++) {
+	if (mode != RT_UCS4) {
+	    *s++ = ea[i].ec;
+	}
+	if (mode != RT_EC) {
+	    s += varint_encode(ea[i].ucs4, s);
+	}
+    }
+
+    *data = Malloc(s - row_scratch);
+    memcpy(*data, row_scratch, s - row_scratch);
+    return s - row_scratch;
+}
+
+/*
+ * Decode a saved row into <ncols> cells.
+ * Cells past the saved width are filled from defaults_buf. A NULL row
+ * (before the oldest saved row) is decoded as empty cells.
+ */
+static void
+decode_row(const saved_row_t *row, struct ea *ea, int ncols)
+{
+    const unsigned char *s;
+    int width, n_text, mode;
+    int i;
+
+    if (row == NULL) {
+	memset(ea, 0, ncols * sizeof(struct ea));
+	return;
+    }
+    if (row->data == NULL) {
+	memcpy(ea, defaults_buf, ncols * sizeof(struct ea));
+	return;
+    }
+
+    s = row->data;
+    width = s[0] | (s[1] << 8);
+    n_text = s[2] | (s[3] << 8);
+    mode = s[4];
+    s += ROW_HDR_LEN;
+
+    /* Attribute runs. */
+    i = 0;
+    while (i < width) {
+	int run = s[0] | (s[1] << 8);
+	int j;
+
+	for (j = i; j < i + run; j++) {
+	    if (j < ncols) {
+		ea[j].fa = s[2];
+		ea[j].fg = s[3];
+		ea[j].bg = s[4];
+		ea[j].gr = s[5];
+		ea[j].cs = s[6];
+		ea[j].ic = s[7];
+		ea[j].db = s[8];
+		ea[j].ec = 0;
+		ea[j].ucs4 = 0;
+	    }
+	}
+	s += 2 + ROW_ATTR_LEN;
+	i += run;
+    }
+
+    /* Text. */
+    for (i = 0; i < n_text; i++) {
+	unsigned char ec = 0;
+	ucs4_t u = 0;
+
+	if (mode != RT_UCS4) {
+	    ec = *s++;
+	}
+	if (mode != RT_EC) {
+	    u = (ucs4_t)varint_decode(&s);
+	}
+	if (i < ncols) {
+	    ea[i].ec = ec;
+	    ea[i].ucs4 = u;
+	}
+    }
+
+    /* Padding. */
+    if (width < ncols) {
+	memcpy(ea + width, defaults_buf + width,
+		(ncols - width) * sizeof(struct ea));
+    }
+}
+
+/*
+ * Returns the saved row <n> rows after the oldest one, or NULL if there is
+ * no such row.
+ */
+static const saved_row_t *
+saved_row(int n)
+{
+    if (n < 0 || n >= n_saved) {
+	return NULL;
+    }
+    return &saved_rows[(row_first + n) % rows_alloc];
+}
+
+/*
+ * Discard the oldest saved row.
+ */
+static void
+drop_row(void)
+{
+    saved_row_t *row = &saved_rows[row_first];
+
+    saved_bytes -= row->len;
+    Replace(row->data, NULL);
+    row->len = 0;
+    row_first = (row_first + 1) % rows_alloc;
+    n_saved--;
+}
+
+/*
+ * Save one row of <width> cells, or a row of default cells if ea is NULL.
+ */
+static void
+save_row(const struct ea *ea, int width)
+{
+    saved_row_t *row;
+
+    if (n_saved == scroll_max) {
+	drop_row();
+    }
+
+    /* Grow the ring as needed, up to scroll_max rows. */
+    if (n_saved == rows_alloc) {
+	int new_alloc = rows_alloc? rows_alloc * 2: maxROWS * 4;
+	saved_row_t *new_rows;
+	int i;
+
+	if (new_alloc > scroll_max) {
+	    new_alloc = scroll_max;
+	}
+	new_rows = (saved_row_t *)Calloc(new_alloc, sizeof(saved_row_t));
+	for (i = 0; i < n_saved; i++) {
+	    new_rows[i] = saved_rows[(row_first + i) % rows_alloc];
+	}
+	Replace(saved_rows, new_rows);
+	rows_alloc = new_alloc;
+	row_first = 0;
+    }
+
+    row = &saved_rows[(row_first + n_saved) % rows_alloc];
+    if (ea != NULL) {
+	row->len = encode_row(ea, width, &row->data);
+    } else {
+	row->data = NULL;
+	row->len = 0;
+    }
+    saved_bytes += row->len;
+    n_saved++;
+    scroll_next = (scroll_next + 1) % scroll_max;
+}
+
+/*
+ * Discard the oldest rows until the save area is within its byte budget.
+ * In 3270 mode, rows are discarded a screen at a time.
+ */
+static void
+trim_rows(void)
+{
+    size_t budget;
+
+    if (appres.interactive.save_bytes <= 0) {
+	return;
+    }
+    budget = (size_t)appres.interactive.save_bytes;
+    while (saved_bytes > budget && n_saved > 0) {
+	int n = scroll_has_3270? maxROWS: 1;
+
+	while (n-- && n_saved > 0) {
+	    drop_row();
+	}
+    }
+}
+
 /*
  * Initialize (or re-initialize) the scrolling parameters and save area.
  */
@@ -97,8 +401,6 @@ void
 scroll_buf_init(void)
 {
     register int i;
-    int sa_size;
-    unsigned char *s;
 
     /* Set the number of rows to save, as a multiple of maxROWS. */
     scroll_max = appres.interactive.save_lines;
@@ -108,20 +410,12 @@ scroll_buf_init(void)
     if (scroll_max < maxROWS * 5) {
 	scroll_max = maxROWS * 5;
     }
-    if (sbuf != NULL) {
-	Free(sbuf);
-	Free(zbuf);
-	Free(defaults_buf);
-	Free(ea_save);
-    }
-    sa_size = scroll_max + maxROWS;
-    ea_save = (struct ea **)Calloc(sizeof(struct ea *), sa_size);
-    sa_bufsize = (sa_size *
-	    (sizeof(unsigned char) + sizeof(struct ea))) * maxCOLS;
-    sbuf = Malloc(sa_bufsize);
-    zbuf = Malloc(maxCOLS);
-    memset(zbuf, '\0', maxCOLS);
-    defaults_buf = Calloc(maxCOLS, sizeof(struct ea));
+    free_rows();
+    Replace(screen_save, (struct ea *)Calloc(maxROWS * maxCOLS,
+		sizeof(struct ea)));
+    Replace(row_scratch, (unsigned char *)Malloc(ROW_HDR_LEN +
+		(maxCOLS * (2 + ROW_ATTR_LEN + 1 + VARINT_MAX))));
+    Replace(defaults_buf, (struct ea *)Calloc(maxCOLS, sizeof(struct ea)));
     for (i = 0; i < maxCOLS; i++) {
 	/*
 	 * Black and intensify ensure that the area outside of the primary
@@ -131,10 +425,6 @@ scroll_buf_init(void)
 	defaults_buf[i].bg = HOST_COLOR_BLACK;
 	defaults_buf[i].gr = XAH_INTENSIFY & 0x0f;
     }
-    s = (unsigned char *)sbuf;
-    for (i = 0; i < sa_size; s += (maxCOLS * sizeof(struct ea)), i++) {
-	ea_save[i] = (struct ea *)s;
-    }
     scroll_reset();
     scroll_initted = true;
 }
@@ -154,15 +444,28 @@ screen_set_thumb_traced(float top, float shown, int saved, int screen,
     screen_set_thumb(top, shown, saved, screen, back);
 }
 
+/*
+ * Reset the thumb to show the bottom of the save area.
+ */
+static void
+reset_thumb(void)
+{
+    thumb_top_base = thumb_top =
+	((float)n_saved / (float)(scroll_max + maxROWS));
+    thumb_shown = (float)(1.0 - thumb_top);
+    screen_set_thumb_traced(thumb_top, thumb_shown, n_saved, maxROWS,
+	    scrolled_back);
+}
+
 /*
  * Reset the scrolling parameters and erase the save area.
  */
 static void
 scroll_reset(void)
 {
-    memset(sbuf, 0, sa_bufsize);
+    free_rows();
+    memset(screen_save, 0, maxROWS * maxCOLS * sizeof(struct ea));
     scroll_next = 0;
-    n_saved = 0;
     scrolled_back = 0;
     thumb_top_base = thumb_top = 0.0;
     thumb_shown = 1.0;
@@ -193,31 +496,13 @@ scroll_save(int n)
     /* Save the screen contents. */
     for (row = 0; row < n; row++) {
 	if (row < ROWS) {
-	    memmove(ea_save[scroll_next],
-		    ea_buf + (row * COLS),
-		    COLS * sizeof(struct ea));
-	    if (COLS < maxCOLS) {
-		memcpy(ea_save[scroll_next] + COLS, defaults_buf,
-			(maxCOLS - COLS) * sizeof(struct ea));
-	    }
+	    save_row(ea_buf + (row * COLS), COLS);
 	} else {
-	    memcpy(ea_save[scroll_next], defaults_buf,
-		    maxCOLS * sizeof(struct ea));
-	}
-	scroll_next = (scroll_next + 1) % scroll_max;
-	if (n_saved < scroll_max) {
-	    n_saved++;
+	    save_row(NULL, maxCOLS);
 	}
     }
     if (n == ROWS && n < maxROWS) {
-	for (row = n; row < maxROWS; row++) {
-	    memcpy(ea_save[scroll_next], defaults_buf,
-		    maxCOLS * sizeof(struct ea));
-	}
-	scroll_next = (scroll_next + 1) % scroll_max;
-	if (n_saved < scroll_max) {
-	    n_saved++;
-	}
+	save_row(NULL, maxCOLS);
     }
 
     /*
@@ -229,26 +514,18 @@ scroll_save(int n)
 	int pad;
 
 	for (pad = maxROWS - (scroll_next % maxROWS); pad; pad--) {
-	    memcpy(ea_save[scroll_next], defaults_buf,
-		    maxCOLS * sizeof(struct ea));
-	    scroll_next = (scroll_next + 1) % scroll_max;
-	    if (n_saved < scroll_max) {
-		n_saved++;
-	    }
+	    save_row(NULL, maxCOLS);
 	}
 
     }
+    trim_rows();
 
 #if defined(SCROLL_DEBUG) /*[*/
     vtrace(" -> n_saved %d\n", n_saved);
 #endif /*]*/
 
     /* Reset the thumb. */
-    thumb_top_base = thumb_top =
-	((float)n_saved / (float)(scroll_max + maxROWS));
-    thumb_shown = (float)(1.0 - thumb_top);
-    screen_set_thumb_traced(thumb_top, thumb_shown, n_saved, maxROWS,
-	    scrolled_back);
+    reset_thumb();
 }
 
 /*
@@ -281,7 +558,7 @@ save_image(void)
 #endif /*]*/
 
     for (i = 0; i < maxROWS; i++) {
-	memmove(ea_save[scroll_max + i],
+	memmove(screen_save + (i * maxCOLS),
 		(ea_buf + (i * COLS)), COLS * sizeof(struct ea));
     }
     need_saving = false;
@@ -295,7 +572,7 @@ sync_scroll(int sb)
 {
     int slop;
     int i;
-    int scroll_first;
+    int first_row;
     float tt0;
 
 #if defined(SCROLL_DEBUG) /*[*/
@@ -349,20 +626,18 @@ sync_scroll(int sb)
 	vscreen_swapped = false;
     }
 
-    scroll_first = (scroll_next + scroll_max - sb) % scroll_max;
+    first_row = n_saved - sb;
 #if defined(SCROLL_DEBUG) /*[*/
-    vtrace("sync_scroll: scroll_first is %d\n", scroll_first);
+    vtrace("sync_scroll: first_row is %d\n", first_row);
 #endif /*]*/
 
-    /* Update the screen. */
+    /* Update the screen, decoding only the saved rows that are visible. */
     for (i = 0; i < maxROWS; i++) {
 	if (i < sb) {
-	    memmove((ea_buf + (i * COLS)),
-		    ea_save[(scroll_first + i) % scroll_max],
-		    COLS * sizeof(struct ea));
+	    decode_row(saved_row(first_row + i), ea_buf + (i * COLS), COLS);
 	} else {
 	    memmove((ea_buf + (i * COLS)),
-		    ea_save[scroll_max + i - sb],
+		    screen_save + ((i - sb) * maxCOLS),
 		    COLS * sizeof(struct ea));
 	}
     }
@@ -552,6 +827,39 @@ toggle_save_lines(const char *name _is_unused, const char *value, unsigned flags
     return TU_SUCCESS;
 }
 
+/*
+ * Toggle the memory budget for the scrollback buffer.
+ */
+static toggle_upcall_ret_t
+toggle_save_bytes(const char *name _is_unused, const char *value,
+	unsigned flags, ia_t ia)
+{
+    unsigned long l;
+    char *end;
+    int bytes;
+
+    if (!*value) {
+	appres.interactive.save_bytes = 0;
+	return TU_SUCCESS;
+    }
+
+    l = strtoul(value, &end, 10);
+    bytes = (int)l;
+    if (*end != '\0' || (unsigned long)bytes != l || bytes < 0) {
+	popup_an_error("Invalid %s value", ResSaveBytes);
+	return TU_FAILURE;
+    }
+    appres.interactive.save_bytes = bytes;
+    if (scroll_initted) {
+	if (scrolled_back) {
+	    sync_scroll(0);
+	}
+	trim_rows();
+	reset_thumb();
+    }
+    return TU_SUCCESS;
+}
+
 /*
  * Called when a host connects, disconnects or changes NVT/3270 modes.
  */
@@ -581,6 +889,8 @@ scroll_register(void)
     /* Register the toggles. */
     register_extended_toggle(ResSaveLines, toggle_save_lines, NULL, NULL,
 	    (void **)&appres.interactive.save_lines, XRM_INT);
+    register_extended_toggle(ResSaveBytes, toggle_save_bytes, NULL, NULL,
+	    (void **)&appres.interactive.save_bytes, XRM_INT);
 
     /* Register the state change callbacks. */
     register_schange(ST_CONNECT, scroll_connect);
@@ -82,6 +82,7 @@ typedef struct {
     char *server_subjects;
     bool negotiate_pending;
     bool negotiated;
+    bool default_paths_pending;	/* default CA locations not loaded yet */
 } ssl_sio_t;
 
 static ssl_sio_t *current_sio;
@@ -577,7 +578,11 @@ sio_init(tls_config_t *config, const char *password, sio_t *sio_ret)
 	    goto fail;
 	}
     } else {
-	SSL_CTX_set_default_verify_paths(s->ctx);
+	/*
+	 * Loading the default CA locations is expensive, and most connections
+	 * never use TLS. Defer it until negotiation starts.
+	 */
+	s->default_paths_pending = true;
     }
 
     /* Pull in the client certificate file. */
@@ -934,6 +939,12 @@ sio_negotiate(sio_t sio, socket_t sock, const char *hostname, bool *data)
 	s->sock = sock;
 	s->hostname = hostname;
 
+	/* Pull in the default CA locations. */
+	if (s->default_paths_pending) {
+	    SSL_CTX_set_default_verify_paths(s->ctx);
+	    s->default_paths_pending = false;
+	}
+
 #if defined(OPENSSL102) /*[*/
 	/* Have OpenSSL verify the hostname. */
 	if (s->config->verify_host_cert &&
@@ -88,7 +88,7 @@ static int stdin_errno;
 
 static bool pushed_wait = false;
 static bool enabled = true;
-static char *pj_in;	/* pending JSON input */
+static json_stream_t *pj_in;	/* pending JSON input */
 static json_t *pj_out;		/* pending JSON output state */
 
 static unsigned stdin_capabilities;
@@ -107,13 +107,7 @@ json_input(char *buf, bool *need_more)
 {
     *need_more = false;
 
-    if (pj_in != NULL) {
-	/* Concatenate the input. */
-	char *s = pj_in;
-
-	pj_in = Asprintf("%s%s", pj_in, buf);
-	Free(s);
-    } else {
+    if (pj_in == NULL) {
 	char *s = buf;
 
 	/* Check for JSON. */
@@ -121,7 +115,7 @@ json_input(char *buf, bool *need_more)
 	    s++;
 	}
 	if (*s == '{' || *s == '[' || *s == '"') {
-	    pj_in = NewString(buf);
+	    pj_in = json_stream_init();
 	}
     }
 
@@ -131,8 +125,8 @@ json_input(char *buf, bool *need_more)
 	char *errmsg;
 	hjparse_ret_t ret;
 
-	/* Try JSON parsing. */
-	ret = hjson_parse(pj_in, strlen(pj_in), &cmds, &single,
+	/* Parse this line, picking up where the previous one left off. */
+	ret = hjson_parse_stream(pj_in, buf, strlen(buf), &cmds, &single,
 		&errmsg);
 	if (ret != HJ_OK) {
 	    /* Unsuccessful JSON. */
@@ -143,7 +137,7 @@ json_input(char *buf, bool *need_more)
 		Free(errmsg);
 		push_cb(fail, strlen(fail), &stdin_cb, NULL);
 		Free(fail);
-		Replace(pj_in, NULL);
+		json_stream_free(pj_in);
 		if (ret == HJ_BAD_CONTENT) {
 		    pj_out = s3json_init();
 		}
@@ -152,7 +146,6 @@ json_input(char *buf, bool *need_more)
 	    /* Incomplete JSON. */
 	    /* Enable more input. */
 	    assert(ret == HJ_INCOMPLETE);
-	    Free(errmsg);
 	    *need_more = true;
 	    return true;
 	}
@@ -165,7 +158,7 @@ json_input(char *buf, bool *need_more)
 	    push_cb(single, strlen(single), &stdin_cb, NULL);
 	    Free(single);
 	}
-	Replace(pj_in, NULL);
+	json_stream_free(pj_in);
 	return true;
     }
 
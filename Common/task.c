@@ -86,19 +86,21 @@
 #include "utf8.h"
 #include "utils.h"
 #include "varbuf.h"
+#include "varint.h"
 #include "vstatus.h"
 #include "xio.h"
 
 #include "w3misc.h"
 
-#define NVT_SAVE_SIZE	4096
-
 /* Maximum size of a macro. */
 #define MSC_BUF	1024
 
 /* IA test for UTF-8 overrides. */
 #define IA_UTF8(ia)	((ia) == IA_HTTPD)
 
+/* Maximum number of alternative texts for Wait(StringAt). */
+#define WAIT_STRINGS_MAX	32
+
 /* Base and variable wait times for a wrong cookie, in ms. */
 #define WRONG_COOKIE_BASE	1000
 #define WRONG_COOKIE_VAR	1000
@@ -109,6 +111,33 @@ char *security_cookie;
 
 /* Statics */
 
+/*
+ * Aho-Corasick automaton for the texts passed to Expect(). The failure
+ * links are folded into the transition table, so matching is one table
+ * lookup per byte.
+ */
+typedef struct {
+    int (*delta)[256];		/* transitions */
+    int *match;			/* per state: first text ending here, or -1 */
+} expect_ac_t;
+
+/*
+ * One text passed to Wait(StringAt). The text is compiled into a bitmap of
+ * the EBCDIC codes that display as each of its characters, so checking plain
+ * 3270 cells needs no translation.
+ */
+typedef struct {
+    int baddr;			/* buffer address */
+    char *string;		/* text to match */
+    int ncells;			/* cells covered, or -1 if not compiled */
+    unsigned char (*accept)[32];/* per cell: matching EBCDIC codes */
+    bool *blank;		/* per cell: text is a blank */
+    unsigned char odd[32];	/* EBCDIC codes with no translation */
+    bool monocase;		/* MONOCASE setting when compiled */
+    unsigned long epoch;	/* code page epoch when compiled */
+    int fa_addr;		/* field attribute address at last check */
+} string_match_t;
+
 typedef struct task {
     /* Common fields. */
     struct task *next;		/**< next task on the stack */
@@ -158,14 +187,18 @@ typedef struct task {
 
     struct {
 	int baddr;	/* location for wait operations */
-	char *string;	/* string to wait for */
-	bool force_utf8;/* true if string is UTF-8 */
+	string_match_t *strings; /* strings to wait for */
+	unsigned nstrings; /* number of strings */
+	bool force_utf8;/* true if strings are UTF-8 */
+	unsigned long generation; /* screen generation at last check */
     } match;
 
     /* Expect() fields. */
     struct {
-	char   *text;	/* text to match */
-	size_t	len;	/* length of match */
+	expect_ac_t *ac;/* automaton for the texts to match */
+	int	state;	/* automaton state */
+	uint64_t next;	/* NVT stream offset of the next byte to scan */
+	bool	report;	/* report which text matched */
     } expect;
 
     /* Macro fields. */
@@ -234,8 +267,11 @@ static const char *task_state_name[] = {
 
 static struct macro_def *macro_last = (struct macro_def *) NULL;
 static unsigned char *nvt_save_buf;
+static size_t   nvt_save_size = 0;
 static size_t   nvt_save_cnt = 0;
 static int      nvt_save_ix = 0;
+static uint64_t nvt_save_total = 0;	/* bytes ever stored */
+static unsigned long codepage_epoch = 0; /* bumped on code page changes */
 static const char *st_name[NUM_ST] = {
     "Macro",		/* MACRO */
     "Callback"		/* CB */
@@ -254,6 +290,7 @@ static void task_pop(void);
 static void wait_timed_out(ioid_t id);
 static task_t *task_redirect_to(void);
 static bool expect_matches(task_t *task);
+static void expect_ac_free(expect_ac_t **acp);
 
 /* Macro that defines that the keyboard is locked due to user input. */
 #define KBWAIT_MASK	(KL_OIA_LOCKED|KL_OIA_TWAIT|KL_DEFERRED_UNLOCK|KL_ENTER_INHIBIT|KL_AWAITING_FIRST|KL_FT|KL_BID)
@@ -305,7 +342,7 @@ static struct {
     { KwUnlock,        0, 0, TS_WAIT_UNLOCK },
     { KwSeconds,       0, 0, TS_TIME_WAIT },
     { KwCursorAt,      1, 2, TS_WAIT_CURSOR_AT },
-    { KwStringAt,      2, 3, TS_WAIT_STRING_AT },
+    { KwStringAt,      2, 3 * WAIT_STRINGS_MAX, TS_WAIT_STRING_AT },
     { KwInputFieldAt,  1, 2, TS_WAIT_IFIELD_AT },
     { NULL, 0, 0 }
 };
@@ -313,6 +350,7 @@ static struct {
 static action_t Abort_action;
 static action_t Ascii_action;
 static action_t Ascii1_action;
+static action_t AsciiDelta_action;
 static action_t AsciiField_action;
 static action_t CloseScript_action;
 static action_t Ebcdic_action;
@@ -566,6 +604,13 @@ Fail_action(ia_t ia, unsigned argc, const char **argv)
     return false;
 }
 
+/* Code page change handler: Wait(StringAt) texts need recompiling. */
+static void
+task_codepage_change(bool ignored _is_unused)
+{
+    codepage_epoch++;
+}
+
 /**
  * Task module registration.
  */
@@ -577,6 +622,7 @@ task_register(void)
 	{ AnAnsiText,		NvtText_action, 0 },
 	{ AnAscii,		Ascii_action, 0 },
 	{ AnAscii1,		Ascii1_action, 0 },
+	{ AnAsciiDelta,		AsciiDelta_action, 0 },
 	{ AnAsciiField,		AsciiField_action, 0 },
 	{ AnBell,		Bell_action, 0 },
 	{ AnCapabilities,	Capabilities_action, ACTION_HIDDEN },
@@ -630,8 +676,8 @@ task_register(void)
     /* Register resources. */
     register_xresources(task_xresources, array_count(task_xresources));
 
-    /* This doesn't go here, but it needs to happen once. */
-    nvt_save_buf = (unsigned char *)Malloc(NVT_SAVE_SIZE);
+    /* Register state change handlers. */
+    register_schange(ST_CODEPAGE, task_codepage_change);
 }
 
 /**
@@ -653,22 +699,48 @@ task_set_state(task_t *s, enum task_state state, const char *why)
     }
 }
 
+/* Free a set of Wait(StringAt) texts. */
+static void
+strings_free(string_match_t *strings, unsigned nstrings)
+{
+    unsigned i;
+
+    for (i = 0; i < nstrings; i++) {
+	Free(strings[i].string);
+	Free(strings[i].accept);
+	Free(strings[i].blank);
+    }
+    Free(strings);
+}
+
 /**
  * Set match parameters.
  *
  * @param[in] s		task to modify
  * @param[in] baddr	buffer address, or -1
- * @param[in] string	string to match, or NULL
- * @param[in] force_utf8 true if string is encoded in UTF-8
+ * @param[in] strings	strings to match, or NULL; the task takes ownership
+ * @param[in] nstrings	number of strings
+ * @param[in] force_utf8 true if strings are encoded in UTF-8
  */
 static void
-task_set_match(task_t *s, int baddr, const char *string, bool force_utf8)
+task_set_match(task_t *s, int baddr, string_match_t *strings,
+	unsigned nstrings, bool force_utf8)
 {
-    vtrace(TASK_NAME_FMT " wait @%d%s\n", TASK_sNAME(s),
-	    baddr, (string != NULL)? txAsprintf(" '%s'", string): "");
+    unsigned i;
+
+    if (nstrings == 0) {
+	vtrace(TASK_NAME_FMT " wait @%d\n", TASK_sNAME(s), baddr);
+    }
+    for (i = 0; i < nstrings; i++) {
+	vtrace(TASK_NAME_FMT " wait @%d '%s'\n", TASK_sNAME(s),
+		strings[i].baddr, strings[i].string);
+    }
     s->match.baddr = baddr;
-    s->match.string = NewString(string);
+    strings_free(s->match.strings, s->match.nstrings);
+    s->match.strings = strings;
+    s->match.nstrings = nstrings;
     s->match.force_utf8 = force_utf8;
+    s->match.generation = screen_generation;
 }
 
 /* Allocate a new task. */
@@ -692,7 +764,8 @@ new_task(enum task_type type, taskq_t *q)
     s->fatal = false;
     s->is_ft = false;
     s->match.baddr = -1;
-    s->match.string = NULL;
+    s->match.strings = NULL;
+    s->match.nstrings = 0;
     s->match.force_utf8 = false;
 
     return s;
@@ -765,7 +838,7 @@ free_task(task_t *t)
 
     /* Free auxiliary buffers. */
     Replace(t->macro.msc, NULL);
-    Replace(t->expect.text, NULL);
+    expect_ac_free(&t->expect.ac);
     if (t->macro.cmds != NULL) {
 	int i, j;
 	cmd_t *c;
@@ -782,7 +855,8 @@ free_task(task_t *t)
 	Replace(t->macro.cmds, NULL);
 	t->macro.cmd_next = NULL;
     }
-    Replace(t->match.string, NULL);
+    strings_free(t->match.strings, t->match.nstrings);
+    t->match.strings = NULL;
     
     /* Free the structure. */
     Free(t);
@@ -2179,6 +2253,216 @@ grab_string(int baddr, size_t len, struct ea *buf, bool force_utf8)
     return ret;
 }
 
+#define BM_SET(bm, c)	((bm)[(c) >> 3] |= 1 << ((c) & 7))
+#define BM_ISSET(bm, c)	((bm)[(c) >> 3] & (1 << ((c) & 7)))
+
+/**
+ * Compile a Wait(StringAt) text: for each of its characters, the set of
+ * EBCDIC codes that display as that character.
+ * A text that is not valid multibyte is left uncompiled, and is always
+ * checked by translating the screen.
+ *
+ * @param[in,out] m	text to compile
+ * @param[in] force_utf8 true if the text is encoded in UTF-8
+ */
+static void
+string_match_compile(string_match_t *m, bool force_utf8)
+{
+    unsigned flags = EUO_BLANK_UNDEF | (toggled(MONOCASE)? EUO_TOUPPER: 0);
+    const char *s = m->string;
+    size_t len = strlen(s);
+    int n = 0;
+    int e;
+
+    Replace(m->accept, NULL);
+    Replace(m->blank, NULL);
+    m->ncells = -1;
+    m->monocase = toggled(MONOCASE);
+    m->epoch = codepage_epoch;
+
+    memset(m->odd, 0, sizeof(m->odd));
+    for (e = 0; e < 256; e++) {
+	const char *mb;
+
+	if (ebcdic_to_multibyte_fc(e, CS_BASE, flags, force_utf8, &mb) <= 1) {
+	    BM_SET(m->odd, e);
+	}
+    }
+
+    /* Each character is at least one byte, so len bounds the cell count. */
+    m->accept = (unsigned char (*)[32])Malloc((len + 1) * sizeof(*m->accept));
+    m->blank = (bool *)Malloc((len + 1) * sizeof(bool));
+    while (len > 0) {
+	int consumed;
+	enum me_fail error;
+
+	if (multibyte_to_unicode_f(s, len, &consumed, &error,
+		    force_utf8) == 0 || consumed <= 0) {
+	    Replace(m->accept, NULL);
+	    Replace(m->blank, NULL);
+	    return;
+	}
+	memset(m->accept[n], 0, sizeof(m->accept[n]));
+	for (e = 0; e < 256; e++) {
+	    const char *mb;
+	    size_t xlen = ebcdic_to_multibyte_fc(e, CS_BASE, flags,
+		    force_utf8, &mb);
+
+	    if (xlen == (size_t)consumed + 1 && !memcmp(mb, s, consumed)) {
+		BM_SET(m->accept[n], e);
+	    }
+	}
+	m->blank[n] = consumed == 1 && *s == ' ';
+	n++;
+	s += consumed;
+	len -= consumed;
+    }
+    m->ncells = n;
+}
+
+/* Check a Wait(StringAt) text by translating the screen. */
+static bool
+string_match_translated(string_match_t *m, bool force_utf8)
+{
+    char *current_string = grab_string(m->baddr, strlen(m->string), ea_buf,
+	    force_utf8);
+    bool match = !strcmp(current_string, m->string);
+
+    Free(current_string);
+    return match;
+}
+
+/**
+ * Check a Wait(StringAt) text against the screen.
+ * Plain 3270 cells are compared against the compiled form; anything else
+ * (NVT text, DBCS, character sets) falls back to translating the screen.
+ *
+ * @param[in,out] m	text to check
+ * @param[in] force_utf8 true if the text is encoded in UTF-8
+ *
+ * @return true if the text is present
+ */
+static bool
+string_match_check(string_match_t *m, bool force_utf8)
+{
+    bool is_zero;
+    int i;
+
+    if (m->baddr >= ROWS * COLS) {
+	return false;
+    }
+    if (m->ncells < 0 || m->monocase != toggled(MONOCASE) ||
+	    m->epoch != codepage_epoch) {
+	string_match_compile(m, force_utf8);
+    }
+    m->fa_addr = find_field_attribute(m->baddr);
+    if (m->ncells < 0) {
+	return string_match_translated(m, force_utf8);
+    }
+
+    is_zero = FA_IS_ZERO(get_field_attribute(m->baddr));
+    for (i = 0; i < m->ncells; i++) {
+	int baddr = (m->baddr + i) % (ROWS * COLS);
+	struct ea *ea = &ea_buf[baddr];
+
+	if (ea->fa) {
+	    is_zero = FA_IS_ZERO(ea->fa);
+	    if (!m->blank[i]) {
+		return false;
+	    }
+	} else if (is_zero) {
+	    if (!m->blank[i]) {
+		return false;
+	    }
+	} else if (ea->cs != CS_BASE || ea->ucs4 != 0 ||
+		ctlr_dbcs_state(baddr) != DBCS_NONE ||
+		BM_ISSET(m->odd, ea->ec)) {
+	    return string_match_translated(m, force_utf8);
+	} else if (!BM_ISSET(m->accept[i], ea->ec)) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+/**
+ * Test whether a Wait(StringAt) text could have changed since a given screen
+ * generation: its rows were written, the attribute of the field it starts in
+ * changed, or the way it was compiled is out of date.
+ *
+ * @param[in] m		text to test
+ * @param[in] since	screen generation of the last check
+ *
+ * @return true if the text needs checking
+ */
+static bool
+string_match_changed(string_match_t *m, unsigned long since)
+{
+    int row, last;
+
+    if (since == screen_generation) {
+	return m->monocase != toggled(MONOCASE) ||
+	    m->epoch != codepage_epoch;
+    }
+    if (m->ncells <= 0 || m->ncells >= ROWS * COLS ||
+	    m->baddr >= ROWS * COLS ||
+	    m->monocase != toggled(MONOCASE) ||
+	    m->epoch != codepage_epoch ||
+	    find_field_attribute(m->baddr) != m->fa_addr ||
+	    (m->fa_addr >= 0 && row_generation[m->fa_addr / COLS] > since)) {
+	return true;
+    }
+    row = m->baddr / COLS;
+    last = ((m->baddr + m->ncells - 1) % (ROWS * COLS)) / COLS;
+    for (;;) {
+	if (row_generation[row] > since) {
+	    return true;
+	}
+	if (row == last) {
+	    break;
+	}
+	row = (row + 1) % ROWS;
+    }
+    return false;
+}
+
+/**
+ * Check a set of Wait(StringAt) texts.
+ * If more than one text was given, the index of the match is output.
+ *
+ * @param[in,out] strings texts to check
+ * @param[in] nstrings	number of texts
+ * @param[in] force_utf8 true if the texts are encoded in UTF-8
+ * @param[in,out] since	screen generation of the last check, updated; or
+ *			NULL to check every text
+ *
+ * @return index of the first text present, or -1
+ */
+static int
+strings_match(string_match_t *strings, unsigned nstrings, bool force_utf8,
+	unsigned long *since)
+{
+    unsigned i;
+    int match = -1;
+
+    for (i = 0; i < nstrings; i++) {
+	if (since != NULL && !string_match_changed(&strings[i], *since)) {
+	    continue;
+	}
+	if (string_match_check(&strings[i], force_utf8)) {
+	    match = (int)i;
+	    break;
+	}
+    }
+    if (since != NULL) {
+	*since = screen_generation;
+    }
+    if (match >= 0 && nstrings > 1) {
+	action_output("%d", match);
+    }
+    return match;
+}
+
 /**
  * Run one task queue.
  *
@@ -2327,17 +2611,12 @@ run_taskq(void)
 		any = true;
 		break;
 	    }
-	    if (current_task->match.baddr < ROWS * COLS) {
-		char *current_string = grab_string(current_task->match.baddr,
-			strlen(current_task->match.string), ea_buf,
-			current_task->match.force_utf8);
-
-		if (!strcmp(current_string, current_task->match.string)) {
-		    Free(current_string);
-		    any = true;
-		    break;
-		}
-		Free(current_string);
+	    if (strings_match(current_task->match.strings,
+			current_task->match.nstrings,
+			current_task->match.force_utf8,
+			&current_task->match.generation) >= 0) {
+		any = true;
+		break;
 	    }
 	    return any;
 	case TS_WAIT_IFIELD_AT:
@@ -2464,6 +2743,72 @@ set_output_needed(bool needed)
  * Macro- and script-specific actions.
  */
 
+/* Append a byte in hex. */
+static void
+append_hex(varbuf_t *r, unsigned char c)
+{
+    static const char hex[] = "0123456789abcdef";
+    char x[2];
+
+    x[0] = hex[c >> 4];
+    x[1] = hex[c & 0xf];
+    vb_append(r, x, 2);
+}
+
+/*
+ * Append one buffer location in ASCII, tracking whether it is in a
+ * zero-intensity (non-display) field.
+ * Returns false, appending nothing, for the right half of a DBCS character.
+ */
+static bool
+append_ascii(varbuf_t *r, struct ea *buf, int baddr, bool *is_zero,
+	bool monocase, bool force_utf8)
+{
+    char mb[16];
+    const char *mbp;
+    ucs4_t uc;
+    size_t xlen;
+    enum dbcs_state d;
+
+    if (buf[baddr].fa) {
+	*is_zero = FA_IS_ZERO(buf[baddr].fa);
+	vb_append(r, " ", 1);
+	return true;
+    }
+    if (*is_zero) {
+	vb_append(r, " ", 1);
+	return true;
+    }
+    if (IS_RIGHT(d = ctlr_dbcs_state(baddr))) {
+	return false;
+    }
+    if (is_nvt(&buf[baddr], false, &uc)) {
+	/* NVT-mode text. */
+	if (uc >= UPRIV2_Aunderbar && uc <= UPRIV2_Zunderbar) {
+	    uc -= UPRIV2;
+	}
+	if (monocase) {
+	    uc = u_toupper(uc);
+	}
+	xlen = unicode_to_multibyte_f(uc, mb, sizeof(mb), force_utf8);
+	mbp = mb;
+    } else if (IS_LEFT(d)) {
+	/* 3270-mode DBCS text. */
+	xlen = ebcdic_to_multibyte_f((buf[baddr].ec << 8) |
+		buf[baddr + 1].ec, mb, sizeof(mb), force_utf8);
+	mbp = mb;
+    } else {
+	/* 3270-mode text. */
+	xlen = ebcdic_to_multibyte_fc(buf[baddr].ec, buf[baddr].cs,
+		EUO_BLANK_UNDEF | (monocase? EUO_TOUPPER: 0), force_utf8,
+		&mbp);
+    }
+    if (xlen > 1) {
+	vb_append(r, mbp, xlen - 1);
+    }
+    return true;
+}
+
 /*
  * Dump a range of screen locations.
  * Returns true if anything was dumped.
@@ -2475,6 +2820,7 @@ dump_range(int first, int len, bool in_ascii, struct ea *buf,
     int i;
     bool any = false;
     bool is_zero = false;
+    bool monocase = toggled(MONOCASE);
     varbuf_t r;
 
     vb_init(&r);
@@ -2505,52 +2851,9 @@ dump_range(int first, int len, bool in_ascii, struct ea *buf,
 	    any = false;
 	}
 	if (in_ascii) {
-	    char mb[16];
-	    ucs4_t uc;
-	    size_t j;
-	    size_t xlen;
-
-	    if (buf[first + i].fa) {
-		is_zero = FA_IS_ZERO(buf[first + i].fa);
-		vb_appends(&r, " ");
-	    } else if (is_zero) {
-		vb_appends(&r, " ");
-	    } else if (IS_RIGHT(ctlr_dbcs_state(first + i))) {
+	    if (!append_ascii(&r, buf, first + i, &is_zero, monocase,
+			force_utf8)) {
 		continue;
-	    } else {
-		if (is_nvt(&buf[first + i], false, &uc)) {
-		    /* NVT-mode text. */
-		    if (uc >= UPRIV2_Aunderbar && uc <= UPRIV2_Zunderbar) {
-			uc -= UPRIV2;
-		    }
-		    if (toggled(MONOCASE)) {
-			uc = u_toupper(uc);
-		    }
-		    xlen = unicode_to_multibyte_f(uc, mb, sizeof(mb),
-			    force_utf8);
-		    for (j = 0; j < xlen - 1; j++) {
-			vb_appendf(&r, "%c", mb[j]);
-		    }
-		} else {
-		    /* 3270-mode text. */
-		    if (IS_LEFT(ctlr_dbcs_state(first + i))) {
-			xlen = ebcdic_to_multibyte_f((buf[first + i].ec << 8) |
-				buf[first + i + 1].ec,
-				mb, sizeof(mb), force_utf8);
-			for (j = 0; j < xlen - 1; j++) {
-			    vb_appendf(&r, "%c", mb[j]);
-			}
-		    } else {
-			xlen = ebcdic_to_multibyte_fx(buf[first + i].ec,
-				buf[first + i].cs, mb, sizeof(mb),
-				EUO_BLANK_UNDEF |
-				 (toggled(MONOCASE)? EUO_TOUPPER: 0),
-				&uc, force_utf8);
-			for (j = 0; j < xlen - 1; j++) {
-			    vb_appendf(&r, "%c", mb[j]);
-			}
-		    }
-		}
 	    }
 	} else {
 	    ebc_t ebc = 0;
@@ -2568,7 +2871,10 @@ dump_range(int first, int len, bool in_ascii, struct ea *buf,
 		/* 3270-mode text. */
 		ebc = buf[first + i].ec;
 	    }
-	    vb_appendf(&r, "%s%02x", any ? " " : "", ebc);
+	    if (any) {
+		vb_append(&r, " ", 1);
+	    }
+	    append_hex(&r, ebc);
 	}
 	any = true;
     }
@@ -2719,6 +3025,62 @@ AsciiField_action(ia_t ia _is_unused, unsigned argc, const char **argv)
     return dump_field(argc, AnAsciiField, true, IA_UTF8(ia));
 }
 
+/*
+ * AsciiDelta([generation]) action.
+ * Returns the current screen generation, then each row (1-origin) that has
+ * changed since the given generation, in ASCII. With no generation, or one
+ * from the future, returns every row.
+ */
+static bool
+AsciiDelta_action(ia_t ia _is_unused, unsigned argc, const char **argv)
+{
+    unsigned long since = 0;
+    bool all = true;
+    bool monocase = toggled(MONOCASE);
+    int row, col;
+    varbuf_t r;
+
+    action_debug(AnAsciiDelta, ia, argc, argv);
+    if (check_argc(AnAsciiDelta, argc, 0, 1) < 0) {
+	return false;
+    }
+    if (argc > 0) {
+	char *next;
+
+	since = strtoul(argv[0], &next, 10);
+	if (!argv[0][0] || *next != '\0') {
+	    popup_an_error(AnAsciiDelta "(): Invalid generation '%s'",
+		    argv[0]);
+	    return false;
+	}
+	all = since > screen_generation;
+    }
+
+    /* Like Ascii(), this enables Wait(Output). */
+    if (current_task != NULL) {
+	set_output_needed(true);
+    }
+
+    action_output("Generation: %lu", screen_generation);
+    vb_init(&r);
+    for (row = 0; row < ROWS; row++) {
+	bool is_zero;
+
+	if (!all && row_generation[row] <= since) {
+	    continue;
+	}
+	vb_reset(&r);
+	is_zero = FA_IS_ZERO(get_field_attribute(row * COLS));
+	for (col = 0; col < COLS; col++) {
+	    append_ascii(&r, ea_buf, (row * COLS) + col, &is_zero, monocase,
+		    IA_UTF8(ia));
+	}
+	action_output("Row: %d %s", row + 1, vb_buf(&r));
+    }
+    vb_free(&r);
+    return true;
+}
+
 static bool
 Ebcdic_action(ia_t ia _is_unused, unsigned argc, const char **argv)
 {
@@ -2757,6 +3119,137 @@ calc_cs(unsigned char cs)
     }
 }
 
+/* Returns the Unicode value of a buffer location for ReadBuffer. */
+static ucs4_t
+cell_unicode(struct ea *buf, int baddr)
+{
+    ucs4_t uc;
+
+    if (IS_LEFT(ctlr_dbcs_state(baddr))) {
+	if ((uc = buf[baddr].ucs4) == 0) {
+	    uc = ebcdic_to_unicode((buf[baddr].ec << 8) | buf[baddr + 1].ec,
+		    buf[baddr].cs, 0);
+	}
+    } else if (!is_nvt(&buf[baddr], false, &uc)) {
+	/* 3270-mode text. */
+	switch (buf[baddr].ec) {
+	case EBC_null:
+	    uc = 0;
+	    break;
+	case EBC_so:
+	    uc = 0x0e;
+	    break;
+	case EBC_si:
+	    uc = 0x0f;
+	    break;
+	default:
+	    uc = ebcdic_to_unicode(buf[baddr].ec, buf[baddr].cs, 0);
+	    break;
+	}
+    }
+    return uc;
+}
+
+/*
+ * Binary screen image, returned base64-encoded by ReadBuffer(Binary).
+ * Integers are big-endian.
+ *
+ *  version      1 byte, RB_BINARY_VERSION
+ *  generation   8 bytes, screen_generation when the image was taken
+ *  rows         2 bytes
+ *  columns      2 bytes
+ *  cursor       4 bytes, buffer address
+ *  nfields      4 bytes, number of field attributes
+ *  fields       4 bytes each, buffer addresses of the field attributes
+ *  attributes   runs covering the buffer: a 2-byte count, then
+ *               fa fg bg gr cs ic db, 1 byte each
+ *  text         one Unicode value per location, encoded with varint_encode();
+ *               0 for field attributes and the right halves of DBCS
+ *               characters
+ */
+#define RB_BINARY_VERSION	1
+
+/* Append a big-endian integer. */
+static void
+append_be(varbuf_t *r, unsigned long value, int nbytes)
+{
+    char b[8];
+    int i;
+
+    for (i = nbytes - 1; i >= 0; i--) {
+	b[i] = (char)(value & 0xff);
+	value >>= 8;
+    }
+    vb_append(r, b, nbytes);
+}
+
+/* Dump a buffer in binary. */
+static void
+read_buffer_binary(struct ea *buf, int caddr, unsigned long generation)
+{
+    varbuf_t r, fields, runs, text;
+    int baddr;
+    int nfields = 0;
+    int run_start = 0;
+    char *b64;
+
+    vb_init(&fields);
+    vb_init(&runs);
+    vb_init(&text);
+    for (baddr = 0; baddr < ROWS * COLS; baddr++) {
+	struct ea *ea = &buf[baddr];
+	ucs4_t uc = 0;
+	unsigned char v[VARINT_MAX];
+
+	if (ea->fa) {
+	    append_be(&fields, baddr, 4);
+	    nfields++;
+	} else if (!IS_RIGHT(ctlr_dbcs_state(baddr))) {
+	    uc = cell_unicode(buf, baddr);
+	}
+	vb_append(&text, (char *)v, varint_encode(uc, v));
+
+	/* Close the attribute run if the next location differs. */
+	if (baddr + 1 == ROWS * COLS ||
+		baddr + 1 - run_start == 0xffff ||
+		ea[1].fa != ea->fa || ea[1].fg != ea->fg ||
+		ea[1].bg != ea->bg || ea[1].gr != ea->gr ||
+		ea[1].cs != ea->cs || ea[1].ic != ea->ic ||
+		ea[1].db != ea->db) {
+	    char a[7];
+
+	    append_be(&runs, baddr + 1 - run_start, 2);
+	    a[0] = ea->fa;
+	    a[1] = ea->fg;
+	    a[2] = ea->bg;
+	    a[3] = ea->gr;
+	    a[4] = ea->cs;
+	    a[5] = ea->ic;
+	    a[6] = ea->db;
+	    vb_append(&runs, a, sizeof(a));
+	    run_start = baddr + 1;
+	}
+    }
+
+    vb_init(&r);
+    append_be(&r, RB_BINARY_VERSION, 1);
+    append_be(&r, generation, 8);
+    append_be(&r, ROWS, 2);
+    append_be(&r, COLS, 2);
+    append_be(&r, caddr, 4);
+    append_be(&r, nfields, 4);
+    vb_append(&r, vb_buf(&fields), vb_len(&fields));
+    vb_append(&r, vb_buf(&runs), vb_len(&runs));
+    vb_append(&r, vb_buf(&text), vb_len(&text));
+    b64 = base64_encode_len(vb_buf(&r), vb_len(&r));
+    action_output("%s", b64);
+    Free(b64);
+    vb_free(&r);
+    vb_free(&fields);
+    vb_free(&runs);
+    vb_free(&text);
+}
+
 /*
  * Internals of the ReadBuffer action.
  * Operates on the supplied 'buf' parameter, which might be the live
@@ -2764,7 +3257,7 @@ calc_cs(unsigned char cs)
  */
 static bool
 do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
-	bool force_utf8)
+	int caddr, unsigned long generation, bool force_utf8)
 {
     int	baddr;
     unsigned char current_fg = 0x00;
@@ -2772,7 +3265,7 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
     unsigned char current_gr = 0x00;
     unsigned char current_cs = 0x00;
     unsigned char current_ic = 0x00;
-    enum { RB_ASCII, RB_EBCDIC, RB_UNICODE } mode = RB_ASCII;
+    enum { RB_ASCII, RB_EBCDIC, RB_UNICODE, RB_BINARY } mode = RB_ASCII;
     varbuf_t r;
     bool field = false;
     int field_baddr = 0;
@@ -2788,15 +3281,22 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 		mode = RB_EBCDIC;
 	    } else if (!strncasecmp(params[i], KwUnicode, strlen(params[i]))) {
 		mode = RB_UNICODE;
+	    } else if (!strncasecmp(params[i], KwBinary, strlen(params[i]))) {
+		mode = RB_BINARY;
 	    } else if (!strncasecmp(params[i], KwField, strlen(params[i]))) {
 		field = true;
 	    } else {
 		return action_args_are(AnReadBuffer, KwAscii, KwEbcdic,
-			KwUnicode, KwField, NULL);
+			KwUnicode, KwBinary, KwField, NULL);
 		return false;
 	    }
 	}
     }
+    if (mode == RB_BINARY && field) {
+	popup_an_error(AnReadBuffer "(): " KwBinary " and " KwField
+		" are mutually exclusive");
+	return false;
+    }
 
     /*
      * If the client has looked at the live screen, then if they later
@@ -2813,6 +3313,11 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 	set_output_needed(true);
     }
 
+    if (mode == RB_BINARY) {
+	read_buffer_binary(buf, caddr, generation);
+	return true;
+    }
+
     if (field) {
 	if (!formatted) {
 	    popup_an_error(AnReadBuffer "(): no field");
@@ -2912,16 +3417,19 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 		if (buf[baddr].cs & CS_GE) {
 		    vb_appendf(&r, " GE(%02x)", buf[baddr].ec);
 		} else {
-		    vb_appendf(&r, " %02x", buf[baddr].ec);
+		    vb_append(&r, " ", 1);
+		    append_hex(&r, buf[baddr].ec);
 		}
 	    } else if (mode == RB_ASCII) {
 		bool done = false;
 		char mb[16];
+		const char *mbp = mb;
 		size_t j;
 		ucs4_t uc;
 		size_t len;
+		enum dbcs_state d = ctlr_dbcs_state(baddr);
 
-		if (IS_LEFT(ctlr_dbcs_state(baddr))) {
+		if (IS_LEFT(d)) {
 		    if (buf[baddr].ucs4) {
 			/* NVT-mode text. */
 			len = unicode_to_multibyte_f(buf[baddr].ucs4, mb,
@@ -2933,15 +3441,17 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 		    }
 		    vb_appends(&r, " ");
 		    for (j = 0; j < len-1; j++) {
-			vb_appendf(&r, "%02x", mb[j] & 0xff);
+			append_hex(&r, mb[j] & 0xff);
 		    }
 		    done = true;
-		} else if (IS_RIGHT(ctlr_dbcs_state(baddr))) {
+		} else if (IS_RIGHT(d)) {
 		    vb_appends(&r, " -");
 		    done = true;
 		}
 
-		if (is_nvt(&buf[baddr], false, &uc)) {
+		if (done) {
+		    /* Already dumped. */
+		} else if (is_nvt(&buf[baddr], false, &uc)) {
 		    /* NVT-mode text. */
 		    len = unicode_to_multibyte_f(uc, mb, sizeof(mb),
 			    force_utf8);
@@ -2960,56 +3470,28 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 			mb[1] = '\0';
 			break;
 		    default:
-			ebcdic_to_multibyte_fx(buf[baddr].ec, buf[baddr].cs,
-				mb, sizeof(mb), EUO_NONE, &uc, force_utf8);
+			ebcdic_to_multibyte_fc(buf[baddr].ec, buf[baddr].cs,
+				EUO_NONE, force_utf8, &mbp);
 			break;
 		    }
 		}
 
 		if (!done) {
-		    vb_appends(&r, " ");
-		    if (mb[0] == '\0') {
-			vb_appends(&r, "00");
+		    vb_append(&r, " ", 1);
+		    if (mbp[0] == '\0') {
+			vb_append(&r, "00", 2);
 		    } else {
-			for (j = 0; mb[j]; j++) {
-			    vb_appendf(&r, "%02x", mb[j] & 0xff);
+			for (j = 0; mbp[j]; j++) {
+			    append_hex(&r, mbp[j] & 0xff);
 			}
 		    }
 		}
 	    } else {
 		/* Unicode. */
-		ucs4_t uc;
-
 		if (IS_RIGHT(ctlr_dbcs_state(baddr))) {
 		    vb_appends(&r, " -");
 		} else {
-		    if (IS_LEFT(ctlr_dbcs_state(baddr))) {
-			if ((uc = buf[baddr].ucs4) == 0) {
-			    uc = ebcdic_to_unicode(
-				    (buf[baddr].ec << 8) | buf[baddr + 1].ec,
-				    buf[baddr].cs, 0);
-			}
-		    } else {
-			if (!is_nvt(&buf[baddr], false, &uc)) {
-			    /* 3270-mode text. */
-			    switch (buf[baddr].ec) {
-			    case EBC_null:
-				uc = 0;
-				break;
-			    case EBC_so:
-				uc = 0x0e;
-				break;
-			    case EBC_si:
-				uc = 0x0f;
-				break;
-			    default:
-				uc = ebcdic_to_unicode(buf[baddr].ec,
-					buf[baddr].cs, 0);
-				break;
-			    }
-			}
-		    }
-		    vb_appendf(&r, " %04x", uc);
+		    vb_appendf(&r, " %04x", cell_unicode(buf, baddr));
 		}
 	    }
 	}
@@ -3034,7 +3516,8 @@ static bool
 ReadBuffer_action(ia_t ia _is_unused, unsigned argc, const char **argv)
 {
     action_debug(AnReadBuffer, ia, argc, argv);
-    return do_read_buffer(argv, argc, ea_buf, IA_UTF8(ia));
+    return do_read_buffer(argv, argc, ea_buf, cursor_addr, screen_generation,
+	    IA_UTF8(ia));
 }
 
 /*
@@ -3230,6 +3713,7 @@ static int snap_cols = 0;
 static int snap_field_start = -1;
 static int snap_field_length = -1;
 static int snap_caddr = 0;
+static unsigned long snap_generation = 0;
 
 static void
 snap_save(void)
@@ -3262,6 +3746,7 @@ snap_save(void)
 	} while (baddr != snap_field_start);
     }
     snap_caddr = cursor_addr;
+    snap_generation = screen_generation;
 }
 
 /*
@@ -3421,7 +3906,8 @@ Snap_action(ia_t ia _is_unused, unsigned argc, const char **argv)
 	    popup_an_error(AnSnap "(): No saved state");
 	    return false;
 	}
-	return do_read_buffer(argv + 1, argc - 1, snap_buf, IA_UTF8(ia));
+	return do_read_buffer(argv + 1, argc - 1, snap_buf, snap_caddr,
+		snap_generation, IA_UTF8(ia));
     } else {
 	return action_args_are(AnSnap, KwSave, KwSnapStatus, KwRows, KwCols,
 		AnWait, AnAscii, AnAscii1, AnEbcdic, AnEbcdic1, AnReadBuffer,
@@ -3509,7 +3995,9 @@ Wait_action(ia_t ia _is_unused, unsigned argc, const char **argv)
     const char **pr;
     int i;
     int match_baddr = -1;
-    const char *match_string = NULL;
+    string_match_t *strings = NULL;
+    unsigned nstrings = 0;
+    unsigned j;
     char *next_why;
 #define CONNECTED_CHECK do { \
     if (next_state != TS_TIME_WAIT && !(CONNECTED || HALF_CONNECTED)) { \
@@ -3607,22 +4095,31 @@ Wait_action(ia_t ia _is_unused, unsigned argc, const char **argv)
 	}
 	break;
     case TS_WAIT_STRING_AT:
-	CONNECTED_CHECK;
-	if (!parse_rco(AnWait, KwStringAt, np - 2, pr + 1, &match_baddr)) {
+	if (np - 1 > 3 && (np - 1) % 3 != 0) {
+	    popup_an_error(AnWait "(" KwStringAt ") requires row, column "
+		    "and text for each text");
 	    return false;
 	}
 	CONNECTED_CHECK;
-	match_string = pr[np - 1];
-	if (match_baddr < ROWS * COLS) {
-	    char *current_string = grab_string(match_baddr,
-		    strlen(match_string), ea_buf, ia == IA_HTTPD);
-
-	    if (!strcmp(current_string, match_string)) {
-		Free(current_string);
-		return true;
+	nstrings = (np - 1 > 3)? (np - 1) / 3: 1;
+	strings = (string_match_t *)Calloc(nstrings, sizeof(string_match_t));
+	for (j = 0; j < nstrings; j++) {
+	    unsigned sargc = (nstrings > 1)? 3: np - 1;
+	    const char **sargv = pr + 1 + (j * 3);
+
+	    if (!parse_rco(AnWait, KwStringAt, sargc - 1, sargv,
+			&strings[j].baddr)) {
+		strings_free(strings, j);
+		return false;
 	    }
-	    Free(current_string);
+	    strings[j].string = NewString(sargv[sargc - 1]);
+	    strings[j].ncells = -1;
 	}
+	if (strings_match(strings, nstrings, IA_UTF8(ia), NULL) >= 0) {
+	    strings_free(strings, nstrings);
+	    return true;
+	}
+	match_baddr = strings[0].baddr;
 	break;
     case TS_WAIT_IFIELD_AT:
 	if (!parse_rco(AnWait, KwInputFieldAt, np - 1, pr + 1, &match_baddr)) {
@@ -3647,8 +4144,8 @@ Wait_action(ia_t ia _is_unused, unsigned argc, const char **argv)
 	    find_wait_kw(next_state));
     task_set_state(current_task, next_state, next_why);
     if (match_baddr >= 0) {
-	task_set_match(current_task, match_baddr, match_string,
-		ia == IA_HTTPD);
+	task_set_match(current_task, match_baddr, strings, nstrings,
+		IA_UTF8(ia));
     }
 
     /* Set up a timeout, if they want one. */
@@ -3793,19 +4290,21 @@ task_active(void)
     return current_task != NULL;
 }
 
-/* Translate an expect string (uses C escape syntax). */
-static void
-expand_expect(task_t *task, const char *s)
+/*
+ * Translate an expect string (uses C escape syntax).
+ * Returns a malloc'd buffer and its length.
+ */
+static char *
+expand_expect(const char *s, size_t *lenp)
 {
-    char *t = Malloc(strlen(s) + 1);
+    char *ret = Malloc(strlen(s) + 1);
+    char *t = ret;
     char c;
     enum { XS_BASE, XS_BS, XS_O, XS_X } state = XS_BASE;
     int n = 0;
     int nd = 0;
     static char hexes[] = "0123456789abcdef";
 
-    task->expect.text = t;
-
     while ((c = *s++)) {
 	switch (state) {
 	case XS_BASE:
@@ -3877,56 +4376,170 @@ expand_expect(task_t *task, const char *s)
 	    break;
 	}
     }
-    task->expect.len = t - task->expect.text;
+    *lenp = t - ret;
+    return ret;
 }
 
-/* 'mem' version of strstr */
-static char *
-memstr(char *s1, char *s2, int n1, int n2)
+/* Build an Aho-Corasick automaton for a set of expect strings. */
+static expect_ac_t *
+expect_ac_build(const char **texts, unsigned count)
 {
-    int i;
+    expect_ac_t *ac = (expect_ac_t *)Malloc(sizeof(expect_ac_t));
+    char **xtexts = (char **)Malloc(count * sizeof(char *));
+    size_t *lens = (size_t *)Malloc(count * sizeof(size_t));
+    int *fail;
+    int *queue;
+    int max_states = 1;
+    int nstates = 1;
+    int head = 0, tail = 0;
+    unsigned i;
+    int c;
+
+    for (i = 0; i < count; i++) {
+	xtexts[i] = expand_expect(texts[i], &lens[i]);
+	max_states += (int)lens[i];
+    }
+    ac->delta = Malloc(max_states * sizeof(*ac->delta));
+    ac->match = (int *)Malloc(max_states * sizeof(int));
+    fail = (int *)Malloc(max_states * sizeof(int));
+    queue = (int *)Malloc(max_states * sizeof(int));
+    memset(ac->delta, -1, max_states * sizeof(*ac->delta));
+    ac->match[0] = -1;
+
+    /* Build the trie. The first of any duplicate texts wins. */
+    for (i = 0; i < count; i++) {
+	int state = 0;
+	size_t j;
 
-    for (i = 0; i <= n1 - n2; i++, s1++) {
-	if (*s1 == *s2 && !memcmp(s1, s2, n2)) {
-	    return s1;
+	for (j = 0; j < lens[i]; j++) {
+	    unsigned char b = xtexts[i][j];
+
+	    if (ac->delta[state][b] < 0) {
+		ac->match[nstates] = -1;
+		ac->delta[state][b] = nstates++;
+	    }
+	    state = ac->delta[state][b];
 	}
+	if (ac->match[state] < 0) {
+	    ac->match[state] = (int)i;
+	}
+	Free(xtexts[i]);
+    }
+    Free(xtexts);
+    Free(lens);
+
+    /*
+     * Fold in the failure links, breadth first. A state also matches
+     * whatever its failure state matches, in case one text is a suffix of
+     * another; the lower-numbered text is reported.
+     */
+    for (c = 0; c < 256; c++) {
+	if (ac->delta[0][c] < 0) {
+	    ac->delta[0][c] = 0;
+	} else {
+	    fail[ac->delta[0][c]] = 0;
+	    queue[tail++] = ac->delta[0][c];
+	}
+    }
+    while (head < tail) {
+	int state = queue[head++];
+
+	for (c = 0; c < 256; c++) {
+	    int next = ac->delta[state][c];
+
+	    if (next < 0) {
+		ac->delta[state][c] = ac->delta[fail[state]][c];
+		continue;
+	    }
+	    fail[next] = ac->delta[fail[state]][c];
+	    if (ac->match[fail[next]] >= 0 &&
+		    (ac->match[next] < 0 ||
+		     ac->match[fail[next]] < ac->match[next])) {
+		ac->match[next] = ac->match[fail[next]];
+	    }
+	    queue[tail++] = next;
+	}
+    }
+    Free(fail);
+    Free(queue);
+    return ac;
+}
+
+/* Free an expect automaton. */
+static void
+expect_ac_free(expect_ac_t **acp)
+{
+    if (*acp != NULL) {
+	Free((*acp)->delta);
+	Free((*acp)->match);
+	Replace(*acp, NULL);
     }
-    return NULL;
 }
 
-/* Check for a match against an expect string. */
+/*
+ * Check for a match against the expect strings.
+ * The automaton state is kept in the task, so each byte of NVT text is
+ * examined only once, no matter how often this is called.
+ */
 static bool
 expect_matches(task_t *task)
 {
-    size_t ix, i;
-    unsigned char buf[NVT_SAVE_SIZE];
-    char *t;
+    expect_ac_t *ac = task->expect.ac;
+    uint64_t start = nvt_save_total - nvt_save_cnt;
+    int state = task->expect.state;
+    int match = ac->match[0];
+    size_t ix = 0;
 
-    ix = (nvt_save_ix + NVT_SAVE_SIZE - nvt_save_cnt) % NVT_SAVE_SIZE;
-    for (i = 0; i < nvt_save_cnt; i++) {
-	buf[i] = nvt_save_buf[(ix + i) % NVT_SAVE_SIZE];
+    if (task->expect.next < start) {
+	/* Text was consumed or overwritten since the last scan. */
+	task->expect.next = start;
+	state = 0;
     }
-    t = memstr((char *)buf, task->expect.text, (int)nvt_save_cnt,
-	    (int)task->expect.len);
-    if (t != NULL) {
-	nvt_save_cnt -= ((unsigned char *)t - buf) + task->expect.len;
-	Replace(task->expect.text, NULL);
-	return true;
-    } else {
+    if (task->expect.next < nvt_save_total) {
+	ix = (nvt_save_ix + nvt_save_size - (size_t)(nvt_save_total -
+		    task->expect.next)) % nvt_save_size;
+    }
+    while (match < 0 && task->expect.next < nvt_save_total) {
+	state = ac->delta[state][nvt_save_buf[ix]];
+	match = ac->match[state];
+	task->expect.next++;
+	if (++ix == nvt_save_size) {
+	    ix = 0;
+	}
+    }
+    task->expect.state = state;
+    if (match < 0) {
 	return false;
     }
+
+    /* Consume the text, up through the match. */
+    nvt_save_cnt = (size_t)(nvt_save_total - task->expect.next);
+    if (task->expect.report) {
+	action_output("%d", match);
+    }
+    expect_ac_free(&task->expect.ac);
+    return true;
 }
 
 /* Store an NVT character for use by the Expect action. */
 void
 task_store(unsigned char c)
 {
+    if (nvt_save_buf == NULL) {
+	nvt_save_size = (appres.expect_buffer_size > NVT_SAVE_MIN)?
+	    appres.expect_buffer_size: NVT_SAVE_MIN;
+	nvt_save_buf = (unsigned char *)Malloc(nvt_save_size);
+    }
+
     /* Save the character in the buffer. */
     nvt_save_buf[nvt_save_ix++] = c;
-    nvt_save_ix %= NVT_SAVE_SIZE;
-    if (nvt_save_cnt < NVT_SAVE_SIZE) {
+    if ((size_t)nvt_save_ix == nvt_save_size) {
+	nvt_save_ix = 0;
+    }
+    if (nvt_save_cnt < nvt_save_size) {
 	nvt_save_cnt++;
     }
+    nvt_save_total++;
 }
 
 /* Dump whatever NVT data has been sent by the host since last called. */
@@ -3948,10 +4561,10 @@ NvtText_action(ia_t ia, unsigned argc, const char **argv)
 	return true;
     }
 
-    ix = (nvt_save_ix + NVT_SAVE_SIZE - nvt_save_cnt) % NVT_SAVE_SIZE;
+    ix = (nvt_save_ix + nvt_save_size - nvt_save_cnt) % nvt_save_size;
     vb_init(&r);
     for (i = 0; i < nvt_save_cnt; i++) {
-	c = nvt_save_buf[(ix + i) % NVT_SAVE_SIZE];
+	c = nvt_save_buf[(ix + i) % nvt_save_size];
 	if (!(c & ~0x1f)) switch (c) {
 	    case '\n':
 		vb_appends(&r, "\\n");
@@ -4050,7 +4663,7 @@ expect_timed_out(ioid_t id)
 	return;
     }
 
-    Replace(s->expect.text, NULL);
+    expect_ac_free(&s->expect.ac);
 
     current_task = s;
     popup_an_error(AnExpect "(): Timed out");
@@ -4108,14 +4721,39 @@ wait_timed_out(ioid_t id)
     s->wait_id = NULL_IOID;
 }
 
-/* Wait for a string from the host (NVT mode only). */
+/*
+ * Parse an Expect() timeout, which must be all digits.
+ * Returns the value, or -1 if it is not a number.
+ */
+static long
+expect_timeout(const char *arg)
+{
+    char *end;
+    long l;
+
+    if (!isdigit((unsigned char)arg[0])) {
+	return -1;
+    }
+    l = strtol(arg, &end, 10);
+    return (*end == '\0')? l: -1;
+}
+
+/*
+ * Wait for a string from the host (NVT mode only).
+ *  Expect(text[,timeout])
+ *  Expect([-Timeout,timeout,]text,text...)
+ * With more than one text, outputs the index of the one that matched. A
+ * timeout without -Timeout is recognized only in the original two-argument
+ * syntax, and only if it is all digits.
+ */
 static bool
 Expect_action(ia_t ia, unsigned argc, const char **argv)
 {
-    int tmo;
+    const char *tmo_arg = NULL;
+    int tmo = 30;
 
     action_debug(AnExpect, ia, argc, argv);
-    if (check_argc(AnExpect, argc, 1, 2) < 0) {
+    if (check_argc(AnExpect, argc, 1, 0xffff) < 0) {
 	return false;
     }
 
@@ -4124,18 +4762,35 @@ Expect_action(ia_t ia, unsigned argc, const char **argv)
 	popup_an_error(AnExpect "() is valid only when connected in NVT mode");
 	return false;
     }
-    if (argc == 2) {
-	tmo = atoi(argv[1]);
-	if (tmo < 1 || tmo > 600) {
-	    popup_an_error(AnExpect "(): Invalid timeout: %s", argv[1]);
+    if (argc > 1 && !strcasecmp(argv[0], KwDashTimeout)) {
+	if (argc < 3) {
+	    popup_an_error(AnExpect "(): Missing text");
 	    return false;
 	}
-    } else {
-	tmo = 30;
+	tmo_arg = argv[1];
+	argc -= 2;
+	argv += 2;
+    } else if (argc == 2 && expect_timeout(argv[1]) >= 0) {
+	/* The original syntax, Expect(text,timeout). */
+	tmo_arg = argv[1];
+	argc--;
+    }
+    if (tmo_arg != NULL) {
+	long l = expect_timeout(tmo_arg);
+
+	if (l < 1 || l > 600) {
+	    popup_an_error(AnExpect "(): Invalid timeout: %s", tmo_arg);
+	    return false;
+	}
+	tmo = (int)l;
     }
 
     /* See if the text is there already; if not, wait for it. */
-    expand_expect(current_task, argv[0]);
+    expect_ac_free(&current_task->expect.ac);
+    current_task->expect.ac = expect_ac_build(argv, argc);
+    current_task->expect.state = 0;
+    current_task->expect.next = 0;
+    current_task->expect.report = argc > 1;
     if (!expect_matches(current_task)) {
 	current_task->expect_id = AddTimeOut(tmo * 1000, expect_timed_out);
 	task_set_state(current_task, TS_EXPECTING, AnExpect "()");
@@ -64,6 +64,7 @@
 #include "actions.h"
 #include "b3270proto.h"
 #include "b8.h"
+#include "bintrace.h"
 #include "boolstr.h"
 #include "ctlrc.h"
 #include "host.h"
@@ -224,9 +225,11 @@ static ntim_t ntim = NTIM_UNKNOWN;
 static ntim_t parse_ntim(const char *value);
 
 static bool telnet_fsm(unsigned char c);
+static size_t telnet_fsm_run(const unsigned char *buf, size_t len);
 static void net_rawout(unsigned const char *buf, size_t len);
 static void check_in3270(void);
 static void store3270in(unsigned char c);
+static void store3270in_run(const unsigned char *buf, size_t len);
 static void check_linemode(bool init);
 static int non_blocking(bool on);
 static void net_connected(void);
@@ -608,8 +611,7 @@ finish_connect(iosrc_t *iosrc)
 static void
 resolve_done(iosrc_t fd, ioid_t id)
 {
-    int nr;
-    char slot_byte;
+    ssize_t nr;
     int slot;
     int rv;
     char *errmsg;
@@ -617,17 +619,17 @@ resolve_done(iosrc_t fd, ioid_t id)
     net_connect_t nc;
 
     /* Read the data, which is the slot number. */
-    nr = read(resolver_pipe[0], &slot_byte, 1);
+    nr = read(resolver_pipe[0], &slot, sizeof(slot));
     if (nr < 0) {
 	popup_an_errno(errno, "Resolver pipe");
 	return;
     }
-    if (nr == 0) {
+    if (nr != sizeof(slot)) {
 	popup_an_error("Resolver pipe EOF");
+	return;
     }
 
     /* Might be a canceled request. */
-    slot = (int)slot_byte;
     if (slot != resolver_slot) {
 	vtrace("Cleaning up canceled resolver slot %d\n", slot);
 	cleanup_host_and_port(slot);
@@ -1015,7 +1017,14 @@ net_connected_complete(void)
 	Free(buf);
     }
 
-    /* set up NOP transmission */
+    /*
+     * set up NOP transmission (the interval may have been changed while the
+     * connection was pending, so cancel any existing timer first)
+     */
+    if (nop_timeout_id != NULL_IOID) {
+	RemoveTimeOut(nop_timeout_id);
+	nop_timeout_id = NULL_IOID;
+    }
     if (appres.nop_seconds > 0 && !HOST_FLAG(NO_TELNET_HOST)) {
 	nop_timeout_id = AddTimeOut(appres.nop_seconds * 1000, send_nop);
     }
@@ -1515,10 +1524,12 @@ net_input(iosrc_t fd _is_unused, ioid_t id _is_unused)
     }
 
     trace_netdata('<', netrbuf, nr);
+    bintrace_netdata(BINTRACE_HOST, netrbuf, nr);
 
     ns_brcvd += nr;
     stats_poke();
-    for (cp = netrbuf; cp < (netrbuf + nr); cp++) {
+    cp = netrbuf;
+    while (cp < (netrbuf + nr)) {
 #if defined(LOCAL_PROCESS) /*[*/
 	if (local_process) {
 	    /* More to do here, probably. */
@@ -1533,6 +1544,14 @@ net_input(iosrc_t fd _is_unused, ioid_t id _is_unused)
 	    nvt_process((unsigned int) *cp);
 	} else {
 #endif /*]*/
+	    size_t run;
+
+	    /* Store any run of 3270 data in bulk. */
+	    run = telnet_fsm_run(cp, (netrbuf + nr) - cp);
+	    if (run) {
+		cp += run;
+		continue;
+	    }
 	    if (!telnet_fsm(*cp)) {
 		ctlr_dbcs_postprocess();
 		host_disconnect(true);
@@ -1541,6 +1560,7 @@ net_input(iosrc_t fd _is_unused, ioid_t id _is_unused)
 #if defined(LOCAL_PROCESS) /*[*/
 	}
 #endif /*]*/
+	cp++;
     }
 
     if (IN_NVT) {
@@ -1669,6 +1689,39 @@ force_local(char *s)
 #define force_local(s)
 #endif /*]*/
 
+/*
+ * telnet_fsm_run
+ *	Fast path for the telnet finite-state machine.
+ *	If the state machine is in the data state and is accumulating 3270
+ *	data, copies everything up to the next IAC into the 3270 input buffer
+ *	in one operation.
+ *	Returns the number of bytes consumed, or 0 if the next byte needs to
+ *	go through telnet_fsm.
+ */
+static size_t
+telnet_fsm_run(const unsigned char *buf, size_t len)
+{
+    const unsigned char *iac;
+    size_t n;
+
+    if (telnet_state != TNS_DATA ||
+	    cstate == TELNET_PENDING ||
+	    (IN_NVT && !IN_E)) {
+	return 0;
+    }
+
+    if (HOST_FLAG(NO_TELNET_HOST)) {
+	n = len;
+    } else {
+	iac = (const unsigned char *)memchr(buf, IAC, len);
+	n = (iac != NULL)? (size_t)(iac - buf): len;
+    }
+    if (n) {
+	store3270in_run(buf, n);
+    }
+    return n;
+}
+
 /*
  * telnet_fsm
  *	Telnet finite-state machine.
@@ -2904,6 +2957,7 @@ net_rawout(unsigned const char *buf, size_t len)
     int nw;
 
     trace_netdata('>', buf, len);
+    bintrace_netdata(BINTRACE_EMUL, buf, len);
 
     while (len) {
 #if defined(OMTU) /*[*/
@@ -3114,6 +3168,27 @@ store3270in(unsigned char c)
     *ibptr++ = c;
 }
 
+/*
+ * store3270in_run
+ *	Store a run of characters in the 3270 input buffer, growing ibuf to
+ *	hold all of them if necessary.
+ */
+static void
+store3270in_run(const unsigned char *buf, size_t len)
+{
+    size_t used = ibptr - ibuf;
+
+    if (used + len > (size_t)ibuf_size) {
+	while (used + len > (size_t)ibuf_size) {
+	    ibuf_size += BUFSIZ;
+	}
+	ibuf = (unsigned char *)Realloc((char *)ibuf, ibuf_size);
+	ibptr = ibuf + used;
+    }
+    memcpy(ibptr, buf, len);
+    ibptr += len;
+}
+
 /*
  * space3270out
  *	Ensure that <n> more characters will fit in the 3270 output buffer.
@@ -47,6 +47,7 @@
 #include "child.h"
 #include "ctlrc.h"
 #include "find_console.h"
+#include "varbuf.h"	/* must precede fprint_screen.h */
 #include "fprint_screen.h"
 #include "menubar.h"
 #include "model.h"
@@ -86,6 +87,12 @@
 #define MIN_TRACEFILE_SIZE	(64*1024)
 #define MIN_TRACEFILE_SIZE_NAME	"64K"
 
+/* Minimum size of a trace buffer. */
+#define MIN_TRACE_BUFFER_SIZE	(4*1024)
+
+/* How long buffered trace output can sit before it is written. */
+#define TRACE_FLUSH_MS		1000
+
 /* System calls which may not be there. */
 #if !defined(HAVE_FSEEKO) /*[*/
 #define fseeko(s, o, w)	fseek(s, (long)o, w)
@@ -111,12 +118,16 @@ static FILE    *tracef = NULL;
 static char    *tracef_bufptr = NULL;
 static off_t	tracef_size = 0;
 static off_t	tracef_max = 0;
+static char    *tracef_buf = NULL;
+static size_t	tracef_buf_size = 0;
+static ioid_t	tracef_flush_id = NULL_IOID;
 static char    *onetime_tracefile_name = NULL;
 
 static void	vwtrace(bool do_ts, const char *fmt, va_list args);
 static void	wtrace(bool do_ts, const char *fmt, ...);
 static char    *create_tracefile_header(const char *mode);
 static void	stop_tracing(void);
+static void	trace_setbuf(void);
 
 /* Globals */
 bool		trace_skipping = false;
@@ -281,25 +292,44 @@ ntvtrace(const char *fmt, ...)
 
 /*
  * Generate a timestamp for the trace file.
+ * The date and time are only recomputed when the second changes.
  */
 static char *
 gen_ts(void)
 {
+    static time_t last_t = (time_t)-1;
+    static char date_time[32];
     struct timeval tv;
     time_t t;
     struct tm *tm;
 
     gettimeofday(&tv, NULL);
     t = tv.tv_sec;
-    tm = localtime(&t);
-    return txAsprintf("%d%02d%02d.%02d%02d%02d.%03d ",
-	    tm->tm_year + 1900,
-	    tm->tm_mon + 1,
-	    tm->tm_mday,
-	    tm->tm_hour,
-	    tm->tm_min,
-	    tm->tm_sec,
-	    (int)(tv.tv_usec / 1000L));
+    if (t != last_t) {
+	tm = localtime(&t);
+	snprintf(date_time, sizeof(date_time), "%d%02d%02d.%02d%02d%02d",
+		tm->tm_year + 1900,
+		tm->tm_mon + 1,
+		tm->tm_mday,
+		tm->tm_hour,
+		tm->tm_min,
+		tm->tm_sec);
+	last_t = t;
+    }
+    return txAsprintf("%s.%03d ", date_time, (int)(tv.tv_usec / 1000L));
+}
+
+/* Write buffered trace output. */
+static void
+trace_flush(ioid_t id _is_unused)
+{
+    tracef_flush_id = NULL_IOID;
+    if (tracef != NULL && fflush(tracef) == EOF) {
+	if (errno != EPIPE) {
+	    popup_an_errno(errno, "Write to trace file failed");
+	}
+	stop_tracing();
+    }
 }
 
 /*
@@ -342,8 +372,12 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 	    if (ts == NULL) {
 		ts = gen_ts();
 	    }
-	    fwrite(ts, strlen(ts), 1, tracef);
-	    fflush(tracef);
+	    n2w = strlen(ts);
+	    fwrite(ts, n2w, 1, tracef);
+	    if (tracef_buf == NULL) {
+		fflush(tracef);
+	    }
+	    tracef_size += n2w;
 	    wrote_ts = true;
 	}
 
@@ -357,7 +391,10 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 
 	nw = fwrite(bp, n2w, 1, tracef);
 	if (nw == 1) {
-	    fflush(tracef);
+	    if (tracef_buf == NULL) {
+		fflush(tracef);
+	    }
+	    tracef_size += n2w;
 	} else {
 	    if (errno != EPIPE && !IS_EILSEQ(errno)) {
 		popup_an_errno(errno, "Write to trace file failed");
@@ -376,7 +413,10 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 	n2w_left -= n2w;
     }
 
-    tracef_size = ftello(tracef);
+    /* Make sure buffered output is written eventually. */
+    if (tracef_buf != NULL && tracef_flush_id == NULL_IOID) {
+	tracef_flush_id = AddTimeOut(TRACE_FLUSH_MS, trace_flush);
+    }
 
 done:
     if (buf != NULL) {
@@ -405,6 +445,11 @@ stop_tracing(void)
 	fclose(tracef);
     }
     tracef = NULL;
+    if (tracef_flush_id != NULL_IOID) {
+	RemoveTimeOut(tracef_flush_id);
+	tracef_flush_id = NULL_IOID;
+    }
+    Replace(tracef_buf, NULL);
     if (toggled(TRACING)) {
 	toggle_toggle(TRACING);
 	menubar_retoggle(TRACING);
@@ -455,7 +500,7 @@ trace_rollover_check(void)
 
 	/* Initialize it. */
 	tracef_size = 0L;
-	SETLINEBUF(tracef);
+	trace_setbuf();
 	new_header = create_tracefile_header("rolled over");
 	wtrace(false, new_header);
 	Free(new_header);
@@ -613,12 +658,42 @@ create_tracefile_header(const char *trace_mode)
     return buf;
 }
 
+/*
+ * Parse a size, with an optional K or M suffix.
+ * Returns false if the size is not valid.
+ */
+static bool
+parse_size(const char *value, unsigned long *size)
+{
+    char *ptr;
+
+    *size = strtoul(value, &ptr, 0);
+    if (*size == 0 || ptr == value || (*ptr && *(ptr + 1))) {
+	return false;
+    }
+    switch (*ptr) {
+    case 'k':
+    case 'K':
+	*size *= 1024;
+	break;
+    case 'm':
+    case 'M':
+	*size *= 1024 * 1024;
+	break;
+    case '\0':
+	break;
+    default:
+	return false;
+    }
+    return true;
+}
+
 /* Calculate the tracefile maximum size. */
 static void
 get_tracef_max(void)
 {
     static bool calculated = false;
-    char *ptr;
+    unsigned long size;
     bool bad = false;
 
     if (calculated) {
@@ -635,24 +710,8 @@ get_tracef_max(void)
 	return;
     }
 
-    tracef_max = strtoul(appres.trace_file_size, &ptr, 0);
-    if (tracef_max == 0 || ptr == appres.trace_file_size || *(ptr + 1)) {
-	bad = true;
-    } else switch (*ptr) {
-    case 'k':
-    case 'K':
-	tracef_max *= 1024;
-	break;
-    case 'm':
-    case 'M':
-	tracef_max *= 1024 * 1024;
-	break;
-    case '\0':
-	break;
-    default:
-	bad = true;
-	break;
-    }
+    bad = !parse_size(appres.trace_file_size, &size);
+    tracef_max = size;
 
     if (bad) {
 	tracef_max = MIN_TRACEFILE_SIZE;
@@ -662,6 +721,43 @@ get_tracef_max(void)
     }
 }
 
+/*
+ * Set up buffering for a newly-opened trace file.
+ * By default, the trace file is line-buffered. If traceBufferSize is set,
+ * output is accumulated in a buffer of that size and written when the buffer
+ * fills, when TRACE_FLUSH_MS has passed, or when the file is closed.
+ */
+static void
+trace_setbuf(void)
+{
+    static bool calculated = false;
+
+    if (!calculated) {
+	unsigned long size;
+
+	calculated = true;
+	if (appres.trace_buffer_size != NULL &&
+		strcmp(appres.trace_buffer_size, "0")) {
+	    if (!parse_size(appres.trace_buffer_size, &size)) {
+		xs_warning("Invalid %s '%s', ignoring", ResTraceBufferSize,
+			appres.trace_buffer_size);
+	    } else {
+		tracef_buf_size = (size < MIN_TRACE_BUFFER_SIZE)?
+		    MIN_TRACE_BUFFER_SIZE: size;
+	    }
+	}
+    }
+
+    if (tracef_buf_size == 0 || tracef == stdout) {
+	SETLINEBUF(tracef);
+	return;
+    }
+    if (tracef_buf == NULL) {
+	tracef_buf = Malloc(tracef_buf_size);
+    }
+    setvbuf(tracef, tracef_buf, _IOFBF, tracef_buf_size);
+}
+
 /* Parse the name '/dev/fd<n>', so we can simulate it. */
 static int
 get_devfd(const char *pathname)
@@ -804,7 +900,7 @@ tracefile_ok(const char *tfn)
 	}
 	tracef_size = ftello(tracef);
 	Replace(tracefile_name, NewString(append? stfn + 2: stfn));
-	SETLINEBUF(tracef);
+	trace_setbuf();
 #if !defined(_WIN32) /*[*/
 	fcntl(fileno(tracef), F_SETFD, 1);
 #endif /*]*/
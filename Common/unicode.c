@@ -363,6 +363,34 @@ cpalias_t cpaliases[] = {
 
 static uni_t *cur_uni = NULL;
 
+/*
+ * Unicode-to-EBCDIC reverse lookup tables, indexed by the high and low bytes
+ * of a BMP code point. Rows are allocated only when something maps to them.
+ * Where more than one EBCDIC code maps to the same Unicode character, the
+ * lowest one wins.
+ */
+#define U2E_ROWS	256
+#define U2E_COLS	256
+typedef ebc_t *u2e_t[U2E_ROWS];
+static u2e_t u2e_cur;		/* current host code page */
+static u2e_t u2e_apl;		/* APL (GE) characters */
+static bool u2e_apl_built = false;
+
+/*
+ * EBCDIC-to-multibyte translation cache for single-byte characters, used to
+ * dump the screen. Pages are indexed by UTF-8 override, the EUO_BLANK_UNDEF
+ * and EUO_TOUPPER flags, and the character set, and are built on first use.
+ * They depend on the host code page, so set_uni() discards them.
+ */
+#define E2MB_MAX	8
+#define E2MB_FLAGS	(EUO_BLANK_UNDEF | EUO_TOUPPER)
+#define E2MB_CS		(CS_MASK | CS_GE)
+typedef struct {
+    char mb[E2MB_MAX];		/* translation, NUL-terminated */
+    signed char len;		/* length with NUL, 0 for none, -1 if long */
+} e2mb_t;
+static e2mb_t *e2mb_pages[2][4][E2MB_CS + 1];
+
 static void
 codepage_list_one(bool dbcs)
 {
@@ -500,6 +528,46 @@ ebcdic_base_to_unicode(ebc_t c, unsigned flags)
     }
 }
 
+/* Empty a reverse lookup table. */
+static void
+u2e_clear(u2e_t t)
+{
+    int row;
+
+    for (row = 0; row < U2E_ROWS; row++) {
+	Replace(t[row], NULL);
+    }
+}
+
+/* Add a mapping to a reverse lookup table, unless there is one already. */
+static void
+u2e_add(u2e_t t, ucs4_t u, ebc_t e)
+{
+    ebc_t *row;
+
+    if (u == 0 || u >= U2E_ROWS * U2E_COLS) {
+	return;
+    }
+    if ((row = t[u / U2E_COLS]) == NULL) {
+	row = t[u / U2E_COLS] = (ebc_t *)Calloc(U2E_COLS, sizeof(ebc_t));
+    }
+    if (row[u % U2E_COLS] == 0) {
+	row[u % U2E_COLS] = e;
+    }
+}
+
+/* Look up a character in a reverse lookup table. Returns 0 if not found. */
+static ebc_t
+u2e_lookup(u2e_t t, ucs4_t u)
+{
+    ebc_t *row;
+
+    if (u >= U2E_ROWS * U2E_COLS || (row = t[u / U2E_COLS]) == NULL) {
+	return 0;
+    }
+    return row[u % U2E_COLS];
+}
+
 /*
  * Map a UCS-4 character to an EBCDIC character.
  * Returns 0 for failure, nonzero for success.
@@ -507,7 +575,6 @@ ebcdic_base_to_unicode(ebc_t c, unsigned flags)
 ebc_t
 unicode_to_ebcdic(ucs4_t u)
 {
-    int i;
     ebc_t d;
 
     if (!u) {
@@ -517,10 +584,9 @@ unicode_to_ebcdic(ucs4_t u)
 	return 0x40;
     }
 
-    for (i = 0; i < UT_SIZE; i++) {
-	if (cur_uni->code[i] == u) {
-	    return UT_OFFSET + i;
-	}
+    d = u2e_lookup(u2e_cur, u);
+    if (d) {
+	return d;
     }
     /* See if it's DBCS. */
     d = unicode_to_ebcdic_dbcs(u);
@@ -546,14 +612,7 @@ unicode_to_ebcdic_ge(ucs4_t u, bool *ge, bool prefer_apl)
     e_cur = unicode_to_ebcdic(u);
 
     /* Find the character in the APL code page. */
-    for (e_apl = 0x70; e_apl <= 0xfe; e_apl++) {
-	if ((ucs4_t)apl_to_unicode(e_apl, EUO_NONE) == u) {
-	    break;
-	}
-    }
-    if (e_apl > 0xfe) {
-	e_apl = 0;
-    }
+    e_apl = u2e_lookup(u2e_apl, u);
 
     if (e_apl != 0 && ((e_cur == 0) || prefer_apl)) {
 	*ge = true;
@@ -580,6 +639,18 @@ is_all_digits(const char *s)
     return strspn(s, "0123456789") == strlen(s);
 }
 
+/* Discard the EBCDIC-to-multibyte translation cache. */
+static void
+e2mb_clear(void)
+{
+    size_t i;
+    e2mb_t **pages = &e2mb_pages[0][0][0];
+
+    for (i = 0; i < sizeof(e2mb_pages) / sizeof(e2mb_pages[0][0][0]); i++) {
+	Replace(pages[i], NULL);
+    }
+}
+
 /*
  * Set the SBCS EBCDIC-to-Unicode translation table.
  * Returns true for success, false for failure.
@@ -596,6 +667,20 @@ set_uni(const char *cpname, int local_cp _is_unused,
 
     check_apl_consistency(apl2uc);
 
+    /* Build the APL reverse lookup table. */
+    if (!u2e_apl_built) {
+	ebc_t e;
+
+	for (e = 0x70; e <= 0xfe; e++) {
+	    int u = apl_to_unicode(e, EUO_NONE);
+
+	    if (u > 0) {
+		u2e_add(u2e_apl, (ucs4_t)u, e);
+	    }
+	}
+	u2e_apl_built = true;
+    }
+
 #if defined(_WIN32) /*[*/
     u_local_cp = local_cp;
     set_local_cp(local_cp);
@@ -638,7 +723,16 @@ set_uni(const char *cpname, int local_cp _is_unused,
 	    continue;
 	}
 	if (!strcasecmp(realname, uni[i].name)) {
+	    int j;
+
 	    cur_uni = &uni[i];
+
+	    /* Build the reverse lookup table. */
+	    u2e_clear(u2e_cur);
+	    e2mb_clear();
+	    for (j = 0; j < UT_SIZE; j++) {
+		u2e_add(u2e_cur, cur_uni->code[j], UT_OFFSET + j);
+	    }
 	    *host_codepage = uni[i].host_codepage;
 	    *cgcsgid = uni[i].cgcsgid;
 	    if (realnamep != NULL) {
@@ -1077,6 +1171,60 @@ ebcdic_to_multibyte_fx(ebc_t ebc, unsigned char cs, char mb[], size_t mb_len,
     }
 }
 
+/*
+ * Cached version of ebcdic_to_multibyte_fx, without the Unicode result.
+ * Returns the same length, and sets *mbp to the NUL-terminated translation,
+ * which is valid until the next call.
+ */
+size_t
+ebcdic_to_multibyte_fc(ebc_t ebc, unsigned char cs, unsigned flags,
+	bool force_utf8, const char **mbp)
+{
+    static char mb[16];
+    e2mb_t **pagep;
+    e2mb_t *page;
+    e2mb_t *e;
+    ucs4_t uc;
+
+    if ((ebc & ~0xff) || (cs & ~E2MB_CS) || (flags & ~E2MB_FLAGS)) {
+	mb[0] = '\0';
+	*mbp = mb;
+	return ebcdic_to_multibyte_fx(ebc, cs, mb, sizeof(mb), flags, &uc,
+		force_utf8);
+    }
+
+    pagep = &e2mb_pages[force_utf8][((flags & EUO_BLANK_UNDEF)? 1: 0) |
+	((flags & EUO_TOUPPER)? 2: 0)][cs];
+    if ((page = *pagep) == NULL) {
+	int i;
+
+	page = *pagep = (e2mb_t *)Calloc(256, sizeof(e2mb_t));
+	for (i = 0; i < 256; i++) {
+	    size_t len;
+
+	    len = ebcdic_to_multibyte_fx(i, cs, mb, sizeof(mb), flags, &uc,
+		    force_utf8);
+	    if (len > E2MB_MAX) {
+		page[i].len = -1;
+	    } else {
+		/* No translation leaves the entry empty. */
+		memcpy(page[i].mb, mb, len);
+		page[i].len = (signed char)len;
+	    }
+	}
+    }
+
+    e = &page[ebc];
+    if (e->len < 0) {
+	mb[0] = '\0';
+	*mbp = mb;
+	return ebcdic_to_multibyte_fx(ebc, cs, mb, sizeof(mb), flags, &uc,
+		force_utf8);
+    }
+    *mbp = e->mb;
+    return e->len;
+}
+
 /*
  * Convert an EBCDIC string to a multibyte string.
  * Makes lots of assumptions: standard character set, EUO_BLANK_UNDEF.
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ *	varint.c
+ *		Variable-length integers.
+ */
+
+#include "globals.h"
+
+#include "varint.h"
+
+/*
+ * Encode an integer, 7 bits per byte, high-order bits first, with 0x80 set
+ * in every byte but the last.
+ * Returns the number of bytes written to buf, at most VARINT_MAX.
+ */
+size_t
+varint_encode(unsigned long value, unsigned char *buf)
+{
+    unsigned char v[VARINT_MAX];
+    size_t nv = 0;
+
+    do {
+	v[VARINT_MAX - 1 - nv] = (value & 0x7f) | (nv? 0x80: 0);
+	nv++;
+	value >>= 7;
+    } while (value);
+    memcpy(buf, v + VARINT_MAX - nv, nv);
+    return nv;
+}
+
+/*
+ * Decode an integer encoded by varint_encode().
+ * Advances *s past it.
+ */
+unsigned long
+varint_decode(const unsigned char **s)
+{
+    const unsigned char *t = *s;
+    unsigned long value = 0;
+
+    while (*t & 0x80) {
+	value = (value << 7) | (*t++ & 0x7f);
+    }
+    value = (value << 7) | *t++;
+    *s = t;
+    return value;
+}
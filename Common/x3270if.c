@@ -45,6 +45,14 @@
  *
  * - Using a loopback IPv4 socket whose TCP port is passed in explicitly.
  *   This port is bound by the emulators by the -scriptport option.
+ *
+ * - (Unix only) Using an explicitly-named Unix-domain socket, which can be an
+ *   emulator's -socket or an x3270if multiplexer (-D).
+ *
+ * As a multiplexer (-D, Unix only), keeps one connection to the emulator open
+ * and relays commands to it from any number of clients on a Unix-domain
+ * socket, so that scripts that run many actions do not pay for a new emulator
+ * connection each time.
  */
 
 #include "globals.h"
@@ -56,6 +64,7 @@
 # include <sys/types.h>
 # include <sys/socket.h>
 # include <sys/un.h>
+# include <sys/stat.h>
 # include <netinet/in.h>
 # include <arpa/inet.h>
 #endif /*]*/
@@ -101,7 +110,7 @@
 #define FD_ENV_REQUIRED	true
 #else /*][*/
 #define DIRSEP '/'
-#define OPTS	"H:iI:L:p:Ps:St:v"
+#define OPTS	"D:H:iI:L:p:Ps:St:Tu:v"
 #define FD_ENV_REQUIRED	false
 #endif /*]*/
 
@@ -127,12 +136,16 @@ static int verbose = 0;
 static char *buf;
 static size_t buf_size = 0;
 
-static void iterative_io(int pid, unsigned short port);
-static int single_io(int pid, unsigned short port, socket_t socket, int infd,
+static void iterative_io(const char *sockpath, unsigned short port);
+static int single_io(const char *sockpath, unsigned short port, socket_t socket, int infd,
 	int outfd, int fn, char *cmd, char **data_ret, char **errd_ret, char **prompt_ret,
 	itype_t *itype);
 static void interactive_io(int port, const char *emulator_name,
 	const char *help_name, const char *localization);
+#if !defined(_WIN32) /*[*/
+static void mux_io(const char *sockpath, unsigned short port, bool force_pipes,
+	const char *mux_path, bool timing);
+#endif /*]*/
 
 #if defined(HAVE_LIBREADLINE) /*[*/
 static char **attempted_completion(const char *text, int start, int end);
@@ -167,15 +180,25 @@ usage:\n\
  %s [options] -i\n\
    shuttle commands and responses between stdin/stdout and emulator\n\
  %s [options] -I <emulator-name> [-H <help-action-name>]\n\
-   interactive command window\n\
- %s --version\n\
+   interactive command window\n"
+#if !defined(_WIN32) /*[*/
+" %s [options] -D <socket-path> [-T]\n\
+   relay commands from clients on Unix-domain socket <socket-path> over one\n\
+   emulator connection, optionally reporting per-command timing\n"
+#endif /*]*/
+" %s --version\n\
 options:\n\
  -v       verbose operation\n"
 #if !defined(_WIN32) /*[*/
-" -p pid   connect to process <pid>\n"
+" -p pid   connect to process <pid>\n\
+ -u path  connect to Unix-domain socket <path>\n"
 #endif /*]*/
 " -t port  connect to TCP port <port>\n",
-	    me, me, me, me, me, me);
+	    me, me, me, me, me,
+#if !defined(_WIN32) /*[*/
+	    me,
+#endif /*]*/
+	    me);
     exit(__LINE__);
 }
 
@@ -249,13 +272,16 @@ main(int argc, char *argv[])
     int fn = NO_STATUS;
     char *ptr;
     int iterative = 0;
-    int pid = 0;
+    char *sockpath = NULL;
     unsigned short port = 0;
     const char *emulator_name = NULL;
     const char *help_name = NULL;
     const char *localization = NULL;
 #if !defined(_WIN32) /*[*/
+    int pid;
     bool force_pipes = false;
+    const char *mux_path = NULL;
+    bool timing = false;
 #endif /*]*/
 
 #if defined(_WIN32) /*[*/
@@ -280,6 +306,11 @@ main(int argc, char *argv[])
     opterr = 0;
     while ((c = getopt(argc, argv, OPTS)) != -1) {
 	switch (c) {
+#if !defined(_WIN32) /*[*/
+	case 'D':
+	    mux_path = optarg;
+	    break;
+#endif /*]*/
 	case 'H':
 	    help_name = optarg;
 	    break;
@@ -306,6 +337,11 @@ main(int argc, char *argv[])
 		fprintf(stderr, "%s: Invalid process ID: '%s'\n", me, optarg);
 		x3270if_usage();
 	    }
+	    if (sockpath != NULL) {
+		x3270if_usage();
+	    }
+	    sockpath = Malloc(32);
+	    snprintf(sockpath, 32, "/tmp/x3sck.%d", pid);
 	    break;
 	case 'P':
 	    force_pipes = true;
@@ -334,6 +370,17 @@ main(int argc, char *argv[])
 		x3270if_usage();
 	    }
 	    break;
+#if !defined(_WIN32) /*[*/
+	case 'T':
+	    timing = true;
+	    break;
+	case 'u':
+	    if (sockpath != NULL) {
+		x3270if_usage();
+	    }
+	    sockpath = optarg;
+	    break;
+#endif /*]*/
 	case 'v':
 	    verbose++;
 	    break;
@@ -344,6 +391,15 @@ main(int argc, char *argv[])
     }
 
     /* Validate positional arguments. */
+#if !defined(_WIN32) /*[*/
+    if (mux_path != NULL) {
+	if (optind != argc || fn != NO_STATUS || iterative) {
+	    x3270if_usage();
+	}
+    } else if (timing) {
+	x3270if_usage();
+    } else
+#endif /*]*/
     if (optind == argc) {
 	/* No positional arguments. */
 	if (fn == NO_STATUS && !iterative) {
@@ -358,7 +414,7 @@ main(int argc, char *argv[])
 	    x3270if_usage();
 	}
     }
-    if (pid && port) {
+    if (sockpath != NULL && port) {
 	x3270if_usage();
     }
     if (help_name != NULL && emulator_name == NULL) {
@@ -371,10 +427,15 @@ main(int argc, char *argv[])
 #endif /*]*/
 
     /* Do the I/O. */
+#if !defined(_WIN32) /*[*/
+    if (mux_path != NULL) {
+	mux_io(sockpath, port, force_pipes, mux_path, timing);
+    } else
+#endif /*]*/
     if (iterative && emulator_name != NULL) {
 	interactive_io(port, emulator_name, help_name, localization);
     } else if (iterative) {
-	iterative_io(pid, port);
+	iterative_io(sockpath, port);
     } else {
 	const char *cookie = get_cookie();
 	int infd = -1;
@@ -398,7 +459,7 @@ main(int argc, char *argv[])
 	    cmd = Malloc(strlen(AnCapabilities) + 1 + strlen(KwErrd) + 2 + strlen(argv[optind]) + 1);
 	    sprintf(cmd, AnCapabilities "(" KwErrd ") %s", argv[optind]);
 	}
-	rv = single_io(pid, port, INVALID_SOCKET, infd, outfd, fn, cmd, NULL, NULL, NULL, NULL);
+	rv = single_io(sockpath, port, INVALID_SOCKET, infd, outfd, fn, cmd, NULL, NULL, NULL, NULL);
 	Free(cmd);
 	return rv;
     }
@@ -408,7 +469,7 @@ main(int argc, char *argv[])
 #if !defined(_WIN32) /*[*/
 /* Connect to a Unix-domain socket. */
 static socket_t
-usock(int pid)
+usock(const char *path)
 {
     struct sockaddr_un ssun;
     socket_t fd;
@@ -420,7 +481,11 @@ usock(int pid)
     }
     memset(&ssun, '\0', sizeof(struct sockaddr_un));
     ssun.sun_family = AF_UNIX;
-    snprintf(ssun.sun_path, sizeof(ssun.sun_path), "/tmp/x3sck.%d", pid);
+    if (strlen(path) >= sizeof(ssun.sun_path)) {
+	fprintf(stderr, "%s: socket path '%s' is too long\n", me, path);
+	exit(__LINE__);
+    }
+    strcpy(ssun.sun_path, path);
     if (connect(fd, (struct sockaddr *)&ssun, sizeof(ssun)) < 0) {
 	perror("connect");
 	exit(__LINE__);
@@ -508,7 +573,7 @@ get_itype(const char *buf)
 
 /* Do a single command, and interpret the results. */
 static int
-single_io(int pid, unsigned short port, socket_t socket, int xinfd, int xoutfd,
+single_io(const char *sockpath, unsigned short port, socket_t socket, int xinfd, int xoutfd,
 	int fn, char *cmd, char **data_ret, char **errd_ret, char **prompt_ret, itype_t *itype)
 {
     int port_env;
@@ -538,8 +603,8 @@ single_io(int pid, unsigned short port, socket_t socket, int xinfd, int xoutfd,
 	outfd = xoutfd;
     } else {
 #if !defined(_WIN32) /*[*/
-	if (pid) {
-	    insocket = outsocket = usock(pid);
+	if (sockpath != NULL) {
+	    insocket = outsocket = usock(sockpath);
 	    is_socket = true;
 	} else
 #endif /*]*/
@@ -825,7 +890,7 @@ get_ports(socket_t *socket, int *infd, int *outfd)
 
 /* Act as a passive pipe to the emulator. */
 static void
-iterative_io(int pid, unsigned short port)
+iterative_io(const char *sockpath, unsigned short port)
 {
 # define N_IO 2
     struct {
@@ -842,8 +907,8 @@ iterative_io(int pid, unsigned short port)
     /* Get the x3270 file descriptors. */
     io[0].name = "script->emulator";
     io[0].rfd = fileno(stdin);
-    if (pid) {
-	io[0].wfd = usock(pid);
+    if (sockpath != NULL) {
+	io[0].wfd = usock(sockpath);
     } else if (port) {
 	io[0].wfd = tsock(port);
     } else if ((port_env = fd_env(PORT_ENV, FD_ENV_REQUIRED)) >= 0) {
@@ -852,7 +917,7 @@ iterative_io(int pid, unsigned short port)
 	io[0].wfd = fd_env(INPUT_ENV, true);
     }
     io[1].name = "emulator->script";
-    if (pid || port || (port_env >= 0)) {
+    if (sockpath != NULL || port || (port_env >= 0)) {
 	io[1].rfd = dup(io[0].wfd);
     } else {
 	io[1].rfd = fd_env(OUTPUT_ENV, true);
@@ -986,7 +1051,7 @@ stdin_read(LPVOID lpParameter)
 
 /* Act as a passive pipe to the emulator. */
 static void
-iterative_io(int pid, unsigned short port)
+iterative_io(const char *sockpath, unsigned short port)
 {
     char *port_env;
     socket_t s;
@@ -1097,6 +1162,489 @@ iterative_io(int pid, unsigned short port)
 
 #endif /*]*/
 
+#if !defined(_WIN32) /*[*/
+
+/* A growable I/O buffer. */
+typedef struct {
+    char *buf;		/* data */
+    size_t len;		/* bytes in use */
+    size_t size;	/* bytes allocated */
+} mbuf_t;
+
+/* A multiplexer client. */
+typedef struct mux_client {
+    struct mux_client *next;
+    int fd;		/* socket, or -1 once the client has gone away */
+    int id;		/* client number, for timing reports */
+    mbuf_t in;		/* partial command line */
+    mbuf_t out;		/* responses not yet written */
+    int pending;	/* commands awaiting a response */
+    bool eof;		/* client has finished sending */
+} mux_client_t;
+
+/* A command forwarded to the emulator, awaiting its response. */
+typedef struct mux_cmd {
+    struct mux_cmd *next;
+    mux_client_t *client; /* originating client, or NULL for our own */
+    struct timeval t0;	/* time forwarded */
+    char *text;		/* command text, for timing reports */
+} mux_cmd_t;
+
+static mux_client_t *mux_clients;
+static mux_cmd_t *mux_cmds, *mux_cmds_last;
+static volatile sig_atomic_t mux_quit;
+
+/* Append data to a buffer. */
+static void
+mbuf_append(mbuf_t *m, const char *data, size_t len)
+{
+    if (m->len + len > m->size) {
+	m->size = ((m->len + len + IBS - 1) / IBS) * IBS;
+	m->buf = Realloc(m->buf, m->size);
+    }
+    memcpy(m->buf + m->len, data, len);
+    m->len += len;
+}
+
+/* Remove data from the front of a buffer. */
+static void
+mbuf_consume(mbuf_t *m, size_t len)
+{
+    memmove(m->buf, m->buf + len, m->len - len);
+    m->len -= len;
+}
+
+/* Write as much of a buffer as the descriptor will take. */
+static bool
+mbuf_write(mbuf_t *m, int fd)
+{
+    ssize_t nw = write(fd, m->buf, m->len);
+
+    if (nw < 0) {
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    mbuf_consume(m, nw);
+    return true;
+}
+
+/* Catch a termination signal. */
+static void
+mux_signal(int sig)
+{
+    mux_quit = 1;
+}
+
+/* Forward a command to the emulator and queue it for its response. */
+static void
+mux_forward(mbuf_t *eout, mux_client_t *client, const char *text, size_t len)
+{
+    mux_cmd_t *c = Malloc(sizeof(mux_cmd_t) + len + 1);
+
+    c->next = NULL;
+    c->client = client;
+    gettimeofday(&c->t0, NULL);
+    c->text = (char *)(c + 1);
+    memcpy(c->text, text, len);
+    c->text[len] = '\0';
+    if (mux_cmds_last != NULL) {
+	mux_cmds_last->next = c;
+    } else {
+	mux_cmds = c;
+    }
+    mux_cmds_last = c;
+    if (client != NULL) {
+	client->pending++;
+    }
+
+    mbuf_append(eout, text, len);
+    mbuf_append(eout, "\n", 1);
+    if (verbose) {
+	fprintf(stderr, "[%d] out %s\n", client? client->id: 0, c->text);
+    }
+}
+
+/* Free a client that has gone away, once it has no commands outstanding. */
+static void
+mux_reap(mux_client_t *client)
+{
+    mux_client_t **cp;
+
+    if (client->fd >= 0 || client->pending) {
+	return;
+    }
+    for (cp = &mux_clients; *cp != client; cp = &(*cp)->next) {
+    }
+    *cp = client->next;
+    Free(client->in.buf);
+    Free(client->out.buf);
+    Free(client);
+}
+
+/* A client has gone away. */
+static void
+mux_drop(mux_client_t *client)
+{
+    if (verbose) {
+	fprintf(stderr, "[%d] closed\n", client->id);
+    }
+    close(client->fd);
+    client->fd = -1;
+    mux_reap(client);
+}
+
+/* Process a line of emulator output. */
+static void
+mux_emulator_line(const char *line, size_t len, bool timing,
+	unsigned long *count, double *total_ms, double *max_ms)
+{
+    mux_cmd_t *c = mux_cmds;
+    const char *result;
+    struct timeval t1;
+    double ms;
+    const char *text;
+
+    if (verbose) {
+	fprintf(stderr, "[%d] in %.*s\n", (c && c->client)? c->client->id: 0,
+		(int)len, line);
+    }
+    if (c == NULL) {
+	/* Unsolicited output. */
+	return;
+    }
+
+    /* Relay the line to the client, if it is still there. */
+    if (c->client != NULL && c->client->fd >= 0) {
+	mbuf_append(&c->client->out, line, len);
+	mbuf_append(&c->client->out, "\n", 1);
+    }
+
+    /* See if this completes the response. */
+    if (len == strlen(PROMPT_OK) && !strncmp(line, PROMPT_OK, len)) {
+	result = PROMPT_OK;
+    } else if (len == strlen(PROMPT_ERROR) &&
+	    !strncmp(line, PROMPT_ERROR, len)) {
+	result = PROMPT_ERROR;
+    } else if (len > 0 && line[0] == '{') {
+	result = "json";
+    } else {
+	return;
+    }
+
+    /* Complete it. */
+    gettimeofday(&t1, NULL);
+    ms = ((t1.tv_sec - c->t0.tv_sec) * 1000000.0 +
+	    (t1.tv_usec - c->t0.tv_usec)) / 1000.0;
+    if (c->client == NULL) {
+	if (!strcmp(result, PROMPT_ERROR)) {
+	    fprintf(stderr, "%s: emulator rejected the cookie\n", me);
+	    exit(__LINE__);
+	}
+    } else {
+	(*count)++;
+	*total_ms += ms;
+	if (ms > *max_ms) {
+	    *max_ms = ms;
+	}
+	if (timing) {
+	    /* Don't display cookies. */
+	    text = c->text;
+	    if (!strncasecmp(text, AnCookie "(", strlen(AnCookie) + 1) &&
+		    strchr(text, ')') != NULL) {
+		text = strchr(text, ')') + 1;
+		while (*text == ' ') {
+		    text++;
+		}
+	    }
+	    fprintf(stderr, "%s: [%d] %.3f ms %s %s\n", me, c->client->id, ms,
+		    result, text);
+	}
+    }
+
+    mux_cmds = c->next;
+    if (mux_cmds == NULL) {
+	mux_cmds_last = NULL;
+    }
+    if (c->client != NULL) {
+	c->client->pending--;
+	mux_reap(c->client);
+    }
+    Free(c);
+}
+
+/* Bind the multiplexer's listening socket. */
+static int
+mux_listen(const char *mux_path)
+{
+    struct sockaddr_un ssun;
+    struct stat st;
+    int fd;
+
+    memset(&ssun, '\0', sizeof(struct sockaddr_un));
+    ssun.sun_family = AF_UNIX;
+    if (strlen(mux_path) >= sizeof(ssun.sun_path)) {
+	fprintf(stderr, "%s: socket path '%s' is too long\n", me, mux_path);
+	exit(__LINE__);
+    }
+    strcpy(ssun.sun_path, mux_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+	perror("socket");
+	exit(__LINE__);
+    }
+
+    /* Remove a stale socket, but not a live one or anything else. */
+    if (lstat(mux_path, &st) == 0) {
+	if (!S_ISSOCK(st.st_mode)) {
+	    fprintf(stderr, "%s: '%s' exists and is not a socket\n", me,
+		    mux_path);
+	    exit(__LINE__);
+	}
+	if (connect(fd, (struct sockaddr *)&ssun, sizeof(ssun)) == 0) {
+	    fprintf(stderr, "%s: '%s' is in use\n", me, mux_path);
+	    exit(__LINE__);
+	}
+	unlink(mux_path);
+	close(fd);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+	    perror("socket");
+	    exit(__LINE__);
+	}
+    }
+
+    if (bind(fd, (struct sockaddr *)&ssun, sizeof(ssun)) < 0) {
+	perror("bind");
+	exit(__LINE__);
+    }
+    if (chmod(mux_path, 0600) < 0 || listen(fd, SOMAXCONN) < 0) {
+	perror(mux_path);
+	unlink(mux_path);
+	exit(__LINE__);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/*
+ * Act as a multiplexer: keep one connection to the emulator open, and relay
+ * commands from any number of clients on a Unix-domain socket.
+ *
+ * Commands are forwarded as soon as they arrive and the emulator answers them
+ * in order, so each response is routed back to the client that sent the
+ * oldest unanswered command. Each command must be a single line, and input
+ * requests (the interactive capability) are not supported.
+ */
+static void
+mux_io(const char *sockpath, unsigned short port, bool force_pipes,
+	const char *mux_path, bool timing)
+{
+    int lfd;
+    int erfd, ewfd;
+    int port_env = -1;
+    const char *cookie = NULL;
+    mbuf_t ein = { NULL, 0, 0 };
+    mbuf_t eout = { NULL, 0, 0 };
+    int next_id = 1;
+    unsigned long count = 0;
+    double total_ms = 0.0;
+    double max_ms = 0.0;
+    struct sigaction sa;
+    char rbuf[IBS];
+
+    /* Connect to the emulator. */
+    if (force_pipes) {
+	erfd = fd_env(OUTPUT_ENV, true);
+	ewfd = fd_env(INPUT_ENV, true);
+    } else if (sockpath != NULL) {
+	erfd = ewfd = usock(sockpath);
+    } else if (port) {
+	erfd = ewfd = tsock(port);
+    } else if ((port_env = fd_env(PORT_ENV, false)) >= 0) {
+	erfd = ewfd = tsock(port_env);
+    } else {
+	erfd = fd_env(OUTPUT_ENV, true);
+	ewfd = fd_env(INPUT_ENV, true);
+    }
+    if (erfd == ewfd) {
+	cookie = get_cookie();
+    }
+    fcntl(ewfd, F_SETFL, fcntl(ewfd, F_GETFL) | O_NONBLOCK);
+
+    /* Pass the cookie once, for everyone. */
+    if (cookie != NULL) {
+	char *cmd = Malloc(strlen(AnCookie) + 1 + strlen(cookie) + 2);
+
+	sprintf(cmd, AnCookie "(%s)", cookie);
+	mux_forward(&eout, NULL, cmd, strlen(cmd));
+	Free(cmd);
+    }
+
+    lfd = mux_listen(mux_path);
+
+    memset(&sa, '\0', sizeof(sa));
+    sa.sa_handler = mux_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
+
+    while (!mux_quit) {
+	fd_set rfds, wfds;
+	int fd_max;
+	mux_client_t *client, *next;
+	ssize_t nr;
+	size_t i, start;
+
+	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
+	FD_SET(lfd, &rfds);
+	FD_SET(erfd, &rfds);
+	fd_max = (lfd > erfd)? lfd: erfd;
+	if (eout.len) {
+	    FD_SET(ewfd, &wfds);
+	    if (ewfd > fd_max) {
+		fd_max = ewfd;
+	    }
+	}
+	for (client = mux_clients; client != NULL; client = client->next) {
+	    if (client->fd < 0) {
+		continue;
+	    }
+	    if (!client->eof) {
+		FD_SET(client->fd, &rfds);
+	    }
+	    if (client->out.len) {
+		FD_SET(client->fd, &wfds);
+	    }
+	    if (client->fd > fd_max) {
+		fd_max = client->fd;
+	    }
+	}
+
+	if (select(fd_max + 1, &rfds, &wfds, NULL, NULL) < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    perror("x3270if: select");
+	    unlink(mux_path);
+	    exit(__LINE__);
+	}
+
+	/* Emulator output. */
+	if (eout.len && FD_ISSET(ewfd, &wfds) && !mbuf_write(&eout, ewfd)) {
+	    fprintf(stderr, "%s: write(emulator): %s\n", me, strerror(errno));
+	    break;
+	}
+
+	/* Emulator input. */
+	if (FD_ISSET(erfd, &rfds)) {
+	    nr = read(erfd, rbuf, sizeof(rbuf));
+	    if (nr < 0 && (errno == EAGAIN || errno == EINTR)) {
+		continue;
+	    }
+	    if (nr <= 0) {
+		if (nr < 0) {
+		    fprintf(stderr, "%s: read(emulator): %s\n", me,
+			    strerror(errno));
+		} else if (verbose) {
+		    fprintf(stderr, "emulator EOF\n");
+		}
+		break;
+	    }
+	    mbuf_append(&ein, rbuf, nr);
+	    start = 0;
+	    for (i = 0; i < ein.len; i++) {
+		if (ein.buf[i] == '\n') {
+		    mux_emulator_line(ein.buf + start, i - start, timing,
+			    &count, &total_ms, &max_ms);
+		    start = i + 1;
+		}
+	    }
+	    mbuf_consume(&ein, start);
+	}
+
+	/* New clients. */
+	if (FD_ISSET(lfd, &rfds)) {
+	    int fd = accept(lfd, NULL, NULL);
+
+	    if (fd >= 0) {
+		if (fd >= FD_SETSIZE) {
+		    close(fd);
+		} else {
+		    client = Calloc(1, sizeof(mux_client_t));
+		    client->fd = fd;
+		    client->id = next_id++;
+		    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		    client->next = mux_clients;
+		    mux_clients = client;
+		    if (verbose) {
+			fprintf(stderr, "[%d] connected\n", client->id);
+		    }
+		}
+	    }
+	}
+
+	/* Client I/O. */
+	for (client = mux_clients; client != NULL; client = next) {
+	    next = client->next;
+	    if (client->fd < 0) {
+		continue;
+	    }
+	    if (client->out.len && FD_ISSET(client->fd, &wfds) &&
+		    !mbuf_write(&client->out, client->fd)) {
+		mux_drop(client);
+		continue;
+	    }
+	    if (client->eof) {
+		/* Close once the last response has been delivered. */
+		if (!client->pending && !client->out.len) {
+		    mux_drop(client);
+		}
+		continue;
+	    }
+	    if (!FD_ISSET(client->fd, &rfds)) {
+		continue;
+	    }
+	    nr = read(client->fd, rbuf, sizeof(rbuf));
+	    if (nr < 0 && (errno == EAGAIN || errno == EINTR)) {
+		continue;
+	    }
+	    if (nr <= 0) {
+		/* Forward an unterminated last command. */
+		if (nr == 0 && client->in.len) {
+		    mux_forward(&eout, client, client->in.buf, client->in.len);
+		    client->in.len = 0;
+		}
+		client->eof = true;
+		if (nr < 0 || (!client->pending && !client->out.len)) {
+		    mux_drop(client);
+		}
+		continue;
+	    }
+	    mbuf_append(&client->in, rbuf, nr);
+	    start = 0;
+	    for (i = 0; i < client->in.len; i++) {
+		if (client->in.buf[i] == '\n') {
+		    mux_forward(&eout, client, client->in.buf + start,
+			    i - start);
+		    start = i + 1;
+		}
+	    }
+	    mbuf_consume(&client->in, start);
+	}
+    }
+
+    unlink(mux_path);
+    if (timing) {
+	fprintf(stderr, "%s: %lu command%s, %.3f ms mean, %.3f ms max\n", me,
+		count, (count == 1)? "": "s", count? total_ms / count: 0.0,
+		max_ms);
+    }
+    exit(0);
+}
+
+#endif /*]*/
+
 #if defined(HAVE_LIBREADLINE) /*[*/
 static char **
 attempted_completion(const char *text, int start, int end)
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# b3270 JSON command channel benchmark
+
+import os
+import threading
+import time
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+class BenchB3270Json(cti.cti):
+
+    # Scale factor.
+    mbytes = int(os.environ.get('BENCH_MBYTES', '1'))
+
+    # A cheap action.
+    action = '{"action":"Set","args":["startTls"]}'
+
+    def feed(self, name:str, commands:bytes, count:float, units:str):
+        '''Feed commands to b3270 and time them through to a final tagged
+           command'''
+        b3270 = Popen(['b3270', '-json'], stdin=PIPE, stdout=PIPE,
+            stderr=DEVNULL)
+        self.children.append(b3270)
+        b3270.stdout.readline()
+
+        # Write from another thread, so b3270 output cannot block us.
+        done = b'{"run":{"r-tag":"done","actions":' + self.action.encode() + b'}}\n'
+        def writer():
+            b3270.stdin.write(commands + done)
+            b3270.stdin.flush()
+        start = time.monotonic()
+        w = threading.Thread(target=writer)
+        w.start()
+        while True:
+            line = b3270.stdout.readline()
+            self.assertNotEqual(b'', line, 'b3270 exited early')
+            if b'"r-tag":"done"' in line:
+                break
+        elapsed = time.monotonic() - start
+        w.join()
+        b3270.stdin.close()
+        b3270.stdout.close()
+        bench.wait_rusage(b3270)
+        bench.report(name, count, units, elapsed)
+
+    # Many small commands, one per line.
+    def test_b3270_json_small(self):
+        n = 100000 * self.mbytes
+        cmd = ('{"run":{"actions":' + self.action + '}}\n').encode()
+        self.feed('JSON small commands', cmd * n, n, 'commands')
+
+    # A few multi-megabyte commands, spread over many lines.
+    def test_b3270_json_large(self):
+        n = (1024 * 1024 * self.mbytes) // (len(self.action) + 2)
+        cmd = ('{"run":{"actions":[\n' + ',\n'.join([self.action] * n) +
+            '\n]}}\n').encode()
+        self.feed('JSON large commands', cmd * 3, len(cmd * 3) / (1024 * 1024),
+            'MB')
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# b3270 scrollback memory and throughput benchmark
+
+import os
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+# TELNET negotiation for NVT mode.
+host_setup = b'\xff\xfb\x01\xff\xfb\x03'
+
+class BenchB3270Scroll(cti.cti):
+
+    # Megabytes of text to stream.
+    mbytes = int(os.environ.get('BENCH_MBYTES', '16'))
+
+    # Stream a colored log through b3270 with a large scrollback buffer, then
+    # page back through all of it.
+    def test_b3270_scrollback(self):
+        host = bench.streamhost(self)
+        b3270 = Popen(['b3270', '-json'], stdin=PIPE, stdout=DEVNULL,
+            stderr=DEVNULL)
+        self.children.append(b3270)
+        b3270.stdin.write(b'"Set(saveLines,100000)"\n')
+        b3270.stdin.write(f'"Connect(127.0.0.1:{host.port})"\n'.encode())
+        b3270.stdin.flush()
+        host.accept()
+        host.send(host_setup)
+
+        # Build 1 MB of log lines with some color changes, then send it
+        # repeatedly.
+        lines = []
+        size = 0
+        n = 0
+        while size < 1024 * 1024:
+            line = f'{n:08d} \x1b[3{n % 8}mINFO\x1b[0m [worker-{n % 16:02d}] ' + \
+                f'processed request id={n * 7919 % 1000003} status=200\r\n'
+            lines.append(line.encode('ascii'))
+            size += len(lines[-1])
+            n += 1
+        chunk = b''.join(lines)
+        for _ in range(self.mbytes):
+            host.conn.sendall(chunk)
+        host.send(b'')
+        host.close()
+
+        # Page back through the whole buffer.
+        pages = (self.mbytes * len(lines)) // 24
+        b3270.stdin.write(b'"Scroll(Backward)"\n' * pages)
+        b3270.stdin.write(b'"Quit()"\n')
+        b3270.stdin.flush()
+        b3270.stdin.close()
+        cpu, rss = bench.wait_rusage_rss(b3270)
+        bench.report('scrollback', self.mbytes * len(chunk) / (1024 * 1024),
+            'MB', cpu)
+        bench.report_memory('scrollback', rss)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -2040,6 +2040,9 @@ screen_resume(void)
 void
 cursor_move(int baddr)
 {
+    if (baddr != cursor_addr) {
+	screen_generation++;	/* the cursor is part of the screen image */
+    }
     cursor_addr = baddr;
 }
 
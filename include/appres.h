@@ -57,6 +57,8 @@ typedef struct {
     bool	 debug_tracing;
     char	*devname;	/* for 5250 */
     bool	 disconnect_clear;
+    char	*event_backend;
+    int		 expect_buffer_size;
     bool	 extended_data_stream;
     char	*ft_command;
 #if defined(_WIN32) /*[*/
@@ -101,6 +103,8 @@ typedef struct {
     bool	 socket;
     char	*suppress_actions;
     char	*termname;
+    char	*trace_binary_file;
+    char	*trace_buffer_size;
     char	*trace_dir;
     char	*trace_file;
     char	*trace_file_size;
@@ -149,6 +153,7 @@ typedef struct {
 	char	*printer_lu;
 	char	*printer_opts;
 	int	 save_lines;
+	int	 save_bytes;
 	bool	 visual_bell;
     } interactive;
 
@@ -31,4 +31,5 @@
  */
 
 char *base64_encode(const char *s);
+char *base64_encode_len(const char *s, size_t len);
 char *base64_decode(const char *s);
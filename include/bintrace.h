@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *	bintrace.h
+ *		Binary network data traces.
+ */
+
+/*
+ * A binary trace file starts with BINTRACE_MAGIC, followed by records.
+ * Each record is a BINTRACE_HDR_LEN-byte header followed by the data.
+ * Integers are big-endian.
+ *
+ *  offset  size  contents
+ *   0       1    direction: BINTRACE_HOST ('<') or BINTRACE_EMUL ('>')
+ *   1       3    reserved, zero
+ *   4       4    data length
+ *   8       8    timestamp, microseconds since the epoch
+ */
+#define BINTRACE_MAGIC		"x3270bt1"
+#define BINTRACE_MAGIC_LEN	8
+#define BINTRACE_HDR_LEN	16
+
+#define BINTRACE_HOST		'<'	/* host to emulator */
+#define BINTRACE_EMUL		'>'	/* emulator to host */
+
+typedef struct {
+    char direction;		/* BINTRACE_HOST or BINTRACE_EMUL */
+    unsigned long long us;	/* timestamp */
+    size_t len;			/* data length */
+    unsigned char *buf;		/* data */
+    size_t buf_size;		/* allocated size of buf */
+} bintrace_record_t;
+
+typedef enum {
+    BTR_RECORD,			/* got a record */
+    BTR_EOF,			/* clean end of file */
+    BTR_ERROR			/* malformed or truncated file */
+} bintrace_read_t;
+
+void bintrace_encode_header(unsigned char *hdr, char direction, size_t len,
+	unsigned long long us);
+bool bintrace_is_binary(FILE *f);
+bintrace_read_t bintrace_read(FILE *f, bintrace_record_t *r);
+
+/* Emulator-side capture. */
+void bintrace_netdata(char direction, unsigned const char *buf, size_t len);
@@ -42,8 +42,11 @@ extern int crm_nattr;
 extern unsigned char reply_mode;
 extern bool screen_alt;
 extern bool screen_changed;
+extern unsigned long screen_generation;
 extern int first_changed;
 extern int last_changed;
+extern bool *row_changed;
+extern unsigned long *row_generation;
 
 bool check_rows_cols(int mn, unsigned ovc, unsigned ovr);
 void ctlr_aclear(int baddr, int count, int clear_ea);
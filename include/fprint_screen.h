@@ -52,6 +52,8 @@ typedef enum {
 
 fps_status_t fprint_screen(FILE *f, ptype_t ptype, unsigned opts,
 	const char *caption, const char *printer_name, void *wait_context);
+fps_status_t fprint_screen_vb(varbuf_t *vb, ptype_t ptype, unsigned opts,
+	const char *caption);
 fps_status_t fprint_screen_start(FILE *f, ptype_t ptype, unsigned opts,
 	const char *caption, const char *printer_name, fps_t *fps,
 	void *wait_context);
@@ -416,6 +416,10 @@ enum keytype { KT_STD, KT_GE };
 #define DFT_MIN_BUF	256
 #define DFT_MAX_BUF	32767
 
+/* Default size of the NVT text buffer searched by Expect(). */
+#define NVT_SAVE_SIZE	4096
+#define NVT_SAVE_MIN	256
+
 /* DBCS Preedit Types */
 #define PT_ROOT		"Root"
 #define PT_OVER_THE_SPOT	"OverTheSpot"
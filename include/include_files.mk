@@ -1,5 +1,5 @@
 INCLUDE_HEADERS = 3270ds.h actions.h apl.h appres.h arpa_telnet.h asprintf.h \
-	b8.h bind-opt.h charset.h child.h child_popups.h ctlr.h ctlrc.h \
+	b8.h bind-opt.h bintrace.h charset.h child.h child_popups.h ctlr.h ctlrc.h \
 	fallbacks.h fprint_screen.h ft.h ft_cut.h ft_cut_ds.h ft_dft.h \
 	ft_dft_ds.h ft_gui.h ft_private.h gdi_print.h globals.h glue.h \
 	glue_gui.h host.h host_gui.h httpd-core.h httpd-io.h httpd-nodes.h \
@@ -9,5 +9,5 @@ INCLUDE_HEADERS = 3270ds.h actions.h apl.h appres.h arpa_telnet.h asprintf.h \
 	resolver.h resources.h rpq.h save.h screen.h scroll.h see.h selectc.h \
 	sf.h status.h tables.h telnet.h telnet_core.h telnet_gui.h \
 	telnet_private.h tls_passwd_gui.h tn3270e.h toggles.h trace.h \
-	trace_gui.h unicode_dbcs.h unicodec.h utf8.h util.h varbuf.h w3misc.h \
-	wincmn.h windirs.h winprint.h winvers.h xio.h
+	trace_gui.h unicode_dbcs.h unicodec.h utf8.h util.h varbuf.h varint.h \
+	w3misc.h wincmn.h windirs.h winprint.h winvers.h xio.h
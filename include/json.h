@@ -74,6 +74,22 @@ json_errcode_t json_parse(const char *text, ssize_t len, json_t **result,
 	json_parse_error_t **error);
 #define json_parse_s(t, r, e) json_parse(t, NT, r, e)
 
+/* Parse text into JSON incrementally, as it arrives. */
+typedef struct json_stream json_stream_t;
+json_stream_t *json_stream_init(void);
+json_errcode_t json_stream_parse(json_stream_t *js, const char *text,
+	size_t len, size_t *consumed, json_t **result,
+	json_parse_error_t **error);
+json_errcode_t json_stream_end(json_stream_t *js, json_t **result,
+	json_parse_error_t **error);
+json_errcode_t json_stream_trailing(json_stream_t *js, const char *text,
+	size_t len, json_parse_error_t **error);
+bool json_stream_idle(const json_stream_t *js);
+json_stream_t *_json_stream_free(json_stream_t *js);
+#define json_stream_free(s) do { \
+    s = _json_stream_free(s); \
+} while (false)
+
 /* Free a JSON node recursively. */
 json_t *_json_free(json_t *json);
 json_parse_error_t *_json_free_error(json_parse_error_t *error);
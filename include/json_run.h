@@ -40,6 +40,8 @@ typedef enum {
 cmd_t **free_cmds(cmd_t **cmds);
 hjparse_ret_t hjson_parse(const char *cmd, size_t cmd_len, cmd_t ***cmds,
 	char **split, char **errmsg);
+hjparse_ret_t hjson_parse_stream(json_stream_t *js, const char *cmd,
+	size_t cmd_len, cmd_t ***cmds, char **single, char **errmsg);
 bool hjson_split(const json_t *json, cmd_t ***cmds, char **single,
 	char **errmsg);
 bool json_key_matches(const char *key, size_t key_length,
@@ -40,6 +40,7 @@
 #define AnAnsiText	"AnsiText"
 #define AnAscii		"Ascii"
 #define AnAscii1	"Ascii1"
+#define AnAsciiDelta	"AsciiDelta"
 #define AnAsciiField	"AsciiField"
 #define AnCapabilities	"Capabilities"
 #define AnCircumNot	"CircumNot"
@@ -161,6 +162,8 @@
 #define KwAssert	"assert"
 #define KwExit		"exit"
 #define KwNull		"null"
+/*  Parameters to Expect(). */
+#define KwDashTimeout	"-timeout"
 /*  Parameters to HexString(). */
 #define KwDashAscii	"-ascii"
 /*  Parameters to KeyboardDisable(). */
@@ -205,6 +208,7 @@
 #define KwModel		"Model"
 #define KwPrefixes	"Prefixes"
 #define KwProxy		"Proxy"
+#define KwResolver	"Resolver"
 #define KwScreenCurSize	"ScreenCurSize"
 #define KwScreenMaxSize	"ScreenMaxSize"
 #define KwScreenSizeCurrent "ScreenSizeCurrent"
@@ -234,6 +238,7 @@
 #define KwAscii		"ascii"
 #define KwEbcdic	"ebcdic"
 #define KwUnicode	"unicode"
+#define KwBinary	"binary"
 #define KwField		"field"
 /*  Parameters to RequestInput(). */
 #define KwDashNoEcho	"-noecho"
@@ -56,3 +56,4 @@ bool numeric_host_and_port(const struct sockaddr *sa, socklen_t salen,
 	char *host, size_t hostlen, char *serv, size_t servlen, char **errmsg);
 
 void set_46(bool prefer4, bool prefer6);
+const char *resolver_query_stats(void);
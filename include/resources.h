@@ -99,6 +99,8 @@
 #define ResDpi			"dpi"
 #define ResEmulatorFont		"emulatorFont"
 #define ResEof			"eof"
+#define ResEventBackend		"eventBackend"
+#define ResExpectBufferSize	"expectBufferSize"
 #define ResErase		"erase"
 #define ResExtendedDataStream	"extendedDataStream"
 #define ResFixedSize		"fixedSize"
@@ -205,6 +207,7 @@
 #define ResReverseVideo		"reverseVideo"
 #define ResRightToLeftMode	"rightToLeftMode"
 #define ResRprnt		"rprnt"
+#define ResSaveBytes		"saveBytes"
 #define ResSaveLines		"saveLines"
 #define ResSchemeList		"schemeList"
 #define ResScreenTrace		"screenTrace"
@@ -234,6 +237,8 @@
 #define ResTlsMinProtocol	"tlsMinProtocol"
 #define ResTlsSecurityLevel	"tlsSecurityLevel"
 #define ResTrace		"trace"
+#define ResTraceBinaryFile	"traceBinaryFile"
+#define ResTraceBufferSize	"traceBufferSize"
 #define ResTraceDir		"traceDir"
 #define ResTraceFile		"traceFile"
 #define ResTraceFileSize	"traceFileSize"
@@ -370,6 +375,7 @@
 #define ClsEmulatorFont		"EmulatorFont"
 #define ClsEof			"Eof"
 #define ClsErase		"Erase"
+#define ClsExpectBufferSize	"ExpectBufferSize"
 #define ClsExtendedDataStream	"ExtendedDataStream"
 #define ClsFixedSize		"FixedSize"
 #define ClsFtAllocation		"FtAllocation"
@@ -456,6 +462,7 @@
 #define ClsReverseInputMode	"ReverseInputMode"
 #define ClsRightToLeftMode	"RightToLeftMode"
 #define ClsRprnt		"Rprnt"
+#define ClsSaveBytes		"SaveBytes"
 #define ClsSaveLines		"SaveLines"
 #define ClsSbcsCgcsgid		"SbcsSgcsgid"
 #define ClsScreenTrace		"ScreenTrace"
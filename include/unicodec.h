@@ -57,6 +57,8 @@ size_t ebcdic_to_multibyte_f(ebc_t ebc, char mb[], size_t mb_len, bool
 	force_utf8);
 size_t ebcdic_to_multibyte_fx(ebc_t ebc, unsigned char cs, char mb[],
 	size_t mb_len, unsigned flags, ucs4_t *ucp, bool force_utf8);
+size_t ebcdic_to_multibyte_fc(ebc_t ebc, unsigned char cs, unsigned flags,
+	bool force_utf8, const char **mbp);
 size_t ebcdic_to_multibyte_string(unsigned char *ebc, size_t ebc_len,
 	char mb[], size_t mb_len);
 size_t ebcdic_to_multibyte_x(ebc_t ebc, unsigned char cs, char mb[],
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# pr3287 SCS print job throughput benchmark
+
+import os
+import tempfile
+import unittest
+from subprocess import Popen, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+# Writes a trace file with the TN3270E negotiation and BIND from the smoke
+# test, followed by one SCS print job of about mbytes megabytes.
+def write_scs_trace(path:str, mbytes:int):
+    with open(path, 'w') as out:
+        with open('pr3287/Test/smoke.trc', 'r') as smoke:
+            for line in smoke:
+                out.write(line)
+                if line.startswith('RCVD TN3270E(BIND-IMAGE'):
+                    break
+
+        # One report line, in EBCDIC, ending with an SCS NL.
+        def scs_line(n:int) -> bytes:
+            text = f'{n:08d}  ACCT {n * 7919 % 1000003:07d}  ' + \
+                f'BALANCE {n % 100000:>9d}.{n % 100:02d}  STATUS OK'
+            return text.encode('cp037') + b'\x15'
+
+        # SCS-DATA records of about 4 KB each.
+        n = 0
+        size = 0
+        while size < mbytes * 1024 * 1024:
+            record = b''
+            while len(record) < 4096:
+                record += scs_line(n)
+                n += 1
+            size += len(record)
+            out.write('< 0x0   ' + (b'\x01\x00\x00\x00\x00' + record + b'\xff\xef').hex() + '\n')
+
+        # PRINT-EOJ.
+        out.write('< 0x0   ' + b'\x08\x00\x00\x00\x00\xff\xef'.hex() + '\n')
+    return size
+
+@unittest.skipIf(os.name == 'nt', 'Does not run on Windows')
+class BenchPr3287Scs(cti.cti):
+
+    # Megabytes of SCS data to print.
+    mbytes = int(os.environ.get('BENCH_MBYTES', '20'))
+
+    # Print one large SCS job from a trace file, with optional extra options.
+    def print_scs(self, name:str, extra_args:list):
+        with tempfile.TemporaryDirectory() as tempdir:
+            trace = os.environ.get('BENCH_TRACE')
+            if trace == None:
+                trace = os.path.join(tempdir, 'scs.trc')
+                write_scs_trace(trace, self.mbytes)
+            records = bench.host_records(trace)
+            size = sum(len(r) for r in records)
+            out = os.path.join(tempdir, 'out')
+
+            host = bench.streamhost(self)
+            args = ['pr3287'] + extra_args + \
+                os.environ.get('BENCH_PR3287_ARGS', '').split()
+            pr3287 = Popen(args + ['-command', f"cat >'{out}'",
+                f'127.0.0.1:{host.port}'], stdout=DEVNULL, stderr=DEVNULL)
+            self.children.append(pr3287)
+            host.accept()
+            host.send(b''.join(records), timeout=300)
+            host.close()
+            cpu = bench.wait_rusage(pr3287)
+            self.children.remove(pr3287)
+            self.assertGreater(os.path.getsize(out), 0, 'pr3287 did not print')
+        bench.report(name, size / (1024 * 1024), 'MB', cpu)
+
+    # Print a large SCS job.
+    def test_pr3287_scs_print(self):
+        self.print_scs('SCS print', [])
+
+    # Print a large SCS job with tracing on.
+    def test_pr3287_scs_print_traced(self):
+        self.print_scs('SCS print (traced)', ['-trace', '-tracefile', os.devnull])
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# pr3287 multi-LU (-lus) tests
+
+import glob
+import os
+import pathlib
+import re
+import select
+import socket
+import sys
+import tempfile
+import threading
+import time
+import unittest
+from subprocess import Popen
+import Common.Test.cti as cti
+
+# Host data from the smoke test trace, up to the first mark.
+def smoke_data():
+    data = b''
+    with open('pr3287/Test/smoke.trc', 'r') as file:
+        for line in file:
+            if re.match('^< 0x[0-9a-f]+ +', line):
+                data += bytes.fromhex(line.split()[2])
+            elif line.startswith('+'):
+                break
+    return data
+
+# Playback server that feeds the same trace to any number of connections.
+class multi_playback():
+
+    def __init__(self, n: int):
+        self.n = n
+        self.data = smoke_data()
+        self.conns = []
+        self.listensocket = socket.socket(socket.AF_INET, socket.SOCK_STREAM, 0)
+        self.listensocket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listensocket.bind(('127.0.0.1', 0))
+        self.port = self.listensocket.getsockname()[1]
+        self.listensocket.listen(n)
+        self.thread = threading.Thread(target=self.process)
+        self.thread.start()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, exc_traceback):
+        self.close()
+
+    # Accept each connection and send it the trace.
+    def process(self):
+        while len(self.conns) < self.n:
+            r, _, _ = select.select([self.listensocket], [], [], 10)
+            if r == []:
+                break
+            (conn, _) = self.listensocket.accept()
+            conn.sendall(self.data)
+            self.conns.append(conn)
+
+    def close(self):
+        '''Disconnect everyone'''
+        self.thread.join()
+        # Drain what the emulator sent, so the close does not turn into a reset.
+        for conn in self.conns:
+            conn.shutdown(socket.SHUT_WR)
+        for conn in self.conns:
+            while select.select([conn], [], [], 5)[0] != [] and conn.recv(4096) != b'':
+                pass
+            conn.close()
+        self.conns = []
+        self.listensocket.close()
+
+@unittest.skipIf(sys.platform.startswith('win'), 'Does not run on Windows')
+@unittest.skipIf(sys.platform == 'cygwin', 'This does some very strange things on Cygwin')
+class TestPr3287MultiLu(cti.cti):
+
+    # Returns the LU names for a test.
+    def lu_names(self, n: int):
+        return [f'LU{i:03d}' for i in range(n)]
+
+    # Checks that every LU has spooled two complete jobs.
+    def spool_check(self, tempdir: str, lus):
+        files = [f for f in os.listdir(tempdir) if not f.startswith('.')]
+        return len(files) == 2 * len(lus)
+
+    # Serves n LUs from one pr3287, spooling jobs into a directory.
+    def multilu_spooldir(self, n: int, timeout: int):
+        ref_printout = pathlib.Path('pr3287/Test/smoke.out').read_bytes()
+        lus = self.lu_names(n)
+        with tempfile.TemporaryDirectory() as tempdir:
+            with multi_playback(n) as p:
+                start = time.monotonic()
+                pr3287 = Popen(cti.vgwrap(['pr3287', '-lus', ','.join(lus),
+                    '-spooldir', tempdir, f'127.0.0.1:{p.port}']))
+                self.children.append(pr3287)
+                self.try_until(lambda: self.spool_check(tempdir, lus), timeout,
+                    'pr3287 did not spool all of the jobs')
+                elapsed = time.monotonic() - start
+
+            # Disconnecting every LU makes pr3287 exit.
+            self.vgwait(pr3287, timeout=timeout)
+            self.children.remove(pr3287)
+
+            # Each LU's second job is the reference printout.
+            for lu in lus:
+                jobs = glob.glob(os.path.join(tempdir, f'{lu}.*.2'))
+                self.assertEqual(1, len(jobs), f'{lu} job 2 missing')
+                self.assertEqual(ref_printout, pathlib.Path(jobs[0]).read_bytes())
+        return elapsed
+
+    # Multi-LU spool directory test.
+    def test_pr3287_multilu_spooldir(self):
+        self.multilu_spooldir(4, 5)
+
+    # Multi-LU load test: many LUs in one process.
+    def test_pr3287_multilu_load(self):
+        n = 200
+        elapsed = self.multilu_spooldir(n, 30)
+        print(f'\n{n} LUs, {2 * n} jobs in {elapsed:.2f}s', file=sys.stderr)
+
+    # Multi-LU long-lived pipe test.
+    def test_pr3287_multilu_pipe(self):
+        ref_printout = pathlib.Path('pr3287/Test/smoke.out').read_bytes()
+        n = 4
+        (po_handle, po_name) = tempfile.mkstemp()
+        with multi_playback(n) as p:
+            pr3287 = Popen(cti.vgwrap(['pr3287', '-lus', ','.join(self.lu_names(n)),
+                '-pipe', f"cat >'{po_name}'", f'127.0.0.1:{p.port}']))
+            self.children.append(pr3287)
+            self.try_until(lambda: os.read(os.open(po_name, os.O_RDONLY), 1 << 20).count(ref_printout) == n, 5,
+                'pr3287 did not write all of the jobs')
+        self.vgwait(pr3287)
+        self.children.remove(pr3287)
+
+        # Every job went to the one pipe, intact.
+        printout = pathlib.Path(po_name).read_bytes()
+        os.close(po_handle)
+        os.unlink(po_name)
+        self.assertEqual(n, printout.count(ref_printout))
+
+if __name__ == '__main__':
+    unittest.main()
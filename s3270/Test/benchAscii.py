@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 Ascii()/ReadBuffer() screen dump benchmark
+
+import os
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+# Screen size.
+rows = 62
+cols = 160
+
+# TELNET negotiation for plain 3270 mode.
+host_setup = bytes.fromhex('fffd18' + 'fffa1801fff0' + 'fffd19fffb19' +
+    'fffd00fffb00')
+
+# An Erase/Write Alternate that fills the screen with fields: on each row,
+# a protected label and an unprotected, highlighted value. The cursor goes
+# in the first value.
+def screen():
+    data = b'\x7e\xc2'
+    for row in range(rows):
+        label = f'Row {row:02d} label: '
+        value = f'value {row * 7919 % 100003:06d} ' + 'abcdefghij' * 15
+        value = value[:cols - len(label) - 2]
+        data += b'\x1d\x60' + label.encode('cp037')
+        data += b'\x29\x02\xc0\x40\x41\xf2'
+        if row == 0:
+            # Insert cursor, so the emulator sees an input field.
+            data += b'\x13'
+        data += value.encode('cp037')
+    return data + b'\xff\xef'
+
+class BenchS3270Ascii(cti.cti):
+
+    # Number of screen dumps.
+    count = int(os.environ.get('BENCH_MBYTES', '1')) * 5000
+
+    def dump(self, name:str, action:str):
+        host = bench.streamhost(self)
+        args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+        s3270 = Popen(args + ['-model', '3279-2-E', '-oversize',
+            f'{cols}x{rows}', f'127.0.0.1:{host.port}'], stdin=PIPE,
+            stdout=DEVNULL, stderr=DEVNULL)
+        self.children.append(s3270)
+        host.accept()
+        host.send(host_setup)
+        host.send(screen())
+        s3270.stdin.write(f'{action}\n'.encode() * self.count)
+        s3270.stdin.write(b'Quit()\n')
+        s3270.stdin.flush()
+        s3270.stdin.close()
+        cpu = bench.wait_rusage(s3270)
+        host.close()
+        bench.report(name, self.count, 'screens', cpu)
+
+    def test_s3270_ascii(self):
+        self.dump('Ascii()', 'Ascii()')
+
+    def test_s3270_readbuffer(self):
+        self.dump('ReadBuffer(Ascii)', 'ReadBuffer(Ascii)')
+
+if __name__ == '__main__':
+    unittest.main()
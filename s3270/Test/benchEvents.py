@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 event dispatch latency benchmark
+
+import os
+import resource
+import socket
+import time
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+class BenchS3270Events(cti.cti):
+
+    # Number of idle peer connections.
+    peers = int(os.environ.get('BENCH_PEERS', '2000'))
+
+    # Number of round trips to time.
+    iterations = int(os.environ.get('BENCH_ITERATIONS', '5000'))
+
+    # Time peer-script round trips with many idle peer connections open.
+    def dispatch(self, backend:str, npeers:int):
+
+        # Make sure there are enough file descriptors.
+        soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+        want = 2 * npeers + 100
+        if soft < want:
+            if hard != resource.RLIM_INFINITY and hard < want:
+                self.skipTest(f'Need {want} file descriptors')
+            resource.setrlimit(resource.RLIMIT_NOFILE, (want, hard))
+
+        # Start s3270.
+        port, ts = cti.unused_port()
+        s3270 = Popen(['s3270', '-xrm', f's3270.eventBackend: {backend}',
+                       '-scriptport', str(port)], stdin=DEVNULL, stdout=DEVNULL)
+        self.children.append(s3270)
+        ts.close()
+        self.check_listen(port)
+
+        # Open the idle connections.
+        idle = []
+        for _ in range(npeers):
+            idle.append(socket.create_connection(('127.0.0.1', port)))
+
+        # Time round trips on one more, using an action that produces no
+        # data lines, so the reply is a single segment.
+        with socket.create_connection(('127.0.0.1', port)) as s:
+            s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            f = s.makefile('rb')
+            times = []
+            for _ in range(self.iterations):
+                start = time.perf_counter_ns()
+                s.sendall(b'MoveCursor1(1,1)\n')
+                while True:
+                    line = f.readline()
+                    self.assertNotEqual(b'', line, 'Unexpected EOF')
+                    if line == b'ok\n':
+                        break
+                    self.assertNotEqual(b'error\n', line, 'Command failed')
+                times.append(time.perf_counter_ns() - start)
+            s.sendall(b'Quit()\n')
+            f.close()
+
+        for c in idle:
+            c.close()
+        self.vgwait(s3270)
+
+        bench.report_latency(f'{backend}, {npeers} idle peers', times)
+
+    def test_s3270_dispatch_epoll(self):
+        self.dispatch('epoll', self.peers)
+    def test_s3270_dispatch_select(self):
+        # select() cannot handle file descriptors above FD_SETSIZE.
+        self.dispatch('select', min(self.peers, 1000))
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 Expect() benchmark
+
+import os
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+import s3270.Test.benchNvt as benchNvt
+
+class BenchS3270Expect(cti.cti):
+
+    # Megabytes of text to stream.
+    mbytes = int(os.environ.get('BENCH_MBYTES', '100'))
+
+    # Stream noisy NVT output while Expect() waits for a prompt, which
+    # arrives at the very end.
+    def expect(self, name: str, action: str, result: bytes):
+        host = bench.streamhost(self)
+        args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+        s3270 = Popen(args + [f'127.0.0.1:{host.port}'], stdin=PIPE,
+            stdout=PIPE, stderr=DEVNULL)
+        self.children.append(s3270)
+        host.accept()
+        host.send(benchNvt.host_setup)
+        s3270.stdin.write(action.encode() + b'\n')
+        s3270.stdin.flush()
+
+        # 1 MB of log lines that almost, but never quite, contain a prompt.
+        lines = []
+        size = 0
+        n = 0
+        while size < 1024 * 1024:
+            line = f'{n:08d} login attempt from host-{n % 97:02d} ' + \
+                f'password check {n % 3} ${n}\r\n'
+            lines.append(line.encode('ascii'))
+            size += len(lines[-1])
+            n += 1
+        chunk = b''.join(lines)
+        for _ in range(self.mbytes):
+            host.conn.sendall(chunk)
+        host.send(b'\r\nlogin: ')
+        out = b''
+        while not out.endswith(b'ok\n') and not out.endswith(b'error\n'):
+            out += s3270.stdout.readline()
+        self.assertTrue(out.endswith(b'ok\n'))
+        self.assertTrue(out.startswith(result))
+        host.close()
+        s3270.stdin.write(b'Quit()\n')
+        s3270.stdin.flush()
+        s3270.stdin.close()
+        cpu = bench.wait_rusage(s3270)
+        bench.report(name, self.mbytes * len(chunk) / (1024 * 1024),
+            'MB', cpu)
+
+    def test_s3270_expect(self):
+        self.expect('Expect', 'Expect("login: ",600)', b'')
+
+    def test_s3270_expect_multiple(self):
+        self.expect('Expect multiple',
+            'Expect(-Timeout,600,Password:,"login: ","$ ")', b'data: 1\n')
+
+if __name__ == '__main__':
+    unittest.main()
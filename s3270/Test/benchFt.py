@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# s3270 DFT upload throughput benchmark, against a host that replays the
+# IND$FILE records from an upload trace for as many Gets as the file needs
+
+import hashlib
+import os
+import random
+import select
+import socket
+import tempfile
+import time
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+IAC = 0xff
+
+# Host that drives a DFT upload with the records from a trace.
+class dfthost():
+
+    conn = None
+
+    def __init__(self, tc:cti.cti, trace_file:str):
+        self.tc = tc
+        records = bench.host_records(trace_file)
+        find = lambda pattern: next(r for r in records if pattern in r)
+        self.login = records[:2]
+        self.open = find(b'FT:DATA')
+        self.pre = records[2:records.index(self.open)]
+        self.get = find(b'\xd0\x46\x11')
+        self.close_req = find(b'\xd0\x41\x12')
+        self.msg_open = find(b'FT:MSG')
+        self.msg_data = find(b'\xd0\x47\x04')
+        self.buf = b''
+        self.digest = hashlib.sha256()
+        # Simulated host processing time per Get, in seconds.
+        self.delay = float(os.environ.get('BENCH_FT_HOST_MS', '0')) / 1000
+        self.listensocket = socket.socket(socket.AF_INET, socket.SOCK_STREAM, 0)
+        self.listensocket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.listensocket.bind(('127.0.0.1', 0))
+        self.port = self.listensocket.getsockname()[1]
+        self.listensocket.listen()
+
+    def accept(self, timeout=5):
+        '''Accept the emulator connection and put up the first screen'''
+        r, _, _ = select.select([self.listensocket], [], [], timeout)
+        self.tc.assertNotEqual([], r, 'Emulator did not connect')
+        (self.conn, _) = self.listensocket.accept()
+        self.listensocket.close()
+        self.conn.sendall(b''.join(self.login))
+
+    def record(self):
+        '''Read the next record from the emulator, skipping Telnet negotiation'''
+        while True:
+            while len(self.buf) >= 3 and self.buf[0] == IAC:
+                if self.buf[1] in (0xfb, 0xfc, 0xfd, 0xfe):
+                    self.buf = self.buf[3:]
+                elif self.buf[1] == 0xfa and b'\xff\xf0' in self.buf:
+                    self.buf = self.buf[self.buf.index(b'\xff\xf0') + 2:]
+                else:
+                    break
+            start = 0
+            while True:
+                i = self.buf.find(b'\xff\xef', start)
+                if i < 0:
+                    break
+                j = i
+                while j > 0 and self.buf[j - 1] == IAC:
+                    j -= 1
+                if (i - j) % 2 == 0:
+                    record = self.buf[:i]
+                    self.buf = self.buf[i + 2:]
+                    return record
+                start = i + 1
+            r, _, _ = select.select([self.conn], [], [], 10)
+            self.tc.assertNotEqual([], r, 'Emulator did not answer')
+            data = self.conn.recv(65536)
+            self.tc.assertNotEqual(b'', data, 'Emulator disconnected')
+            self.buf += data
+
+    def upload(self):
+        '''Run the host side of an upload, returning the number of data buffers'''
+        # Wait for the IND$FILE command, then query the emulator.
+        while self.record()[0] != 0x7d:
+            pass
+        self.conn.sendall(b''.join(self.pre))
+        while self.record()[0] != 0x88:
+            pass
+
+        # Open, Get until EOF, Close.
+        self.conn.sendall(self.open)
+        self.record()
+        buffers = 0
+        while True:
+            self.conn.sendall(self.get)
+            record = self.record()
+            if b'\xd0\x46\x08' in record:
+                break
+            self.digest.update(record.replace(b'\xff\xff', b'\xff')[17:])
+            buffers += 1
+            if self.delay:
+                time.sleep(self.delay)
+        self.conn.sendall(self.close_req)
+        self.record()
+
+        # Send the completion message.
+        self.conn.sendall(self.msg_open)
+        self.record()
+        self.conn.sendall(self.msg_data)
+        self.record()
+        return buffers
+
+    def close(self):
+        if self.conn != None:
+            self.conn.close()
+            self.conn = None
+
+class BenchS3270Ft(cti.cti):
+
+    # Size of the file to upload.
+    mbytes = 16 * int(os.environ.get('BENCH_MBYTES', '1'))
+
+    # Issue an action and return its output.
+    def action(self, s3270, action:str):
+        s3270.stdin.write(f'{action}\n'.encode())
+        s3270.stdin.flush()
+        out = []
+        while True:
+            line = s3270.stdout.readline().decode()
+            self.assertNotEqual('', line, 's3270 exited')
+            out.append(line.strip())
+            if line.strip() in ('ok', 'error'):
+                return out
+
+    def upload(self, name:str, local_file:str, options:str, expect:bytes):
+        host = dfthost(self, 's3270/Test/ft_dft.trc')
+        s3270 = Popen(cti.vgwrap(['s3270', f'127.0.0.1:{host.port}']), stdin=PIPE, stdout=PIPE)
+        self.children.append(s3270)
+        host.accept()
+        self.action(s3270, 'Wait(InputField)')
+
+        # Time the transfer.
+        start = time.monotonic()
+        s3270.stdin.write(f'transfer direction=send host=tso localfile={local_file} hostfile=x {options}\n'.encode())
+        s3270.stdin.flush()
+        buffers = host.upload()
+        out = self.action(s3270, '')
+        seconds = time.monotonic() - start
+        self.assertIn('Transfer complete', out[0])
+        self.assertEqual('ok', out[-1])
+        self.assertEqual(hashlib.sha256(expect).hexdigest(), host.digest.hexdigest(), 'Wrong data uploaded')
+        bench.report(f'{name}, {buffers} buffers', os.path.getsize(local_file) / (1024 * 1024), 'MB', seconds)
+
+        s3270.stdin.close()
+        self.vgwait(s3270, timeout=10)
+        s3270.stdout.close()
+        host.close()
+
+    def test_s3270_ft_upload(self):
+        size = self.mbytes * 1024 * 1024
+
+        # Text: lines of printable characters, leaving out the ones that
+        # IND$FILE's fixed translation table changes.
+        rng = random.Random(3270)
+        chars = [chr(c) for c in range(0x20, 0x7f) if chr(c) not in '[]^|']
+        lines = [''.join(rng.choices(chars, k=rng.randint(0, 79))) for _ in range(1000)]
+        text = ('\n'.join(lines) + '\n').encode()
+        text = text * (size // len(text))
+        (fd, text_file) = tempfile.mkstemp()
+        with os.fdopen(fd, 'wb') as f:
+            f.write(text)
+        binary = rng.randbytes(size)
+        (fd, bin_file) = tempfile.mkstemp()
+        with os.fdopen(fd, 'wb') as f:
+            f.write(binary)
+
+        # The text survives the trip through the host code page unchanged.
+        crlf = text.replace(b'\n', b'\r\n')
+        self.upload('ascii', text_file, '', crlf)
+        self.upload('ascii bufferSize=32767', text_file, 'bufferSize=32767', crlf)
+        self.upload('ascii cr=keep remap=no', text_file, 'cr=keep remap=no', text)
+        self.upload('binary bufferSize=32767', bin_file, 'mode=binary bufferSize=32767', binary)
+
+        os.unlink(text_file)
+        os.unlink(bin_file)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# s3270 HTTP screen endpoint throughput benchmark
+
+import http.client
+import os
+import time
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+import Common.Test.playback as playback
+
+def cpu_seconds(pid:int):
+    '''Return the CPU time used so far by a running process, in seconds'''
+    with open(f'/proc/{pid}/stat', 'r') as f:
+        fields = f.read().rsplit(')', 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+@unittest.skipUnless(os.path.exists('/proc/self/stat'), 'Linux-specific')
+class BenchS3270Httpd(cti.cti):
+
+    # Number of requests per endpoint.
+    requests = 2000 * int(os.environ.get('BENCH_MBYTES', '1'))
+
+    # Fetch a URL repeatedly, reporting requests per second.
+    def fetch(self, pid:int, port:int, url:str):
+        cpu = cpu_seconds(pid)
+        start = time.monotonic()
+        for _ in range(self.requests):
+            conn = http.client.HTTPConnection('127.0.0.1', port)
+            conn.request('GET', url)
+            r = conn.getresponse()
+            r.read()
+            self.assertEqual(200, r.status)
+            conn.close()
+        elapsed = time.monotonic() - start
+        cpu = cpu_seconds(pid) - cpu
+        bench.report(f'GET {url}', self.requests, 'requests', elapsed)
+        bench.report(f'GET {url} (s3270 CPU)', self.requests, 'requests', cpu)
+
+    def test_s3270_httpd_screen(self):
+        playback_port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ibmlink.trc', port=playback_port) as p:
+            ts.close()
+
+            # Start s3270 with a webserver and put a screen up.
+            http_port, ts = cti.unused_port()
+            args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+            s3270 = Popen(args + ['-httpd', f'127.0.0.1:{http_port}',
+                f'127.0.0.1:{playback_port}'], stdin=PIPE, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(http_port)
+            ts.close()
+            p.send_records(4)
+
+            # Hammer the endpoints.
+            self.fetch(s3270.pid, http_port, '/3270/screen.html')
+            self.fetch(s3270.pid, http_port, '/3270/interact.html')
+            self.fetch(s3270.pid, http_port, '/3270/rest/json/Ascii1()')
+            self.fetch(s3270.pid, http_port, '/3270/rest/html/Ascii1()')
+
+            # Stop s3270.
+            conn = http.client.HTTPConnection('127.0.0.1', http_port)
+            conn.request('GET', '/3270/rest/json/Quit(-force)')
+            conn.close()
+
+        s3270.stdin.close()
+        self.vgwait(s3270)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# s3270 HTTP load test: latency and throughput of the REST API with
+# per-request connections, keep-alive connections, concurrent clients and
+# pipelined requests
+
+import os
+import socket
+import threading
+import time
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+import Common.Test.playback as playback
+
+class BenchS3270HttpdLoad(cti.cti):
+
+    # Number of requests per test.
+    requests = 2000 * int(os.environ.get('BENCH_MBYTES', '1'))
+
+    # Number of concurrent clients.
+    clients = 4
+
+    # Number of requests sent at once when pipelining.
+    depth = 16
+
+    url = '/3270/rest/json/Ascii1()'
+
+    def request(self):
+        return f'GET {self.url} HTTP/1.1\r\nHost: localhost\r\n\r\n'.encode()
+
+    def connect(self):
+        s = socket.create_connection(('127.0.0.1', self.port))
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        s.settimeout(10)
+        return s
+
+    # Issue requests one at a time on one connection, or on a new connection
+    # for each request. Returns the latency of each request.
+    def sequential(self, count:int, keepalive:bool):
+        times = []
+        s = self.connect() if keepalive else None
+        for _ in range(count):
+            start = time.monotonic_ns()
+            if not keepalive:
+                s = self.connect()
+            s.sendall(self.request())
+            header, _, _ = cti.http_response(s, b'')
+            times.append(time.monotonic_ns() - start)
+            self.assertTrue(header.startswith('HTTP/1.1 200 '))
+            if not keepalive:
+                s.close()
+        if keepalive:
+            s.close()
+        return times
+
+    def test_s3270_httpd_load(self):
+        playback_port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ibmlink.trc', port=playback_port) as p:
+            ts.close()
+
+            # Start s3270 with a webserver and put a screen up.
+            self.port, ts = cti.unused_port()
+            args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+            s3270 = Popen(args + ['-httpd', f'127.0.0.1:{self.port}',
+                f'127.0.0.1:{playback_port}'], stdin=PIPE, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(self.port)
+            ts.close()
+            p.send_records(4)
+
+            # A new connection for each request.
+            start = time.monotonic()
+            times = self.sequential(self.requests, False)
+            bench.report('connection per request', self.requests, 'requests', time.monotonic() - start)
+            bench.report_latency('connection per request', times)
+
+            # One keep-alive connection.
+            start = time.monotonic()
+            times = self.sequential(self.requests, True)
+            bench.report('keep-alive', self.requests, 'requests', time.monotonic() - start)
+            bench.report_latency('keep-alive', times)
+
+            # Concurrent keep-alive clients.
+            results = [None] * self.clients
+            def client(i):
+                results[i] = self.sequential(self.requests // self.clients, True)
+            threads = [threading.Thread(target=client, args=(i,)) for i in range(self.clients)]
+            start = time.monotonic()
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+            elapsed = time.monotonic() - start
+            times = [t for r in results for t in r]
+            bench.report(f'{self.clients} keep-alive clients', len(times), 'requests', elapsed)
+            bench.report_latency(f'{self.clients} keep-alive clients', times)
+
+            # Pipelined requests on one connection.
+            times = []
+            s = self.connect()
+            start = time.monotonic()
+            for _ in range(self.requests // self.depth):
+                t = time.monotonic_ns()
+                s.sendall(self.request() * self.depth)
+                buf = b''
+                for _ in range(self.depth):
+                    header, _, buf = cti.http_response(s, buf)
+                    self.assertTrue(header.startswith('HTTP/1.1 200 '))
+                times.append(time.monotonic_ns() - t)
+            elapsed = time.monotonic() - start
+            s.close()
+            bench.report(f'pipelined x{self.depth}', len(times) * self.depth, 'requests', elapsed)
+            bench.report_latency(f'pipelined x{self.depth} (per batch)', times)
+
+            # Stop s3270.
+            s = self.connect()
+            s.sendall(f'GET /3270/rest/json/Quit(-force) HTTP/1.1\r\nHost: localhost\r\n\r\n'.encode())
+            s.close()
+
+        s3270.stdin.close()
+        self.vgwait(s3270)
+
+if __name__ == '__main__':
+    unittest.main()
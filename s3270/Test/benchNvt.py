@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 NVT-mode scrolling throughput benchmark
+
+import os
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+# TELNET negotiation for NVT mode: the host will echo and suppress go-ahead,
+# but does not offer a terminal type, so the emulator stays in NVT mode.
+host_setup = b'\xff\xfb\x01\xff\xfb\x03'
+
+class BenchS3270Nvt(cti.cti):
+
+    # Megabytes of text to stream.
+    mbytes = int(os.environ.get('BENCH_MBYTES', '100'))
+
+    # Stream a long log through the emulator, one line at a time, so that
+    # nearly every line scrolls the screen.
+    def test_s3270_nvt_scroll(self):
+        host = bench.streamhost(self)
+        args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+        s3270 = Popen(args + [f'127.0.0.1:{host.port}'], stdin=PIPE,
+            stdout=DEVNULL, stderr=DEVNULL)
+        self.children.append(s3270)
+        host.accept()
+        host.send(host_setup)
+
+        # Build 1 MB of numbered log lines, then send it repeatedly.
+        lines = []
+        size = 0
+        n = 0
+        while size < 1024 * 1024:
+            line = f'{n:08d} INFO  [worker-{n % 16:02d}] processed request ' + \
+                f'id={n * 7919 % 1000003} status=200 bytes={n % 4096}\r\n'
+            lines.append(line.encode('ascii'))
+            size += len(lines[-1])
+            n += 1
+        chunk = b''.join(lines)
+        for _ in range(self.mbytes):
+            host.conn.sendall(chunk)
+        host.send(b'')
+        host.close()
+        s3270.stdin.write(b'Quit()\n')
+        s3270.stdin.flush()
+        s3270.stdin.close()
+        cpu = bench.wait_rusage(s3270)
+        bench.report('NVT scroll', self.mbytes * len(chunk) / (1024 * 1024),
+            'MB', cpu)
+
+if __name__ == '__main__':
+    unittest.main()
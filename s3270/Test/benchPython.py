@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# Python x3270if action throughput benchmark: one action per round trip
+# versus pipelined actions
+
+import os
+import sys
+import time
+import unittest
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+import Common.Test.playback as playback
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..', 'Common', 'Python'))
+import x3270if
+
+class BenchPythonX3270if(cti.cti):
+
+    # Number of actions per test.
+    actions = 5000 * int(os.environ.get('BENCH_MBYTES', '1'))
+
+    def one_at_a_time(self, em, action:str):
+        start = time.monotonic()
+        for _ in range(self.actions):
+            em.run_action(action)
+        bench.report(f'run_action {action}', self.actions, 'actions', time.monotonic() - start)
+
+    def pipelined(self, em, action:str):
+        start = time.monotonic()
+        results = em.run_actions([action] * self.actions)
+        bench.report(f'run_actions {action}', self.actions, 'actions', time.monotonic() - start)
+        self.assertEqual(self.actions, len(results))
+
+    def test_python_x3270if(self):
+        playback_port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ibmlink.trc', port=playback_port) as p:
+            ts.close()
+
+            # Start s3270 and put a screen up.
+            em = x3270if.new_emulator(extra_args=os.environ.get('BENCH_S3270_ARGS', '').split())
+            connect = em.submit_action('Open', f'127.0.0.1:{playback_port}')
+            em.flush()
+            p.send_records(4)
+            connect.result()
+            em.run_action('Wait(InputField)')
+
+            # Results come back in order, and failures are reported.
+            row = em.run_action('Ascii1', 1, 1, 1, 20)
+            results = em.run_actions(['Set(monoCase)', ('Ascii1', 1, 1, 1, 20), 'Set(monoCase)'])
+            self.assertEqual(['false', row, 'false'], results)
+            with self.assertRaises(x3270if.ActionFailException):
+                em.run_actions(['Set(monoCase)', 'Foo()', 'Set(monoCase)'])
+            self.assertEqual('false', em.run_action('Set(monoCase)'))
+
+            for action in ['Set(monoCase)', 'Ascii1()', 'Wait(InputField)']:
+                self.one_at_a_time(em, action)
+                self.pipelined(em, action)
+
+            del em
+
+if __name__ == '__main__':
+    unittest.main()
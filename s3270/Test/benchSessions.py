@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 per-session cost benchmark
+
+import os
+import sys
+import time
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+# TELNET negotiation for plain 3270 mode, then an Erase/Write that leaves
+# an unformatted screen with the keyboard unlocked.
+host_setup = bytes.fromhex('fffd18' + 'fffa1801fff0' + 'fffd19fffb19' +
+    'fffd00fffb00' + 'f5c2ffef')
+
+def private_kbytes(pid:int):
+    '''Return the private (unshared) memory of a process, in kilobytes'''
+    kb = 0
+    with open(f'/proc/{pid}/smaps_rollup', 'r') as f:
+        for line in f:
+            if line.startswith('Private_'):
+                kb += int(line.split()[1])
+    return kb
+
+@unittest.skipUnless(os.path.exists('/proc/self/smaps_rollup'), 'Linux-specific')
+class BenchS3270Sessions(cti.cti):
+
+    # Number of sessions.
+    sessions = 50 * int(os.environ.get('BENCH_MBYTES', '1'))
+
+    def test_s3270_sessions(self):
+        hosts = []
+        children = []
+
+        # Start the sessions.
+        start = time.monotonic()
+        for _ in range(self.sessions):
+            host = bench.streamhost(self)
+            args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+            s3270 = Popen(args + [f'127.0.0.1:{host.port}'], stdin=PIPE,
+                stdout=DEVNULL, stderr=DEVNULL)
+            self.children.append(s3270)
+            host.accept()
+            host.send(host_setup)
+            hosts.append(host)
+            children.append(s3270)
+        elapsed = time.monotonic() - start
+
+        # Measure them.
+        kbytes = sum(private_kbytes(child.pid) for child in children)
+
+        # Clean up.
+        for host in hosts:
+            host.close()
+        for child in children:
+            child.stdin.write(b'Quit()\n')
+            child.stdin.close()
+            self.vgwait(child)
+        bench.report('session start', self.sessions, 'sessions', elapsed)
+        print(f'bench: session memory: {kbytes / self.sessions:.0f} KB private per session', file=sys.stderr)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 String() throughput benchmark
+
+import os
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+# TELNET negotiation for plain 3270 mode, then an Erase/Write that leaves
+# an unformatted screen with the keyboard unlocked.
+host_setup = bytes.fromhex('fffd18' + 'fffa1801fff0' + 'fffd19fffb19' +
+    'fffd00fffb00' + 'f5c2ffef')
+
+class BenchS3270String(cti.cti):
+
+    # Kilobytes of text to paste.
+    kbytes = int(os.environ.get('BENCH_MBYTES', '1')) * 1024
+
+    # Text to paste, with some non-ASCII characters.
+    text = 'The quick brown fox jumps over the lazy dog, 0123456789 ' + \
+        'café naïve über £¢¬ '
+
+    def test_s3270_string(self):
+        host = bench.streamhost(self)
+        args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+        s3270 = Popen(args + [f'127.0.0.1:{host.port}'], stdin=PIPE,
+            stdout=DEVNULL, stderr=DEVNULL)
+        self.children.append(s3270)
+        host.accept()
+        host.send(host_setup)
+
+        # Paste the text in 4K chunks.
+        chunk = (self.text * (4096 // len(self.text) + 1))[:4096]
+        nchunks = self.kbytes // 4
+        for _ in range(nchunks):
+            s3270.stdin.write(f'String("{chunk}")\n'.encode('utf-8'))
+        s3270.stdin.write(b'Quit()\n')
+        s3270.stdin.flush()
+        s3270.stdin.close()
+        cpu = bench.wait_rusage(s3270)
+        host.close()
+        bench.report('String()', (nchunks * len(chunk)) / (1024 * 1024), 'MB', cpu)
+
+if __name__ == '__main__':
+    unittest.main()
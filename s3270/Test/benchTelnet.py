@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 host input throughput benchmark
+
+import glob
+import os
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+class BenchS3270Telnet(cti.cti):
+
+    # Megabytes of host data to replay through each trace.
+    mbytes = int(os.environ.get('BENCH_MBYTES', '16'))
+
+    # Replay the host side of a trace file, repeating its 3270 data records.
+    def replay(self, trace:str):
+        stream = bench.replay_stream(trace, self.mbytes)
+        if stream == None:
+            return None
+
+        host = bench.streamhost(self)
+        args = ['s3270'] + os.environ.get('BENCH_S3270_ARGS', '').split()
+        model = bench.trace_model(trace)
+        if model != None:
+            args += ['-model', model]
+        s3270 = Popen(args + [f'127.0.0.1:{host.port}'], stdin=PIPE, stdout=DEVNULL, stderr=DEVNULL)
+        self.children.append(s3270)
+        host.accept()
+        host.send(stream)
+        host.close()
+        s3270.stdin.write(b'Quit()\n')
+        s3270.stdin.flush()
+        s3270.stdin.close()
+        cpu = bench.wait_rusage(s3270)
+        return (len(stream), cpu)
+
+    # Replay every 3270 trace in the test directory.
+    def test_s3270_telnet_input(self):
+        total_bytes = 0
+        total_cpu = 0.0
+        for trace in sorted(glob.glob('s3270/Test/*.trc')):
+            name = os.path.basename(trace)
+            if name.startswith('ft'):
+                # File transfers would make the emulator write files.
+                continue
+            result = self.replay(trace)
+            if result == None:
+                continue
+            nbytes, cpu = result
+            bench.report(name, nbytes / (1024 * 1024), 'MB', cpu)
+            total_bytes += nbytes
+            total_cpu += cpu
+        bench.report('total', total_bytes / (1024 * 1024), 'MB', total_cpu)
+
+if __name__ == '__main__':
+    unittest.main()
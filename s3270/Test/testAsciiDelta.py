@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 AsciiDelta() tests
+
+import unittest
+from subprocess import Popen, DEVNULL
+import requests
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+def delta(result: list):
+    '''Split AsciiDelta() output into the generation and a row dictionary'''
+    generation = int(result[0].split(': ')[1])
+    rows = {}
+    for line in result[1:]:
+        row, text = line[len('Row: '):].split(' ', 1)
+        rows[int(row)] = text
+    return (generation, rows)
+
+class TestS3270AsciiDelta(cti.cti):
+
+    # s3270 AsciiDelta() test
+    def test_s3270_ascii_delta(self):
+
+        # Start 'playback' to read s3270's output.
+        port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ibmlink.trc', port=port) as p:
+            ts.close()
+
+            # Start s3270.
+            hport, ts = cti.unused_port()
+            s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(hport), f'127.0.0.1:{port}']), stdin=DEVNULL, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(hport)
+            ts.close()
+
+            # Paint the screen. With no generation, every row comes back.
+            p.send_records(4)
+            url = f'http://127.0.0.1:{hport}/3270/rest/json/'
+            generation, rows = delta(requests.get(url + 'AsciiDelta()').json()['result'])
+            ascii = requests.get(url + 'Ascii()').json()['result']
+            self.assertEqual(dict(enumerate(ascii, start=1)), rows)
+
+            # Nothing has changed since then.
+            again, rows = delta(requests.get(url + f'AsciiDelta({generation})').json()['result'])
+            self.assertEqual(generation, again)
+            self.assertEqual({}, rows)
+
+            # Type something, and only the cursor row comes back.
+            cursor_row = int(requests.get(url + 'Query(Cursor1)').json()['result'][0].split()[1])
+            requests.get(url + 'String(abc)')
+            changed, rows = delta(requests.get(url + f'AsciiDelta({generation})').json()['result'])
+            self.assertLess(generation, changed)
+            self.assertEqual([cursor_row], list(rows.keys()))
+            self.assertEqual(requests.get(url + f'Ascii1({cursor_row},1,80)').json()['result'][0], rows[cursor_row])
+
+            # A generation from the future returns everything.
+            _, rows = delta(requests.get(url + f'AsciiDelta({changed + 1})').json()['result'])
+            self.assertEqual(24, len(rows))
+
+            # Bad generations are rejected.
+            self.assertFalse(requests.get(url + 'AsciiDelta(x)').ok)
+            self.assertFalse(requests.get(url + 'AsciiDelta(1,2)').ok)
+
+            requests.get(url + 'Disconnect()')
+            requests.get(url + 'Quit()')
+
+        # Wait for the processes to exit.
+        self.vgwait(s3270)
+
+    # s3270 AsciiDelta() field attribute test
+    def test_s3270_ascii_delta_fa(self):
+
+        # Start 'playback' to read s3270's output.
+        port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/fa_change.trc', port=port) as p:
+            ts.close()
+
+            # Start s3270.
+            hport, ts = cti.unused_port()
+            s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(hport), f'127.0.0.1:{port}']), stdin=DEVNULL, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(hport)
+            ts.close()
+
+            # Paint the screen.
+            p.send_records(1)
+            url = f'http://127.0.0.1:{hport}/3270/rest/json/'
+            generation, rows = delta(requests.get(url + 'AsciiDelta()').json()['result'])
+            self.assertEqual('Line three', rows[3].strip())
+
+            # Make the field on rows 3 through 6 non-display. Only the field
+            # attribute on row 2 changes, but every row of the field comes
+            # back, blank.
+            p.send_records(1)
+            _, rows = delta(requests.get(url + f'AsciiDelta({generation})').json()['result'])
+            self.assertEqual([2, 3, 4, 5, 6], list(rows.keys()))
+            self.assertEqual('', rows[3].strip())
+            self.assertEqual('', rows[5].strip())
+
+            requests.get(url + 'Disconnect()')
+            requests.get(url + 'Quit()')
+
+        # Wait for the processes to exit.
+        self.vgwait(s3270)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 binary trace tests
+
+import glob
+import os
+import re
+import struct
+import tempfile
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+# Tools built with the playback utility.
+def tool(name:str):
+    found = glob.glob(f'obj/*/playback/{name}')
+    return found[0] if found != [] else None
+
+# Read a binary trace, returning a list of (direction, data) tuples.
+def read_btrc(path:str):
+    records = []
+    with open(path, 'rb') as f:
+        assert f.read(8) == b'x3270bt1'
+        while True:
+            hdr = f.read(16)
+            if hdr == b'':
+                break
+            direction, length, _ = struct.unpack('>c3xIQ', hdr)
+            records.append((direction.decode(), f.read(length)))
+    return records
+
+# Return the network data from a text trace, one string per direction.
+def text_netdata(path:str):
+    data = { '<': '', '>': '' }
+    with open(path, 'r', errors='replace') as f:
+        for line in f:
+            m = re.match('^([<>]) 0x[0-9a-f]+ +([0-9a-f]+)$', line.rstrip())
+            if m != None:
+                data[m.group(1)] += m.group(2)
+    return data
+
+class TestS3270BinaryTrace(cti.cti):
+
+    # Run s3270 against a playback trace, with the given extra arguments.
+    def run_s3270(self, trace:str, args:list):
+        port, ts = cti.unused_port()
+        with playback.playback(self, trace, port=port) as p:
+            ts.close()
+            s3270 = Popen(cti.vgwrap(['s3270'] + args + [f'127.0.0.1:{port}']),
+                stdin=PIPE, stdout=DEVNULL)
+            self.children.append(s3270)
+            s3270.stdin.write(b'PF(3)\n')
+            s3270.stdin.write(b'Quit()\n')
+            s3270.stdin.flush()
+            p.match()
+        s3270.stdin.close()
+        self.vgwait(s3270)
+
+    # Capture a session and check it against the text trace of the same session.
+    def capture(self, tmpdir:str):
+        btrc = os.path.join(tmpdir, 'x3270.btrc')
+        trc = os.path.join(tmpdir, 'x3270.trc')
+        self.run_s3270('s3270/Test/ibmlink-cr.trc',
+            ['-xrm', f's3270.traceBinaryFile: {btrc}', '-trace', '-tracefile', trc])
+        return (btrc, trc)
+
+    # s3270 binary trace capture test
+    def test_s3270_binary_trace(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            btrc, trc = self.capture(tmpdir)
+            records = read_btrc(btrc)
+            self.assertNotEqual([], records)
+            expect = text_netdata(trc)
+            for direction in ['<', '>']:
+                got = b''.join([r[1] for r in records if r[0] == direction])
+                self.assertEqual(expect[direction], got.hex())
+
+    # Binary trace conversion and playback test
+    def test_s3270_binary_trace_convert(self):
+        btrc2trc = tool('btrc2trc')
+        playback_tool = tool('playback')
+        if btrc2trc == None or playback_tool == None:
+            self.skipTest('playback tools not built')
+        with tempfile.TemporaryDirectory() as tmpdir:
+            btrc, trc = self.capture(tmpdir)
+
+            # Convert it and compare with the text trace.
+            converted = os.path.join(tmpdir, 'converted.trc')
+            with open(converted, 'w') as f:
+                conv = Popen([btrc2trc, btrc], stdout=f)
+                self.children.append(conv)
+                self.vgwait(conv)
+            self.assertEqual(text_netdata(trc), text_netdata(converted))
+
+            # Play the binary trace back to a new session.
+            port, ts = cti.unused_port()
+            ts.close()
+            pb = Popen([playback_tool, '-b', '-p', str(port), btrc], stdout=PIPE)
+            self.children.append(pb)
+            self.assertTrue(pb.stdout.readline().startswith(b'Waiting for connection'))
+            s3270 = Popen(cti.vgwrap(['s3270', f'127.0.0.1:{port}']), stdin=PIPE,
+                stdout=DEVNULL)
+            self.children.append(s3270)
+            s3270.stdin.write(b'PF(3)\n')
+            s3270.stdin.flush()
+            pb.stdout.read()
+            pb.stdout.close()
+            self.vgwait(pb)
+            s3270.stdin.write(b'Quit()\n')
+            s3270.stdin.close()
+            self.vgwait(s3270)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 Expect() tests
+
+import unittest
+from subprocess import Popen
+import threading
+import time
+import requests
+import Common.Test.cti as cti
+
+class TestS3270Expect(cti.cti):
+
+    # Start s3270 talking NVT to a send server.
+    def start(self, args=[]):
+        s = cti.sendserver(self)
+        hport, ts = cti.unused_port()
+        s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(hport)] + args + [f'a:c:t:127.0.0.1:{s.port}']))
+        self.children.append(s3270)
+        self.check_listen(hport)
+        ts.close()
+        return (s, s3270, f'http://127.0.0.1:{hport}/3270/rest/json/')
+
+    # Clean up.
+    def stop(self, s, s3270, url):
+        s.close()
+        requests.get(url + 'Quit()')
+        self.vgwait(s3270)
+
+    # Multiple texts, reporting which one matched.
+    def test_s3270_expect_multiple(self):
+        s, s3270, url = self.start()
+
+        s.send(b'Welcome\r\nlogin: ')
+        r = requests.get(url + 'Expect(-Timeout,2,Password:,login:)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+        self.assertEqual(['1'], r.json()['result'])
+
+        # A match that arrives in pieces, while Expect() is waiting.
+        s.send(b'xyzzy\r\nPass')
+        def send_rest():
+            time.sleep(0.2)
+            s.send(b'word: ')
+        t = threading.Thread(target=send_rest)
+        t.start()
+        r = requests.get(url + 'Expect(-Timeout,2,login:,Password:,\\r\\n$ )')
+        t.join()
+        self.assertEqual(requests.codes.ok, r.status_code)
+        self.assertEqual(['1'], r.json()['result'])
+
+        # The match that ends first wins, even if it starts later.
+        s.send(b'abcd')
+        r = requests.get(url + 'Expect(-Timeout,2,abcd,bc)')
+        self.assertEqual(['1'], r.json()['result'])
+
+        # Matched text is consumed; the single-text syntax is unchanged.
+        s.send(b'hello')
+        r = requests.get(url + 'Expect(hello,1)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+        self.assertEqual([], r.json()['result'])
+        r = requests.get(url + 'Expect(hello,1)')
+        self.assertFalse(r.ok)
+
+        self.stop(s, s3270, url)
+
+    # Timeouts are parsed strictly.
+    def test_s3270_expect_timeout_syntax(self):
+        s, s3270, url = self.start()
+
+        # A second text that starts with a digit is a text, not a timeout.
+        s.send(b'5> ')
+        r = requests.get(url + 'Expect(login:,5>)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+        self.assertEqual(['1'], r.json()['result'])
+
+        # Malformed timeouts are rejected.
+        for bad in ['-Timeout,5x,abc', '-Timeout,,abc', '-Timeout,0,abc',
+                '-Timeout,601,abc', '-Timeout,99999999999999999999,abc',
+                'abc,0', '-Timeout,5']:
+            r = requests.get(url + f'Expect({bad})')
+            self.assertFalse(r.ok, bad)
+
+        self.stop(s, s3270, url)
+
+    # The expect buffer size is configurable.
+    def test_s3270_expect_buffer_size(self):
+        s, s3270, url = self.start(['-xrm', 's3270.expectBufferSize: 100000'])
+
+        # Stream more than the default 4 KiB, then look for the first line.
+        s.send(b'first\r\n' + b'noise\r\n' * 2000)
+        r = requests.get(url + 'Expect(-Timeout,2,last,first)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+        self.assertEqual(['1'], r.json()['result'])
+
+        self.stop(s, s3270, url)
+
+if __name__ == '__main__':
+    unittest.main()
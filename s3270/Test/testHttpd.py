@@ -27,6 +27,7 @@
 #
 # s3270 HTTPS tests
 
+import socket
 import unittest
 from subprocess import Popen, PIPE, DEVNULL
 import requests
@@ -64,6 +65,55 @@ class TestS3270Httpd(cti.cti):
         s.close()
         self.vgwait(s3270)
 
+    # s3270 HTTPD pipelining test.
+    def test_s3270_httpd_pipeline(self):
+
+        # Start s3270.
+        port, ts = cti.unused_port()
+        s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(port)]))
+        self.children.append(s3270)
+        self.check_listen(port)
+        ts.close()
+
+        # Send several requests at once, one of them with content.
+        s = socket.create_connection(('127.0.0.1', port))
+        s.settimeout(5)
+        s.sendall(b'GET /3270/rest/json/Set(monoCase) HTTP/1.1\r\nHost: x\r\n\r\n' +
+            b'POST /3270/rest/post HTTP/1.1\r\nHost: x\r\nContent-Type: text/plain\r\nContent-Length: 13\r\n\r\nSet(monoCase)' +
+            b'GET /3270/rest/text/Set(monoCase) HTTP/1.1\r\nHost: x\r\n\r\n' +
+            b'GET /3270/rest/json/Foo( HTTP/1.1\r\nHost: x\r\n\r\n' +
+            b'GET /3270/rest/html/Set(monoCase) HTTP/1.1\r\nHost: x\r\n\r\n')
+
+        # The responses come back in order.
+        buf = b''
+        header, body, buf = cti.http_response(s, buf)
+        self.assertTrue(header.startswith('HTTP/1.1 200 '))
+        self.assertEqual('{"result":["false"]', body[:19])
+        header, body, buf = cti.http_response(s, buf)
+        self.assertTrue(header.startswith('HTTP/1.1 200 '))
+        self.assertEqual('false', body.splitlines()[1])
+        header, body, buf = cti.http_response(s, buf)
+        self.assertTrue(header.startswith('HTTP/1.1 200 '))
+        self.assertEqual(['false'], body.splitlines())
+        header, body, buf = cti.http_response(s, buf)
+        self.assertTrue(header.startswith('HTTP/1.1 400 '))
+        self.assertIn('Syntax', body)
+        header, body, buf = cti.http_response(s, buf)
+        self.assertTrue(header.startswith('HTTP/1.1 200 '))
+        self.assertIn('<html>', body)
+        self.assertEqual(b'', buf)
+
+        # An HTTP 1.0 client can ask for the connection to stay open.
+        s.sendall(b'GET /3270/rest/text/Set(monoCase) HTTP/1.0\r\nConnection: keep-alive\r\n\r\n')
+        header, body, buf = cti.http_response(s, buf)
+        self.assertIn('\r\nConnection: keep-alive', header)
+        self.assertEqual(['false'], body.splitlines())
+
+        # Wait for the process to exit successfully.
+        s.sendall(b'GET /3270/rest/json/Quit() HTTP/1.1\r\nHost: x\r\n\r\n')
+        s.close()
+        self.vgwait(s3270)
+
     # s3270 HTTPD stext error test.
     def s3270_httpd_stext_error_test(self, actions:str, content:str):
 
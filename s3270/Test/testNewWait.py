@@ -81,6 +81,7 @@ class TestNewWait(cti.cti):
         x.join(timeout=2)
         requests.get(f'http://127.0.0.1:{s3270_port}/3270/rest/json/Quit()')
         self.vgwait(s3270)
+        return r.json()['result']
 
     # Generic flavor of CursorAt test.
     def test_cursor_at(self):
@@ -93,6 +94,12 @@ class TestNewWait(cti.cti):
         self.new_wait(4, ['String("xxx")'], 'StringAt,21,13,"xx"')
     def test_string_at_offset(self):
         self.new_wait(4, ['String("xxx")'], 'StringAt,1612,"xx"')
+    def test_string_at_multiple(self):
+        result = self.new_wait(4, ['String("xxx")'], 'StringAt,1,1,"nomatch",21,13,"xx",22,1,"xx"')
+        self.assertEqual(['1'], result)
+    def test_string_at_next_field(self):
+        result = self.new_wait(4, ['String("xxx")', 'Tab()', 'String("yyy")'], 'StringAt,21,32,"yy",21,13,"zz"')
+        self.assertEqual(['0'], result)
 
     # Generic flavor of InputFieldAt test.
     def test_input_field_at(self):
@@ -125,6 +132,7 @@ class TestNewWait(cti.cti):
         self.simple_negative_test(port, 'Wait(CursorAt,300,300)', 'Invalid')
         self.simple_negative_test(port, 'Wait(StringAt)', 'requires')
         self.simple_negative_test(port, 'Wait(StringAt,1,2,3,4)', 'requires')
+        self.simple_negative_test(port, 'Wait(StringAt,1,2,3,4,5)', 'requires')
         self.simple_negative_test(port, 'Wait(InputFieldAt)', 'requires')
         self.simple_negative_test(port, 'Wait(InputFieldAt,1,2,3)', 'requires')
 
@@ -165,6 +173,8 @@ class TestNewWait(cti.cti):
             self.nop(sport, 'Wait(CursorAt,21,13)')
             self.nop(sport, 'Wait(InputFieldAt,21,13)')
             self.nop(sport, 'Wait(StringAt,21,13,"___")')
+            r = requests.get(f'http://127.0.0.1:{sport}/3270/rest/json/Wait(StringAt,1,1,"nomatch",21,13,"___")')
+            self.assertEqual(['1'], r.json()['result'])
 
         requests.get(f'http://127.0.0.1:{sport}/3270/rest/json/Quit()')
         self.vgwait(s3270)
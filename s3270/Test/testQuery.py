@@ -76,5 +76,49 @@ class TestS3270Query(cti.cti):
         s3270.stdin.close()
         self.vgwait(s3270)
 
+    # s3270 Query(Resolver) test
+    def test_s3270_query_resolver(self):
+
+        # Nothing is listening on this port, so each connect fails after the
+        # name is resolved.
+        port, ts = cti.unused_port()
+        ts.close()
+
+        # Start s3270, with the mock resolver.
+        http_port, ts = cti.unused_port()
+        env = os.environ.copy()
+        env['MOCK_SYNC_RESOLVER'] = f'127.0.0.1/{port}'
+        s3270 = Popen(cti.vgwrap(['s3270', '-utenv', '-httpd', f'127.0.0.1:{http_port}']),
+            stdin=PIPE, stdout=DEVNULL, env=env)
+        self.children.append(s3270)
+        self.check_listen(http_port)
+        ts.close()
+
+        # Returns the resolver statistics.
+        def resolver_stats():
+            r = requests.get(f'http://127.0.0.1:{http_port}/3270/rest/json/Query(Resolver)')
+            stats = r.json()['result'][0].split()
+            return { k: int(v) for k, v in zip(stats[::2], stats[1::2]) }
+
+        # Connect to the same host twice.
+        before = resolver_stats()
+        for _ in range(2):
+            r = requests.get(f'http://127.0.0.1:{http_port}/3270/rest/json/Connect(mainframe:{port})')
+            self.assertEqual(requests.codes.bad, r.status_code)
+
+        # The second lookup should have come from the cache.
+        after = resolver_stats()
+        self.assertEqual(2, after['requests'] - before['requests'])
+        self.assertEqual(1, after['hits'] - before['hits'])
+        self.assertEqual(1, after['lookups'] - before['lookups'])
+        self.assertEqual(0, after['failures'])
+
+        # Stop s3270.
+        requests.get(f'http://127.0.0.1:{http_port}/3270/rest/json/Quit(-force))')
+
+        # Wait for the processes to exit.
+        s3270.stdin.close()
+        self.vgwait(s3270)
+
 if __name__ == '__main__':
     unittest.main()
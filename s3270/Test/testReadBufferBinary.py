@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 ReadBuffer(Binary) tests
+
+import unittest
+from subprocess import Popen, DEVNULL
+import requests
+import base64
+import struct
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+def decode(b64: str):
+    '''Decode a ReadBuffer(Binary) image'''
+    data = base64.b64decode(b64)
+    version, generation, rows, cols, cursor, nfields = struct.unpack_from('>BQHHII', data)
+    offset = struct.calcsize('>BQHHII')
+    fields = list(struct.unpack_from(f'>{nfields}I', data, offset))
+    offset += 4 * nfields
+    attrs = []
+    while len(attrs) < rows * cols:
+        count, = struct.unpack_from('>H', data, offset)
+        attrs += [data[offset + 2:offset + 9]] * count
+        offset += 9
+    text = []
+    while len(text) < rows * cols:
+        uc = 0
+        while True:
+            b = data[offset]
+            offset += 1
+            uc = (uc << 7) | (b & 0x7f)
+            if not b & 0x80:
+                break
+        text.append(uc)
+    return { 'version': version, 'generation': generation, 'rows': rows,
+        'cols': cols, 'cursor': cursor, 'fields': fields, 'attrs': attrs,
+        'text': text, 'extra': len(data) - offset }
+
+class TestS3270ReadBufferBinary(cti.cti):
+
+    # s3270 ReadBuffer(Binary) test
+    def test_s3270_readbuffer_binary(self):
+
+        # Start 'playback' to read s3270's output.
+        port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ibmlink.trc', port=port) as p:
+            ts.close()
+
+            # Start s3270.
+            hport, ts = cti.unused_port()
+            s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(hport), f'127.0.0.1:{port}']), stdin=DEVNULL, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(hport)
+            ts.close()
+
+            # Paint the screen and compare the image with the text dumps.
+            p.send_records(4)
+            url = f'http://127.0.0.1:{hport}/3270/rest/json/'
+            image = decode(requests.get(url + 'ReadBuffer(Binary)').json()['result'][0])
+            self.assertEqual(1, image['version'])
+            self.assertEqual(0, image['extra'])
+            self.assertEqual((24, 80), (image['rows'], image['cols']))
+            cursor = requests.get(url + 'Query(Cursor)').json()['result'][0].split()
+            self.assertEqual(int(cursor[0]) * 80 + int(cursor[1]), image['cursor'])
+            unicode = ' '.join(requests.get(url + 'ReadBuffer(Unicode)').json()['result']).split()
+            fields = []
+            for baddr, cell in enumerate(unicode):
+                if cell.startswith('SF('):
+                    fields.append(baddr)
+                    self.assertEqual(int(cell[6:8], 16), image['attrs'][baddr][0])
+                else:
+                    cell = cell.split(')')[-1]
+                    self.assertEqual(int(cell, 16), image['text'][baddr])
+            self.assertNotEqual([], fields)
+            self.assertEqual(fields, image['fields'])
+
+            # The generation stays put until the screen changes.
+            again = decode(requests.get(url + 'ReadBuffer(Binary)').json()['result'][0])
+            self.assertEqual(image['generation'], again['generation'])
+            requests.get(url + 'Snap(Save)')
+            requests.get(url + 'String(abc)')
+            changed = decode(requests.get(url + 'ReadBuffer(Binary)').json()['result'][0])
+            self.assertLess(image['generation'], changed['generation'])
+            snap = decode(requests.get(url + 'Snap(ReadBuffer,Binary)').json()['result'][0])
+            self.assertEqual(image, snap)
+
+            # Moving the cursor changes the image, so it changes the
+            # generation, too.
+            target = 1 if changed['cursor'] == 0 else 0
+            requests.get(url + f'MoveCursor({target // 80},{target % 80})')
+            moved = decode(requests.get(url + 'ReadBuffer(Binary)').json()['result'][0])
+            self.assertEqual(target, moved['cursor'])
+            self.assertLess(changed['generation'], moved['generation'])
+
+            # Binary and Field do not mix.
+            self.assertFalse(requests.get(url + 'ReadBuffer(Binary,Field)').ok)
+
+            requests.get(url + 'Disconnect()')
+            requests.get(url + 'Quit()')
+
+        # Wait for the processes to exit.
+        self.vgwait(s3270)
+
+if __name__ == '__main__':
+    unittest.main()
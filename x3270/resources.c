@@ -48,6 +48,8 @@
 XtResource resources[] = {
     { ResSaveLines, ClsSaveLines, XtRInt, sizeof(int),
       offset(interactive.save_lines), XtRString, "4096" },
+    { ResSaveBytes, ClsSaveBytes, XtRInt, sizeof(int),
+      offset(interactive.save_bytes), XtRString, "0" },
     { ResUnlockDelayMs, ClsUnlockDelayMs, XtRInt, sizeof(int),
       offset(unlock_delay_ms), XtRString, "350" },
     { ResScriptPort, ClsScriptPort, XtRString, sizeof(String),
@@ -114,6 +116,8 @@ XtResource resources[] = {
       offset(interactive.crosshair_color), XtRString, "purple" },
     { ResConnectTimeout, ClsConnectTimeout, XtRInt, sizeof(int),
       offset(connect_timeout), XtRString, "0" },
+    { ResExpectBufferSize, ClsExpectBufferSize, XtRInt, sizeof(int),
+      offset(expect_buffer_size), XtRString, "4096" },
     { ResConsole, ClsConsole, XtRString, sizeof(char *),
       offset(interactive.console), XtRString, 0 },
     { ResNoTelnetInputMode, ClsNoTelnetInputMode, XtRString, sizeof(char *),
@@ -1824,6 +1824,9 @@ toggle_altCursor(toggle_index_t ix, enum toggle_type tt _is_unused)
 void
 cursor_move(int baddr)
 {
+    if (baddr != cursor_addr) {
+	screen_generation++;	/* the cursor is part of the screen image */
+    }
     cursor_addr = baddr;
     if (CONNECTED) {
 	status_cursor_pos(cursor_addr);
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# x3270if benchmark: one-shot actions versus actions relayed by a multiplexer
+
+import os
+import signal
+import socket
+import subprocess
+import tempfile
+import time
+import unittest
+from subprocess import Popen, DEVNULL
+import Common.Test.bench as bench
+import Common.Test.cti as cti
+
+class BenchX3270ifMux(cti.cti):
+
+    # Number of actions per test.
+    actions = 500 * int(os.environ.get('BENCH_MBYTES', '1'))
+    action = 'Set(monoCase)'
+
+    # Run one x3270if process per action.
+    def one_shot(self, name:str, args:list):
+        start = time.monotonic()
+        for _ in range(self.actions):
+            subprocess.run(['x3270if'] + args + [self.action], stdout=DEVNULL, check=True)
+        bench.report(name, self.actions, 'actions', time.monotonic() - start)
+
+    # Read one complete response from a multiplexer connection.
+    def response(self, s:socket.socket, buf:bytes):
+        while not (buf.endswith(b'\nok\n') or buf.endswith(b'\nerror\n')):
+            b = s.recv(65536)
+            self.assertNotEqual(b'', b)
+            buf += b
+        return buf
+
+    def test_x3270if_mux(self):
+
+        # Start a copy of s3270 to talk to.
+        port, ts = cti.unused_port()
+        s3270 = Popen(['s3270', '-scriptport', f'127.0.0.1:{port}'], stdin=DEVNULL, stdout=DEVNULL)
+        self.children.append(s3270)
+        self.check_listen(port)
+        ts.close()
+
+        # Start the multiplexer.
+        path = os.path.join(tempfile.gettempdir(), f'x3270if-bench.{os.getpid()}')
+        mux = Popen(['x3270if', '-t', str(port), '-D', path], stderr=DEVNULL)
+        self.children.append(mux)
+        self.try_until(lambda: os.path.exists(path), 2, 'Multiplexer did not start')
+
+        # One process per action, connecting to the emulator or to the multiplexer.
+        self.one_shot('one-shot x3270if -t', ['-t', str(port)])
+        self.one_shot('one-shot x3270if -u (multiplexer)', ['-u', path])
+
+        # A persistent client, one action per round trip.
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(path)
+        cmd = (self.action + '\n').encode()
+        start = time.monotonic()
+        for _ in range(self.actions):
+            s.sendall(cmd)
+            self.response(s, b'')
+        bench.report('multiplexer client, one at a time', self.actions, 'actions', time.monotonic() - start)
+
+        # A persistent client, pipelined.
+        start = time.monotonic()
+        s.sendall(cmd * self.actions)
+        s.shutdown(socket.SHUT_WR)
+        data = b''
+        while True:
+            b = s.recv(65536)
+            if not b:
+                break
+            data += b
+        bench.report('multiplexer client, pipelined', self.actions, 'actions', time.monotonic() - start)
+        self.assertEqual(self.actions, data.count(b'\nok\n'))
+        s.close()
+
+        mux.send_signal(signal.SIGTERM)
+        mux.wait(timeout=2)
+        self.children.remove(mux)
+        s3270.kill()
+        self.children.remove(s3270)
+        s3270.wait()
+
+if __name__ == '__main__':
+    unittest.main()
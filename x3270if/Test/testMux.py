@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021-2022 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+#
+# x3270if multiplexer tests
+
+import os
+import signal
+import socket
+import tempfile
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import Common.Test.cti as cti
+
+class TestX3270ifMux(cti.cti):
+
+    # Send commands on a multiplexer connection and collect the responses.
+    def mux_client(self, path:str, commands:bytes):
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(path)
+        s.sendall(commands)
+        return s
+
+    def mux_responses(self, s:socket.socket):
+        s.shutdown(socket.SHUT_WR)
+        data = b''
+        while True:
+            b = s.recv(4096)
+            if not b:
+                break
+            data += b
+        s.close()
+        return data.decode().splitlines()
+
+    # x3270if multiplexer test
+    def test_x3270if_mux(self):
+
+        # Start a copy of s3270 to talk to.
+        port, ts = cti.unused_port()
+        s3270 = Popen(["s3270", "-scriptport", f"127.0.0.1:{port}"],
+                stdin=DEVNULL, stdout=DEVNULL)
+        self.children.append(s3270)
+        self.check_listen(port)
+        ts.close()
+
+        # Start the multiplexer.
+        path = os.path.join(tempfile.gettempdir(), f'x3270if-mux.{os.getpid()}')
+        mux = Popen(cti.vgwrap(["x3270if", "-t", str(port), "-D", path, "-T"]),
+                stderr=PIPE)
+        self.children.append(mux)
+        self.try_until(lambda: os.path.exists(path), 2, 'Multiplexer did not start')
+
+        # Run a one-shot x3270if through it.
+        x3270if = Popen(cti.vgwrap(["x3270if", "-u", path, "Set(startTls)"]),
+                stdout=PIPE)
+        self.children.append(x3270if)
+        stdout = x3270if.communicate()[0].decode()
+        self.vgwait(x3270if)
+        self.assertEqual('true\n', stdout)
+
+        # Interleave two clients. Each gets its own responses, in order.
+        a = self.mux_client(path, b'Set(startTls)\nFoo()\n')
+        b = self.mux_client(path, b'Set(monoCase)\n')
+        a_out = self.mux_responses(a)
+        b_out = self.mux_responses(b)
+        self.assertEqual(6, len(a_out))
+        self.assertEqual(['data: true', 'ok'], [a_out[0], a_out[2]])
+        self.assertEqual('error', a_out[5])
+        self.assertEqual(3, len(b_out))
+        self.assertEqual(['data: false', 'ok'], [b_out[0], b_out[2]])
+
+        # Stop the multiplexer. It cleans up and reports timing.
+        mux.send_signal(signal.SIGTERM)
+        stderr = mux.communicate()[1].decode()
+        self.vgwait(mux)
+        self.assertFalse(os.path.exists(path))
+        lines = stderr.splitlines()
+        self.assertEqual(5, len(lines))
+        self.assertRegex(lines[0], r'^x3270if: \[1\] [0-9.]+ ms ok Capabilities\(errd\) Set\(startTls\)$')
+        self.assertRegex(lines[4], r'^x3270if: 4 commands, [0-9.]+ ms mean, [0-9.]+ ms max$')
+
+        s3270.kill()
+        self.children.remove(s3270)
+        s3270.wait()
+
+if __name__ == '__main__':
+    unittest.main()